@@ -0,0 +1,275 @@
+"""Banc de mesure des handlers HTTP de la mangeoire (ESP32 ou émulateur).
+Usage:
+  python bench_client.py --url http://10.0.0.76 --target stream,status --duration 10
+Optionnel:
+  --clients 2 --json resultats.json
+
+Cibles: stream, capture, still, status, control. Pour chaque cible: débit (req/s ou
+images/s), octets reçus, latences p50/p95/p99. Si /metrics est disponible, les compteurs de
+l'appareil (images perdues, échecs de capture, durée moyenne par étape) sont relevés
+avant/après pour isoler le coût côté firmware. Avec la cible still (photos haute
+résolution), /api/still donne en fin de run la latence des bascules et les images perdues:
+  python bench_client.py --target stream,still --duration 20
+Les allocations par image ou par requête se mesurent sur l'hôte, sans carte :
+host/bench/handler_bench.cpp (lancé par ctest, voir host/CMakeLists.txt).
+"""
+
+from __future__ import annotations
+import argparse
+import json
+import sys
+import threading
+import time
+from typing import Dict, List, Optional
+
+try:
+    import requests  # type: ignore
+except ImportError:  # pragma: no cover
+    print("Le module 'requests' est requis. Installez-le: pip install requests")
+    sys.exit(1)
+
+DEFAULT_URL = "http://10.0.0.76"
+TARGETS = ("stream", "capture", "still", "status", "control")
+
+
+class Result:
+    def __init__(self, target: str):
+        self.target = target
+        self.count = 0
+        self.errors = 0
+        self.bytes = 0
+        self.latencies: List[float] = []
+        self.codes: Dict[int, int] = {}
+        self.lock = threading.Lock()
+
+    def add(self, latency: float, size: int, code: int = 200) -> None:
+        with self.lock:
+            self.count += 1
+            self.bytes += size
+            self.latencies.append(latency)
+            self.codes[code] = self.codes.get(code, 0) + 1
+
+    def error(self) -> None:
+        with self.lock:
+            self.errors += 1
+
+    def summary(self, duration: float) -> dict:
+        lat = sorted(self.latencies)
+        return {
+            "target": self.target,
+            "count": self.count,
+            "errors": self.errors,
+            "rate": self.count / duration if duration else 0.0,
+            "bytes": self.bytes,
+            "bytes_per_s": self.bytes / duration if duration else 0.0,
+            "bytes_per_item": self.bytes / self.count if self.count else 0.0,
+            "p50_ms": _percentile(lat, 0.50) * 1000,
+            "p95_ms": _percentile(lat, 0.95) * 1000,
+            "p99_ms": _percentile(lat, 0.99) * 1000,
+            "codes": self.codes,
+        }
+
+
+def _percentile(values: List[float], q: float) -> float:
+    if not values:
+        return 0.0
+    return values[min(len(values) - 1, int(q * (len(values) - 1) + 0.5))]
+
+
+def bench_stream(base: str, result: Result, stop: float, timeout: int) -> None:
+    """Lit le flux MJPEG et mesure l'intervalle entre images (Content-Length des parts)."""
+    try:
+        resp = requests.get(base + "/stream", stream=True, timeout=timeout)
+    except requests.RequestException:  # type: ignore
+        result.error()
+        return
+    raw = resp.raw
+    last = time.perf_counter()
+    try:
+        while time.perf_counter() < stop:
+            length = None
+            line = raw.readline()
+            while line and line not in (b"\r\n", b"\n"):
+                if line.lower().startswith(b"content-length:"):
+                    length = int(line.split(b":", 1)[1])
+                line = raw.readline()
+            if not line:
+                break
+            if length is None:
+                continue
+            data = raw.read(length)
+            now = time.perf_counter()
+            result.add(now - last, len(data))
+            last = now
+    except Exception:  # noqa: BLE001
+        result.error()
+    finally:
+        resp.close()
+
+
+def bench_request(
+    base: str, target: str, result: Result, stop: float, timeout: int
+) -> None:
+    session = requests.Session()
+    etag: Optional[str] = None
+    quality = 10
+    while time.perf_counter() < stop:
+        headers = {}
+        if target == "capture":
+            url = base + "/capture"
+        elif target == "still":
+            url = base + "/still"
+        elif target == "status":
+            url = base + "/status"
+            if etag:
+                headers["If-None-Match"] = etag
+        else:
+            # Alterne deux valeurs pour forcer une vraie écriture capteur
+            quality = 12 if quality == 10 else 10
+            url = f"{base}/control?var=quality&val={quality}"
+        start = time.perf_counter()
+        try:
+            resp = session.get(url, headers=headers, timeout=timeout)
+        except requests.RequestException:  # type: ignore
+            result.error()
+            continue
+        elapsed = time.perf_counter() - start
+        if resp.status_code in (200, 304):
+            result.add(elapsed, len(resp.content), resp.status_code)
+            etag = resp.headers.get("ETag", etag)
+        else:
+            result.error()
+
+
+def fetch_metrics(base: str, timeout: int) -> Optional[Dict[str, float]]:
+    """Relève /metrics (format texte Prometheus) -> {nom{labels}: valeur}."""
+    try:
+        resp = requests.get(base + "/metrics", timeout=timeout)
+    except requests.RequestException:  # type: ignore
+        return None
+    if resp.status_code != 200:
+        return None
+    values: Dict[str, float] = {}
+    for line in resp.text.splitlines():
+        if not line or line.startswith("#"):
+            continue
+        name, _, value = line.rpartition(" ")
+        try:
+            values[name] = float(value)
+        except ValueError:
+            continue
+    return values
+
+
+def metrics_delta(before: Dict[str, float], after: Dict[str, float]) -> dict:
+    delta = {}
+    for key in (
+        "birdcam_frames_captured_total",
+        "birdcam_frames_sent_total",
+        "birdcam_frames_dropped_total",
+        "birdcam_capture_failures_total",
+        "birdcam_bytes_sent_total",
+    ):
+        if key in after:
+            delta[key] = after[key] - before.get(key, 0.0)
+    # Durée moyenne par étape = delta(sum) / delta(count)
+    for key, value in after.items():
+        if key.startswith("birdcam_stage_seconds_sum"):
+            labels = key[len("birdcam_stage_seconds_sum") :]
+            count_key = "birdcam_stage_seconds_count" + labels
+            n = after.get(count_key, 0.0) - before.get(count_key, 0.0)
+            if n > 0:
+                mean = (value - before.get(key, 0.0)) / n
+                delta["stage_mean_ms" + labels] = mean * 1000
+    for key in ("birdcam_heap_free_bytes", "birdcam_heap_largest_free_block_bytes"):
+        if key in after:
+            delta[key] = after[key]
+    return delta
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Mesurer le débit et la latence des handlers HTTP de la caméra"
+    )
+    parser.add_argument("--url", default=DEFAULT_URL, help="URL de base de la caméra")
+    parser.add_argument(
+        "--target",
+        default="stream",
+        help="Cibles séparées par des virgules: " + ",".join(TARGETS),
+    )
+    parser.add_argument("--duration", type=float, default=10.0, help="Durée (s)")
+    parser.add_argument(
+        "--clients", type=int, default=1, help="Clients simultanés par cible"
+    )
+    parser.add_argument("--timeout", type=int, default=10, help="Timeout requête (s)")
+    parser.add_argument("--json", help="Fichier de sortie JSON (comparaison entre runs)")
+    args = parser.parse_args()
+
+    base = args.url.rstrip("/")
+    targets = [t.strip() for t in args.target.split(",") if t.strip()]
+    for t in targets:
+        if t not in TARGETS:
+            print("Cible inconnue:", t)
+            sys.exit(1)
+
+    before = fetch_metrics(base, args.timeout)
+    results = {t: Result(t) for t in targets}
+    stop = time.perf_counter() + args.duration
+    threads = []
+    for t in targets:
+        for _ in range(args.clients):
+            if t == "stream":
+                fn, fargs = bench_stream, (base, results[t], stop, args.timeout)
+            else:
+                fn, fargs = bench_request, (base, t, results[t], stop, args.timeout)
+            th = threading.Thread(target=fn, args=fargs, daemon=True)
+            th.start()
+            threads.append(th)
+    start = time.perf_counter()
+    for th in threads:
+        th.join(args.duration + args.timeout)
+    duration = time.perf_counter() - start
+    after = fetch_metrics(base, args.timeout)
+
+    report = {
+        "url": base,
+        "duration": duration,
+        "results": [r.summary(duration) for r in results.values()],
+    }
+    for r in report["results"]:
+        print(
+            f"{r['target']:8s} {r['count']:6d} ({r['rate']:.1f}/s) err={r['errors']} "
+            f"{r['bytes_per_s'] / 1024:.1f} KiB/s {r['bytes_per_item']:.0f} o/item "
+            f"p50={r['p50_ms']:.1f}ms p95={r['p95_ms']:.1f}ms p99={r['p99_ms']:.1f}ms "
+            f"codes={r['codes']}"
+        )
+    if before is not None and after is not None:
+        report["device"] = metrics_delta(before, after)
+        print("Appareil (/metrics):")
+        for key, value in report["device"].items():
+            print(f"  {key} = {value:.2f}")
+    else:
+        print("/metrics indisponible: mesures côté client uniquement")
+    if "still" in targets:
+        try:
+            report["still"] = requests.get(base + "/api/still", timeout=args.timeout).json()
+        except (requests.RequestException, ValueError):  # type: ignore
+            report["still"] = None
+        st = report["still"]
+        if st:
+            print(
+                f"Bascules (/api/still): {st['switches']} "
+                f"vers photo avg={st['switch_us']['avg'] / 1000:.1f}ms max={st['switch_us']['max'] / 1000:.1f}ms "
+                f"retour avg={st['back_us']['avg'] / 1000:.1f}ms "
+                f"flux interrompu avg={st['gap_us']['avg'] / 1000:.1f}ms "
+                f"images perdues={st['lost']['total']}"
+            )
+
+    if args.json:
+        with open(args.json, "w", encoding="utf-8") as f:
+            json.dump(report, f, indent=2)
+        print("Résultats écrits dans", args.json)
+
+
+if __name__ == "__main__":
+    main()
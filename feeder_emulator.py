@@ -0,0 +1,367 @@
+"""Emulateur de mangeoires (firmware mangoire_esp32) pour tests de charge du serveur.
+Usage:
+  python feeder_emulator.py --source enregistrement.mjpeg --count 24 --base-port 8100
+Sources acceptées:
+  - enregistrement BCR1 du firmware (curl http://10.0.0.76/api/record > session.bcr
+    après /stream?record=N), rejoué au rythme d'origine avec ses réglages /status
+  - capture brute du flux /stream (ex: curl http://10.0.0.76/stream > rec.mjpeg),
+    rejouée au rythme d'origine grâce aux en-têtes X-Timestamp
+  - répertoire d'images .jpg, rejouées à --fps images/s
+Avec --max-speed, chaque client /stream reçoit les images à la suite, sans attente.
+
+Chaque mangeoire virtuelle écoute sur son propre port et expose la même surface HTTP
+que le firmware: /stream (même découpage _STREAM_PART, X-Timestamp, chunked),
+/capture, /status (ETag/304) et /control. Toutes tournent dans un seul processus.
+"""
+
+from __future__ import annotations
+import argparse
+import asyncio
+import bisect
+import json
+import os
+import re
+import struct
+import sys
+import time
+from typing import Dict, List, Optional, Tuple
+from urllib.parse import parse_qs, urlsplit
+
+PART_BOUNDARY = "123456789000000000000987654321"
+STREAM_CONTENT_TYPE = "multipart/x-mixed-replace;boundary=" + PART_BOUNDARY
+STREAM_BOUNDARY = ("\r\n--" + PART_BOUNDARY + "\r\n").encode()
+STREAM_PART = "Content-Type: image/jpeg\r\nContent-Length: {}\r\nX-Timestamp: {}.{:06d}\r\n\r\n"
+
+# Valeurs initiales de /status (reprend les clés de status_handler)
+DEFAULT_STATUS = {
+    "xclk": 20,
+    "pixformat": 4,
+    "framesize": 8,
+    "quality": 10,
+    "brightness": 0,
+    "contrast": 0,
+    "saturation": 0,
+    "sharpness": 0,
+    "special_effect": 0,
+    "wb_mode": 0,
+    "awb": 1,
+    "awb_gain": 1,
+    "aec": 1,
+    "aec2": 0,
+    "ae_level": 0,
+    "aec_value": 168,
+    "agc": 1,
+    "agc_gain": 0,
+    "gainceiling": 0,
+    "bpc": 0,
+    "wpc": 1,
+    "raw_gma": 1,
+    "lenc": 1,
+    "hmirror": 0,
+    "vflip": 0,
+    "dcw": 1,
+    "colorbar": 0,
+    "led_intensity": -1,
+}
+
+Frame = Tuple[float, bytes]  # (décalage en secondes depuis la 1re image, JPEG)
+Settings = Tuple[float, dict]  # (décalage, document /status enregistré)
+
+# Conteneur BCR1 (voir mangoire_esp32/recorder.h)
+BCR_MAGIC = b"BCR1"
+BCR_SETTINGS = 1
+BCR_FRAME = 2
+BCR_FRAME_HEADER = struct.Struct("<qIII")  # capture_us, fb_get_us, send_us, len
+
+
+def load_bcr(path: str) -> Tuple[List[Frame], List[Settings]]:
+    """Lit un enregistrement BCR1: images horodatées et réglages successifs."""
+    with open(path, "rb") as f:
+        data = f.read()
+    if data[:4] != BCR_MAGIC:
+        raise ValueError("Conteneur BCR1 invalide: " + path)
+    frames: List[Frame] = []
+    settings: List[Settings] = []
+    first_us: Optional[int] = None
+    last_us = 0
+    pos = 8
+    while pos + 8 <= len(data):
+        rtype, length = data[pos], struct.unpack_from("<I", data, pos + 4)[0]
+        payload = data[pos + 8 : pos + 8 + length]
+        pos += 8 + length
+        if rtype == BCR_FRAME:
+            capture_us, _, _, jpeg_len = BCR_FRAME_HEADER.unpack_from(payload)
+            if first_us is None:
+                first_us = capture_us
+            last_us = capture_us
+            frames.append(((capture_us - first_us) / 1e6, payload[BCR_FRAME_HEADER.size :][:jpeg_len]))
+        elif rtype == BCR_SETTINGS:
+            # Les réglages précèdent l'image à laquelle ils s'appliquent
+            offset = (last_us - first_us) / 1e6 if first_us is not None else 0.0
+            settings.append((offset, json.loads(payload.decode())))
+    return frames, settings
+
+
+def load_mjpeg(path: str) -> List[Frame]:
+    """Découpe une capture brute de /stream en images horodatées."""
+    with open(path, "rb") as f:
+        data = f.read()
+    frames: List[Frame] = []
+    header_re = re.compile(rb"Content-Length: (\d+)\r\n(?:X-Timestamp: (\d+)\.(\d+)\r\n)?\r\n")
+    pos = 0
+    first_ts: Optional[float] = None
+    while True:
+        m = header_re.search(data, pos)
+        if not m:
+            break
+        length = int(m.group(1))
+        start = m.end()
+        jpeg = data[start : start + length]
+        if len(jpeg) < length:
+            break
+        if m.group(2) is not None:
+            ts = int(m.group(2)) + int(m.group(3)) / 1e6
+        else:
+            ts = len(frames) / 10.0
+        if first_ts is None:
+            first_ts = ts
+        frames.append((ts - first_ts, jpeg))
+        pos = start + length
+    return frames
+
+
+def load_directory(path: str, fps: float) -> List[Frame]:
+    names = sorted(n for n in os.listdir(path) if n.lower().endswith((".jpg", ".jpeg")))
+    frames: List[Frame] = []
+    for i, name in enumerate(names):
+        with open(os.path.join(path, name), "rb") as f:
+            frames.append((i / fps, f.read()))
+    return frames
+
+
+def load_source(path: str, fps: float) -> Tuple[List[Frame], List[Settings]]:
+    if os.path.isdir(path):
+        return load_directory(path, fps), []
+    with open(path, "rb") as f:
+        if f.read(4) == BCR_MAGIC:
+            return load_bcr(path)
+    return load_mjpeg(path), []
+
+
+class Feeder:
+    """Une mangeoire virtuelle: horloge de lecture propre, réglages et serveur HTTP."""
+
+    def __init__(
+        self, index: int, port: int, frames: List[Frame], offset: float,
+        settings: List[Settings], max_speed: bool = False
+    ):
+        self.index = index
+        self.port = port
+        self.frames = frames
+        self.offsets = [off for off, _ in frames]
+        self.settings = settings
+        self.max_speed = max_speed
+        # Durée d'une boucle: dernière image + intervalle moyen
+        last = frames[-1][0]
+        self.period = last + (last / (len(frames) - 1) if len(frames) > 1 else 0.1)
+        self.t0 = time.monotonic() - offset
+        self.status = dict(DEFAULT_STATUS)
+        if settings:
+            self.status.update(settings[0][1])
+        self.applied = 0
+        self.version = 0
+        self.boot_id = int(time.time() * 1000) & 0xFFFFFFFF
+        self.boot = time.monotonic()
+        self.stats = {"stream_clients": 0, "frames_sent": 0, "bytes_sent": 0}
+
+    def uptime(self) -> float:
+        # Comme fb->timestamp sur l'ESP32: temps depuis le démarrage
+        return time.monotonic() - self.boot
+
+    def etag(self) -> str:
+        return f'"{self.boot_id:08x}-{self.version}"'
+
+    def frame_at(self, now: float) -> Tuple[int, float]:
+        """Index de l'image courante et heure (monotonic) de la suivante."""
+        elapsed = now - self.t0
+        loop, pos = divmod(elapsed, self.period)
+        idx = max(0, bisect.bisect_right(self.offsets, pos) - 1)
+        if idx + 1 < len(self.frames):
+            next_at = self.t0 + loop * self.period + self.frames[idx + 1][0]
+        else:
+            next_at = self.t0 + (loop + 1) * self.period
+        return idx, next_at
+
+    async def handle(self, reader: asyncio.StreamReader, writer: asyncio.StreamWriter):
+        try:
+            while True:
+                request = await reader.readuntil(b"\r\n\r\n")
+                lines = request.decode("latin-1").split("\r\n")
+                method, target, _ = lines[0].split(" ", 2)
+                headers = {}
+                for line in lines[1:]:
+                    if ":" in line:
+                        k, v = line.split(":", 1)
+                        headers[k.strip().lower()] = v.strip()
+                length = int(headers.get("content-length", "0") or 0)
+                if length:
+                    await reader.readexactly(length)
+                url = urlsplit(target)
+                query = {k: v[0] for k, v in parse_qs(url.query).items()}
+                if url.path == "/stream" and method == "GET":
+                    await self.stream(writer)
+                    return
+                status, ctype, body, extra = self.route(method, url.path, query, headers)
+                await self.respond(writer, status, ctype, body, extra)
+                if headers.get("connection", "").lower() == "close":
+                    return
+        except (asyncio.IncompleteReadError, ConnectionError, ValueError):
+            pass
+        finally:
+            writer.close()
+
+    def route(self, method: str, path: str, query: Dict[str, str], headers: Dict[str, str]):
+        if path == "/capture" and method == "GET":
+            idx, _ = self.frame_at(time.monotonic())
+            ts = self.uptime()
+            extra = {
+                "Content-Disposition": "inline; filename=capture.jpg",
+                "X-Timestamp": f"{int(ts)}.{int((ts % 1) * 1e6):06d}",
+            }
+            return "200 OK", "image/jpeg", self.frames[idx][1], extra
+        if path == "/status" and method == "GET":
+            self.apply_recorded_settings()
+            etag = self.etag()
+            extra = {"ETag": etag, "Cache-Control": "no-cache"}
+            if headers.get("if-none-match") == etag:
+                return "304 Not Modified", "application/json", b"", extra
+            body = json.dumps(self.status, separators=(",", ":")).encode()
+            return "200 OK", "application/json", body, extra
+        if path == "/control" and method == "GET":
+            var, val = query.get("var"), query.get("val")
+            if var is None or val is None:
+                return "404 Not Found", "text/plain", b"Not Found", {}
+            if var not in self.status:
+                return "500 Internal Server Error", "text/plain", b"", {}
+            self.status[var] = int(val)
+            self.version += 1
+            return "200 OK", "text/html", b"", {}
+        return "404 Not Found", "text/plain", b"Not Found", {}
+
+    def apply_recorded_settings(self):
+        """Suit les changements de réglages enregistrés (source BCR1)."""
+        if len(self.settings) <= 1:
+            return
+        pos = (time.monotonic() - self.t0) % self.period
+        current = max(0, bisect.bisect_right([off for off, _ in self.settings], pos) - 1)
+        if current != self.applied:
+            self.applied = current
+            self.status.update(self.settings[current][1])
+            self.version += 1
+
+    async def respond(self, writer, status: str, ctype: str, body: bytes, extra: Dict[str, str]):
+        head = [f"HTTP/1.1 {status}", f"Content-Type: {ctype}", f"Content-Length: {len(body)}"]
+        head.append("Access-Control-Allow-Origin: *")
+        head += [f"{k}: {v}" for k, v in extra.items()]
+        writer.write(("\r\n".join(head) + "\r\n\r\n").encode() + body)
+        await writer.drain()
+
+    async def send_chunk(self, writer, data: bytes):
+        # Un appel httpd_resp_send_chunk = un chunk HTTP
+        writer.write(f"{len(data):x}\r\n".encode() + data + b"\r\n")
+        await writer.drain()
+
+    async def stream(self, writer):
+        head = [
+            "HTTP/1.1 200 OK",
+            "Content-Type: " + STREAM_CONTENT_TYPE,
+            "Transfer-Encoding: chunked",
+            "Access-Control-Allow-Origin: *",
+            "X-Framerate: 60",
+        ]
+        writer.write(("\r\n".join(head) + "\r\n\r\n").encode())
+        self.stats["stream_clients"] += 1
+        seq = 0
+        try:
+            while True:
+                if self.max_speed:
+                    # Relecture au débit maximal: images à la suite, seul l'envoi limite
+                    idx, next_at = seq % len(self.frames), 0.0
+                    seq += 1
+                else:
+                    idx, next_at = self.frame_at(time.monotonic())
+                jpeg = self.frames[idx][1]
+                ts = self.uptime()
+                part = STREAM_PART.format(len(jpeg), int(ts), int((ts % 1) * 1e6))
+                await self.send_chunk(writer, STREAM_BOUNDARY)
+                await self.send_chunk(writer, part.encode())
+                await self.send_chunk(writer, jpeg)
+                self.stats["frames_sent"] += 1
+                self.stats["bytes_sent"] += len(jpeg)
+                await asyncio.sleep(max(0.0, next_at - time.monotonic()))
+        finally:
+            self.stats["stream_clients"] -= 1
+
+
+async def report(feeders: List[Feeder], interval: float):
+    last = {f.port: 0 for f in feeders}
+    while True:
+        await asyncio.sleep(interval)
+        clients = sum(f.stats["stream_clients"] for f in feeders)
+        frames = sum(f.stats["frames_sent"] - last[f.port] for f in feeders)
+        last = {f.port: f.stats["frames_sent"] for f in feeders}
+        print(f"[emulateur] {len(feeders)} mangeoires, {clients} flux actifs, {frames / interval:.1f} images/s")
+
+
+async def run(args, frames: List[Frame], settings: List[Settings]):
+    feeders = []
+    servers = []
+    for i in range(args.count):
+        port = args.base_port + i
+        # Décalage de lecture pour que les mangeoires ne soient pas synchrones
+        offset = (i * 7.919) % max(frames[-1][0], 0.001) if args.desync else 0.0
+        feeder = Feeder(i, port, frames, offset, settings, args.max_speed)
+        server = await asyncio.start_server(feeder.handle, args.host, port)
+        feeders.append(feeder)
+        servers.append(server)
+    print(
+        f"{len(feeders)} mangeoires sur {args.host}:{args.base_port}-{args.base_port + args.count - 1} "
+        f"({len(frames)} images, boucle de {feeders[0].period:.1f}s)"
+    )
+    tasks = [asyncio.create_task(s.serve_forever()) for s in servers]
+    if args.report > 0:
+        tasks.append(asyncio.create_task(report(feeders, args.report)))
+    await asyncio.gather(*tasks)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Emuler une ou plusieurs mangeoires ESP32")
+    parser.add_argument("--source", "-s", required=True, help="Enregistrement .bcr, capture .mjpeg ou répertoire de .jpg")
+    parser.add_argument("--count", "-n", type=int, default=1, help="Nombre de mangeoires")
+    parser.add_argument("--base-port", type=int, default=8100, help="Port de la 1re mangeoire")
+    parser.add_argument("--host", default="0.0.0.0", help="Adresse d'écoute")
+    parser.add_argument("--fps", type=float, default=10.0, help="Cadence pour un répertoire de .jpg")
+    parser.add_argument("--no-desync", dest="desync", action="store_false", help="Toutes les mangeoires en phase")
+    parser.add_argument("--max-speed", action="store_true", help="Flux au débit maximal (ignore le rythme d'origine)")
+    parser.add_argument("--report", type=float, default=10.0, help="Intervalle du résumé (s), 0 = aucun")
+    args = parser.parse_args()
+
+    if not os.path.exists(args.source):
+        print("Source introuvable:", args.source)
+        sys.exit(1)
+    try:
+        frames, settings = load_source(args.source, args.fps)
+    except ValueError as exc:
+        print(exc)
+        sys.exit(1)
+    if not frames:
+        print("Aucune image trouvée dans", args.source)
+        sys.exit(1)
+    try:
+        asyncio.run(run(args, frames, settings))
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,50 @@
+#include "alloc_count.h"
+#include <atomic>
+
+extern "C"
+{
+  void *__libc_malloc(size_t size);
+  void *__libc_calloc(size_t n, size_t size);
+  void *__libc_realloc(void *ptr, size_t size);
+  void __libc_free(void *ptr);
+}
+
+static std::atomic<uint64_t> alloc_count(0);
+static std::atomic<uint64_t> alloc_bytes(0);
+
+static inline void alloc_add(size_t size)
+{
+  alloc_count.fetch_add(1, std::memory_order_relaxed);
+  alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+extern "C" void *malloc(size_t size)
+{
+  alloc_add(size);
+  return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t n, size_t size)
+{
+  alloc_add(n * size);
+  return __libc_calloc(n, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+  alloc_add(size);
+  return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void *ptr)
+{
+  __libc_free(ptr);
+}
+
+alloc_stats_t alloc_stats()
+{
+  alloc_stats_t s;
+  s.count = alloc_count.load(std::memory_order_relaxed);
+  s.bytes = alloc_bytes.load(std::memory_order_relaxed);
+  return s;
+}
@@ -0,0 +1,14 @@
+#pragma once
+// Compteurs d'allocations du processus : malloc, calloc, realloc (et donc new) sont
+// remplacés par des versions qui comptent avant d'appeler la glibc. Tous les threads
+// sont comptés (tâches httpd, flux, log...).
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct
+{
+  uint64_t count; // Allocations (realloc compris)
+  uint64_t bytes; // Octets demandés
+} alloc_stats_t;
+
+alloc_stats_t alloc_stats();
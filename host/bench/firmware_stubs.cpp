@@ -0,0 +1,27 @@
+// Modules du firmware non compilés sur l'hôte (WiFi, client HTTP de visite, LittleFS) :
+// seules les fonctions appelées par les modules compilés sont fournies.
+#include "config_utils.h"
+#include "visit_capture.h"
+#include "wifi_connect.h"
+
+bool loadConfig(JsonDocument &doc, const char *filename)
+{
+  return false;
+}
+
+// Pas d'association : chemin "none"
+void wifi_connect_write(json_writer_t *w)
+{
+  json_begin_object(w);
+  json_kv_str(w, "path", "none");
+  json_end_object(w);
+}
+
+// Démarrage normal, sans rafale de visite
+void visit_write(json_writer_t *w)
+{
+  json_begin_object(w);
+  json_kv_bool(w, "wakeup", false);
+  json_kv_uint(w, "frames", 0);
+  json_end_object(w);
+}
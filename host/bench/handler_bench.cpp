@@ -0,0 +1,458 @@
+/*
+Banc hôte des handlers HTTP (mangoire_esp32/app_httpd.cpp) : le serveur tourne sur le
+faux esp_http_server et la fausse caméra de host/shim, sans carte ni réseau.
+Pour chaque handler : débit, allocations et octets envoyés par image (/stream) ou par
+requête ; /capture compte les 150 ms d'allumage de la LED du firmware. Lancé par ctest avec --quick (voir host/CMakeLists.txt) ; le code de sortie est
+non nul si un handler répond mal ou dépasse son budget d'allocations.
+
+  handler_bench [--quick] [--frames N] [--requests N] [--fps F] [--jpeg-dir DIR]
+*/
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include "alloc_count.h"
+#include "boot_phase.h"
+#include "camera_window.h"
+#include "esp_camera.h"
+#include "fake_camera.h"
+#include "fake_httpd.h"
+#include "log_ring.h"
+#include "sensor_lock.h"
+#include "settings_store.h"
+#include "still_capture.h"
+#include "task_topology.h"
+
+void startCameraServer();
+void camera_settings_restore();
+
+// Budgets d'allocations par unité (image ou requête) : un dépassement signale une
+// allocation ajoutée sur le chemin chaud. Mesuré : /stream 0,3 (copie de la requête et
+// tâche, amorties sur 40 images), /capture et /status 0, /control 1.
+#define BUDGET_STREAM_ALLOCS 0.5
+#define BUDGET_CAPTURE_ALLOCS 0.5
+#define BUDGET_STATUS_ALLOCS 0.5
+#define BUDGET_STATUS_304_ALLOCS 0.5
+#define BUDGET_CONTROL_ALLOCS 1.5
+
+#define BENCH_MAX_STREAMS 2 // Clients /stream simultanés au plus
+
+static int failures = 0;
+
+#define CHECK(cond)                                                     \
+  do                                                                    \
+  {                                                                     \
+    if (!(cond))                                                        \
+    {                                                                   \
+      fprintf(stderr, "%s:%d: échec: %s\n", __FILE__, __LINE__, #cond); \
+      failures++;                                                       \
+    }                                                                   \
+  } while (0)
+
+typedef struct
+{
+  const char *name;
+  uint32_t units;    // Images ou requêtes
+  int64_t us;        // Durée totale
+  alloc_stats_t alloc;
+  uint64_t bytes;    // Octets de corps envoyés
+  uint32_t sends;    // Envois httpd
+} bench_result_t;
+
+typedef struct
+{
+  alloc_stats_t alloc;
+  int64_t us;
+  uint32_t frames;
+} bench_mark_t;
+
+static bench_mark_t bench_mark()
+{
+  bench_mark_t m;
+  m.alloc = alloc_stats();
+  m.us = esp_timer_get_time();
+  m.frames = fake_camera_frames();
+  return m;
+}
+
+static void bench_close(bench_result_t *r, const bench_mark_t *start)
+{
+  bench_mark_t end = bench_mark();
+  r->us = end.us - start->us;
+  r->alloc.count = end.alloc.count - start->alloc.count;
+  r->alloc.bytes = end.alloc.bytes - start->alloc.bytes;
+}
+
+static void bench_print(const bench_result_t *r)
+{
+  double n = r->units ? r->units : 1;
+  printf("%-16s %8u %10.1f %10.2f %12.1f %12.1f %8.2f\n", r->name, r->units, r->us ? r->units * 1e6 / r->us : 0.0, r->alloc.count / n, r->alloc.bytes / n, r->bytes / n, r->sends / n);
+}
+
+static std::string header_value(const std::string &headers, const char *name)
+{
+  std::string key = std::string(name) + ": ";
+  size_t pos = headers.find(key);
+  if (pos == std::string::npos)
+  {
+    return "";
+  }
+  pos += key.size();
+  return headers.substr(pos, headers.find('\n', pos) - pos);
+}
+
+static fake_httpd_req_t bench_get(const char *uri, const char *headers = NULL)
+{
+  fake_httpd_req_t req = {};
+  req.method = HTTP_GET;
+  req.uri = uri;
+  req.headers = headers;
+  return req;
+}
+
+// `count` requêtes identiques, chacune vérifiée par son statut attendu
+static bench_result_t bench_requests(const char *name, const fake_httpd_req_t *req, uint32_t count, int expected_status)
+{
+  bench_result_t r = {};
+  r.name = name;
+  fake_httpd_resp_t resp;
+  fake_httpd_request(req, &resp); // Réponse dimensionnée hors mesure
+  bench_mark_t start = bench_mark();
+  for (uint32_t i = 0; i < count; i++)
+  {
+    fake_httpd_request(req, &resp);
+    if (resp.status != expected_status)
+    {
+      fprintf(stderr, "%s: statut %d (attendu %d) %s\n", req->uri, resp.status, expected_status, resp.body.c_str());
+      failures++;
+      break;
+    }
+    r.units++;
+    r.bytes += resp.bytes;
+    r.sends += resp.sends;
+  }
+  bench_close(&r, &start);
+  return r;
+}
+
+// Un client /stream qui ferme après `frames` images d'environ `frame_len` octets
+static void stream_client(uint32_t frames, size_t frame_len, fake_httpd_resp_t *resp)
+{
+  fake_httpd_req_t req = bench_get("/stream");
+  req.close_after = (uint64_t)frames * (frame_len + 128);
+  fake_httpd_request(&req, resp);
+}
+
+static bench_result_t bench_stream(const char *name, int clients, uint32_t frames, size_t frame_len)
+{
+  bench_result_t r = {};
+  r.name = name;
+  fake_httpd_resp_t resp[BENCH_MAX_STREAMS];
+  std::thread threads[BENCH_MAX_STREAMS];
+  bench_mark_t start = bench_mark();
+  for (int i = 0; i < clients; i++)
+  {
+    threads[i] = std::thread(stream_client, frames, frame_len, &resp[i]);
+  }
+  for (int i = 0; i < clients; i++)
+  {
+    threads[i].join();
+  }
+  bench_close(&r, &start);
+  for (int i = 0; i < clients; i++)
+  {
+    CHECK(resp[i].status == 200);
+    CHECK(resp[i].async);
+    CHECK(resp[i].type.find("multipart/x-mixed-replace") == 0);
+    r.bytes += resp[i].bytes;
+    r.sends += resp[i].sends;
+  }
+  // Images livrées par la caméra : chaque client prend les siennes
+  r.units = fake_camera_frames() - start.frames;
+  CHECK(r.units > 0);
+  return r;
+}
+
+// Attend que la caméra ait livré au moins une image de plus que `frames`
+static void wait_camera_frames(uint32_t frames)
+{
+  while (fake_camera_frames() <= frames)
+  {
+    delay(1);
+  }
+}
+
+// /api/bench/camera : balayage dans sa propre tâche, exclusif avec /stream
+static void check_camera_sweep(size_t frame_len)
+{
+  fake_camera_set_fps(50);
+  fake_httpd_req_t sweep = bench_get("/api/bench/camera?fs=8&q=12&frames=5");
+  fake_httpd_resp_t resp;
+
+  fake_httpd_resp_t stream_resp;
+  uint32_t frames = fake_camera_frames();
+  std::thread stream(stream_client, 10, frame_len, &stream_resp);
+  wait_camera_frames(frames);
+  fake_httpd_request(&sweep, &resp);
+  CHECK(resp.status == 503);
+  stream.join();
+
+  fake_httpd_resp_t sweep_resp;
+  frames = fake_camera_frames();
+  std::thread bench(fake_httpd_request, &sweep, &sweep_resp);
+  wait_camera_frames(frames);
+  fake_httpd_req_t live = bench_get("/stream");
+  fake_httpd_request(&live, &resp);
+  CHECK(resp.status == 503);
+  bench.join();
+  CHECK(sweep_resp.status == 200);
+  CHECK(sweep_resp.async);
+  CHECK(sweep_resp.body.find("\"fps\":") != std::string::npos);
+
+  // Capteur à PLL : balayage refusé sans préréglage d'origine, sinon rétabli à la fin
+  sensor_t *s = esp_camera_sensor_get();
+  uint16_t pid = s->id.PID;
+  s->id.PID = OV3660_PID;
+  fake_httpd_req_t pll = bench_get("/api/bench/camera?pll=4,6&frames=2");
+  fake_httpd_request(&pll, &resp);
+  CHECK(resp.status == 400);
+  pll = bench_get("/api/bench/camera?pll=4,6&frames=2&restore=0,29,1,0,0,0,1,8");
+  fake_httpd_request(&pll, &resp);
+  CHECK(resp.status == 200);
+  CHECK(resp.body.find("\"pll\":6") != std::string::npos);
+  CHECK(resp.body.find("\"pll_restored\":29") != std::string::npos);
+  CHECK(fake_camera_pll_mul() == 29);
+  s->id.PID = pid;
+  fake_camera_set_fps(0);
+}
+
+// Une photo passe par la taille photo puis revient : /status change d'ETag et ne garde
+// pas la framesize de la photo
+static void check_still_status()
+{
+  fake_camera_set_fps(50);
+  fake_httpd_req_t status = bench_get("/status");
+  fake_httpd_resp_t before, after;
+  fake_httpd_request(&status, &before);
+  // Réussie ou non (images de synthèse plus grosses que l'emplacement), la bascule a eu lieu
+  still_info_t info;
+  still_capture(1, &info);
+  CHECK(info.switch_us > 0);
+  fake_httpd_request(&status, &after);
+  CHECK(after.status == 200);
+  CHECK(header_value(after.headers, "ETag") != header_value(before.headers, "ETag"));
+  CHECK(after.body.find("\"framesize\":8,") != std::string::npos);
+  fake_camera_set_fps(0);
+}
+
+// /api/bench/net : les deux sens passent par une tâche admise comme un flux ; le
+// serveur rend la main tout de suite, le rapport reflète la mesure
+static void check_net_bench()
+{
+  fake_httpd_req_t down = bench_get("/api/bench/net?bytes=100000&chunk=4096");
+  fake_httpd_resp_t resp;
+  fake_httpd_request(&down, &resp);
+  CHECK(resp.status == 200);
+  CHECK(resp.async);
+  CHECK(resp.bytes == 100000);
+  std::string body(50000, 'x');
+  fake_httpd_req_t up = {};
+  up.method = HTTP_POST;
+  up.uri = "/api/bench/net";
+  up.body = body.c_str();
+  up.body_len = body.size();
+  fake_httpd_request(&up, &resp);
+  CHECK(resp.status == 200);
+  CHECK(resp.async);
+  CHECK(resp.body.find("\"direction\":\"upload\",\"bytes\":50000") != std::string::npos);
+  fake_httpd_req_t admission = bench_get("/api/admission");
+  fake_httpd_request(&admission, &resp);
+  CHECK(resp.body.find("\"streams\":0") != std::string::npos);
+}
+
+static std::string status_etag()
+{
+  fake_httpd_req_t status = bench_get("/status");
+  fake_httpd_resp_t resp;
+  fake_httpd_request(&status, &resp);
+  return header_value(resp.headers, "ETag");
+}
+
+// Suivi de l'oiseau : /status change quand la fenêtre bouge ou est rendue, pas quand
+// l'oiseau reste dans la même fenêtre
+static void check_window_follow()
+{
+  settings_set(SET_PRESENCE_FOLLOW, 1);
+  presence_position_t pos = {.valid = true, .x = 500, .y = 500, .mm = 120};
+  std::string etag = status_etag();
+  camera_window_follow(&pos);
+  CHECK(camera_window_get(NULL));
+  std::string following = status_etag();
+  CHECK(following != etag);
+  camera_window_follow(&pos);
+  CHECK(status_etag() == following);
+  pos.valid = false;
+  camera_window_follow(&pos);
+  CHECK(!camera_window_get(NULL));
+  CHECK(status_etag() != following);
+  settings_set(SET_PRESENCE_FOLLOW, 0);
+}
+
+static void bench_check_budget(const bench_result_t *r, double budget)
+{
+  double per_unit = r->units ? (double)r->alloc.count / r->units : 0;
+  if (per_unit > budget)
+  {
+    fprintf(stderr, "%s: %.2f allocations par unité, budget %.2f\n", r->name, per_unit, budget);
+    failures++;
+  }
+}
+
+static void usage()
+{
+  fprintf(stderr, "usage: handler_bench [--quick] [--frames N] [--requests N] [--fps F] [--jpeg-dir DIR]\n");
+  _exit(2);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t frames = 300;
+  uint32_t requests = 500;
+  int fps = 0;
+  const char *jpeg_dir = NULL;
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--quick"))
+    {
+      frames = 40;
+      requests = 50;
+    }
+    else if (i + 1 < argc && !strcmp(argv[i], "--frames"))
+    {
+      frames = atoi(argv[++i]);
+    }
+    else if (i + 1 < argc && !strcmp(argv[i], "--requests"))
+    {
+      requests = atoi(argv[++i]);
+    }
+    else if (i + 1 < argc && !strcmp(argv[i], "--fps"))
+    {
+      fps = atoi(argv[++i]);
+    }
+    else if (i + 1 < argc && !strcmp(argv[i], "--jpeg-dir"))
+    {
+      jpeg_dir = argv[++i];
+    }
+    else
+    {
+      usage();
+    }
+  }
+  if (!frames || !requests)
+  {
+    usage();
+  }
+  if (!fake_camera_source(jpeg_dir))
+  {
+    fprintf(stderr, "%s: aucun JPEG lisible\n", jpeg_dir);
+    _exit(2);
+  }
+  fake_camera_set_fps(fps);
+
+  // Séquence de setup() et boot_camera_task (mangoire_esp32.ino), sans WiFi ni LittleFS
+  boot_phase_init();
+  sensor_lock_init();
+  settings_init();
+  task_topology_load();
+  log_ring_init();
+  CHECK(esp_camera_init(NULL) == ESP_OK);
+  sensor_t *s = esp_camera_sensor_get();
+  still_init(FRAMESIZE_UXGA);
+  s->set_framesize(s, FRAMESIZE_VGA);
+  camera_settings_restore();
+  boot_signal(BOOT_READY_FS | BOOT_READY_CAMERA | BOOT_DONE_CAMERA);
+  startCameraServer();
+
+  // Chauffe : images de synthèse encodées, caches et tampons des handlers alloués
+  fake_httpd_req_t capture = bench_get("/capture");
+  fake_httpd_req_t status = bench_get("/status");
+  fake_httpd_req_t control = bench_get("/control?var=quality&val=12");
+  fake_httpd_resp_t resp;
+  fake_httpd_request(&capture, &resp);
+  CHECK(resp.status == 200);
+  CHECK(resp.type == "image/jpeg");
+  size_t frame_len = resp.bytes;
+  CHECK(frame_len > 0);
+  fake_httpd_request(&control, &resp);
+  CHECK(resp.status == 200);
+  fake_httpd_request(&status, &resp);
+  CHECK(resp.status == 200);
+  CHECK(resp.body.find("\"quality\":12") != std::string::npos);
+  std::string etag = header_value(resp.headers, "ETag");
+  CHECK(!etag.empty());
+  CHECK(resp.body.find("admission") == std::string::npos);
+  fake_httpd_req_t admission = bench_get("/api/admission");
+  fake_httpd_request(&admission, &resp);
+  CHECK(resp.status == 200);
+  CHECK(resp.body.find("\"streams\":0") != std::string::npos);
+  // Le schéma dépasse 64 réglages : les derniers figurent aussi dans la configuration complète
+  fake_httpd_req_t config = bench_get("/api/config");
+  fake_httpd_request(&config, &resp);
+  CHECK(resp.status == 200);
+  CHECK(resp.body.find("\"task_visit\":{\"core\":-1") != std::string::npos);
+  CHECK(resp.body.find("\"trigger\":false") != std::string::npos);
+  // Corps refusé par http_body_json : le 400 est compté comme tel dans /metrics
+  fake_httpd_req_t bad_config = {};
+  bad_config.method = HTTP_POST;
+  bad_config.uri = "/api/config";
+  bad_config.body = "{";
+  bad_config.body_len = 1;
+  fake_httpd_request(&bad_config, &resp);
+  CHECK(resp.status == 400);
+  // Client qui annonce un corps puis se tait : 408 après quelques délais, pas d'attente sans fin
+  bad_config.content_len = 64;
+  fake_httpd_request(&bad_config, &resp);
+  CHECK(resp.status == 408);
+  fake_httpd_req_t metrics = bench_get("/metrics");
+  fake_httpd_resp_t metrics_resp;
+  fake_httpd_request(&metrics, &metrics_resp);
+  CHECK(metrics_resp.status == 200);
+  CHECK(metrics_resp.body.find("birdcam_http_requests_total{uri=\"/api/config\",status=\"400\"} 1") != std::string::npos);
+  std::string inm = "If-None-Match: " + etag + "\n";
+  fake_httpd_req_t status_304 = bench_get("/status", inm.c_str());
+  bench_result_t warm = bench_stream("warmup", 1, 4, frame_len);
+  (void)warm;
+
+  bench_result_t results[6];
+  results[0] = bench_stream("/stream", 1, frames, frame_len);
+  results[1] = bench_stream("/stream x2", 2, frames, frame_len);
+  results[2] = bench_requests("/capture", &capture, requests, 200);
+  results[3] = bench_requests("/status", &status, requests, 200);
+  results[4] = bench_requests("/status 304", &status_304, requests, 304);
+  results[5] = bench_requests("/control", &control, requests, 200);
+
+  printf("%-16s %8s %10s %10s %12s %12s %8s\n", "handler", "unités", "unités/s", "allocs/u", "alloc o/u", "envoyés o/u", "envois/u");
+  for (const bench_result_t &r : results)
+  {
+    bench_print(&r);
+  }
+
+  bench_check_budget(&results[0], BUDGET_STREAM_ALLOCS);
+  bench_check_budget(&results[2], BUDGET_CAPTURE_ALLOCS);
+  bench_check_budget(&results[3], BUDGET_STATUS_ALLOCS);
+  bench_check_budget(&results[4], BUDGET_STATUS_304_ALLOCS);
+  bench_check_budget(&results[5], BUDGET_CONTROL_ALLOCS);
+  check_camera_sweep(frame_len);
+  check_still_status();
+  check_window_follow();
+  check_net_bench();
+
+  // Les tâches du firmware (threads détachés) tournent encore : pas de destructeurs statiques
+  fflush(stdout);
+  fflush(stderr);
+  _exit(failures ? 1 : 0);
+}
@@ -0,0 +1,311 @@
+/*
+Banc hôte de la découpe JPEG de /capture?crop= (mangoire_esp32/jpeg_crop.cpp),
+construit avec les autres cibles de host/CMakeLists.txt.
+Usage:
+  ./jpeg_crop_bench image.jpg [x,y,w,h] [répétitions]
+  ./jpeg_crop_bench --synth 1600x1200 [x,y,w,h] [répétitions]
+
+Compare, sur le même rectangle:
+  - la découpe dans le domaine compressé (jpeg_crop, code du firmware);
+  - décodage complet + découpe + réencodage (libjpeg, qualité --quality, 85 par
+    défaut, proche de la qualité 12 du capteur).
+Pour chaque méthode: durée moyenne, octets produits et PSNR contre la découpe de
+l'image source décodée (sur-échantillonnage simple pour que les bords de chroma
+ne dépendent pas des pixels voisins). La découpe sans perte doit donner inf : le
+code de sortie est non nul sinon. ctest la vérifie sur des images --synth.
+Avec --synth, une image de test est générée (4:2:0, DRI toutes les 8 MCU avec
+--dri, 4:2:2 avec --422).
+*/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include <jpeglib.h> // Après stdio.h (FILE, size_t)
+#include "jpeg_crop.h"
+
+typedef std::vector<uint8_t> bytes_t;
+
+typedef struct
+{
+  int w, h;
+  bytes_t rgb;
+} image_t;
+
+static double now_us()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static bool decode(const bytes_t &jpg, image_t *img)
+{
+  struct jpeg_decompress_struct cinfo;
+  struct jpeg_error_mgr jerr;
+  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_decompress(&cinfo);
+  jpeg_mem_src(&cinfo, jpg.data(), jpg.size());
+  if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK)
+  {
+    jpeg_destroy_decompress(&cinfo);
+    return false;
+  }
+  cinfo.out_color_space = JCS_RGB;
+  cinfo.do_fancy_upsampling = FALSE;
+  cinfo.dct_method = JDCT_ISLOW;
+  jpeg_start_decompress(&cinfo);
+  img->w = cinfo.output_width;
+  img->h = cinfo.output_height;
+  img->rgb.resize((size_t)img->w * img->h * 3);
+  while (cinfo.output_scanline < cinfo.output_height)
+  {
+    JSAMPROW row = &img->rgb[(size_t)cinfo.output_scanline * img->w * 3];
+    jpeg_read_scanlines(&cinfo, &row, 1);
+  }
+  jpeg_finish_decompress(&cinfo);
+  jpeg_destroy_decompress(&cinfo);
+  return true;
+}
+
+static bytes_t encode(const image_t &img, int quality, int h_samp, int v_samp, int restart)
+{
+  struct jpeg_compress_struct cinfo;
+  struct jpeg_error_mgr jerr;
+  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_compress(&cinfo);
+  unsigned char *buf = NULL;
+  unsigned long len = 0;
+  jpeg_mem_dest(&cinfo, &buf, &len);
+  cinfo.image_width = img.w;
+  cinfo.image_height = img.h;
+  cinfo.input_components = 3;
+  cinfo.in_color_space = JCS_RGB;
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, quality, TRUE);
+  cinfo.comp_info[0].h_samp_factor = h_samp;
+  cinfo.comp_info[0].v_samp_factor = v_samp;
+  cinfo.restart_interval = restart;
+  jpeg_start_compress(&cinfo, TRUE);
+  while (cinfo.next_scanline < cinfo.image_height)
+  {
+    JSAMPROW row = (JSAMPROW)&img.rgb[(size_t)cinfo.next_scanline * img.w * 3];
+    jpeg_write_scanlines(&cinfo, &row, 1);
+  }
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+  bytes_t out(buf, buf + len);
+  free(buf);
+  return out;
+}
+
+static image_t crop_pixels(const image_t &img, const jpeg_rect_t &r)
+{
+  image_t out;
+  out.w = r.w;
+  out.h = r.h;
+  out.rgb.resize((size_t)r.w * r.h * 3);
+  for (int y = 0; y < r.h; y++)
+  {
+    memcpy(&out.rgb[(size_t)y * r.w * 3], &img.rgb[((size_t)(r.y + y) * img.w + r.x) * 3], (size_t)r.w * 3);
+  }
+  return out;
+}
+
+static double psnr(const image_t &a, const image_t &b)
+{
+  if (a.w != b.w || a.h != b.h)
+  {
+    return -1;
+  }
+  double se = 0;
+  for (size_t i = 0; i < a.rgb.size(); i++)
+  {
+    double d = (double)a.rgb[i] - b.rgb[i];
+    se += d * d;
+  }
+  return se ? 10 * log10(255.0 * 255.0 * a.rgb.size() / se) : INFINITY;
+}
+
+// Mangeoire de synthèse : dégradés, damier et bruit, assez de détail pour les AC
+static image_t synth(int w, int h)
+{
+  image_t img;
+  img.w = w;
+  img.h = h;
+  img.rgb.resize((size_t)w * h * 3);
+  srand(1);
+  for (int y = 0; y < h; y++)
+  {
+    for (int x = 0; x < w; x++)
+    {
+      uint8_t *p = &img.rgb[((size_t)y * w + x) * 3];
+      int check = ((x / 37) ^ (y / 29)) & 1 ? 60 : 0;
+      p[0] = (x * 255 / w + check + rand() % 24) & 0xFF;
+      p[1] = (y * 255 / h + rand() % 24) & 0xFF;
+      p[2] = ((x + y) * 128 / (w + h) + check * 2) & 0xFF;
+    }
+  }
+  return img;
+}
+
+static bool load(const char *path, bytes_t *out)
+{
+  FILE *f = fopen(path, "rb");
+  if (!f)
+  {
+    return false;
+  }
+  uint8_t buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+  {
+    out->insert(out->end(), buf, buf + n);
+  }
+  fclose(f);
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  const char *path = NULL;
+  const char *synth_size = NULL;
+  const char *rect_arg = NULL;
+  const char *save = NULL;
+  int reps = 50;
+  int quality = 85;
+  int restart = 0;
+  int v_samp = 2;
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--synth") && i + 1 < argc)
+    {
+      synth_size = argv[++i];
+    }
+    else if (!strcmp(argv[i], "--quality") && i + 1 < argc)
+    {
+      quality = atoi(argv[++i]);
+    }
+    else if (!strcmp(argv[i], "--save") && i + 1 < argc)
+    {
+      save = argv[++i];
+    }
+    else if (!strcmp(argv[i], "--dri"))
+    {
+      restart = 8;
+    }
+    else if (!strcmp(argv[i], "--422"))
+    {
+      v_samp = 1;
+    }
+    else if (!path && !synth_size && argv[i][0] != '-')
+    {
+      path = argv[i];
+    }
+    else if (!rect_arg && strchr(argv[i], ','))
+    {
+      rect_arg = argv[i];
+    }
+    else if (atoi(argv[i]) > 0)
+    {
+      reps = atoi(argv[i]);
+    }
+  }
+
+  bytes_t src;
+  if (synth_size)
+  {
+    int w = 0, h = 0;
+    if (sscanf(synth_size, "%dx%d", &w, &h) != 2 || w <= 0 || h <= 0)
+    {
+      fprintf(stderr, "Taille invalide: %s\n", synth_size);
+      return 1;
+    }
+    src = encode(synth(w, h), quality, 2, v_samp, restart);
+  }
+  else if (!path || !load(path, &src))
+  {
+    fprintf(stderr, "Usage: %s image.jpg|--synth WxH [x,y,w,h] [répétitions] [--quality Q] [--dri] [--422] [--save crop.jpg]\n", argv[0]);
+    return 1;
+  }
+
+  image_t full;
+  if (!decode(src, &full))
+  {
+    fprintf(stderr, "JPEG source illisible\n");
+    return 1;
+  }
+  jpeg_rect_t rect = {(uint16_t)(full.w / 4), (uint16_t)(full.h / 3), (uint16_t)(full.w / 2), (uint16_t)(full.h / 2)};
+  if (rect_arg)
+  {
+    unsigned x, y, w, h;
+    if (sscanf(rect_arg, "%u,%u,%u,%u", &x, &y, &w, &h) != 4)
+    {
+      fprintf(stderr, "Rectangle invalide: %s\n", rect_arg);
+      return 1;
+    }
+    rect = {(uint16_t)x, (uint16_t)y, (uint16_t)w, (uint16_t)h};
+  }
+  printf("Source: %dx%d, %zu octets, rectangle %u,%u %ux%u, %d répétitions\n", full.w, full.h, src.size(), rect.x, rect.y, rect.w, rect.h, reps);
+
+  // Découpe dans le domaine compressé
+  bytes_t out(src.size() + JPEG_CROP_SLACK(src.size()));
+  size_t out_len = 0;
+  jpeg_rect_t actual = {};
+  double t0 = now_us();
+  jpeg_crop_err_t err = JPEG_CROP_OK;
+  for (int i = 0; i < reps && err == JPEG_CROP_OK; i++)
+  {
+    err = jpeg_crop(src.data(), src.size(), &rect, out.data(), out.size(), &out_len, &actual);
+  }
+  double crop_us = (now_us() - t0) / reps;
+  if (err != JPEG_CROP_OK)
+  {
+    fprintf(stderr, "jpeg_crop: %s\n", jpeg_crop_strerror(err));
+    return 1;
+  }
+  out.resize(out_len);
+  image_t ref = crop_pixels(full, actual);
+  image_t got;
+  if (!decode(out, &got))
+  {
+    fprintf(stderr, "Sortie de jpeg_crop illisible\n");
+    return 1;
+  }
+  if (save)
+  {
+    FILE *f = fopen(save, "wb");
+    if (f)
+    {
+      fwrite(out.data(), 1, out.size(), f);
+      fclose(f);
+    }
+  }
+
+  // Décodage + découpe + réencodage, sur le même rectangle aligné
+  bytes_t reenc;
+  t0 = now_us();
+  for (int i = 0; i < reps; i++)
+  {
+    image_t dec;
+    decode(src, &dec);
+    reenc = encode(crop_pixels(dec, actual), quality, 2, v_samp, 0);
+  }
+  double reenc_us = (now_us() - t0) / reps;
+  image_t reenc_img;
+  decode(reenc, &reenc_img);
+
+  printf("Rectangle aligné MCU: %u,%u %ux%u\n", actual.x, actual.y, actual.w, actual.h);
+  printf("%-24s %10s %10s %8s\n", "méthode", "µs", "octets", "PSNR dB");
+  printf("%-24s %10.0f %10zu %8.2f\n", "jpeg_crop (compressé)", crop_us, out.size(), psnr(ref, got));
+  printf("%-24s %10.0f %10zu %8.2f\n", "décodage+réencodage", reenc_us, reenc.size(), psnr(ref, reenc_img));
+  printf("Gain: x%.1f\n", reenc_us / crop_us);
+  if (!isinf(psnr(ref, got)))
+  {
+    fprintf(stderr, "jpeg_crop: découpe avec perte\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,227 @@
+/*
+Banc hôte des statistiques en flux (mangoire_esp32/stream_stats.h) : coût par valeur de
+chaque statistique, taille d'une instance (une par client /stream et par étape), et
+erreur des quantiles de LogHistogram face au quantile exact. Référence : ra_filter_t,
+la moyenne glissante remplacée (tableau alloué, recopiée ici), et le quantile exact par
+nth_element sur les 100 valeurs d'une période de journalisation du flux.
+Lancé par ctest avec --quick (voir host/CMakeLists.txt) ; le code de sortie est non nul
+si une erreur de quantile dépasse la borne de l'histogramme (1/2^SubBits).
+
+  stream_stats_bench [--quick] [--values N]
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "stream_stats.h"
+
+#define BENCH_WINDOW 20          // STREAM_AVG_FRAMES (app_httpd.cpp)
+#define BENCH_PERIOD 100         // STREAM_STATS_PERIOD : valeurs par calcul de quantiles
+#define BENCH_SAMPLES (1 << 16)  // Durées de synthèse, rejouées en boucle
+#define BENCH_QUANTILE_ERROR 0.25 // LogHistogram<2> : borne haute du seau, au plus +25 %
+
+static int failures = 0;
+
+#define CHECK(cond)                                                     \
+  do                                                                    \
+  {                                                                     \
+    if (!(cond))                                                        \
+    {                                                                   \
+      fprintf(stderr, "%s:%d: échec: %s\n", __FILE__, __LINE__, #cond); \
+      failures++;                                                       \
+    }                                                                   \
+  } while (0)
+
+// ra_filter_t du CameraWebServer d'origine, pour comparaison
+typedef struct
+{
+  size_t size;
+  size_t index;
+  size_t count;
+  int sum;
+  int *values;
+} ra_filter_t;
+
+static ra_filter_t *ra_filter_init(ra_filter_t *filter, size_t sample_size)
+{
+  memset(filter, 0, sizeof(ra_filter_t));
+  filter->values = (int *)calloc(sample_size, sizeof(int));
+  if (!filter->values)
+  {
+    return NULL;
+  }
+  filter->size = sample_size;
+  return filter;
+}
+
+static int ra_filter_run(ra_filter_t *filter, int value)
+{
+  filter->sum -= filter->values[filter->index];
+  filter->values[filter->index] = value;
+  filter->sum += filter->values[filter->index];
+  filter->index++;
+  filter->index = filter->index % filter->size;
+  if (filter->count < filter->size)
+  {
+    filter->count++;
+  }
+  return filter->sum / filter->count;
+}
+
+typedef struct
+{
+  const char *name;
+  size_t size; // Octets par instance
+  uint64_t ops;
+  double ns;
+} bench_result_t;
+
+static std::vector<uint32_t> samples;
+static volatile uint64_t sink; // Empêche le compilateur de supprimer les boucles mesurées
+
+// Durées d'image en µs : log-normale autour de 50 ms, avec une queue (images lentes)
+static void bench_samples()
+{
+  std::mt19937 rng(42);
+  std::lognormal_distribution<double> dist(std::log(50000.0), 0.35);
+  samples.resize(BENCH_SAMPLES);
+  for (uint32_t &v : samples)
+  {
+    double d = dist(rng);
+    v = d > 1e7 ? 10000000 : (uint32_t)d;
+  }
+}
+
+static double now_ns()
+{
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// `fn(v)` pour `n` valeurs rejouées depuis samples
+template <typename F>
+static bench_result_t bench_run(const char *name, size_t size, uint64_t n, F fn)
+{
+  uint64_t acc = 0;
+  double t0 = now_ns();
+  for (uint64_t i = 0; i < n; i++)
+  {
+    acc += fn(samples[i & (BENCH_SAMPLES - 1)]);
+  }
+  double t1 = now_ns();
+  sink = acc;
+  return {name, size, n, n ? (t1 - t0) / n : 0};
+}
+
+static void bench_print(const bench_result_t *r)
+{
+  printf("%-24s %10.2f %10zu\n", r->name, r->ns, r->size);
+}
+
+// Quantiles de l'histogramme face au quantile exact (tri) sur les mêmes valeurs
+static void check_quantiles(size_t n)
+{
+  LogHistogram<> h;
+  std::vector<uint32_t> sorted(samples.begin(), samples.begin() + n);
+  for (uint32_t v : sorted)
+  {
+    h.add(v);
+  }
+  std::sort(sorted.begin(), sorted.end());
+  static const float qs[] = {0.5f, 0.95f, 0.99f};
+  for (float q : qs)
+  {
+    uint32_t exact = sorted[(size_t)(q * (n - 1))];
+    uint32_t est = h.quantile(q);
+    double err = exact ? ((double)est - exact) / exact : 0;
+    printf("p%-3d sur %6zu valeurs : exact %8u, histogramme %8u (%+.1f %%)\n", (int)(q * 100 + 0.5f), n, exact, est, err * 100);
+    CHECK(est >= exact);
+    CHECK(err <= BENCH_QUANTILE_ERROR);
+  }
+}
+
+static void usage()
+{
+  fprintf(stderr, "usage: stream_stats_bench [--quick] [--values N]\n");
+  exit(2);
+}
+
+int main(int argc, char **argv)
+{
+  uint64_t values = 20000000;
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--quick"))
+    {
+      values = 200000;
+    }
+    else if (!strcmp(argv[i], "--values") && i + 1 < argc)
+    {
+      values = strtoull(argv[++i], NULL, 10);
+    }
+    else
+    {
+      usage();
+    }
+  }
+  bench_samples();
+
+  ra_filter_t ra;
+  CHECK(ra_filter_init(&ra, BENCH_WINDOW) != NULL);
+  WindowMean<uint32_t, BENCH_WINDOW> window;
+  Ewma ewma(0.1f);
+  MinMax<uint32_t> minmax;
+  LogHistogram<> hist;
+  for (uint32_t v : samples)
+  {
+    hist.add(v);
+  }
+  std::vector<uint32_t> period(BENCH_PERIOD);
+
+  bench_result_t results[] = {
+      bench_run("ra_filter_t (réf.)", sizeof(ra) + BENCH_WINDOW * sizeof(int), values, [&](uint32_t v) { return (uint64_t)ra_filter_run(&ra, v); }),
+      bench_run("WindowMean<u32,20>", sizeof(window), values, [&](uint32_t v) { return (uint64_t)window.add(v); }),
+      bench_run("Ewma", sizeof(ewma), values, [&](uint32_t v) { return (uint64_t)ewma.add(v); }),
+      bench_run("MinMax<u32>", sizeof(minmax), values, [&](uint32_t v) {
+        minmax.add(v);
+        return (uint64_t)minmax.max();
+      }),
+      bench_run("LogHistogram::add", sizeof(hist), values, [&](uint32_t v) {
+        hist.add(v);
+        return (uint64_t)hist.count();
+      }),
+      // Une période de journalisation : p50, p95 et p99
+      bench_run("LogHistogram p50/95/99", sizeof(hist), values / BENCH_PERIOD, [&](uint32_t v) {
+        return (uint64_t)hist.quantile(0.5f) + hist.quantile(0.95f) + hist.quantile(0.99f) + (v & 1);
+      }),
+      // Même période par sélection exacte sur les 100 dernières valeurs (copie + 3 nth_element)
+      bench_run("exact p50/95/99 (réf.)", BENCH_PERIOD * sizeof(uint32_t), values / BENCH_PERIOD, [&](uint32_t v) {
+        size_t base = v & (BENCH_SAMPLES - BENCH_PERIOD - 1);
+        std::copy(samples.begin() + base, samples.begin() + base + BENCH_PERIOD, period.begin());
+        uint64_t s = 0;
+        static const size_t ranks[] = {BENCH_PERIOD / 2, BENCH_PERIOD * 95 / 100, BENCH_PERIOD * 99 / 100};
+        for (size_t r : ranks)
+        {
+          std::nth_element(period.begin(), period.begin() + r, period.end());
+          s += period[r];
+        }
+        return s;
+      }),
+  };
+  free(ra.values);
+
+  printf("%-24s %10s %10s\n", "statistique", "ns/appel", "octets");
+  for (const bench_result_t &r : results)
+  {
+    bench_print(&r);
+  }
+
+  check_quantiles(BENCH_PERIOD);
+  check_quantiles(BENCH_SAMPLES);
+  return failures ? 1 : 0;
+}
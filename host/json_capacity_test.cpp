@@ -0,0 +1,146 @@
+/*
+Capacités des documents ArduinoJson calculées par le firmware, vérifiées contre la vraie
+bibliothèque : le substitut de host/shim n'analyse rien et ne peut pas manquer de place.
+Construit seulement si ARDUINOJSON_DIR désigne les sources d'ArduinoJson 6 (voir
+host/CMakeLists.txt) ; les emplacements y ont la taille de l'hôte, les calculs du
+firmware passant par JSON_OBJECT_SIZE / JSON_ARRAY_SIZE suivent.
+*/
+
+#include <ArduinoJson.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "json_capacity.h"
+#include "settings_store.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                     \
+  do                                                                    \
+  {                                                                     \
+    if (!(cond))                                                        \
+    {                                                                   \
+      fprintf(stderr, "%s:%d: échec: %s\n", __FILE__, __LINE__, #cond); \
+      failures++;                                                       \
+    }                                                                   \
+  } while (0)
+
+typedef struct
+{
+  const char *group;
+  const char *name;
+  setting_type_t type;
+  int32_t min;
+  int32_t max;
+} setting_row_t;
+
+#define SETTING_ROW(id, group, name, nvs, type, def, min, max) {group, name, type, min, max},
+static const setting_row_t setting_rows[] = {SETTINGS_SCHEMA(SETTING_ROW)};
+#undef SETTING_ROW
+
+// Document de GET /api/config au pire : chaînes et secrets à leur longueur maximale
+static std::string settings_full_config()
+{
+  std::string json = "{";
+  const char *open = NULL;
+  for (const setting_row_t &r : setting_rows)
+  {
+    if (!open || strcmp(open, r.group))
+    {
+      json += open ? "}," : "";
+      json += "\"" + std::string(r.group) + "\":{";
+      open = r.group;
+    }
+    else
+    {
+      json += ",";
+    }
+    json += "\"" + std::string(r.name) + "\":";
+    if (r.type == SETTING_STR || r.type == SETTING_SECRET)
+    {
+      json += "\"" + std::string(r.max, 'x') + "\"";
+    }
+    else
+    {
+      json += std::to_string(r.min < 0 ? r.min : r.max);
+    }
+  }
+  return json + "}}";
+}
+
+// PATCH /api/config avec le document complet : filtre et document de config_patch_handler
+static void test_settings_patch()
+{
+  DynamicJsonDocument filter(SETTINGS_JSON_FILTER_SIZE);
+  for (const setting_row_t &r : setting_rows)
+  {
+    filter[r.group] = true;
+  }
+  CHECK(!filter.overflowed());
+
+  std::string json = settings_full_config();
+  DynamicJsonDocument doc(SETTINGS_JSON_DOC_SIZE);
+  DeserializationError err = deserializeJson(doc, json.c_str(), DeserializationOption::Filter(filter));
+  if (err)
+  {
+    fprintf(stderr, "PATCH complet : %s (capacité %zu)\n", err.c_str(), (size_t)SETTINGS_JSON_DOC_SIZE);
+  }
+  CHECK(!err);
+  CHECK(doc.size() == settings_group_total(false));
+  CHECK(doc["wifi"]["password"].as<std::string>().size() == 63);
+}
+
+#define REGS_TEST_ENTRIES 1024 // REGS_MAX_COUNT (app_httpd.cpp)
+
+static void test_json_array_count()
+{
+  CHECK(json_array_count("") == 0);
+  CHECK(json_array_count("{\"a\":1}") == 0);
+  CHECK(json_array_count(" [ ] ") == 0);
+  CHECK(json_array_count("[1]") == 1);
+  CHECK(json_array_count("[[1,2,3],[4,5,6]]") == 2);
+  CHECK(json_array_count("[\"a,b\",\"c\\\"]\"]") == 2);
+  CHECK(json_array_count("[{\"a\":[1,2]},3]") == 2);
+}
+
+// POST /api/regs : entrées au pire (registres sur 16 bits) et corps compact, sans espaces
+static void test_regs_post()
+{
+  std::string body = "[";
+  for (int i = 0; i < REGS_TEST_ENTRIES; i++)
+  {
+    body += i ? ",[65535,255,255]" : "[65535,255,255]";
+  }
+  body += "]";
+  size_t entries = json_array_count(body.c_str());
+  CHECK(entries == REGS_TEST_ENTRIES);
+  // Même appel que regs_post_handler : tampon modifiable (sans copie des chaînes)
+  DynamicJsonDocument doc(JSON_TABLE_SIZE(entries, 3));
+  DeserializationError err = deserializeJson(doc, &body[0]);
+  if (err)
+  {
+    fprintf(stderr, "POST /api/regs : %s\n", err.c_str());
+  }
+  CHECK(!err);
+  CHECK(doc.size() == REGS_TEST_ENTRIES);
+  CHECK(doc[REGS_TEST_ENTRIES - 1][2].as<int>() == 255);
+
+  // Entrée de quatre valeurs : NoMemory, signalé à part par le handler
+  char wide[] = "[[1,2,3,4]]";
+  DynamicJsonDocument small(JSON_TABLE_SIZE(json_array_count(wide), 3));
+  CHECK(deserializeJson(small, wide) == DeserializationError::NoMemory);
+}
+
+int main()
+{
+  test_settings_patch();
+  test_json_array_count();
+  test_regs_post();
+  if (failures)
+  {
+    fprintf(stderr, "%d vérification(s) en échec\n", failures);
+    return 1;
+  }
+  printf("json_capacity : OK\n");
+  return 0;
+}
@@ -0,0 +1,45 @@
+#pragma once
+// Sous-ensemble du cœur Arduino ESP32 utilisé par le firmware
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp32-hal-ledc.h"
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+bool psramFound();
+char *itoa(int value, char *str, int base); // newlib, absent de la glibc
+
+// Serial écrit sur stderr, sauf si BENCH_QUIET est défini dans l'environnement
+class HardwareSerial
+{
+public:
+  void begin(unsigned long baud) {}
+  void setDebugOutput(bool en) {}
+  size_t write(const uint8_t *buf, size_t len);
+  size_t print(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+  size_t println(const char *s = "") { return print(s) + print("\n"); }
+  size_t printf(const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+};
+
+extern HardwareSerial Serial;
+
+class EspClass
+{
+public:
+  uint32_t getFreeHeap() { return heap_caps_get_free_size(MALLOC_CAP_INTERNAL); }
+  uint32_t getFreePsram() { return heap_caps_get_free_size(MALLOC_CAP_SPIRAM); }
+  uint32_t getPsramSize() { return 4 * 1024 * 1024; }
+  void restart();
+};
+
+extern EspClass ESP;
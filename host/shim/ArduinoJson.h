@@ -0,0 +1,297 @@
+#pragma once
+// ArduinoJson 6 réduit à ce que le firmware compile : aucun analyseur, tout document est
+// vide et deserializeJson() consomme l'entrée puis répond InvalidInput. Les handlers à
+// corps JSON (/api/config, /api/net, /api/tasks, /api/logs, /regs) répondent donc 400
+// sur l'hôte ; les handlers mesurés par le banc n'en ont pas.
+#include <stddef.h>
+#include <stdint.h>
+
+// Capacités comme ArduinoJson 6 sur ESP32 : un emplacement de 16 octets par valeur
+#define JSON_ARRAY_SIZE(n) ((n) * 16)
+#define JSON_OBJECT_SIZE(n) ((n) * 16)
+
+class JsonString
+{
+public:
+  const char *c_str() const
+  {
+    return "";
+  }
+};
+
+class JsonVariantConst;
+class JsonObjectConst;
+class JsonPairConst;
+class JsonPair;
+class JsonObject;
+class JsonArray;
+
+class JsonVariantConst
+{
+public:
+  bool isNull() const
+  {
+    return true;
+  }
+  template <typename T>
+  bool is() const
+  {
+    return false;
+  }
+  template <typename T>
+  T as() const
+  {
+    return T();
+  }
+  JsonVariantConst operator[](const char *key) const
+  {
+    return JsonVariantConst();
+  }
+  JsonVariantConst operator[](int index) const
+  {
+    return JsonVariantConst();
+  }
+};
+
+class JsonVariant : public JsonVariantConst
+{
+public:
+  JsonVariant operator[](const char *key)
+  {
+    return JsonVariant();
+  }
+  JsonVariant operator[](int index)
+  {
+    return JsonVariant();
+  }
+  template <typename T>
+  JsonVariant &operator=(const T &value)
+  {
+    return *this;
+  }
+};
+
+class JsonPairConst
+{
+public:
+  JsonString key() const
+  {
+    return JsonString();
+  }
+  JsonVariantConst value() const
+  {
+    return JsonVariantConst();
+  }
+};
+
+class JsonPair
+{
+public:
+  JsonString key() const
+  {
+    return JsonString();
+  }
+  JsonVariant value() const
+  {
+    return JsonVariant();
+  }
+};
+
+class JsonObjectConst
+{
+public:
+  JsonObjectConst()
+  {
+  }
+  JsonObjectConst(JsonVariantConst v)
+  {
+  }
+  const JsonPairConst *begin() const
+  {
+    return NULL;
+  }
+  const JsonPairConst *end() const
+  {
+    return NULL;
+  }
+  JsonVariantConst operator[](const char *key) const
+  {
+    return JsonVariantConst();
+  }
+};
+
+class JsonObject
+{
+public:
+  JsonObject()
+  {
+  }
+  JsonObject(JsonVariant v)
+  {
+  }
+  JsonPair *begin() const
+  {
+    return NULL;
+  }
+  JsonPair *end() const
+  {
+    return NULL;
+  }
+};
+
+class JsonArray
+{
+public:
+  JsonArray()
+  {
+  }
+  JsonArray(JsonVariant v)
+  {
+  }
+  bool isNull() const
+  {
+    return true;
+  }
+  size_t size() const
+  {
+    return 0;
+  }
+  JsonVariant *begin() const
+  {
+    return NULL;
+  }
+  JsonVariant *end() const
+  {
+    return NULL;
+  }
+  JsonVariant operator[](int index) const
+  {
+    return JsonVariant();
+  }
+};
+
+class JsonDocument
+{
+public:
+  explicit JsonDocument(size_t capacity = 0) : capacity_(capacity)
+  {
+  }
+  size_t capacity() const
+  {
+    return capacity_;
+  }
+  JsonVariant operator[](const char *key)
+  {
+    return JsonVariant();
+  }
+  JsonVariantConst operator[](const char *key) const
+  {
+    return JsonVariantConst();
+  }
+  template <typename T>
+  bool is() const
+  {
+    return false;
+  }
+  template <typename T>
+  T as() const
+  {
+    return T();
+  }
+  size_t size() const
+  {
+    return 0;
+  }
+  void clear()
+  {
+  }
+
+private:
+  size_t capacity_;
+};
+
+class DynamicJsonDocument : public JsonDocument
+{
+public:
+  explicit DynamicJsonDocument(size_t capacity) : JsonDocument(capacity)
+  {
+  }
+};
+
+template <size_t N>
+class StaticJsonDocument : public JsonDocument
+{
+public:
+  StaticJsonDocument() : JsonDocument(N)
+  {
+  }
+};
+
+class DeserializationError
+{
+public:
+  enum Code
+  {
+    Ok,
+    EmptyInput,
+    IncompleteInput,
+    InvalidInput,
+    NoMemory,
+    TooDeep
+  };
+  DeserializationError(Code c = Ok) : code_(c)
+  {
+  }
+  explicit operator bool() const
+  {
+    return code_ != Ok;
+  }
+  bool operator==(Code c) const
+  {
+    return code_ == c;
+  }
+  const char *c_str() const
+  {
+    return code_ == Ok ? "Ok" : "InvalidInput";
+  }
+
+private:
+  Code code_;
+};
+
+namespace DeserializationOption
+{
+  class Filter
+  {
+  public:
+    explicit Filter(const JsonDocument &doc)
+    {
+    }
+  };
+}
+
+inline DeserializationError deserializeJson(JsonDocument &doc, const char *input)
+{
+  return DeserializationError::InvalidInput;
+}
+
+inline DeserializationError deserializeJson(JsonDocument &doc, char *input)
+{
+  return DeserializationError::InvalidInput;
+}
+
+// Lecteur en flux (read() < 0 en fin de corps) : vidé pour laisser la connexion propre
+template <typename Reader>
+DeserializationError deserializeJson(JsonDocument &doc, Reader &reader)
+{
+  while (reader.read() >= 0)
+  {
+  }
+  return DeserializationError::InvalidInput;
+}
+
+template <typename Reader>
+DeserializationError deserializeJson(JsonDocument &doc, Reader &reader, DeserializationOption::Filter filter)
+{
+  return deserializeJson(doc, reader);
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include <stdint.h>
+
+class WiFiClass
+{
+public:
+  int8_t RSSI() { return 0; }
+  bool getSleep() { return false; }
+};
+
+extern WiFiClass WiFi;
@@ -0,0 +1,393 @@
+// Fausse caméra esp32-camera : images JPEG prêtes à l'emploi (fichiers ou synthèse
+// libjpeg), servies à la cadence du capteur depuis FAKE_CAMERA_FB_COUNT tampons.
+#include "esp_camera.h"
+#include "img_converters.h"
+#include "fake_camera.h"
+#include "esp_timer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <dirent.h>
+#include <mutex>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include <jpeglib.h> // Après stdio.h (FILE, size_t)
+
+#define FAKE_CAMERA_WAIT_MS 4000 // Délai du pilote avant un fb_get NULL
+
+typedef std::vector<uint8_t> bytes_t;
+
+const resolution_info_t resolution[FRAMESIZE_INVALID] = {
+    {96, 96, 0},     {160, 120, 0},   {176, 144, 0},   {240, 176, 0},  {240, 240, 0},   {320, 240, 0},
+    {400, 296, 0},   {480, 320, 0},   {640, 480, 0},   {800, 600, 0},  {1024, 768, 0},  {1280, 720, 0},
+    {1280, 1024, 0}, {1600, 1200, 0}, {1920, 1080, 0}, {720, 1280, 0}, {864, 1536, 0},  {2048, 1536, 0},
+    {2560, 1440, 0}, {2560, 1600, 0}, {1080, 1920, 0}, {2560, 1920, 0},
+};
+
+static std::mutex cam_mutex;
+static std::condition_variable cam_cv;
+static camera_fb_t cam_fbs[FAKE_CAMERA_FB_COUNT];
+static bool cam_fb_used[FAKE_CAMERA_FB_COUNT];
+static std::vector<bytes_t> cam_files;
+static std::vector<bytes_t> cam_synth[FRAMESIZE_INVALID];
+static uint32_t cam_next = 0;
+static int cam_period_us = 0;
+static int64_t cam_next_us = 0;
+static std::atomic<uint32_t> cam_frames(0);
+static bool cam_ready = false;
+
+static sensor_t cam_sensor;
+static uint8_t cam_regs[0x10000];
+
+// Mangeoire de synthèse : dégradés, damier décalé à chaque image et bruit
+static bytes_t synth_encode(int w, int h, int seed)
+{
+  std::vector<uint8_t> rgb((size_t)w * h * 3);
+  srand(seed + 1);
+  for (int y = 0; y < h; y++)
+  {
+    for (int x = 0; x < w; x++)
+    {
+      uint8_t *p = &rgb[((size_t)y * w + x) * 3];
+      int check = (((x + seed * 7) / 37) ^ (y / 29)) & 1 ? 60 : 0;
+      p[0] = (x * 255 / w + check + rand() % 24) & 0xFF;
+      p[1] = (y * 255 / h + rand() % 24) & 0xFF;
+      p[2] = ((x + y) * 128 / (w + h) + check * 2) & 0xFF;
+    }
+  }
+  struct jpeg_compress_struct cinfo;
+  struct jpeg_error_mgr jerr;
+  cinfo.err = jpeg_std_error(&jerr);
+  jpeg_create_compress(&cinfo);
+  unsigned char *buf = NULL;
+  unsigned long len = 0;
+  jpeg_mem_dest(&cinfo, &buf, &len);
+  cinfo.image_width = w;
+  cinfo.image_height = h;
+  cinfo.input_components = 3;
+  cinfo.in_color_space = JCS_RGB;
+  jpeg_set_defaults(&cinfo);
+  jpeg_set_quality(&cinfo, FAKE_CAMERA_QUALITY, TRUE);
+  cinfo.comp_info[0].h_samp_factor = 2; // 4:2:2 comme l'OV2640
+  cinfo.comp_info[0].v_samp_factor = 1;
+  jpeg_start_compress(&cinfo, TRUE);
+  while (cinfo.next_scanline < cinfo.image_height)
+  {
+    JSAMPROW row = (JSAMPROW)&rgb[(size_t)cinfo.next_scanline * w * 3];
+    jpeg_write_scanlines(&cinfo, &row, 1);
+  }
+  jpeg_finish_compress(&cinfo);
+  jpeg_destroy_compress(&cinfo);
+  bytes_t out(buf, buf + len);
+  free(buf);
+  return out;
+}
+
+static bool load_file(const std::string &path, bytes_t *out)
+{
+  FILE *f = fopen(path.c_str(), "rb");
+  if (!f)
+  {
+    return false;
+  }
+  uint8_t buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+  {
+    out->insert(out->end(), buf, buf + n);
+  }
+  fclose(f);
+  return out->size() > 4 && (*out)[0] == 0xFF && (*out)[1] == 0xD8;
+}
+
+bool fake_camera_source(const char *dir)
+{
+  std::lock_guard<std::mutex> lock(cam_mutex);
+  cam_files.clear();
+  if (!dir)
+  {
+    return true;
+  }
+  DIR *d = opendir(dir);
+  if (!d)
+  {
+    return false;
+  }
+  std::vector<std::string> names;
+  while (struct dirent *e = readdir(d))
+  {
+    size_t n = strlen(e->d_name);
+    if (n > 4 && (!strcasecmp(e->d_name + n - 4, ".jpg") || (n > 5 && !strcasecmp(e->d_name + n - 5, ".jpeg"))))
+    {
+      names.push_back(e->d_name);
+    }
+  }
+  closedir(d);
+  std::sort(names.begin(), names.end());
+  for (const std::string &name : names)
+  {
+    bytes_t data;
+    if (load_file(std::string(dir) + "/" + name, &data))
+    {
+      cam_files.push_back(std::move(data));
+    }
+  }
+  return !cam_files.empty();
+}
+
+void fake_camera_set_fps(int fps)
+{
+  std::lock_guard<std::mutex> lock(cam_mutex);
+  cam_period_us = fps > 0 ? 1000000 / fps : 0;
+  cam_next_us = 0;
+}
+
+uint32_t fake_camera_frames()
+{
+  return cam_frames.load();
+}
+
+// Image suivante de la source, sous cam_mutex
+static const bytes_t *next_frame(framesize_t fs)
+{
+  if (!cam_files.empty())
+  {
+    return &cam_files[cam_next++ % cam_files.size()];
+  }
+  std::vector<bytes_t> &synth = cam_synth[fs];
+  if (synth.empty())
+  {
+    for (int i = 0; i < FAKE_CAMERA_SYNTH_FRAMES; i++)
+    {
+      synth.push_back(synth_encode(resolution[fs].width, resolution[fs].height, i));
+    }
+  }
+  return &synth[cam_next++ % synth.size()];
+}
+
+camera_fb_t *esp_camera_fb_get()
+{
+  std::unique_lock<std::mutex> lock(cam_mutex);
+  if (!cam_ready)
+  {
+    return NULL;
+  }
+  int slot = -1;
+  auto free_slot = [&slot]
+  {
+    for (int i = 0; i < FAKE_CAMERA_FB_COUNT; i++)
+    {
+      if (!cam_fb_used[i])
+      {
+        slot = i;
+        return true;
+      }
+    }
+    return false;
+  };
+  if (!cam_cv.wait_for(lock, std::chrono::milliseconds(FAKE_CAMERA_WAIT_MS), free_slot))
+  {
+    return NULL;
+  }
+  cam_fb_used[slot] = true;
+  // Une seule trame en cours de lecture, comme le DMA : les lecteurs se partagent la cadence
+  if (cam_period_us)
+  {
+    int64_t now = esp_timer_get_time();
+    if (cam_next_us < now)
+    {
+      cam_next_us = now;
+    }
+    int64_t due = cam_next_us;
+    cam_next_us += cam_period_us;
+    lock.unlock();
+    std::this_thread::sleep_for(std::chrono::microseconds(due - now));
+    lock.lock();
+  }
+  framesize_t fs = cam_sensor.status.framesize;
+  const bytes_t *frame = next_frame(fs);
+  camera_fb_t *fb = &cam_fbs[slot];
+  fb->buf = (uint8_t *)frame->data();
+  fb->len = frame->size();
+  fb->width = resolution[fs].width;
+  fb->height = resolution[fs].height;
+  fb->format = PIXFORMAT_JPEG;
+  int64_t t = esp_timer_get_time();
+  fb->timestamp.tv_sec = t / 1000000;
+  fb->timestamp.tv_usec = t % 1000000;
+  cam_frames++;
+  return fb;
+}
+
+void esp_camera_fb_return(camera_fb_t *fb)
+{
+  {
+    std::lock_guard<std::mutex> lock(cam_mutex);
+    cam_fb_used[fb - cam_fbs] = false;
+  }
+  cam_cv.notify_one();
+}
+
+sensor_t *esp_camera_sensor_get()
+{
+  return cam_ready ? &cam_sensor : NULL;
+}
+
+static int set_framesize(sensor_t *s, framesize_t fs)
+{
+  if (fs >= FRAMESIZE_INVALID)
+  {
+    return -1;
+  }
+  std::lock_guard<std::mutex> lock(cam_mutex);
+  s->status.framesize = fs;
+  return 0;
+}
+
+#define STATUS_SETTER(name, field)   \
+  static int name(sensor_t *s, int v) \
+  {                                   \
+    s->status.field = v;              \
+    return 0;                         \
+  }
+
+STATUS_SETTER(set_contrast, contrast)
+STATUS_SETTER(set_brightness, brightness)
+STATUS_SETTER(set_saturation, saturation)
+STATUS_SETTER(set_sharpness, sharpness)
+STATUS_SETTER(set_denoise, denoise)
+STATUS_SETTER(set_quality, quality)
+STATUS_SETTER(set_colorbar, colorbar)
+STATUS_SETTER(set_whitebal, awb)
+STATUS_SETTER(set_gain_ctrl, agc)
+STATUS_SETTER(set_exposure_ctrl, aec)
+STATUS_SETTER(set_hmirror, hmirror)
+STATUS_SETTER(set_vflip, vflip)
+STATUS_SETTER(set_aec2, aec2)
+STATUS_SETTER(set_awb_gain, awb_gain)
+STATUS_SETTER(set_agc_gain, agc_gain)
+STATUS_SETTER(set_aec_value, aec_value)
+STATUS_SETTER(set_special_effect, special_effect)
+STATUS_SETTER(set_wb_mode, wb_mode)
+STATUS_SETTER(set_ae_level, ae_level)
+STATUS_SETTER(set_dcw, dcw)
+STATUS_SETTER(set_bpc, bpc)
+STATUS_SETTER(set_wpc, wpc)
+STATUS_SETTER(set_raw_gma, raw_gma)
+STATUS_SETTER(set_lenc, lenc)
+
+static int set_gainceiling(sensor_t *s, gainceiling_t g)
+{
+  s->status.gainceiling = g;
+  return 0;
+}
+
+static int set_pixformat(sensor_t *s, pixformat_t f)
+{
+  return f == PIXFORMAT_JPEG ? 0 : -1;
+}
+
+static int get_reg(sensor_t *s, int reg, int mask)
+{
+  return cam_regs[reg & 0xFFFF] & mask;
+}
+
+static int set_reg(sensor_t *s, int reg, int mask, int value)
+{
+  uint8_t *r = &cam_regs[reg & 0xFFFF];
+  *r = (*r & ~mask) | (value & mask);
+  return 0;
+}
+
+static int set_res_raw(sensor_t *s, int startX, int startY, int endX, int endY, int offsetX, int offsetY, int totalX, int totalY, int outputX, int outputY, bool scale, bool binning)
+{
+  return 0;
+}
+
+static std::atomic<int> cam_pll_mul{-1};
+
+int fake_camera_pll_mul()
+{
+  return cam_pll_mul.load();
+}
+
+static int set_pll(sensor_t *s, int bypass, int mul, int sys, int root, int pre, int seld5, int pclken, int pclk)
+{
+  cam_pll_mul = mul;
+  return 0;
+}
+
+static int set_xclk(sensor_t *s, int timer, int xclk)
+{
+  s->xclk_freq_hz = xclk * 1000000;
+  return 0;
+}
+
+esp_err_t esp_camera_init(const void *config)
+{
+  sensor_t *s = &cam_sensor;
+  s->id.PID = OV2640_PID;
+  s->pixformat = PIXFORMAT_JPEG;
+  s->xclk_freq_hz = 20000000;
+  s->status.framesize = FRAMESIZE_UXGA;
+  s->status.quality = 12;
+  s->status.awb = 1;
+  s->status.aec = 1;
+  s->status.agc = 1;
+  s->set_pixformat = set_pixformat;
+  s->set_framesize = set_framesize;
+  s->set_contrast = set_contrast;
+  s->set_brightness = set_brightness;
+  s->set_saturation = set_saturation;
+  s->set_sharpness = set_sharpness;
+  s->set_denoise = set_denoise;
+  s->set_gainceiling = set_gainceiling;
+  s->set_quality = set_quality;
+  s->set_colorbar = set_colorbar;
+  s->set_whitebal = set_whitebal;
+  s->set_gain_ctrl = set_gain_ctrl;
+  s->set_exposure_ctrl = set_exposure_ctrl;
+  s->set_hmirror = set_hmirror;
+  s->set_vflip = set_vflip;
+  s->set_aec2 = set_aec2;
+  s->set_awb_gain = set_awb_gain;
+  s->set_agc_gain = set_agc_gain;
+  s->set_aec_value = set_aec_value;
+  s->set_special_effect = set_special_effect;
+  s->set_wb_mode = set_wb_mode;
+  s->set_ae_level = set_ae_level;
+  s->set_dcw = set_dcw;
+  s->set_bpc = set_bpc;
+  s->set_wpc = set_wpc;
+  s->set_raw_gma = set_raw_gma;
+  s->set_lenc = set_lenc;
+  s->get_reg = get_reg;
+  s->set_reg = set_reg;
+  s->set_res_raw = set_res_raw;
+  s->set_pll = set_pll;
+  s->set_xclk = set_xclk;
+  std::lock_guard<std::mutex> lock(cam_mutex);
+  cam_ready = true;
+  return ESP_OK;
+}
+
+// Conversions non simulées : le flux JPEG n'en a pas besoin, /bmp répond 500 sur l'hôte
+bool frame2jpg(camera_fb_t *fb, uint8_t quality, uint8_t **out, size_t *out_len)
+{
+  return false;
+}
+
+bool frame2jpg_cb(camera_fb_t *fb, uint8_t quality, jpg_out_cb cb, void *arg)
+{
+  return false;
+}
+
+bool frame2bmp(camera_fb_t *fb, uint8_t **out, size_t *out_len)
+{
+  return false;
+}
@@ -0,0 +1,5 @@
+#pragma once
+#include <stdint.h>
+
+bool ledcAttach(uint8_t pin, uint32_t freq, uint8_t resolution);
+bool ledcWrite(uint8_t pin, uint32_t duty);
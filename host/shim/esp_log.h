@@ -0,0 +1,6 @@
+#pragma once
+#include <stdarg.h>
+
+typedef int (*vprintf_like_t)(const char *, va_list);
+
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func);
@@ -0,0 +1,38 @@
+#pragma once
+#include <stdint.h>
+#include "esp_err.h"
+
+typedef enum
+{
+  WIFI_SECOND_CHAN_NONE,
+  WIFI_SECOND_CHAN_ABOVE,
+  WIFI_SECOND_CHAN_BELOW,
+} wifi_second_chan_t;
+
+typedef struct
+{
+  uint8_t bssid[6];
+  uint8_t ssid[33];
+  uint8_t primary;
+  wifi_second_chan_t second;
+  int8_t rssi;
+  uint32_t phy_11b : 1;
+  uint32_t phy_11g : 1;
+  uint32_t phy_11n : 1;
+} wifi_ap_record_t;
+
+typedef enum
+{
+  WIFI_PHY_MODE_LR,
+  WIFI_PHY_MODE_11B,
+  WIFI_PHY_MODE_11G,
+  WIFI_PHY_MODE_HT20,
+  WIFI_PHY_MODE_HT40,
+  WIFI_PHY_MODE_HE20,
+} wifi_phy_mode_t;
+
+#define ESP_ERR_WIFI_NOT_CONNECT 0x300f
+
+// Station non associée sur l'hôte : ESP_ERR_WIFI_NOT_CONNECT
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t *ap);
+esp_err_t esp_wifi_sta_get_negotiated_phymode(wifi_phy_mode_t *phymode);
@@ -0,0 +1,21 @@
+#pragma once
+// Contrôle de la fausse caméra (camera.cpp) : deux tampons comme le pilote en PSRAM,
+// une image à la fois à la cadence demandée, capteur OV2640 sans effet sur les images.
+#include <stddef.h>
+#include <stdint.h>
+
+#define FAKE_CAMERA_FB_COUNT 2
+#define FAKE_CAMERA_SYNTH_FRAMES 4 // Images de synthèse distinctes par framesize
+#define FAKE_CAMERA_QUALITY 85     // Qualité libjpeg, proche de la qualité 12 du capteur
+
+// Source des images : fichiers .jpg de `dir` (ordre des noms, en boucle) ou, si NULL,
+// images de synthèse (libjpeg, 4:2:2) à la framesize courante. Les fichiers gardent leur
+// taille : une photo (still_capture.cpp) n'aboutit que s'ils sont à still.framesize.
+// false si le répertoire ne contient aucun JPEG lisible.
+bool fake_camera_source(const char *dir);
+// Cadence du capteur en images/s ; 0 = une image dès qu'un tampon est libre
+void fake_camera_set_fps(int fps);
+// Images livrées par esp_camera_fb_get depuis le démarrage
+uint32_t fake_camera_frames();
+// Multiplicateur du dernier set_pll (-1 avant le premier)
+int fake_camera_pll_mul();
@@ -0,0 +1,38 @@
+#pragma once
+// Contrôle du faux esp_http_server (httpd.cpp) : chaque requête ouvre une connexion
+// (open_fn), passe par le handler enregistré comme sur la tâche httpd (un handler à la
+// fois), puis attend la fin d'un éventuel handler asynchrone avant close_fn.
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include "esp_http_server.h"
+
+#define FAKE_HTTPD_FIRST_FD 54   // LWIP_SOCKET_OFFSET : premier descripteur lwIP
+#define FAKE_HTTPD_BODY_KEEP 4096 // Début du corps de réponse conservé pour les vérifications
+
+typedef struct
+{
+  int method;            // HTTP_GET, HTTP_POST...
+  const char *uri;       // Chemin, avec ?requête éventuelle
+  const char *headers;   // "Nom: valeur\n"..., NULL = aucun
+  const char *body;      // Corps de la requête (content_len = body_len)
+  size_t body_len;
+  size_t content_len;    // Content-Length annoncé (0 = body_len) ; au-delà du corps, le client se tait
+  uint64_t close_after;  // Le client ferme après ce nombre d'octets de corps reçus (0 = jamais)
+} fake_httpd_req_t;
+
+typedef struct
+{
+  int status;          // 0 = connexion refusée par open_fn
+  esp_err_t result;    // Retour du handler
+  bool async;          // Terminée par une tâche (httpd_req_async_handler_begin)
+  uint32_t sends;      // Appels httpd_resp_send / send_chunk (fin de chunked exclue)
+  uint64_t bytes;      // Octets de corps envoyés
+  std::string type;    // Content-Type
+  std::string headers; // En-têtes posés, "Nom: valeur\n"...
+  std::string body;    // FAKE_HTTPD_BODY_KEEP premiers octets du corps
+} fake_httpd_resp_t;
+
+// Requête sur le serveur de httpd_start ; rend la main une fois la réponse terminée.
+// `resp` peut resservir d'une requête à l'autre (sa mémoire est alors réutilisée).
+void fake_httpd_request(const fake_httpd_req_t *req, fake_httpd_resp_t *resp);
@@ -0,0 +1,384 @@
+// FreeRTOS sur threads hôte : chaque tâche est un std::thread détaché, les priorités et
+// l'affinité sont ignorées (le cœur demandé est seulement rendu par xPortGetCoreID).
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+struct host_task
+{
+  TaskFunction_t fn;
+  void *arg;
+  int core;
+  std::mutex m;
+  std::condition_variable cv;
+  uint32_t notified = 0;
+};
+
+// Levée par vTaskDelete(NULL) pour sortir de la fonction de tâche
+struct host_task_exit
+{
+};
+
+static thread_local host_task *current_task = NULL;
+static std::atomic<int> task_count(1); // loopTask
+
+static const auto host_start = std::chrono::steady_clock::now();
+
+// Attente bornée en ticks (1 ms), portMAX_DELAY = sans limite
+template <typename Pred>
+static bool wait_ticks(std::unique_lock<std::mutex> &lock, std::condition_variable &cv, TickType_t ticks, Pred pred)
+{
+  if (ticks == portMAX_DELAY)
+  {
+    cv.wait(lock, pred);
+    return true;
+  }
+  return cv.wait_for(lock, std::chrono::milliseconds(ticks), pred);
+}
+
+static host_task *task_self()
+{
+  if (!current_task)
+  {
+    current_task = new host_task();
+    current_task->core = 1; // loopTask
+  }
+  return current_task;
+}
+
+static void task_entry(host_task *t)
+{
+  current_task = t;
+  try
+  {
+    t->fn(t->arg);
+  }
+  catch (const host_task_exit &)
+  {
+  }
+  task_count--;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+  host_task *t = new host_task();
+  t->fn = fn;
+  t->arg = arg;
+  t->core = core == tskNO_AFFINITY ? 0 : core;
+  if (handle)
+  {
+    *handle = t;
+  }
+  task_count++;
+  std::thread(task_entry, t).detach();
+  return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg, UBaseType_t priority, TaskHandle_t *handle)
+{
+  return xTaskCreatePinnedToCore(fn, name, stack, arg, priority, handle, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+  if (task == NULL || task == current_task)
+  {
+    throw host_task_exit();
+  }
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+TickType_t xTaskGetTickCount()
+{
+  return (TickType_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - host_start).count();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+  return task_self();
+}
+
+UBaseType_t uxTaskGetNumberOfTasks()
+{
+  return task_count.load();
+}
+
+BaseType_t xPortGetCoreID()
+{
+  return task_self()->core;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+  host_task *t = task_self();
+  std::unique_lock<std::mutex> lock(t->m);
+  wait_ticks(lock, t->cv, ticks, [t]
+             { return t->notified > 0; });
+  uint32_t value = t->notified;
+  if (value)
+  {
+    t->notified = clear ? 0 : value - 1;
+  }
+  return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+  {
+    std::lock_guard<std::mutex> lock(task->m);
+    task->notified++;
+  }
+  task->cv.notify_all();
+  return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken)
+{
+  xTaskNotifyGive(task);
+  if (woken)
+  {
+    *woken = pdTRUE;
+  }
+}
+
+struct host_queue
+{
+  std::mutex m;
+  std::condition_variable cv;
+  std::deque<std::vector<uint8_t>> items;
+  size_t length;
+  size_t item_size;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+  host_queue *q = new host_queue();
+  q->length = length;
+  q->item_size = item_size;
+  return q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t ticks)
+{
+  std::unique_lock<std::mutex> lock(q->m);
+  if (!wait_ticks(lock, q->cv, ticks, [q]
+                  { return q->items.size() < q->length; }))
+  {
+    return pdFALSE;
+  }
+  const uint8_t *p = (const uint8_t *)item;
+  q->items.emplace_back(p, p + q->item_size);
+  q->cv.notify_all();
+  return pdPASS;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t q, const void *item, BaseType_t *woken)
+{
+  if (woken)
+  {
+    *woken = pdTRUE;
+  }
+  return xQueueSend(q, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t ticks)
+{
+  std::unique_lock<std::mutex> lock(q->m);
+  if (!wait_ticks(lock, q->cv, ticks, [q]
+                  { return !q->items.empty(); }))
+  {
+    return pdFALSE;
+  }
+  memcpy(item, q->items.front().data(), q->item_size);
+  q->items.pop_front();
+  q->cv.notify_all();
+  return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+  std::lock_guard<std::mutex> lock(q->m);
+  return q->items.size();
+}
+
+struct host_sem
+{
+  std::mutex m;
+  std::condition_variable cv;
+  UBaseType_t count;
+  UBaseType_t max;
+  TaskHandle_t holder; // Mutex récursif : tâche détentrice
+  UBaseType_t depth;
+};
+
+static SemaphoreHandle_t sem_create(UBaseType_t max, UBaseType_t initial)
+{
+  host_sem *s = new host_sem();
+  s->count = initial;
+  s->max = max;
+  return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+  return sem_create(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+  return sem_create(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial)
+{
+  return sem_create(max, initial);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t ticks)
+{
+  std::unique_lock<std::mutex> lock(s->m);
+  if (!wait_ticks(lock, s->cv, ticks, [s]
+                  { return s->count > 0; }))
+  {
+    return pdFALSE;
+  }
+  s->count--;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s)
+{
+  std::lock_guard<std::mutex> lock(s->m);
+  if (s->count >= s->max)
+  {
+    return pdFALSE;
+  }
+  s->count++;
+  s->cv.notify_one();
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t s, BaseType_t *woken)
+{
+  if (woken)
+  {
+    *woken = pdTRUE;
+  }
+  return xSemaphoreGive(s);
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex()
+{
+  return sem_create(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutexStatic(StaticSemaphore_t *buf)
+{
+  SemaphoreHandle_t s = sem_create(1, 1);
+  buf->impl = s;
+  return s;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t s, TickType_t ticks)
+{
+  TaskHandle_t self = xTaskGetCurrentTaskHandle();
+  std::unique_lock<std::mutex> lock(s->m);
+  if (s->holder == self)
+  {
+    s->depth++;
+    return pdTRUE;
+  }
+  if (!wait_ticks(lock, s->cv, ticks, [s]
+                  { return s->count > 0; }))
+  {
+    return pdFALSE;
+  }
+  s->count--;
+  s->holder = self;
+  s->depth = 1;
+  return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t s)
+{
+  std::lock_guard<std::mutex> lock(s->m);
+  if (s->holder != xTaskGetCurrentTaskHandle())
+  {
+    return pdFALSE;
+  }
+  if (--s->depth == 0)
+  {
+    s->holder = NULL;
+    s->count++;
+    s->cv.notify_one();
+  }
+  return pdTRUE;
+}
+
+struct host_event_group
+{
+  std::mutex m;
+  std::condition_variable cv;
+  EventBits_t bits = 0;
+};
+
+EventGroupHandle_t xEventGroupCreate()
+{
+  return new host_event_group();
+}
+
+EventGroupHandle_t xEventGroupCreateStatic(StaticEventGroup_t *buf)
+{
+  host_event_group *eg = new host_event_group();
+  buf->impl = eg;
+  return eg;
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t eg, EventBits_t bits)
+{
+  std::lock_guard<std::mutex> lock(eg->m);
+  eg->bits |= bits;
+  eg->cv.notify_all();
+  return eg->bits;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t eg, EventBits_t bits)
+{
+  std::lock_guard<std::mutex> lock(eg->m);
+  EventBits_t prev = eg->bits;
+  eg->bits &= ~bits;
+  return prev;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t eg)
+{
+  std::lock_guard<std::mutex> lock(eg->m);
+  return eg->bits;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t eg, EventBits_t bits, BaseType_t clear, BaseType_t all, TickType_t ticks)
+{
+  std::unique_lock<std::mutex> lock(eg->m);
+  auto done = [eg, bits, all]
+  { return all ? (eg->bits & bits) == bits : (eg->bits & bits) != 0; };
+  bool ok = wait_ticks(lock, eg->cv, ticks, done);
+  EventBits_t value = eg->bits;
+  if (ok && clear)
+  {
+    eg->bits &= ~bits;
+  }
+  return value;
+}
@@ -0,0 +1,380 @@
+// Faux esp_http_server : pas de socket, les envois sont comptés (et le début du corps
+// gardé) dans la réponse du client de fake_httpd_request.
+#include "esp_http_server.h"
+#include "fake_httpd.h"
+#include <condition_variable>
+#include <mutex>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <vector>
+
+#define ESP_ERR_HTTPD_RESP_SEND (ESP_ERR_HTTPD_BASE + 6)
+
+typedef struct
+{
+  int fd;
+  const fake_httpd_req_t *in;
+  fake_httpd_resp_t *out;
+  size_t recv_pos;
+  bool closed;     // Fermée par le client (close_after) ou par httpd_sess_trigger_close
+  bool sent;       // Statut et en-têtes partis avec le premier envoi
+  bool async;      // Handler asynchrone en cours
+  bool went_async; // httpd_req_async_handler_begin appelé (reste vrai après complete)
+  int pending_status;
+} fake_conn_t;
+
+static httpd_config_t server_config;
+static bool server_started = false;
+static std::vector<httpd_uri_t> server_uris;
+// La tâche httpd : un handler (et open_fn / close_fn) à la fois
+static std::mutex server_task;
+static std::mutex conn_mutex;
+static std::condition_variable conn_cv;
+static std::vector<fake_conn_t *> conns;
+
+static fake_conn_t *conn_of(httpd_req_t *r)
+{
+  return (fake_conn_t *)r->aux;
+}
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
+{
+  server_config = *config;
+  server_started = true;
+  *handle = &server_config;
+  return ESP_OK;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri)
+{
+  if (!server_started)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  for (const httpd_uri_t &u : server_uris)
+  {
+    if (u.method == uri->method && !strcmp(u.uri, uri->uri))
+    {
+      return ESP_ERR_HTTPD_HANDLER_EXISTS;
+    }
+  }
+  if (server_uris.size() >= server_config.max_uri_handlers)
+  {
+    return ESP_ERR_HTTPD_HANDLERS_FULL;
+  }
+  server_uris.push_back(*uri);
+  return ESP_OK;
+}
+
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd)
+{
+  std::lock_guard<std::mutex> lock(conn_mutex);
+  for (fake_conn_t *c : conns)
+  {
+    if (c->fd == sockfd)
+    {
+      c->closed = true;
+      return ESP_OK;
+    }
+  }
+  return ESP_ERR_NOT_FOUND;
+}
+
+int httpd_req_to_sockfd(httpd_req_t *r)
+{
+  return conn_of(r)->fd;
+}
+
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t len)
+{
+  fake_conn_t *c = conn_of(r);
+  size_t left = c->in->body_len - c->recv_pos;
+  if (!left && len && c->in->content_len > c->in->body_len)
+  {
+    return HTTPD_SOCK_ERR_TIMEOUT; // Client muet : recv_wait_timeout écoulé
+  }
+  size_t n = len < left ? len : left;
+  memcpy(buf, c->in->body + c->recv_pos, n);
+  c->recv_pos += n;
+  return (int)n;
+}
+
+static const char *query_of(httpd_req_t *r)
+{
+  const char *q = strchr(r->uri, '?');
+  return q ? q + 1 : NULL;
+}
+
+size_t httpd_req_get_url_query_len(httpd_req_t *r)
+{
+  const char *q = query_of(r);
+  return q ? strlen(q) : 0;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *r, char *buf, size_t len)
+{
+  const char *q = query_of(r);
+  if (!q)
+  {
+    return ESP_ERR_NOT_FOUND;
+  }
+  if (!len)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  size_t n = strlen(q);
+  size_t copy = n < len - 1 ? n : len - 1;
+  memcpy(buf, q, copy);
+  buf[copy] = '\0';
+  return copy < n ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val, size_t val_size)
+{
+  size_t key_len = strlen(key);
+  for (const char *p = qry; p && *p;)
+  {
+    const char *end = strchr(p, '&');
+    size_t pair_len = end ? (size_t)(end - p) : strlen(p);
+    if (pair_len > key_len && !strncmp(p, key, key_len) && p[key_len] == '=')
+    {
+      const char *v = p + key_len + 1;
+      size_t n = pair_len - key_len - 1;
+      size_t copy = n < val_size - 1 ? n : val_size - 1;
+      memcpy(val, v, copy);
+      val[copy] = '\0';
+      return copy < n ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+    }
+    p = end ? end + 1 : NULL;
+  }
+  return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field, char *val, size_t val_size)
+{
+  size_t field_len = strlen(field);
+  for (const char *p = conn_of(r)->in->headers; p && *p;)
+  {
+    const char *end = strchr(p, '\n');
+    size_t line_len = end ? (size_t)(end - p) : strlen(p);
+    if (line_len > field_len && !strncasecmp(p, field, field_len) && p[field_len] == ':')
+    {
+      const char *v = p + field_len + 1;
+      while (*v == ' ')
+      {
+        v++;
+      }
+      size_t n = line_len - (v - p);
+      size_t copy = n < val_size - 1 ? n : val_size - 1;
+      memcpy(val, v, copy);
+      val[copy] = '\0';
+      return copy < n ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+    }
+    p = end ? end + 1 : NULL;
+  }
+  return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t httpd_req_async_handler_begin(httpd_req_t *r, httpd_req_t **out)
+{
+  // Copie de la requête, comme le serveur : le handler synchrone peut revenir
+  httpd_req_t *copy = (httpd_req_t *)malloc(sizeof(httpd_req_t));
+  if (!copy)
+  {
+    return ESP_ERR_NO_MEM;
+  }
+  memcpy((void *)copy, r, sizeof(httpd_req_t));
+  std::lock_guard<std::mutex> lock(conn_mutex);
+  conn_of(r)->async = true;
+  conn_of(r)->went_async = true;
+  *out = copy;
+  return ESP_OK;
+}
+
+esp_err_t httpd_req_async_handler_complete(httpd_req_t *r)
+{
+  fake_conn_t *c = conn_of(r);
+  free(r);
+  {
+    std::lock_guard<std::mutex> lock(conn_mutex);
+    c->async = false;
+  }
+  conn_cv.notify_all();
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status)
+{
+  conn_of(r)->pending_status = atoi(status);
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type)
+{
+  conn_of(r)->out->type = type;
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value)
+{
+  std::string &h = conn_of(r)->out->headers;
+  h += field;
+  h += ": ";
+  h += value;
+  h += "\n";
+  return ESP_OK;
+}
+
+static esp_err_t conn_send(fake_conn_t *c, const char *buf, size_t len)
+{
+  fake_httpd_resp_t *out = c->out;
+  std::lock_guard<std::mutex> lock(conn_mutex);
+  if (!c->sent)
+  {
+    out->status = c->pending_status;
+    c->sent = true;
+  }
+  if (c->closed || (c->in->close_after && out->bytes + len > c->in->close_after))
+  {
+    c->closed = true;
+    return ESP_ERR_HTTPD_RESP_SEND;
+  }
+  out->sends++;
+  out->bytes += len;
+  if (len && out->body.size() < FAKE_HTTPD_BODY_KEEP)
+  {
+    size_t keep = FAKE_HTTPD_BODY_KEEP - out->body.size();
+    out->body.append(buf, len < keep ? len : keep);
+  }
+  return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t len)
+{
+  if (len == HTTPD_RESP_USE_STRLEN)
+  {
+    len = buf ? strlen(buf) : 0;
+  }
+  return conn_send(conn_of(r), buf, len);
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t len)
+{
+  if (!buf || !len)
+  {
+    return ESP_OK; // Fin de la réponse chunked
+  }
+  if (len == HTTPD_RESP_USE_STRLEN)
+  {
+    len = strlen(buf);
+  }
+  return conn_send(conn_of(r), buf, len);
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *r, httpd_err_code_t error, const char *msg)
+{
+  static const int codes[HTTPD_ERR_CODE_MAX] = {500, 501, 505, 400, 401, 403, 404, 405, 408, 411, 414, 431};
+  conn_of(r)->pending_status = codes[error];
+  return httpd_resp_send(r, msg ? msg : "", HTTPD_RESP_USE_STRLEN);
+}
+
+// Plus petit descripteur libre, comme lwIP
+static void conn_open(fake_conn_t *c)
+{
+  std::lock_guard<std::mutex> lock(conn_mutex);
+  for (c->fd = FAKE_HTTPD_FIRST_FD;; c->fd++)
+  {
+    bool used = false;
+    for (fake_conn_t *o : conns)
+    {
+      used |= o->fd == c->fd;
+    }
+    if (!used)
+    {
+      break;
+    }
+  }
+  conns.push_back(c);
+}
+
+void fake_httpd_request(const fake_httpd_req_t *in, fake_httpd_resp_t *out)
+{
+  // Les chaînes gardent leur capacité : une réponse réutilisée n'alloue plus, seules les
+  // allocations du firmware sont comptées
+  out->status = 0;
+  out->result = ESP_OK;
+  out->async = false;
+  out->sends = 0;
+  out->bytes = 0;
+  out->type.clear();
+  out->headers.clear();
+  out->body.clear();
+  fake_conn_t c = {};
+  c.in = in;
+  c.out = out;
+  c.pending_status = 200;
+  conn_open(&c);
+
+  httpd_req_t req = {};
+  req.handle = &server_config;
+  req.method = in->method;
+  strncpy((char *)req.uri, in->uri, HTTPD_MAX_URI_LEN);
+  req.content_len = in->content_len ? in->content_len : in->body_len;
+  req.aux = &c;
+
+  std::unique_lock<std::mutex> task(server_task);
+  bool open = !server_config.open_fn || server_config.open_fn(&server_config, c.fd) == ESP_OK;
+  if (open)
+  {
+    size_t path_len = strcspn(in->uri, "?");
+    const httpd_uri_t *match = NULL;
+    for (const httpd_uri_t &u : server_uris)
+    {
+      if ((int)u.method == in->method && strlen(u.uri) == path_len && !strncmp(u.uri, in->uri, path_len))
+      {
+        match = &u;
+      }
+    }
+    if (match)
+    {
+      req.user_ctx = match->user_ctx;
+      out->result = match->handler(&req);
+    }
+    else
+    {
+      out->result = httpd_resp_send_err(&req, HTTPD_404_NOT_FOUND, "Not found");
+    }
+  }
+  task.unlock();
+
+  {
+    std::unique_lock<std::mutex> lock(conn_mutex);
+    // Une tâche rapide peut avoir terminé avant le retour du handler
+    out->async = c.went_async;
+    conn_cv.wait(lock, [&c]
+                 { return !c.async; });
+  }
+  if (open)
+  {
+    if (!c.sent)
+    {
+      out->status = c.pending_status;
+    }
+    task.lock();
+    if (server_config.close_fn)
+    {
+      server_config.close_fn(&server_config, c.fd);
+    }
+    task.unlock();
+  }
+  std::lock_guard<std::mutex> lock(conn_mutex);
+  for (size_t i = 0; i < conns.size(); i++)
+  {
+    if (conns[i] == &c)
+    {
+      conns.erase(conns.begin() + i);
+      break;
+    }
+  }
+}
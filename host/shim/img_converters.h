@@ -0,0 +1,11 @@
+#pragma once
+// Conversions esp32-camera, non simulées (camera.cpp) : elles échouent toujours
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_camera.h"
+
+typedef size_t (*jpg_out_cb)(void *arg, size_t index, const void *data, size_t len);
+
+bool frame2jpg(camera_fb_t *fb, uint8_t quality, uint8_t **out, size_t *out_len);
+bool frame2jpg_cb(camera_fb_t *fb, uint8_t quality, jpg_out_cb cb, void *arg);
+bool frame2bmp(camera_fb_t *fb, uint8_t **out, size_t *out_len);
@@ -0,0 +1,7 @@
+#pragma once
+// Sockets hôte : les descripteurs du faux httpd ne sont pas ouverts, setsockopt échoue
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
@@ -0,0 +1,335 @@
+// Reste de l'IDF et du cœur Arduino : horloge, tas, NVS en mémoire, temporisateurs,
+// Serial, et valeurs fixes pour ce qui n'existe pas sur l'hôte (WiFi, reset, sommeil).
+#include <Arduino.h>
+#include <WiFi.h>
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_sleep.h"
+#include "esp_system.h"
+#include "esp_wifi.h"
+#include "nvs.h"
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <random>
+#include <stdarg.h>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#define HOST_HEAP_FREE (200 * 1024)         // Tas interne libre annoncé (ESP32 après WiFi)
+#define HOST_PSRAM_FREE (4 * 1024 * 1024)  // PSRAM libre annoncée
+
+HardwareSerial Serial;
+EspClass ESP;
+WiFiClass WiFi;
+
+static const auto host_start = std::chrono::steady_clock::now();
+
+int64_t esp_timer_get_time()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - host_start).count();
+}
+
+unsigned long millis()
+{
+  return esp_timer_get_time() / 1000;
+}
+
+unsigned long micros()
+{
+  return esp_timer_get_time();
+}
+
+void delay(uint32_t ms)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+bool psramFound()
+{
+  return true;
+}
+
+char *itoa(int value, char *str, int base)
+{
+  if (base == 16)
+  {
+    sprintf(str, "%x", value);
+  }
+  else
+  {
+    sprintf(str, "%d", value);
+  }
+  return str;
+}
+
+size_t HardwareSerial::write(const uint8_t *buf, size_t len)
+{
+  static const bool quiet = getenv("BENCH_QUIET") != NULL;
+  return quiet ? len : fwrite(buf, 1, len, stderr);
+}
+
+size_t HardwareSerial::printf(const char *fmt, ...)
+{
+  char buf[256];
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(buf, sizeof(buf), fmt, args);
+  va_end(args);
+  return write((const uint8_t *)buf, n < (int)sizeof(buf) ? n : sizeof(buf) - 1);
+}
+
+void EspClass::restart()
+{
+  esp_restart();
+}
+
+void esp_restart()
+{
+  fprintf(stderr, "esp_restart()\n");
+  fflush(stderr);
+  _exit(0);
+}
+
+esp_reset_reason_t esp_reset_reason()
+{
+  return ESP_RST_POWERON;
+}
+
+esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause()
+{
+  return ESP_SLEEP_WAKEUP_UNDEFINED;
+}
+
+uint32_t esp_random()
+{
+  static std::mt19937 gen(std::random_device{}());
+  static std::mutex m;
+  std::lock_guard<std::mutex> lock(m);
+  return gen();
+}
+
+const char *esp_err_to_name(esp_err_t code)
+{
+  switch (code)
+  {
+  case ESP_OK:
+    return "ESP_OK";
+  case ESP_FAIL:
+    return "ESP_FAIL";
+  case ESP_ERR_NO_MEM:
+    return "ESP_ERR_NO_MEM";
+  case ESP_ERR_INVALID_ARG:
+    return "ESP_ERR_INVALID_ARG";
+  case ESP_ERR_INVALID_STATE:
+    return "ESP_ERR_INVALID_STATE";
+  case ESP_ERR_INVALID_SIZE:
+    return "ESP_ERR_INVALID_SIZE";
+  case ESP_ERR_NOT_FOUND:
+    return "ESP_ERR_NOT_FOUND";
+  case ESP_ERR_NOT_SUPPORTED:
+    return "ESP_ERR_NOT_SUPPORTED";
+  case ESP_ERR_TIMEOUT:
+    return "ESP_ERR_TIMEOUT";
+  default:
+    return "UNKNOWN ERROR";
+  }
+}
+
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func)
+{
+  return vprintf;
+}
+
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t *ap)
+{
+  return ESP_ERR_WIFI_NOT_CONNECT;
+}
+
+esp_err_t esp_wifi_sta_get_negotiated_phymode(wifi_phy_mode_t *phymode)
+{
+  return ESP_ERR_WIFI_NOT_CONNECT;
+}
+
+bool ledcAttach(uint8_t pin, uint32_t freq, uint8_t resolution)
+{
+  return true;
+}
+
+bool ledcWrite(uint8_t pin, uint32_t duty)
+{
+  return true;
+}
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+  return malloc(size);
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+  return calloc(n, size);
+}
+
+void heap_caps_free(void *ptr)
+{
+  free(ptr);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+  return caps & MALLOC_CAP_SPIRAM ? HOST_PSRAM_FREE : HOST_HEAP_FREE;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps)
+{
+  return heap_caps_get_free_size(caps) / 2;
+}
+
+// Temporisateur à un coup : un thread par armement, annulé par un numéro de génération
+struct host_timer
+{
+  esp_timer_cb_t callback;
+  void *arg;
+  std::atomic<uint32_t> generation;
+};
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out)
+{
+  host_timer *t = new host_timer();
+  t->callback = args->callback;
+  t->arg = args->arg;
+  t->generation = 0;
+  *out = t;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+  uint32_t gen = ++timer->generation;
+  std::thread([timer, gen, timeout_us]
+              {
+                std::this_thread::sleep_for(std::chrono::microseconds(timeout_us));
+                if (timer->generation.load() == gen)
+                {
+                  timer->callback(timer->arg);
+                } })
+      .detach();
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+  timer->generation++;
+  return ESP_OK;
+}
+
+// NVS : un espace de noms par handle, valeurs gardées sous forme d'octets
+typedef std::map<std::string, std::vector<uint8_t>> nvs_ns_t;
+static std::mutex nvs_mutex;
+static std::vector<std::string> nvs_handles;
+static std::map<std::string, nvs_ns_t> nvs_store;
+
+static nvs_ns_t *nvs_ns(nvs_handle_t h)
+{
+  return h && h <= nvs_handles.size() ? &nvs_store[nvs_handles[h - 1]] : NULL;
+}
+
+esp_err_t nvs_open(const char *ns, nvs_open_mode_t mode, nvs_handle_t *out)
+{
+  std::lock_guard<std::mutex> lock(nvs_mutex);
+  nvs_handles.push_back(ns);
+  *out = nvs_handles.size();
+  return ESP_OK;
+}
+
+static esp_err_t nvs_get(nvs_handle_t h, const char *key, void *out, size_t *len, bool exact)
+{
+  std::lock_guard<std::mutex> lock(nvs_mutex);
+  nvs_ns_t *ns = nvs_ns(h);
+  if (!ns)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  auto it = ns->find(key);
+  if (it == ns->end())
+  {
+    return ESP_ERR_NVS_NOT_FOUND;
+  }
+  const std::vector<uint8_t> &v = it->second;
+  if (!out)
+  {
+    *len = v.size();
+    return ESP_OK;
+  }
+  if (exact ? *len != v.size() : *len < v.size())
+  {
+    return ESP_ERR_NVS_INVALID_LENGTH;
+  }
+  memcpy(out, v.data(), v.size());
+  *len = v.size();
+  return ESP_OK;
+}
+
+static esp_err_t nvs_set(nvs_handle_t h, const char *key, const void *value, size_t len)
+{
+  std::lock_guard<std::mutex> lock(nvs_mutex);
+  nvs_ns_t *ns = nvs_ns(h);
+  if (!ns)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  const uint8_t *p = (const uint8_t *)value;
+  (*ns)[key].assign(p, p + len);
+  return ESP_OK;
+}
+
+esp_err_t nvs_get_i32(nvs_handle_t h, const char *key, int32_t *out)
+{
+  size_t len = sizeof(*out);
+  return nvs_get(h, key, out, &len, true);
+}
+
+esp_err_t nvs_set_i32(nvs_handle_t h, const char *key, int32_t value)
+{
+  return nvs_set(h, key, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_str(nvs_handle_t h, const char *key, char *out, size_t *len)
+{
+  return nvs_get(h, key, out, len, false);
+}
+
+esp_err_t nvs_set_str(nvs_handle_t h, const char *key, const char *value)
+{
+  return nvs_set(h, key, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t h, const char *key, void *out, size_t *len)
+{
+  return nvs_get(h, key, out, len, false);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t h, const char *key, const void *value, size_t len)
+{
+  return nvs_set(h, key, value, len);
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t h, const char *key)
+{
+  std::lock_guard<std::mutex> lock(nvs_mutex);
+  nvs_ns_t *ns = nvs_ns(h);
+  if (!ns)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  return ns->erase(key) ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_commit(nvs_handle_t h)
+{
+  return ESP_OK;
+}
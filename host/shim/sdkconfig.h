@@ -0,0 +1,2 @@
+#pragma once
+// Pas de CONFIG_HTTPD_WS_SUPPORT ni de CONFIG_ARDUHAL_ESP_LOG : chemins par défaut du sketch
@@ -0,0 +1,164 @@
+/*
+Tests hôte des statistiques en flux (mangoire_esp32/stream_stats.h).
+Lancés par ctest (voir host/CMakeLists.txt) ; chaque vérification ratée est affichée
+et le code de sortie est alors non nul.
+*/
+
+#include <stdint.h>
+#include <stdio.h>
+#include "stream_stats.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                     \
+  do                                                                    \
+  {                                                                     \
+    if (!(cond))                                                        \
+    {                                                                   \
+      fprintf(stderr, "%s:%d: échec: %s\n", __FILE__, __LINE__, #cond); \
+      failures++;                                                       \
+    }                                                                   \
+  } while (0)
+
+static void test_window_mean()
+{
+  WindowMean<uint32_t, 4> m;
+  CHECK(m.mean() == 0);
+  CHECK(m.count() == 0);
+  CHECK(m.add(10) == 10);
+  CHECK(m.add(20) == 15);
+  m.add(30);
+  CHECK(m.add(40) == 25);
+  // Fenêtre pleine : la plus ancienne valeur sort
+  CHECK(m.add(50) == 35);
+  CHECK(m.count() == 4);
+  m.reset();
+  CHECK(m.mean() == 0);
+  CHECK(m.count() == 0);
+
+  WindowMean<int, 3> s;
+  s.add(-3);
+  CHECK(s.add(3) == 0);
+  CHECK(s.add(-9) == -3);
+}
+
+static void test_ewma()
+{
+  Ewma e(0.5f);
+  CHECK(e.add(10) == 10.0f); // Première valeur prise telle quelle
+  CHECK(e.add(20) == 15.0f);
+  CHECK(e.add(15) == 15.0f);
+  e.reset();
+  CHECK(e.add(4) == 4.0f);
+
+  Ewma last(1.0f);
+  last.add(7);
+  CHECK(last.add(3) == 3.0f);
+}
+
+static void test_min_max()
+{
+  MinMax<int> mm;
+  CHECK(mm.count() == 0);
+  CHECK(mm.min() == 0 && mm.max() == 0);
+  // Première valeur négative : min et max partent d'elle, pas de 0
+  mm.add(-7);
+  CHECK(mm.min() == -7 && mm.max() == -7);
+  mm.add(5);
+  mm.add(-2);
+  mm.add(9);
+  CHECK(mm.min() == -7);
+  CHECK(mm.max() == 9);
+  CHECK(mm.count() == 4);
+  mm.reset();
+  CHECK(mm.count() == 0);
+  mm.add(3);
+  CHECK(mm.min() == 3 && mm.max() == 3);
+}
+
+typedef LogHistogram<> hist_t;
+
+static void test_histogram_buckets()
+{
+  CHECK(hist_t::kBuckets == 92);
+  // Valeurs exactes sous 2 * kSub
+  for (uint32_t v = 0; v < 2 * hist_t::kSub; v++)
+  {
+    CHECK(hist_t::upper(hist_t::bucket(v)) == v);
+  }
+  // Seaux contigus et croissants, borne haute à moins de 25 % de la valeur
+  unsigned prev = 0;
+  int bad = 0;
+  for (uint32_t v = 1; v < (1u << 24) && bad < 5; v++)
+  {
+    unsigned b = hist_t::bucket(v);
+    uint32_t up = hist_t::upper(b);
+    bool ok = (b == prev || b == prev + 1) && v <= up && v > hist_t::upper(b - 1) && (uint64_t)(up - v) * 4 <= v;
+    if (!ok)
+    {
+      fprintf(stderr, "seau de %u : %u (borne %u)\n", v, b, up);
+      bad++;
+    }
+    prev = b;
+  }
+  CHECK(bad == 0);
+  // Au-delà de 2^MaxBits : dernier seau
+  CHECK(hist_t::bucket(1u << 24) == hist_t::kBuckets - 1);
+  CHECK(hist_t::bucket(UINT32_MAX) == hist_t::kBuckets - 1);
+  CHECK(hist_t::upper(hist_t::kBuckets - 1) == (1u << 24) - 1);
+}
+
+static void test_histogram_quantile()
+{
+  hist_t h;
+  CHECK(h.quantile(0.5f) == 0);
+  for (uint32_t v = 1; v <= 100; v++)
+  {
+    h.add(v);
+  }
+  CHECK(h.count() == 100);
+  CHECK(h.quantile(0.0f) == 1);
+  CHECK(h.quantile(0.5f) == hist_t::upper(hist_t::bucket(50)));
+  CHECK(h.quantile(0.95f) == hist_t::upper(hist_t::bucket(95)));
+  CHECK(h.quantile(1.0f) == hist_t::upper(hist_t::bucket(100)));
+  h.reset();
+  CHECK(h.count() == 0);
+  CHECK(h.quantile(0.99f) == 0);
+}
+
+static void test_histogram_halve()
+{
+  hist_t h;
+  for (int i = 0; i < 3; i++)
+  {
+    h.add(1000);
+  }
+  for (uint32_t i = 0; i < 0xFFFF; i++)
+  {
+    h.add(7);
+  }
+  CHECK(h.count() == 0xFFFF + 3);
+  // Compteur saturé : tous divisés par 2 (arrondi haut, un seau non vide le reste)
+  h.add(7);
+  CHECK(h.count() == 0x8000 + 1 + 2);
+  CHECK(h.quantile(0.0f) == 7);
+  CHECK(h.quantile(0.99f) == 7);
+  CHECK(h.quantile(1.0f) == hist_t::upper(hist_t::bucket(1000)));
+}
+
+int main()
+{
+  test_window_mean();
+  test_ewma();
+  test_min_max();
+  test_histogram_buckets();
+  test_histogram_quantile();
+  test_histogram_halve();
+  if (failures)
+  {
+    fprintf(stderr, "%d vérification(s) en échec\n", failures);
+    return 1;
+  }
+  printf("stream_stats : OK\n");
+  return 0;
+}
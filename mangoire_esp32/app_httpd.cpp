@@ -10,22 +10,84 @@
 #include "camera_index.h"
 
 #include "board_config.h"
-#include "config_utils.h"
 #include <ArduinoJson.h>
 #include "esp_http_server.h"
 #include "esp_camera.h"
 #include <ArduinoJson.h>
 #include <string.h>
+#include <atomic>
+#include "esp_random.h"
+#include "json_writer.h"
+#include "event_ring.h"
+#include "metrics.h"
+#include "trace.h"
+#include "stream_stats.h"
+#include "recorder.h"
+#include "net_profile.h"
+#include "task_topology.h"
+#include "log_ring.h"
+#include "settings_store.h"
+#include "http_body.h"
+#include "json_capacity.h"
+#include "http_status.h"
+#include "boot_phase.h"
+#include "wifi_connect.h"
+#include "visit_capture.h"
+#include "presence.h"
+#include "camera_window.h"
+#include "jpeg_crop.h"
+#include "still_capture.h"
+#include "sensor_lock.h"
+#include "lwip/sockets.h"
+#include "esp_wifi.h"
+#include <WiFi.h>
+
+// Réglage modifié : invalide /status et notifie les abonnés /events
+static void settings_changed(const char *key)
+{
+  status_invalidate();
+  event_publish(EVENT_SETTINGS, "{\"keys\":[\"%s\"]}", key);
+}
+
+static void settings_changed(const settings_mask_t *changed)
+{
+  status_invalidate();
+  char keys[EVENT_DATA_SIZE];
+  json_writer_t w;
+  json_writer_init(&w, keys, sizeof(keys) - 1);
+  json_begin_object(&w);
+  json_key(&w, "keys");
+  json_begin_array(&w);
+  for (int i = 0; i < SETTING_COUNT; i++)
+  {
+    if (settings_mask_has(changed, i))
+    {
+      json_str(&w, settings_schema[i].name);
+    }
+  }
+  json_end_array(&w);
+  json_end_object(&w);
+  if (json_writer_finish(&w) == ESP_OK)
+  {
+    keys[w.len] = 0;
+    event_publish(EVENT_SETTINGS, "%s", keys);
+  }
+  else
+  {
+    event_publish(EVENT_SETTINGS, "{\"keys\":null,\"truncated\":true}");
+  }
+}
+
 void camera_dma_diagnostics(const char *contexte)
 {
-  Serial.printf("[DIAG][%s] Heap: %u, PSRAM: %u, PSRAM size: %u\n", contexte, ESP.getFreeHeap(), ESP.getFreePsram(), ESP.getPsramSize());
+  LOGR_I(LOG_MOD_CORE, "[%s] Heap: %u, PSRAM: %u, PSRAM size: %u", contexte, ESP.getFreeHeap(), ESP.getFreePsram(), ESP.getPsramSize());
   sensor_t *s = esp_camera_sensor_get();
   if (s)
   {
-    Serial.printf("[DIAG][%s] Capteur PID: 0x%02X, framesize: %d, pixformat: %d\n", contexte, s->id.PID, s->status.framesize, s->pixformat);
+    LOGR_I(LOG_MOD_CORE, "[%s] Capteur PID: 0x%02X, framesize: %d, pixformat: %d", contexte, s->id.PID, s->status.framesize, s->pixformat);
   }
-  Serial.printf("[DIAG][%s] PSRAM found: %s\n", contexte, psramFound() ? "OUI" : "NON");
-  Serial.printf("[DIAG][%s] xclk_freq_hz: %d\n", contexte, XCLK_GPIO_NUM);
+  LOGR_I(LOG_MOD_CORE, "[%s] PSRAM found: %s", contexte, psramFound() ? "OUI" : "NON");
+  LOGR_I(LOG_MOD_CORE, "[%s] xclk_freq_hz: %d", contexte, XCLK_GPIO_NUM);
 }
 
 // Diagnostic après capture
@@ -33,13 +95,13 @@ void camera_fb_diagnostics(const camera_fb_t *fb, const char *contexte)
 {
   if (fb)
   {
-    Serial.printf("[DIAG][%s] Frame OK: len=%u, w=%u, h=%u, format=%u\n", contexte, fb->len, fb->width, fb->height, fb->format);
+    LOGR_D(LOG_MOD_CAMERA, "[%s] Frame OK: len=%u, w=%u, h=%u, format=%u", contexte, fb->len, fb->width, fb->height, fb->format);
   }
   else
   {
-    Serial.printf("[DIAG][%s] Frame NULL (capture échouée)\n", contexte);
+    LOGR_W(LOG_MOD_CAMERA, "[%s] Frame NULL (capture échouée)", contexte);
   }
-  Serial.printf("[DIAG][%s] Heap: %u, PSRAM: %u\n", contexte, ESP.getFreeHeap(), ESP.getFreePsram());
+  LOGR_D(LOG_MOD_CAMERA, "[%s] Heap: %u, PSRAM: %u", contexte, ESP.getFreeHeap(), ESP.getFreePsram());
 }
 // Page HTML de réglages caméra
 static const char settings_html[] = R"rawliteral(
@@ -101,7 +163,7 @@ static const char settings_html[] = R"rawliteral(
           for(const k in s){
             // On ne modifie la valeur du champ que si elle existe dans le formulaire
             if(document.forms[0][k] !== undefined && s[k] !== undefined && s[k] !== null) {
-              document.forms[0][k].value = s[k];
+              document.forms[0][k].value = Number(s[k]); // awb/agc/aec : booléens JSON
             }
           }
         }
@@ -143,66 +205,152 @@ static esp_err_t settings_html_handler(httpd_req_t *req)
   return ESP_OK;
 }
 
+// Applique un réglage du groupe "camera" au capteur
+static void camera_setting_apply(sensor_t *s, setting_id_t id)
+{
+  int v = settings_get(id);
+  switch (id)
+  {
+  case SET_CAM_QUALITY:
+    s->set_quality(s, v);
+    break;
+  case SET_CAM_CONTRAST:
+    s->set_contrast(s, v);
+    break;
+  case SET_CAM_BRIGHTNESS:
+    s->set_brightness(s, v);
+    break;
+  case SET_CAM_SATURATION:
+    s->set_saturation(s, v);
+    break;
+  case SET_CAM_AWB:
+    s->set_whitebal(s, v);
+    break;
+  case SET_CAM_AGC:
+    s->set_gain_ctrl(s, v);
+    break;
+  case SET_CAM_AEC:
+    s->set_exposure_ctrl(s, v);
+    break;
+  default:
+    break;
+  }
+}
+
+// Applique les réglages caméra enregistrés (cache RAM, sans accès flash) ;
+// appelé par la tâche d'initialisation caméra
+void camera_settings_restore()
+{
+  sensor_t *s = esp_camera_sensor_get();
+  if (!s)
+  {
+    LOGR_E(LOG_MOD_CAMERA, "esp_camera_sensor_get Error");
+    return;
+  }
+  sensor_lock();
+  for (int id = SET_CAM_QUALITY; id <= SET_CAM_AEC; id++)
+  {
+    if (settings_is_set((setting_id_t)id))
+    {
+      camera_setting_apply(s, (setting_id_t)id);
+    }
+  }
+  // Après le choix de la framesize : la ROI en dépend
+  camera_window_restore();
+  sensor_unlock();
+  status_invalidate();
+}
+
+#define SETTINGS_CHUNK_SIZE 256   // Tampon d'envoi des réponses réglages
+#define SETTINGS_DOC_MAX (8 * 1024) // Plafond de tas d'un PATCH /api/config
+#define SETTINGS_FILTER_SIZE SETTINGS_JSON_FILTER_SIZE
+#define SETTINGS_DOC_SIZE SETTINGS_JSON_DOC_SIZE
+static_assert(SETTINGS_FILTER_SIZE + SETTINGS_DOC_SIZE <= SETTINGS_DOC_MAX, "Schéma trop gros pour un PATCH /api/config en une fois");
+
+// Réponse des mises à jour : seulement les réglages modifiés, avec leur nouvelle valeur
+static esp_err_t settings_send_changed(httpd_req_t *req, const settings_mask_t *changed, const char *group)
+{
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  char out[SETTINGS_CHUNK_SIZE];
+  json_writer_t w;
+  json_writer_init_httpd(&w, out, sizeof(out), req);
+  settings_write_mask(&w, changed, group);
+  esp_err_t res = json_writer_finish(&w);
+  if (res == ESP_OK)
+  {
+    res = httpd_resp_send_chunk(req, NULL, 0);
+  }
+  return res;
+}
+
+// Mise à jour d'un groupe à plat ({"nom":valeur}) depuis le corps de la requête,
+// lu en flux et filtré sur le schéma, tout ou rien. Retourne ESP_FAIL après avoir répondu
+// en cas d'erreur.
+static esp_err_t settings_update_group(httpd_req_t *req, const char *group, settings_mask_t *changed)
+{
+  DynamicJsonDocument filter(SETTINGS_FILTER_SIZE);
+  settings_filter(filter, group);
+  DynamicJsonDocument doc(SETTINGS_DOC_SIZE);
+  if (http_body_json(req, doc, &filter) != ESP_OK)
+  {
+    return ESP_FAIL;
+  }
+  if (settings_from_json(doc.as<JsonObjectConst>(), group, changed))
+  {
+    http_send_err(req, HTTPD_400_BAD_REQUEST, "Valeur hors limites");
+    return ESP_FAIL;
+  }
+  return ESP_OK;
+}
+
 // Handler GET/POST /api/settings
 static esp_err_t settings_api_handler(httpd_req_t *req)
 {
   if (req->method == HTTP_GET)
   {
-    StaticJsonDocument<256> doc;
-    loadConfig(doc, "/settings.json");
-    String out;
-    serializeJson(doc, out);
+    // Seuls les réglages enregistrés : le formulaire garde ses valeurs par défaut pour les autres
+    char out[256];
+    json_writer_t w;
+    json_writer_init(&w, out, sizeof(out));
+    settings_write_group(&w, "camera", true);
+    if (json_writer_finish(&w) != ESP_OK)
+    {
+      return http_send_500(req);
+    }
     httpd_resp_set_type(req, "application/json");
     httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-    httpd_resp_sendstr(req, out.c_str());
-    return ESP_OK;
+    return httpd_resp_send(req, out, w.len);
   }
   else if (req->method == HTTP_POST)
   {
-    char buf[256];
-    int len = req->content_len;
-    if (len > 255)
-      len = 255;
-    int r = httpd_req_recv(req, buf, len);
-    if (r <= 0)
-    {
-      httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Reception failed");
-      return ESP_FAIL;
-    }
-    buf[r] = 0;
-    StaticJsonDocument<256> doc;
-    DeserializationError err = deserializeJson(doc, buf);
-    if (err)
+    // Mise à jour partielle ; écriture NVS différée : des POST rapprochés (curseurs)
+    // ne font qu'une écriture
+    settings_mask_t changed = {};
+    if (settings_update_group(req, "camera", &changed) != ESP_OK)
     {
-      httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "JSON invalide");
       return ESP_FAIL;
     }
-    saveConfig(doc, "/settings.json");
-    httpd_resp_set_type(req, "application/json");
-    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-    httpd_resp_sendstr(req, "{\"status\":\"ok\"}");
     // Appliquer les réglages à la caméra immédiatement
     sensor_t *s = esp_camera_sensor_get();
-    if (s)
-    {
-      if (doc.containsKey("quality"))
-        s->set_quality(s, doc["quality"]);
-      if (doc.containsKey("contrast"))
-        s->set_contrast(s, doc["contrast"]);
-      if (doc.containsKey("brightness"))
-        s->set_brightness(s, doc["brightness"]);
-      if (doc.containsKey("saturation"))
-        s->set_saturation(s, doc["saturation"]);
-      if (doc.containsKey("awb"))
-        s->set_whitebal(s, doc["awb"]);
-      if (doc.containsKey("agc"))
-        s->set_gain_ctrl(s, doc["agc"]);
-      if (doc.containsKey("aec"))
-        s->set_exposure_ctrl(s, doc["aec"]);
+    if (s && settings_mask_any(&changed))
+    {
+      TRACE_BEGIN("settings_write");
+      sensor_lock();
+      for (int id = SET_CAM_QUALITY; id <= SET_CAM_AEC; id++)
+      {
+        if (settings_mask_has(&changed, id))
+        {
+          camera_setting_apply(s, (setting_id_t)id);
+        }
+      }
+      sensor_unlock();
+      TRACE_END("settings_write");
+      settings_changed(&changed);
     }
-    return ESP_OK;
+    return settings_send_changed(req, &changed, "camera");
   }
-  httpd_resp_send_err(req, HTTPD_405_METHOD_NOT_ALLOWED, "Method not allowed");
+  http_send_err(req, HTTPD_405_METHOD_NOT_ALLOWED, "Method not allowed");
   return ESP_FAIL;
 }
 
@@ -261,6 +409,7 @@ static esp_err_t reboot_handler(httpd_req_t *req)
   httpd_resp_set_type(req, "application/json");
   httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
   httpd_resp_sendstr(req, "{\"status\":\"rebooting\"}");
+  settings_flush(); // Écritures différées en attente
   delay(200);
   ESP.restart();
   return ESP_OK;
@@ -287,41 +436,70 @@ static esp_err_t config_html_handler(httpd_req_t *req)
 // WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 // See the License for the specific language governing permissions and
 // limitations under the License.
-// Handler pour POST /api/config
-static esp_err_t config_update_handler(httpd_req_t *req)
+// Handler GET /api/config : tous les réglages du schéma {"groupe":{"nom":valeur}}
+static esp_err_t config_get_handler(httpd_req_t *req)
 {
-  // Limite de 1024 octets pour la config
-  char buf[1025];
-  int total_len = req->content_len;
-  if (total_len > 1024)
+  settings_mask_t all = settings_mask_all();
+  return settings_send_changed(req, &all, NULL);
+}
+
+// Handler PATCH /api/config : JSON Merge Patch sur le document de GET /api/config
+// (clé absente = inchangée, null = défaut), tout ou rien : une valeur refusée donne un 400
+// sans rien modifier. Répond avec les seuls réglages modifiés.
+static esp_err_t config_patch_handler(httpd_req_t *req)
+{
+  DynamicJsonDocument filter(SETTINGS_FILTER_SIZE);
+  settings_filter(filter, NULL);
+  DynamicJsonDocument doc(SETTINGS_DOC_SIZE);
+  if (http_body_json(req, doc, &filter) != ESP_OK)
   {
-    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Payload trop gros");
     return ESP_FAIL;
   }
-  int ret = httpd_req_recv(req, buf, total_len);
-  if (ret <= 0)
+  settings_mask_t changed = {};
+  if (settings_patch(doc.as<JsonObjectConst>(), &changed))
   {
-    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Lecture échouée");
+    http_send_err(req, HTTPD_400_BAD_REQUEST, "Valeur hors limites");
     return ESP_FAIL;
   }
-  buf[ret] = 0;
-
-  StaticJsonDocument<1024> doc;
-  DeserializationError error = deserializeJson(doc, buf);
-  if (error)
+  // Les modules qui recopient leurs réglages les relisent ; caméra appliquée tout de suite
+  net_profile_load();
+  task_topology_load();
+  sensor_t *s = esp_camera_sensor_get();
+  sensor_lock();
+  for (int id = SET_CAM_QUALITY; s && id <= SET_CAM_AEC; id++)
   {
-    httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "JSON invalide");
-    return ESP_FAIL;
+    if (settings_mask_has(&changed, id))
+    {
+      camera_setting_apply(s, (setting_id_t)id);
+    }
   }
-  if (!saveConfig(doc))
+  for (int id = SET_ROI_ENABLED; s && id <= SET_ROI_BINNING; id++)
+  {
+    if (settings_mask_has(&changed, id))
+    {
+      camera_window_restore();
+      break;
+    }
+  }
+  sensor_unlock();
+  if (settings_mask_any(&changed))
+  {
+    settings_changed(&changed);
+  }
+  return settings_send_changed(req, &changed, NULL);
+}
+
+// Handler POST /api/config (formulaire WiFi) : {"ssid":..,"password":..}
+static esp_err_t config_update_handler(httpd_req_t *req)
+{
+  settings_mask_t changed = {};
+  if (settings_update_group(req, "wifi", &changed) != ESP_OK)
   {
-    httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Ecriture de la config échouée");
     return ESP_FAIL;
   }
-  httpd_resp_set_type(req, "application/json");
-  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-  httpd_resp_sendstr(req, "{\"status\":\"ok\"}");
-  return ESP_OK;
+  // Pris en compte au redémarrage : écriture immédiate, l'utilisateur redémarre juste après
+  settings_flush();
+  return settings_send_changed(req, &changed, "wifi");
 }
 // Enregistrement du endpoint config
 httpd_uri_t config_uri = {
@@ -337,6 +515,32 @@ httpd_uri_t config_uri = {
 #endif
 };
 
+httpd_uri_t config_get_uri = {
+    .uri = "/api/config",
+    .method = HTTP_GET,
+    .handler = config_get_handler,
+    .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    ,
+    .is_websocket = false,
+    .handle_ws_control_frames = false,
+    .supported_subprotocol = NULL
+#endif
+};
+
+httpd_uri_t config_patch_uri = {
+    .uri = "/api/config",
+    .method = HTTP_PATCH,
+    .handler = config_patch_handler,
+    .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+    ,
+    .is_websocket = false,
+    .handle_ws_control_frames = false,
+    .supported_subprotocol = NULL
+#endif
+};
+
 #if defined(ARDUINO_ARCH_ESP32) && defined(CONFIG_ARDUHAL_ESP_LOG)
 #include "esp32-hal-log.h"
 #endif
@@ -364,81 +568,228 @@ static const char *_STREAM_PART = "Content-Type: image/jpeg\r\nContent-Length: %
 httpd_handle_t stream_httpd = NULL;
 httpd_handle_t camera_httpd = NULL;
 
-typedef struct
+#define STREAM_AVG_FRAMES 20    // Fenêtre de la moyenne glissante du temps par image
+#define STREAM_STATS_PERIOD 100 // Journalisation des percentiles toutes les N images
+
+#define HTTPD_MAX_SOCKETS 4       // max_open_sockets
+#define HTTPD_MAX_URI_HANDLERS 44 // max_uri_handlers : 41 enregistrés avec ENABLE_TRACE
+
+#if defined(LED_GPIO_NUM)
+void enable_led(bool en)
+{ // Turn LED On or Off
+  int duty = en ? led_duty : 0;
+  if (en && isStreaming && (led_duty > CONFIG_LED_MAX_INTENSITY))
+  {
+    duty = CONFIG_LED_MAX_INTENSITY;
+  }
+  ledcWrite(LED_GPIO_NUM, duty);
+  // ledc_set_duty(CONFIG_LED_LEDC_SPEED_MODE, CONFIG_LED_LEDC_CHANNEL, duty);
+  // ledc_update_duty(CONFIG_LED_LEDC_SPEED_MODE, CONFIG_LED_LEDC_CHANNEL);
+  LOGR_I(LOG_MOD_CMD, "Set LED intensity to %d", duty);
+}
+#endif
+
+// Adresse IP du client (IPv4 affichée sous forme IPv6 mappée par lwIP)
+static void http_peer(httpd_req_t *req, char *buf, size_t len)
+{
+  struct sockaddr_in6 addr;
+  socklen_t addr_len = sizeof(addr);
+  buf[0] = 0;
+  if (getpeername(httpd_req_to_sockfd(req), (struct sockaddr *)&addr, &addr_len) == 0)
+  {
+    inet_ntop(AF_INET6, &addr.sin6_addr, buf, len);
+  }
+}
+
+// ===========================
+// Admission des connexions
+// ===========================
+// Les 4 sockets sont partagés entre connexions longues (/stream, /events) et contrôle
+// (/status, /control, proxy Django...) :
+//  - ADMIT_CONTROL_RESERVE sockets ne sont jamais pris par une connexion longue ;
+//  - chaque classe longue est plafonnée ; au-delà, 503 immédiat avec Retry-After ;
+//  - quand tous les sockets sont ouverts, le keep-alive de contrôle inactif depuis le
+//    plus longtemps est fermé pour garder une place libre.
+// Les flux tournent dans leurs propres tâches, sous la priorité de httpd.
+#define ADMIT_MAX_STREAMS 2
+#define ADMIT_MAX_EVENTS 2
+#define ADMIT_CONTROL_RESERVE 1
+#define ADMIT_IDLE_US (2 * 1000000LL) // Inactivité minimale avant éviction
+#define ADMIT_RETRY_AFTER "5"
+
+typedef enum
 {
-  size_t size;  // number of values used for filtering
-  size_t index; // current value index
-  size_t count; // value count
-  int sum;
-  int *values; // array to be filled with values
-} ra_filter_t;
+  ADMIT_STREAM = 0,
+  ADMIT_EVENTS,
+  ADMIT_CONTROL,
+  ADMIT_CLASS_COUNT
+} admit_class_t;
 
-static ra_filter_t ra_filter;
+typedef struct
+{
+  int fd; // -1 : libre
+  int64_t last_used;
+  std::atomic<bool> long_lived;
+} admit_sock_t;
+
+static admit_sock_t admit_socks[HTTPD_MAX_SOCKETS];
+static std::atomic<int> admit_active[ADMIT_CONTROL];
+static std::atomic<uint32_t> admit_admitted[ADMIT_CLASS_COUNT];
+static std::atomic<uint32_t> admit_rejected[ADMIT_CONTROL];
+static std::atomic<uint32_t> admit_evicted(0);
+static const int admit_limits[ADMIT_CONTROL] = {ADMIT_MAX_STREAMS, ADMIT_MAX_EVENTS};
+// Balayage /api/bench/camera en cours (compté comme flux) : /stream est refusé jusqu'à la fin
+static std::atomic<bool> bench_camera_running(false);
+
+static admit_sock_t *admit_find(int fd)
+{
+  for (int i = 0; i < HTTPD_MAX_SOCKETS; i++)
+  {
+    if (admit_socks[i].fd == fd)
+    {
+      return &admit_socks[i];
+    }
+  }
+  return NULL;
+}
 
-static ra_filter_t *ra_filter_init(ra_filter_t *filter, size_t sample_size)
+// Nouvelle connexion (tâche httpd) : profil socket "control", puis éviction si plein
+static esp_err_t http_open_fn(httpd_handle_t hd, int sockfd)
 {
-  memset(filter, 0, sizeof(ra_filter_t));
+  net_profile_apply(sockfd, &net_profile.control);
+  int64_t now = esp_timer_get_time();
+  int open = 0;
+  admit_sock_t *slot = admit_find(-1);
+  if (slot)
+  {
+    slot->fd = sockfd;
+    slot->last_used = now;
+    slot->long_lived = false;
+  }
+  admit_admitted[ADMIT_CONTROL]++;
+
+  admit_sock_t *lru = NULL;
+  for (int i = 0; i < HTTPD_MAX_SOCKETS; i++)
+  {
+    admit_sock_t *a = &admit_socks[i];
+    if (a->fd < 0)
+    {
+      continue;
+    }
+    open++;
+    if (a->fd != sockfd && !a->long_lived && now - a->last_used > ADMIT_IDLE_US && (!lru || a->last_used < lru->last_used))
+    {
+      lru = a;
+    }
+  }
+  if (open >= HTTPD_MAX_SOCKETS && lru)
+  {
+    LOGR_I(LOG_MOD_HTTP, "Admission: evicting idle socket %d", lru->fd);
+    httpd_sess_trigger_close(hd, lru->fd);
+    lru->long_lived = true; // Ne pas le choisir deux fois avant sa fermeture
+    admit_evicted++;
+  }
+  return ESP_OK;
+}
 
-  filter->values = (int *)malloc(sample_size * sizeof(int));
-  if (!filter->values)
+static void http_close_fn(httpd_handle_t hd, int sockfd)
+{
+  admit_sock_t *a = admit_find(sockfd);
+  if (a)
   {
-    return NULL;
+    a->fd = -1;
   }
-  memset(filter->values, 0, sample_size * sizeof(int));
+  close(sockfd);
+}
 
-  filter->size = sample_size;
-  return filter;
+// Activité sur un socket de contrôle (fin de requête)
+static void admit_touch(int sockfd)
+{
+  admit_sock_t *a = admit_find(sockfd);
+  if (a)
+  {
+    a->last_used = esp_timer_get_time();
+  }
 }
 
-#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-static int ra_filter_run(ra_filter_t *filter, int value)
+// Admet une connexion longue ; sinon répond 503 + Retry-After et retourne false.
+// Appelé depuis la tâche httpd : vérification et incrément ne peuvent pas s'entrelacer.
+static bool admit_long_lived(httpd_req_t *req, admit_class_t cls)
 {
-  if (!filter->values)
+  int long_lived = admit_active[ADMIT_STREAM].load() + admit_active[ADMIT_EVENTS].load();
+  if (admit_active[cls].load() >= admit_limits[cls] || long_lived >= HTTPD_MAX_SOCKETS - ADMIT_CONTROL_RESERVE)
   {
-    return value;
+    admit_rejected[cls]++;
+    http_set_status(req, "503 Service Unavailable");
+    httpd_resp_set_hdr(req, "Retry-After", ADMIT_RETRY_AFTER);
+    httpd_resp_send(req, NULL, 0);
+    return false;
   }
-  filter->sum -= filter->values[filter->index];
-  filter->values[filter->index] = value;
-  filter->sum += filter->values[filter->index];
-  filter->index++;
-  filter->index = filter->index % filter->size;
-  if (filter->count < filter->size)
+  admit_active[cls]++;
+  admit_admitted[cls]++;
+  admit_sock_t *a = admit_find(httpd_req_to_sockfd(req));
+  if (a)
   {
-    filter->count++;
+    a->long_lived = true;
   }
-  return filter->sum / filter->count;
+  return true;
 }
-#endif
 
-#if defined(LED_GPIO_NUM)
-void enable_led(bool en)
-{ // Turn LED On or Off
-  int duty = en ? led_duty : 0;
-  if (en && isStreaming && (led_duty > CONFIG_LED_MAX_INTENSITY))
+// Fin d'une connexion longue (tâche du flux ou de /events)
+static void admit_release(admit_class_t cls, int sockfd)
+{
+  admit_active[cls]--;
+  admit_sock_t *a = admit_find(sockfd);
+  if (a)
   {
-    duty = CONFIG_LED_MAX_INTENSITY;
+    a->last_used = esp_timer_get_time();
+    a->long_lived = false;
   }
-  ledcWrite(LED_GPIO_NUM, duty);
-  // ledc_set_duty(CONFIG_LED_LEDC_SPEED_MODE, CONFIG_LED_LEDC_CHANNEL, duty);
-  // ledc_update_duty(CONFIG_LED_LEDC_SPEED_MODE, CONFIG_LED_LEDC_CHANNEL);
-  log_i("Set LED intensity to %d", duty);
 }
-#endif
+
+static void admit_write(json_writer_t *w)
+{
+  static const char *names[ADMIT_CLASS_COUNT] = {"stream", "events", "control"};
+  json_begin_object(w);
+  json_kv_int(w, "streams", admit_active[ADMIT_STREAM].load());
+  json_kv_int(w, "events", admit_active[ADMIT_EVENTS].load());
+  json_key(w, "admitted");
+  json_begin_object(w);
+  for (int c = 0; c < ADMIT_CLASS_COUNT; c++)
+  {
+    json_kv_uint(w, names[c], admit_admitted[c].load());
+  }
+  json_end_object(w);
+  json_key(w, "rejected");
+  json_begin_object(w);
+  for (int c = 0; c < ADMIT_CONTROL; c++)
+  {
+    json_kv_uint(w, names[c], admit_rejected[c].load());
+  }
+  json_end_object(w);
+  json_kv_uint(w, "evicted", admit_evicted.load());
+  json_end_object(w);
+}
 
 static esp_err_t bmp_handler(httpd_req_t *req)
 {
   camera_fb_t *fb = NULL;
   esp_err_t res = ESP_OK;
-#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
   uint64_t fr_start = esp_timer_get_time();
-#endif
-  fb = esp_camera_fb_get();
+  int64_t t_get = esp_timer_get_time();
+  TRACE_BEGIN("fb_get");
+  fb = still_stream_fb_get();
+  TRACE_END("fb_get");
+  int64_t t_conv = esp_timer_get_time();
+  metrics_observe(METRIC_STAGE_FB_GET, METRIC_HANDLER_BMP, t_conv - t_get);
   if (!fb)
   {
-    log_e("Camera capture failed");
-    httpd_resp_send_500(req);
+    metrics_capture_failed();
+    LOGR_E(LOG_MOD_CAMERA, "Camera capture failed");
+    http_send_500(req);
     return ESP_FAIL;
   }
+  metrics_frame_captured(-1);
 
   httpd_resp_set_type(req, "image/x-windows-bmp");
   httpd_resp_set_hdr(req, "Content-Disposition", "inline; filename=capture.bmp");
@@ -450,20 +801,34 @@ static esp_err_t bmp_handler(httpd_req_t *req)
 
   uint8_t *buf = NULL;
   size_t buf_len = 0;
+  TRACE_BEGIN("frame2bmp");
   bool converted = frame2bmp(fb, &buf, &buf_len);
+  TRACE_END("frame2bmp");
   esp_camera_fb_return(fb);
+  int64_t t_send = esp_timer_get_time();
+  metrics_observe(METRIC_STAGE_JPEG, METRIC_HANDLER_BMP, t_send - t_conv);
   if (!converted)
   {
-    log_e("BMP Conversion failed");
-    httpd_resp_send_500(req);
+    metrics_frame_dropped(-1);
+    LOGR_E(LOG_MOD_CAMERA, "BMP Conversion failed");
+    http_send_500(req);
     return ESP_FAIL;
   }
+  TRACE_BEGIN("send");
   res = httpd_resp_send(req, (const char *)buf, buf_len);
+  TRACE_END("send");
+  metrics_observe(METRIC_STAGE_SEND, METRIC_HANDLER_BMP, esp_timer_get_time() - t_send);
+  if (res == ESP_OK)
+  {
+    metrics_frame_sent(-1, buf_len);
+  }
+  else
+  {
+    metrics_frame_dropped(-1);
+  }
   free(buf);
-#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
   uint64_t fr_end = esp_timer_get_time();
-#endif
-  log_i("BMP: %llums, %uB", (uint64_t)((fr_end - fr_start) / 1000), buf_len);
+  LOGR_I(LOG_MOD_CAMERA, "BMP: %llums, %uB", (uint64_t)((fr_end - fr_start) / 1000), buf_len);
   return res;
 }
 
@@ -474,7 +839,10 @@ static size_t jpg_encode_stream(void *arg, size_t index, const void *data, size_
   {
     j->len = 0;
   }
-  if (httpd_resp_send_chunk(j->req, (const char *)data, len) != ESP_OK)
+  TRACE_BEGIN("send_chunk");
+  esp_err_t res = httpd_resp_send_chunk(j->req, (const char *)data, len);
+  TRACE_END("send_chunk");
+  if (res != ESP_OK)
   {
     return 0;
   }
@@ -482,29 +850,135 @@ static size_t jpg_encode_stream(void *arg, size_t index, const void *data, size_
   return len;
 }
 
+// /capture?crop=x,y,w,h : découpe JPEG sans perte (jpeg_crop.h), pixels de la framesize.
+// ESP_ERR_NO_MEM si la requête ne peut être copiée, ESP_ERR_INVALID_ARG si crop= est mal formé
+static esp_err_t capture_crop_parse(httpd_req_t *req, bool *crop, jpeg_rect_t *rect)
+{
+  char value[32];
+  *crop = false;
+  size_t query_len = httpd_req_get_url_query_len(req) + 1;
+  if (query_len <= 1)
+  {
+    return ESP_OK;
+  }
+  char *query = (char *)malloc(query_len);
+  if (!query)
+  {
+    return ESP_ERR_NO_MEM;
+  }
+  esp_err_t found = httpd_req_get_url_query_str(req, query, query_len);
+  if (found == ESP_OK)
+  {
+    found = httpd_query_key_value(query, "crop", value, sizeof(value));
+  }
+  free(query);
+  if (found == ESP_ERR_NOT_FOUND)
+  {
+    return ESP_OK;
+  }
+  if (found != ESP_OK)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  // Virgules éventuellement encodées (%2C) par le client
+  char *d = value;
+  for (const char *c = value; *c; c++, d++)
+  {
+    if (c[0] == '%' && c[1] == '2' && (c[2] == 'C' || c[2] == 'c'))
+    {
+      c += 2;
+      *d = ',';
+    }
+    else
+    {
+      *d = *c;
+    }
+  }
+  *d = '\0';
+  unsigned x, y, w, h;
+  char end;
+  if (sscanf(value, "%u,%u,%u,%u%c", &x, &y, &w, &h, &end) != 4 || !w || !h || x > UINT16_MAX || y > UINT16_MAX || w > UINT16_MAX || h > UINT16_MAX)
+  {
+    return ESP_ERR_INVALID_ARG;
+  }
+  *rect = {(uint16_t)x, (uint16_t)y, (uint16_t)w, (uint16_t)h};
+  *crop = true;
+  return ESP_OK;
+}
+
+// Découpe de fb puis retour du tampon caméra avant l'envoi ; *out à libérer.
+// *actual : rectangle réellement livré (aligné sur les MCU), *crop_us : coût
+static esp_err_t capture_crop(httpd_req_t *req, camera_fb_t *fb, const jpeg_rect_t *rect, uint8_t **out, size_t *out_len, jpeg_rect_t *actual, int64_t *crop_us)
+{
+  size_t out_size = fb->len + JPEG_CROP_SLACK(fb->len);
+  *out = (uint8_t *)heap_caps_malloc(out_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  if (!*out)
+  {
+    *out = (uint8_t *)malloc(out_size);
+  }
+  int64_t t0 = esp_timer_get_time();
+  TRACE_BEGIN("jpeg_crop");
+  jpeg_crop_err_t err = *out ? jpeg_crop(fb->buf, fb->len, rect, *out, out_size, out_len, actual) : JPEG_CROP_NO_MEMORY;
+  TRACE_END("jpeg_crop");
+  *crop_us = esp_timer_get_time() - t0;
+  metrics_observe(METRIC_STAGE_JPEG, METRIC_HANDLER_CAPTURE, *crop_us);
+  esp_camera_fb_return(fb);
+  if (err != JPEG_CROP_OK)
+  {
+    free(*out);
+    *out = NULL;
+    LOGR_W(LOG_MOD_CAMERA, "Découpe %u,%u %ux%u : %s", rect->x, rect->y, rect->w, rect->h, jpeg_crop_strerror(err));
+    http_send_err(req, err == JPEG_CROP_OUTSIDE ? HTTPD_400_BAD_REQUEST : HTTPD_500_INTERNAL_SERVER_ERROR, jpeg_crop_strerror(err));
+    return ESP_FAIL;
+  }
+  return ESP_OK;
+}
+
 static esp_err_t capture_handler(httpd_req_t *req)
 {
   camera_fb_t *fb = NULL;
   esp_err_t res = ESP_OK;
-#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
   int64_t fr_start = esp_timer_get_time();
-#endif
+  bool crop = false;
+  jpeg_rect_t crop_rect;
+  esp_err_t parsed = capture_crop_parse(req, &crop, &crop_rect);
+  if (parsed == ESP_ERR_NO_MEM)
+  {
+    http_send_500(req);
+    return ESP_FAIL;
+  }
+  if (parsed != ESP_OK)
+  {
+    http_send_err(req, HTTPD_400_BAD_REQUEST, "crop=x,y,w,h attendu");
+    return ESP_FAIL;
+  }
 
 #if defined(LED_GPIO_NUM)
   enable_led(true);
   vTaskDelay(150 / portTICK_PERIOD_MS); // The LED needs to be turned on ~150ms before the call to esp_camera_fb_get()
-  fb = esp_camera_fb_get();             // or it won't be visible in the frame. A better way to do this is needed.
+  int64_t t_get = esp_timer_get_time();
+  TRACE_BEGIN("fb_get");
+  fb = still_stream_fb_get(); // or it won't be visible in the frame. A better way to do this is needed.
+  TRACE_END("fb_get");
   enable_led(false);
 #else
-  fb = esp_camera_fb_get();
+  int64_t t_get = esp_timer_get_time();
+  TRACE_BEGIN("fb_get");
+  fb = still_stream_fb_get();
+  TRACE_END("fb_get");
 #endif
+  int64_t t_send = esp_timer_get_time();
+  metrics_observe(METRIC_STAGE_FB_GET, METRIC_HANDLER_CAPTURE, t_send - t_get);
 
   if (!fb)
   {
-    log_e("Camera capture failed");
-    httpd_resp_send_500(req);
+    metrics_capture_failed();
+    LOGR_E(LOG_MOD_CAMERA, "Camera capture failed");
+    http_send_500(req);
     return ESP_FAIL;
   }
+  metrics_frame_captured(-1);
+  boot_mark_first_frame();
 
   httpd_resp_set_type(req, "image/jpeg");
   httpd_resp_set_hdr(req, "Content-Disposition", "inline; filename=capture.jpg");
@@ -514,47 +988,157 @@ static esp_err_t capture_handler(httpd_req_t *req)
   snprintf(ts, 32, "%lld.%06ld", fb->timestamp.tv_sec, fb->timestamp.tv_usec);
   httpd_resp_set_hdr(req, "X-Timestamp", (const char *)ts);
 
-#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
   size_t fb_len = 0;
-#endif
+  if (crop && fb->format != PIXFORMAT_JPEG)
+  {
+    esp_camera_fb_return(fb);
+    metrics_frame_dropped(-1);
+    http_send_err(req, HTTPD_400_BAD_REQUEST, "crop : capteur hors JPEG");
+    return ESP_FAIL;
+  }
+  if (crop)
+  {
+    uint8_t *out = NULL;
+    size_t out_len = 0;
+    jpeg_rect_t actual = {};
+    int64_t crop_us = 0;
+    if (capture_crop(req, fb, &crop_rect, &out, &out_len, &actual, &crop_us) != ESP_OK)
+    {
+      metrics_frame_dropped(-1);
+      return ESP_FAIL;
+    }
+    char crop_hdr[24];
+    char crop_us_hdr[12];
+    snprintf(crop_hdr, sizeof(crop_hdr), "%u,%u,%u,%u", actual.x, actual.y, actual.w, actual.h);
+    snprintf(crop_us_hdr, sizeof(crop_us_hdr), "%lld", (long long)crop_us);
+    httpd_resp_set_hdr(req, "X-Crop", crop_hdr);
+    httpd_resp_set_hdr(req, "X-Crop-Us", crop_us_hdr);
+    int64_t t_crop = esp_timer_get_time();
+    TRACE_BEGIN("send");
+    res = httpd_resp_send(req, (const char *)out, out_len);
+    TRACE_END("send");
+    metrics_observe(METRIC_STAGE_SEND, METRIC_HANDLER_CAPTURE, esp_timer_get_time() - t_crop);
+    free(out);
+    if (res == ESP_OK)
+    {
+      metrics_frame_sent(-1, out_len);
+    }
+    else
+    {
+      metrics_frame_dropped(-1);
+    }
+    int64_t fr_end = esp_timer_get_time();
+    LOGR_I(LOG_MOD_CAMERA, "JPG découpé %u,%u %ux%u: %uB %ums", actual.x, actual.y, actual.w, actual.h, (uint32_t)out_len, (uint32_t)((fr_end - fr_start) / 1000));
+    return res;
+  }
   if (fb->format == PIXFORMAT_JPEG)
   {
-#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
     fb_len = fb->len;
-#endif
+    TRACE_BEGIN("send");
     res = httpd_resp_send(req, (const char *)fb->buf, fb->len);
+    TRACE_END("send");
+    metrics_observe(METRIC_STAGE_SEND, METRIC_HANDLER_CAPTURE, esp_timer_get_time() - t_send);
+    if (res == ESP_OK)
+    {
+      metrics_frame_sent(-1, fb->len);
+    }
   }
   else
   {
+    // Encodage et envoi entrelacés : mesurés ensemble comme conversion JPEG
     jpg_chunking_t jchunk = {req, 0};
+    TRACE_BEGIN("frame2jpg");
     res = frame2jpg_cb(fb, 80, jpg_encode_stream, &jchunk) ? ESP_OK : ESP_FAIL;
+    TRACE_END("frame2jpg");
     httpd_resp_send_chunk(req, NULL, 0);
-#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
+    metrics_observe(METRIC_STAGE_JPEG, METRIC_HANDLER_CAPTURE, esp_timer_get_time() - t_send);
+    if (res == ESP_OK)
+    {
+      metrics_frame_sent(-1, jchunk.len);
+    }
     fb_len = jchunk.len;
-#endif
+  }
+  if (res != ESP_OK)
+  {
+    metrics_frame_dropped(-1);
   }
   esp_camera_fb_return(fb);
-#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
   int64_t fr_end = esp_timer_get_time();
-#endif
-  log_i("JPG: %uB %ums", (uint32_t)(fb_len), (uint32_t)((fr_end - fr_start) / 1000));
+  LOGR_I(LOG_MOD_CAMERA, "JPG: %uB %ums", (uint32_t)(fb_len), (uint32_t)((fr_end - fr_start) / 1000));
   return res;
 }
 
-static esp_err_t stream_handler(httpd_req_t *req)
+// Mode d'un client /stream : caméra (avec enregistrement optionnel) ou relecture
+typedef enum
 {
-  camera_fb_t *fb = NULL;
-  struct timeval _timestamp;
-  esp_err_t res = ESP_OK;
-  size_t _jpg_buf_len = 0;
-  uint8_t *_jpg_buf = NULL;
-  char *part_buf[128];
+  STREAM_LIVE = 0,
+  STREAM_REPLAY_ORIG, // Relecture au rythme des horodatages enregistrés
+  STREAM_REPLAY_MAX,  // Relecture aussi vite que l'envoi le permet
+} stream_mode_t;
 
-  static int64_t last_frame = 0;
-  if (!last_frame)
-  {
-    last_frame = esp_timer_get_time();
-  }
+static int parse_get_var(char *buf, const char *key, int def);
+static void stream_record_settings(uint32_t *recorded_version);
+
+// Image suivante de l'enregistrement, à l'heure d'origine en mode STREAM_REPLAY_ORIG
+static bool stream_replay_next(rec_cursor_t *cursor, stream_mode_t mode, bool loop, int64_t *t0, int64_t *first_us, const rec_frame_t **hdr, const uint8_t **jpg)
+{
+  if (!recorder_next_frame(cursor, hdr, jpg))
+  {
+    recorder_rewind(cursor);
+    if (!loop || !recorder_next_frame(cursor, hdr, jpg))
+    {
+      return false;
+    }
+  }
+  if (cursor->frame == 1)
+  {
+    *t0 = esp_timer_get_time();
+    *first_us = (*hdr)->capture_us;
+  }
+  if (mode == STREAM_REPLAY_ORIG)
+  {
+    int64_t wait = *t0 + ((*hdr)->capture_us - *first_us) - esp_timer_get_time();
+    if (wait > 1000)
+    {
+      vTaskDelay(pdMS_TO_TICKS(wait / 1000));
+    }
+  }
+  return true;
+}
+
+// Client /stream confié à sa tâche (requête asynchrone)
+typedef struct
+{
+  httpd_req_t *req;
+  stream_mode_t mode;
+  bool loop;
+  bool recorder; // Détient le tampon d'enregistrement (écriture ou relecture)
+} stream_job_t;
+
+static esp_err_t stream_run(stream_job_t *job)
+{
+  httpd_req_t *req = job->req;
+  stream_mode_t mode = job->mode;
+  camera_fb_t *fb = NULL;
+  struct timeval _timestamp;
+  esp_err_t res = ESP_OK;
+  size_t _jpg_buf_len = 0;
+  uint8_t *_jpg_buf = NULL;
+  char *part_buf[128];
+
+  bool recording = mode == STREAM_LIVE && job->recorder;
+  uint32_t recorded_version = status_version() - 1;
+  rec_cursor_t cursor;
+  int64_t replay_t0 = 0;
+  int64_t replay_first_us = 0;
+  recorder_rewind(&cursor);
+
+  // Statistiques propres à ce client
+  int64_t last_frame = esp_timer_get_time();
+  uint32_t frames = 0;
+  WindowMean<uint32_t, STREAM_AVG_FRAMES> avg_frame;
+  LogHistogram<> frame_hist;
+  LogHistogram<> send_hist;
 
   res = httpd_resp_set_type(req, _STREAM_CONTENT_TYPE);
   if (res != ESP_OK)
@@ -565,6 +1149,11 @@ static esp_err_t stream_handler(httpd_req_t *req)
   httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
   httpd_resp_set_hdr(req, "X-Framerate", "60");
 
+  char peer[48];
+  http_peer(req, peer, sizeof(peer));
+  int client = metrics_client_begin(httpd_req_to_sockfd(req), peer);
+  net_profile_apply(httpd_req_to_sockfd(req), &net_profile.stream);
+
 #if defined(LED_GPIO_NUM)
   isStreaming = true;
   enable_led(true);
@@ -572,24 +1161,58 @@ static esp_err_t stream_handler(httpd_req_t *req)
 
   while (true)
   {
-    fb = esp_camera_fb_get();
-    if (!fb)
+    rec_frame_t *rec = NULL;
+    int64_t t_get = esp_timer_get_time();
+    if (mode != STREAM_LIVE)
     {
-      log_e("Camera capture failed");
-      res = ESP_FAIL;
+      const rec_frame_t *hdr;
+      const uint8_t *jpg;
+      if (!stream_replay_next(&cursor, mode, job->loop, &replay_t0, &replay_first_us, &hdr, &jpg))
+      {
+        break;
+      }
+      _jpg_buf = (uint8_t *)jpg;
+      _jpg_buf_len = hdr->len;
+      _timestamp.tv_sec = hdr->capture_us / 1000000;
+      _timestamp.tv_usec = hdr->capture_us % 1000000;
     }
     else
     {
+      TRACE_BEGIN("fb_get");
+      // Retenu pendant une bascule vers la taille photo (still_capture.h)
+      fb = still_stream_fb_get();
+      TRACE_END("fb_get");
+    }
+    int64_t t_send = esp_timer_get_time();
+    if (mode == STREAM_LIVE)
+    {
+      metrics_observe(METRIC_STAGE_FB_GET, METRIC_HANDLER_STREAM, t_send - t_get);
+    }
+    if (mode == STREAM_LIVE && !fb)
+    {
+      metrics_capture_failed();
+      LOGR_E(LOG_MOD_STREAM, "Camera capture failed");
+      res = ESP_FAIL;
+    }
+    else if (fb)
+    {
+      metrics_frame_captured(client);
+      boot_mark_first_frame();
       _timestamp.tv_sec = fb->timestamp.tv_sec;
       _timestamp.tv_usec = fb->timestamp.tv_usec;
       if (fb->format != PIXFORMAT_JPEG)
       {
+        TRACE_BEGIN("frame2jpg");
         bool jpeg_converted = frame2jpg(fb, 80, &_jpg_buf, &_jpg_buf_len);
+        TRACE_END("frame2jpg");
         esp_camera_fb_return(fb);
         fb = NULL;
+        int64_t t_conv = t_send;
+        t_send = esp_timer_get_time();
+        metrics_observe(METRIC_STAGE_JPEG, METRIC_HANDLER_STREAM, t_send - t_conv);
         if (!jpeg_converted)
         {
-          log_e("JPEG compression failed");
+          LOGR_E(LOG_MOD_STREAM, "JPEG compression failed");
           res = ESP_FAIL;
         }
       }
@@ -598,19 +1221,50 @@ static esp_err_t stream_handler(httpd_req_t *req)
         _jpg_buf_len = fb->len;
         _jpg_buf = fb->buf;
       }
+      if (recording && res == ESP_OK)
+      {
+        stream_record_settings(&recorded_version);
+        rec = recorder_add_frame(_jpg_buf, _jpg_buf_len, (int64_t)_timestamp.tv_sec * 1000000 + _timestamp.tv_usec, t_send - t_get);
+        recording = rec != NULL;
+      }
     }
     if (res == ESP_OK)
     {
+      TRACE_BEGIN("send_chunk");
       res = httpd_resp_send_chunk(req, _STREAM_BOUNDARY, strlen(_STREAM_BOUNDARY));
+      TRACE_END("send_chunk");
     }
     if (res == ESP_OK)
     {
       size_t hlen = snprintf((char *)part_buf, 128, _STREAM_PART, _jpg_buf_len, _timestamp.tv_sec, _timestamp.tv_usec);
+      TRACE_BEGIN("send_chunk");
       res = httpd_resp_send_chunk(req, (const char *)part_buf, hlen);
+      TRACE_END("send_chunk");
     }
     if (res == ESP_OK)
     {
+      TRACE_BEGIN("send_chunk");
       res = httpd_resp_send_chunk(req, (const char *)_jpg_buf, _jpg_buf_len);
+      TRACE_END("send_chunk");
+      uint32_t send_us = esp_timer_get_time() - t_send;
+      metrics_observe(METRIC_STAGE_SEND, METRIC_HANDLER_STREAM, send_us);
+      if (res == ESP_OK)
+      {
+        metrics_frame_sent(client, _jpg_buf_len);
+        send_hist.add(send_us);
+      }
+      if (rec)
+      {
+        rec->send_us = send_us;
+      }
+    }
+    if (mode != STREAM_LIVE)
+    {
+      _jpg_buf = NULL; // Appartient à l'enregistrement
+    }
+    if (res != ESP_OK && (fb || _jpg_buf))
+    {
+      metrics_frame_dropped(client);
     }
     if (fb)
     {
@@ -625,31 +1279,166 @@ static esp_err_t stream_handler(httpd_req_t *req)
     }
     if (res != ESP_OK)
     {
-      log_e("Send frame failed");
+      LOGR_E(LOG_MOD_STREAM, "Send frame failed");
       break;
     }
+    event_check_heap();
     int64_t fr_end = esp_timer_get_time();
 
     int64_t frame_time = fr_end - last_frame;
     last_frame = fr_end;
+    frame_hist.add(frame_time);
 
     frame_time /= 1000;
-#if ARDUHAL_LOG_LEVEL >= ARDUHAL_LOG_LEVEL_INFO
-    uint32_t avg_frame_time = ra_filter_run(&ra_filter, frame_time);
-#endif
-    log_i(
-        "MJPG: %uB %ums (%.1ffps), AVG: %ums (%.1ffps)", (uint32_t)(_jpg_buf_len), (uint32_t)frame_time, 1000.0 / (uint32_t)frame_time, avg_frame_time,
+    uint32_t avg_frame_time = avg_frame.add(frame_time);
+    LOGR_D(
+        LOG_MOD_STREAM, "MJPG: %uB %ums (%.1ffps), AVG: %ums (%.1ffps)", (uint32_t)(_jpg_buf_len), (uint32_t)frame_time, 1000.0 / (uint32_t)frame_time, avg_frame_time,
         1000.0 / avg_frame_time);
+    if (++frames % STREAM_STATS_PERIOD == 0)
+    {
+      LOGR_I(
+          LOG_MOD_STREAM, "MJPG p50/p95/p99: frame %u/%u/%ums, send %u/%u/%ums", frame_hist.quantile(0.5f) / 1000, frame_hist.quantile(0.95f) / 1000,
+          frame_hist.quantile(0.99f) / 1000, send_hist.quantile(0.5f) / 1000, send_hist.quantile(0.95f) / 1000, send_hist.quantile(0.99f) / 1000);
+    }
   }
 
 #if defined(LED_GPIO_NUM)
-  isStreaming = false;
-  enable_led(false);
+  isStreaming = admit_active[ADMIT_STREAM].load() > 1;
+  enable_led(isStreaming);
 #endif
 
+  if (res == ESP_OK)
+  {
+    // Fin de relecture : termine proprement la réponse chunked
+    res = httpd_resp_send_chunk(req, NULL, 0);
+  }
+  if (mode == STREAM_LIVE && job->recorder)
+  {
+    recorder_stop();
+  }
+  metrics_client_end(client);
   return res;
 }
 
+static void stream_task(void *arg)
+{
+  stream_job_t *job = (stream_job_t *)arg;
+  int sockfd = httpd_req_to_sockfd(job->req);
+  stream_run(job);
+  if (job->recorder)
+  {
+    recorder_release();
+  }
+  admit_release(ADMIT_STREAM, sockfd);
+  httpd_req_async_handler_complete(job->req);
+  free(job);
+  vTaskDelete(NULL);
+}
+
+// Handler GET /stream : admission, puis transfert de la requête à une tâche dédiée
+// pour que la tâche httpd reste disponible pour le contrôle.
+//  /stream?record=N[&kb=K] : enregistre les N prochaines images (0 = jusqu'à remplir le tampon)
+//  /stream?replay=orig|max[&loop=1] : rejoue le dernier enregistrement au lieu de la caméra
+static esp_err_t stream_handler(httpd_req_t *req)
+{
+  stream_job_t job = {};
+  job.mode = STREAM_LIVE;
+  char query[64];
+  char value[12];
+  bool record = false;
+  int record_frames = 0;
+  int record_kb = RECORDER_DEFAULT_KB;
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK)
+  {
+    if (httpd_query_key_value(query, "replay", value, sizeof(value)) == ESP_OK)
+    {
+      job.mode = strcmp(value, "max") ? STREAM_REPLAY_ORIG : STREAM_REPLAY_MAX;
+      job.loop = parse_get_var(query, "loop", 0) == 1;
+    }
+    else if (httpd_query_key_value(query, "record", value, sizeof(value)) == ESP_OK)
+    {
+      record = true;
+      record_frames = atoi(value);
+      record_kb = parse_get_var(query, "kb", RECORDER_DEFAULT_KB);
+    }
+  }
+
+  if (job.mode != STREAM_LIVE && !recorder_frames())
+  {
+    return http_send_404(req);
+  }
+  if (bench_camera_running)
+  {
+    // Balayage /api/bench/camera : un flux fausserait ses mesures
+    http_set_status(req, "503 Service Unavailable");
+    httpd_resp_set_hdr(req, "Retry-After", ADMIT_RETRY_AFTER);
+    return httpd_resp_sendstr(req, "Balayage caméra en cours");
+  }
+  if (!admit_long_lived(req, ADMIT_STREAM))
+  {
+    return ESP_OK;
+  }
+  int sockfd = httpd_req_to_sockfd(req);
+  if (job.mode != STREAM_LIVE)
+  {
+    job.recorder = recorder_acquire();
+    if (!job.recorder)
+    {
+      admit_release(ADMIT_STREAM, sockfd);
+      http_set_status(req, "503 Service Unavailable");
+      httpd_resp_set_hdr(req, "Retry-After", ADMIT_RETRY_AFTER);
+      return httpd_resp_send(req, NULL, 0);
+    }
+  }
+  else if (record)
+  {
+    esp_err_t err = recorder_start((size_t)record_kb * 1024, record_frames);
+    if (err != ESP_OK)
+    {
+      admit_release(ADMIT_STREAM, sockfd);
+      if (err == ESP_ERR_INVALID_STATE)
+      {
+        http_set_status(req, "503 Service Unavailable");
+        httpd_resp_set_hdr(req, "Retry-After", ADMIT_RETRY_AFTER);
+        return httpd_resp_send(req, NULL, 0);
+      }
+      http_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Tampon d'enregistrement indisponible");
+      return ESP_FAIL;
+    }
+    job.recorder = true;
+  }
+
+  stream_job_t *task_job = (stream_job_t *)malloc(sizeof(stream_job_t));
+  if (task_job)
+  {
+    *task_job = job;
+  }
+  if (!task_job || httpd_req_async_handler_begin(req, &task_job->req) != ESP_OK)
+  {
+    free(task_job);
+    if (job.recorder)
+    {
+      recorder_release();
+    }
+    admit_release(ADMIT_STREAM, sockfd);
+    return http_send_500(req);
+  }
+  task_job->req->user_ctx = NULL; // Contexte de statut sur la pile de metered_handler
+  if (task_create(TASK_STREAM, stream_task, task_job) != pdPASS)
+  {
+    LOGR_E(LOG_MOD_STREAM, "Stream task creation failed");
+    if (job.recorder)
+    {
+      recorder_release();
+    }
+    admit_release(ADMIT_STREAM, sockfd);
+    httpd_req_async_handler_complete(task_job->req);
+    free(task_job);
+    return ESP_FAIL;
+  }
+  return ESP_OK;
+}
+
 static esp_err_t parse_get(httpd_req_t *req, char **obuf)
 {
   char *buf = NULL;
@@ -661,7 +1450,7 @@ static esp_err_t parse_get(httpd_req_t *req, char **obuf)
     buf = (char *)malloc(buf_len);
     if (!buf)
     {
-      httpd_resp_send_500(req);
+      http_send_500(req);
       return ESP_FAIL;
     }
     if (httpd_req_get_url_query_str(req, buf, buf_len) == ESP_OK)
@@ -671,16 +1460,13 @@ static esp_err_t parse_get(httpd_req_t *req, char **obuf)
     }
     free(buf);
   }
-  httpd_resp_send_404(req);
+  http_send_404(req);
   return ESP_FAIL;
 }
 
 static esp_err_t cmd_handler(httpd_req_t *req)
 {
-  Serial.printf("[cmd_handler] req ptr: %p\n", req);
-  Serial.printf("[cmd_handler] req->uri: %s\n", req->uri ? req->uri : "(null)");
-  Serial.printf("[cmd_handler] req->method: %d\n", req->method);
-  Serial.printf("[cmd_handler] req->content_len: %d\n", req->content_len);
+  LOGR_D(LOG_MOD_CMD, "req %p uri=%s method=%d content_len=%d", req, req->uri ? req->uri : "(null)", req->method, req->content_len);
 
   char *buf = NULL;
   char variable[32];
@@ -693,26 +1479,28 @@ static esp_err_t cmd_handler(httpd_req_t *req)
   if (httpd_query_key_value(buf, "var", variable, sizeof(variable)) != ESP_OK || httpd_query_key_value(buf, "val", value, sizeof(value)) != ESP_OK)
   {
     free(buf);
-    httpd_resp_send_404(req);
+    http_send_404(req);
     return ESP_FAIL;
   }
   free(buf);
-  // Affiche la commande reçue sur le Serial Monitor
-  Serial.print("[cmd_uri] Commande reçue: var=");
-  Serial.print(variable);
-  Serial.print(", val=");
-  Serial.println(value);
-
   int val = atoi(value);
-  log_i("%s = %d", variable, val);
+  // Commande reçue, affichée par la tâche de journal (hors du chemin de la requête)
+  LOGR_I(LOG_MOD_CMD, "Commande reçue: %s = %d", variable, val);
   sensor_t *s = esp_camera_sensor_get();
   int res = 0;
 
+  TRACE_BEGIN("settings_write");
+  sensor_lock();
   if (!strcmp(variable, "framesize"))
   {
     if (s->pixformat == PIXFORMAT_JPEG)
     {
       res = s->set_framesize(s, (framesize_t)val);
+      // Plein champ après set_framesize : ROI recalculée pour la nouvelle taille
+      if (!res)
+      {
+        camera_window_restore();
+      }
     }
   }
   else if (!strcmp(variable, "quality"))
@@ -819,120 +1607,185 @@ static esp_err_t cmd_handler(httpd_req_t *req)
 #endif
   else
   {
-    log_i("Unknown command: %s", variable);
+    LOGR_I(LOG_MOD_CMD, "Unknown command: %s", variable);
     res = -1;
   }
+  sensor_unlock();
+  TRACE_END("settings_write");
 
   if (res < 0)
   {
-    return httpd_resp_send_500(req);
+    return http_send_500(req);
   }
+  settings_changed(variable);
 
   httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
   return httpd_resp_send(req, NULL, 0);
 }
 
-static int print_reg(char *p, sensor_t *s, uint16_t reg, uint32_t mask)
+// Cache du document /status : reconstruit seulement quand status_version change.
+// Les registres bruts ne sont plus inclus ici : voir /api/regs.
+#define STATUS_CACHE_SIZE 1024
+#define STATUS_CHUNK_SIZE 256
+
+static char status_cache[STATUS_CACHE_SIZE];
+static size_t status_cache_len = 0;
+static uint32_t status_cache_version = 0;
+static bool status_cache_valid = false;
+static char status_etag[24];
+
+static void status_write(json_writer_t *w, sensor_t *s)
+{
+  json_begin_object(w);
+  json_kv_uint(w, "xclk", s->xclk_freq_hz / 1000000);
+  json_kv_uint(w, "pixformat", s->pixformat);
+  json_kv_uint(w, "framesize", s->status.framesize);
+  json_kv_bool(w, "roi", camera_window_roi());
+  json_kv_uint(w, "quality", s->status.quality);
+  json_kv_int(w, "brightness", s->status.brightness);
+  json_kv_int(w, "contrast", s->status.contrast);
+  json_kv_int(w, "saturation", s->status.saturation);
+  json_kv_int(w, "sharpness", s->status.sharpness);
+  json_kv_uint(w, "special_effect", s->status.special_effect);
+  json_kv_uint(w, "wb_mode", s->status.wb_mode);
+  json_kv_uint(w, "awb", s->status.awb);
+  json_kv_uint(w, "awb_gain", s->status.awb_gain);
+  json_kv_uint(w, "aec", s->status.aec);
+  json_kv_uint(w, "aec2", s->status.aec2);
+  json_kv_int(w, "ae_level", s->status.ae_level);
+  json_kv_uint(w, "aec_value", s->status.aec_value);
+  json_kv_uint(w, "agc", s->status.agc);
+  json_kv_uint(w, "agc_gain", s->status.agc_gain);
+  json_kv_uint(w, "gainceiling", s->status.gainceiling);
+  json_kv_uint(w, "bpc", s->status.bpc);
+  json_kv_uint(w, "wpc", s->status.wpc);
+  json_kv_uint(w, "raw_gma", s->status.raw_gma);
+  json_kv_uint(w, "lenc", s->status.lenc);
+  json_kv_uint(w, "hmirror", s->status.hmirror);
+  json_kv_uint(w, "vflip", s->status.vflip);
+  json_kv_uint(w, "dcw", s->status.dcw);
+  json_kv_uint(w, "colorbar", s->status.colorbar);
+#if defined(LED_GPIO_NUM)
+  json_kv_int(w, "led_intensity", led_duty);
+#else
+  json_kv_int(w, "led_intensity", -1);
+#endif
+  json_end_object(w);
+}
+
+// Reconstruit le cache si la version a changé ; retourne false si le document n'y tient pas.
+// Sous sensor_lock : une bascule photo ou un banc caméra en cours finit (et incrémente la
+// version) avant la lecture, le cache ne garde jamais un état transitoire
+static bool status_refresh(sensor_t *s)
 {
-  return sprintf(p, "\"0x%x\":%u,", reg, s->get_reg(s, reg, mask));
+  sensor_lock();
+  uint32_t version = status_version();
+  if (!status_cache_valid || status_cache_version != version)
+  {
+    json_writer_t w;
+    json_writer_init(&w, status_cache, sizeof(status_cache));
+    status_write(&w, s);
+    status_cache_valid = json_writer_finish(&w) == ESP_OK;
+    status_cache_len = w.len;
+    status_cache_version = version;
+    // L'identifiant de démarrage évite un faux 304 après un redémarrage (version remise à 0)
+    static uint32_t boot_id = esp_random();
+    snprintf(status_etag, sizeof(status_etag), "\"%08lx-%lu\"", (unsigned long)boot_id, (unsigned long)version);
+  }
+  sensor_unlock();
+  return status_cache_valid;
 }
 
 static esp_err_t status_handler(httpd_req_t *req)
 {
-  static char json_response[1024];
   sensor_t *s = esp_camera_sensor_get();
-  char *p = json_response;
-  *p++ = '{';
-  int first = 1;
-
-// Ajout des registres (optionnel, peut être commenté si non utile)
-/*
-if (s->id.PID == OV5640_PID || s->id.PID == OV3660_PID) {
-  for (int reg = 0x3400; reg < 0x3406; reg += 2) {
-    if (!first) p += sprintf(p, ","); first = 0;
-    p += print_reg(p, s, reg, 0xFFF);
-  }
-  if (!first) p += sprintf(p, ","); first = 0;
-  p += print_reg(p, s, 0x3406, 0xFF);
-  if (!first) p += sprintf(p, ","); first = 0;
-  p += print_reg(p, s, 0x3500, 0xFFFF0);
-  if (!first) p += sprintf(p, ","); first = 0;
-  p += print_reg(p, s, 0x3503, 0xFF);
-  if (!first) p += sprintf(p, ","); first = 0;
-  p += print_reg(p, s, 0x350a, 0x3FF);
-  if (!first) p += sprintf(p, ","); first = 0;
-  p += print_reg(p, s, 0x350c, 0xFFFF);
-  for (int reg = 0x5480; reg <= 0x5490; reg++) {
-    if (!first) p += sprintf(p, ","); first = 0;
-    p += print_reg(p, s, reg, 0xFF);
-  }
-  for (int reg = 0x5380; reg <= 0x538b; reg++) {
-    if (!first) p += sprintf(p, ","); first = 0;
-    p += print_reg(p, s, reg, 0xFF);
-  }
-  for (int reg = 0x5580; reg < 0x558a; reg++) {
-    if (!first) p += sprintf(p, ","); first = 0;
-    p += print_reg(p, s, reg, 0xFF);
-  }
-  if (!first) p += sprintf(p, ","); first = 0;
-  p += print_reg(p, s, 0x558a, 0x1FF);
-} else if (s->id.PID == OV2640_PID) {
-  if (!first) p += sprintf(p, ","); first = 0;
-  p += print_reg(p, s, 0xd3, 0xFF);
-  if (!first) p += sprintf(p, ","); first = 0;
-  p += print_reg(p, s, 0x111, 0xFF);
-  if (!first) p += sprintf(p, ","); first = 0;
-  p += print_reg(p, s, 0x132, 0xFF);
-}
-*/
-
-// Ajout des champs principaux
-#define ADD_FIELD(fmt, ...)            \
-  do                                   \
-  {                                    \
-    if (!first)                        \
-      p += sprintf(p, ",");            \
-    p += sprintf(p, fmt, __VA_ARGS__); \
-    first = 0;                         \
-  } while (0)
-  ADD_FIELD("\"xclk\":%u", s->xclk_freq_hz / 1000000);
-  ADD_FIELD("\"pixformat\":%u", s->pixformat);
-  ADD_FIELD("\"framesize\":%u", s->status.framesize);
-  ADD_FIELD("\"quality\":%u", s->status.quality);
-  ADD_FIELD("\"brightness\":%d", s->status.brightness);
-  ADD_FIELD("\"contrast\":%d", s->status.contrast);
-  ADD_FIELD("\"saturation\":%d", s->status.saturation);
-  ADD_FIELD("\"sharpness\":%d", s->status.sharpness);
-  ADD_FIELD("\"special_effect\":%u", s->status.special_effect);
-  ADD_FIELD("\"wb_mode\":%u", s->status.wb_mode);
-  ADD_FIELD("\"awb\":%u", s->status.awb);
-  ADD_FIELD("\"awb_gain\":%u", s->status.awb_gain);
-  ADD_FIELD("\"aec\":%u", s->status.aec);
-  ADD_FIELD("\"aec2\":%u", s->status.aec2);
-  ADD_FIELD("\"ae_level\":%d", s->status.ae_level);
-  ADD_FIELD("\"aec_value\":%u", s->status.aec_value);
-  ADD_FIELD("\"agc\":%u", s->status.agc);
-  ADD_FIELD("\"agc_gain\":%u", s->status.agc_gain);
-  ADD_FIELD("\"gainceiling\":%u", s->status.gainceiling);
-  ADD_FIELD("\"bpc\":%u", s->status.bpc);
-  ADD_FIELD("\"wpc\":%u", s->status.wpc);
-  ADD_FIELD("\"raw_gma\":%u", s->status.raw_gma);
-  ADD_FIELD("\"lenc\":%u", s->status.lenc);
-  ADD_FIELD("\"hmirror\":%u", s->status.hmirror);
-  ADD_FIELD("\"vflip\":%u", s->status.vflip);
-  ADD_FIELD("\"dcw\":%u", s->status.dcw);
-  ADD_FIELD("\"colorbar\":%u", s->status.colorbar);
-#if defined(LED_GPIO_NUM)
-  ADD_FIELD("\"led_intensity\":%u", led_duty);
-#else
-  ADD_FIELD("\"led_intensity\":%d", -1);
-#endif
-#undef ADD_FIELD
-  *p++ = '}';
-  *p++ = 0;
+  if (!s)
+  {
+    return http_send_500(req);
+  }
+
+  status_refresh(s);
+
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+  if (!status_cache_valid)
+  {
+    // Document trop gros pour le cache : envoi en flux, sans ETag
+    LOGR_E(LOG_MOD_HTTP, "Status JSON exceeds %u bytes, streaming uncached", sizeof(status_cache));
+    char out[STATUS_CHUNK_SIZE];
+    json_writer_t w;
+    json_writer_init_httpd(&w, out, sizeof(out), req);
+    status_write(&w, s);
+    esp_err_t res = json_writer_finish(&w);
+    if (res == ESP_OK)
+    {
+      res = httpd_resp_send_chunk(req, NULL, 0);
+    }
+    return res;
+  }
+
+  // Le document ne dépend que des réglages : l'ETag suit status_version
+  httpd_resp_set_hdr(req, "ETag", status_etag);
+  httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+  char inm[sizeof(status_etag)];
+  if (httpd_req_get_hdr_value_str(req, "If-None-Match", inm, sizeof(inm)) == ESP_OK && !strcmp(inm, status_etag))
+  {
+    http_set_status(req, "304 Not Modified");
+    return httpd_resp_send(req, NULL, 0);
+  }
+  return httpd_resp_send(req, status_cache, status_cache_len);
+}
+
+// Handler GET /api/admission : connexions longues ouvertes et compteurs d'admission.
+// Hors de /status : ils changent à chaque connexion et casseraient son ETag.
+static esp_err_t admission_handler(httpd_req_t *req)
+{
   httpd_resp_set_type(req, "application/json");
   httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-  return httpd_resp_send(req, json_response, strlen(json_response));
+  httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+  char out[STATUS_CHUNK_SIZE];
+  json_writer_t w;
+  json_writer_init(&w, out, sizeof(out));
+  admit_write(&w);
+  if (json_writer_finish(&w) != ESP_OK)
+  {
+    return http_send_500(req);
+  }
+  return httpd_resp_send(req, out, w.len);
+}
+
+// Copie le document /status dans l'enregistrement si les réglages ont changé.
+// Appelé depuis la tâche du flux : le cache de status_handler (tâche httpd) n'est pas utilisé.
+static void stream_record_settings(uint32_t *recorded_version)
+{
+  sensor_t *s = esp_camera_sensor_get();
+  if (status_version() == *recorded_version || !s)
+  {
+    return;
+  }
+  char *buf = (char *)malloc(STATUS_CACHE_SIZE);
+  if (!buf)
+  {
+    return;
+  }
+  // Capteur occupé (bascule, banc) : réessayé à l'image suivante plutôt que d'attendre
+  if (!sensor_lock_try(0))
+  {
+    free(buf);
+    return;
+  }
+  uint32_t version = status_version();
+  json_writer_t w;
+  json_writer_init(&w, buf, STATUS_CACHE_SIZE);
+  status_write(&w, s);
+  sensor_unlock();
+  if (json_writer_finish(&w) == ESP_OK)
+  {
+    recorder_add_settings(buf, w.len);
+  }
+  free(buf);
+  *recorded_version = version;
 }
 
 static esp_err_t xclk_handler(httpd_req_t *req)
@@ -947,19 +1800,22 @@ static esp_err_t xclk_handler(httpd_req_t *req)
   if (httpd_query_key_value(buf, "xclk", _xclk, sizeof(_xclk)) != ESP_OK)
   {
     free(buf);
-    httpd_resp_send_404(req);
+    http_send_404(req);
     return ESP_FAIL;
   }
   free(buf);
 
   int xclk = atoi(_xclk);
-  log_i("Set XCLK: %d MHz", xclk);
+  LOGR_I(LOG_MOD_CMD, "Set XCLK: %d MHz", xclk);
 
   sensor_t *s = esp_camera_sensor_get();
+  sensor_lock();
   int res = s->set_xclk(s, LEDC_TIMER_0, xclk);
+  sensor_unlock();
+  settings_changed("xclk");
   if (res)
   {
-    return httpd_resp_send_500(req);
+    return http_send_500(req);
   }
 
   httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
@@ -980,7 +1836,7 @@ static esp_err_t reg_handler(httpd_req_t *req)
   if (httpd_query_key_value(buf, "reg", _reg, sizeof(_reg)) != ESP_OK || httpd_query_key_value(buf, "mask", _mask, sizeof(_mask)) != ESP_OK || httpd_query_key_value(buf, "val", _val, sizeof(_val)) != ESP_OK)
   {
     free(buf);
-    httpd_resp_send_404(req);
+    http_send_404(req);
     return ESP_FAIL;
   }
   free(buf);
@@ -988,13 +1844,16 @@ static esp_err_t reg_handler(httpd_req_t *req)
   int reg = atoi(_reg);
   int mask = atoi(_mask);
   int val = atoi(_val);
-  log_i("Set Register: reg: 0x%02x, mask: 0x%02x, value: 0x%02x", reg, mask, val);
+  LOGR_I(LOG_MOD_CMD, "Set Register: reg: 0x%02x, mask: 0x%02x, value: 0x%02x", reg, mask, val);
 
   sensor_t *s = esp_camera_sensor_get();
+  sensor_lock();
   int res = s->set_reg(s, reg, mask, val);
+  sensor_unlock();
+  settings_changed("reg");
   if (res)
   {
-    return httpd_resp_send_500(req);
+    return http_send_500(req);
   }
 
   httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
@@ -1014,7 +1873,7 @@ static esp_err_t greg_handler(httpd_req_t *req)
   if (httpd_query_key_value(buf, "reg", _reg, sizeof(_reg)) != ESP_OK || httpd_query_key_value(buf, "mask", _mask, sizeof(_mask)) != ESP_OK)
   {
     free(buf);
-    httpd_resp_send_404(req);
+    http_send_404(req);
     return ESP_FAIL;
   }
   free(buf);
@@ -1022,12 +1881,14 @@ static esp_err_t greg_handler(httpd_req_t *req)
   int reg = atoi(_reg);
   int mask = atoi(_mask);
   sensor_t *s = esp_camera_sensor_get();
+  sensor_lock();
   int res = s->get_reg(s, reg, mask);
+  sensor_unlock();
   if (res < 0)
   {
-    return httpd_resp_send_500(req);
+    return http_send_500(req);
   }
-  log_i("Get Register: reg: 0x%02x, mask: 0x%02x, value: 0x%02x", reg, mask, res);
+  LOGR_I(LOG_MOD_CMD, "Get Register: reg: 0x%02x, mask: 0x%02x, value: 0x%02x", reg, mask, res);
 
   char buffer[20];
   const char *val = itoa(res, buffer, 10);
@@ -1035,6 +1896,221 @@ static esp_err_t greg_handler(httpd_req_t *req)
   return httpd_resp_send(req, val, strlen(val));
 }
 
+// ===========================
+// Lecture/écriture groupée de registres : /api/regs
+// ===========================
+#define REGS_MAX_COUNT 1024 // Nombre max de registres par requête
+#define REGS_CHUNK_SIZE 256 // Taille du tampon d'envoi (envoyé par morceaux)
+#define REGS_MAX_BODY 8192  // Taille max du corps JSON pour l'écriture groupée
+
+// Lit un registre et l'ajoute à la réponse.
+// Format binaire : [reg u16 LE][valeur i32 LE] par registre (valeur < 0 = erreur de lecture)
+// Format JSON : {"0x3400":12,...} (même clés que print_reg)
+// Verrou capteur par registre : pas pendant l'envoi des morceaux
+static void regs_emit(json_writer_t *w, sensor_t *s, uint16_t reg, int mask, bool binary)
+{
+  sensor_lock();
+  int val = s->get_reg(s, reg, mask);
+  sensor_unlock();
+  if (binary)
+  {
+    uint8_t rec[6] = {(uint8_t)reg, (uint8_t)(reg >> 8), (uint8_t)val, (uint8_t)(val >> 8), (uint8_t)(val >> 16), (uint8_t)(val >> 24)};
+    json_raw(w, rec, sizeof(rec));
+    return;
+  }
+  char key[8];
+  snprintf(key, sizeof(key), "0x%x", reg);
+  json_kv_int(w, key, val);
+}
+
+// Handler GET /api/regs
+//   ?from=0x3400&to=0x3406[&step=2][&mask=0xFFF]  : plage de registres
+//   ?list=0x3400:0xFFF,0x3406,0x3503              : liste reg[:mask]
+//   &fmt=bin                                       : réponse binaire compacte
+static esp_err_t regs_get_handler(httpd_req_t *req)
+{
+  char *buf = NULL;
+  char _val[16];
+
+  if (parse_get(req, &buf) != ESP_OK)
+  {
+    return ESP_FAIL;
+  }
+
+  int mask = 0xFF;
+  if (httpd_query_key_value(buf, "mask", _val, sizeof(_val)) == ESP_OK)
+  {
+    mask = strtol(_val, NULL, 0);
+  }
+  bool binary = httpd_query_key_value(buf, "fmt", _val, sizeof(_val)) == ESP_OK && !strcmp(_val, "bin");
+
+  char *list = NULL;
+  int from = -1, to = -1, step = 1;
+  size_t buf_len = strlen(buf) + 1;
+  list = (char *)malloc(buf_len);
+  if (!list)
+  {
+    free(buf);
+    return http_send_500(req);
+  }
+  if (httpd_query_key_value(buf, "list", list, buf_len) != ESP_OK)
+  {
+    free(list);
+    list = NULL;
+    if (httpd_query_key_value(buf, "from", _val, sizeof(_val)) == ESP_OK)
+    {
+      from = strtol(_val, NULL, 0);
+    }
+    if (httpd_query_key_value(buf, "to", _val, sizeof(_val)) == ESP_OK)
+    {
+      to = strtol(_val, NULL, 0);
+    }
+    if (httpd_query_key_value(buf, "step", _val, sizeof(_val)) == ESP_OK)
+    {
+      step = strtol(_val, NULL, 0);
+    }
+  }
+  free(buf);
+
+  if (!list && (from < 0 || to < from || to > 0xFFFF || step < 1 || (to - from) / step >= REGS_MAX_COUNT))
+  {
+    http_send_err(req, HTTPD_400_BAD_REQUEST, "Plage de registres invalide");
+    return ESP_FAIL;
+  }
+
+  sensor_t *s = esp_camera_sensor_get();
+  if (!s)
+  {
+    free(list);
+    return http_send_500(req);
+  }
+
+  httpd_resp_set_type(req, binary ? "application/octet-stream" : "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+  char out[REGS_CHUNK_SIZE];
+  json_writer_t w;
+  json_writer_init_httpd(&w, out, sizeof(out), req);
+  if (!binary)
+  {
+    json_begin_object(&w);
+  }
+  if (list)
+  {
+    int count = 0;
+    char *save = NULL;
+    for (char *tok = strtok_r(list, ",", &save); tok && json_writer_ok(&w) && count < REGS_MAX_COUNT; tok = strtok_r(NULL, ",", &save), count++)
+    {
+      char *sep = strchr(tok, ':');
+      int reg_mask = sep ? strtol(sep + 1, NULL, 0) : mask;
+      regs_emit(&w, s, (uint16_t)strtol(tok, NULL, 0), reg_mask, binary);
+    }
+    free(list);
+  }
+  else
+  {
+    for (int reg = from; reg <= to && json_writer_ok(&w); reg += step)
+    {
+      regs_emit(&w, s, (uint16_t)reg, mask, binary);
+    }
+  }
+  if (!binary)
+  {
+    json_end_object(&w);
+  }
+  esp_err_t res = json_writer_finish(&w);
+  if (res == ESP_OK)
+  {
+    res = httpd_resp_send_chunk(req, NULL, 0);
+  }
+  return res;
+}
+
+// Handler POST /api/regs
+//   Corps : [[reg,mask,val],...]  -> réponse : [res,...] (0 = OK, <0 = erreur)
+static esp_err_t regs_post_handler(httpd_req_t *req)
+{
+  int total_len = req->content_len;
+  if (total_len <= 0 || total_len > REGS_MAX_BODY)
+  {
+    http_send_err(req, HTTPD_400_BAD_REQUEST, "Taille du corps invalide");
+    return ESP_FAIL;
+  }
+  char *body = (char *)malloc(total_len + 1);
+  if (!body)
+  {
+    return http_send_500(req);
+  }
+  if (http_body_read(req, body, total_len) != ESP_OK)
+  {
+    free(body);
+    return ESP_FAIL;
+  }
+  body[total_len] = 0;
+
+  // Un emplacement par valeur : [13060,255,128] coûte 4 emplacements pour ~15 octets
+  size_t entries = json_array_count(body);
+  if (entries > REGS_MAX_COUNT)
+  {
+    free(body);
+    http_send_err(req, HTTPD_400_BAD_REQUEST, "Trop de registres");
+    return ESP_FAIL;
+  }
+  size_t capacity = JSON_TABLE_SIZE(entries, 3);
+  DynamicJsonDocument doc(capacity);
+  if (doc.capacity() < capacity)
+  {
+    free(body);
+    return http_send_500(req);
+  }
+  DeserializationError error = deserializeJson(doc, body);
+  free(body);
+  if (error == DeserializationError::NoMemory)
+  {
+    // Entrée de plus de trois valeurs
+    http_send_err(req, HTTPD_400_BAD_REQUEST, "Entrées [reg,mask,val] attendues");
+    return ESP_FAIL;
+  }
+  if (error || !doc.is<JsonArray>())
+  {
+    http_send_err(req, HTTPD_400_BAD_REQUEST, "JSON invalide");
+    return ESP_FAIL;
+  }
+
+  sensor_t *s = esp_camera_sensor_get();
+  if (!s)
+  {
+    return http_send_500(req);
+  }
+
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+  char out[REGS_CHUNK_SIZE];
+  json_writer_t w;
+  json_writer_init_httpd(&w, out, sizeof(out), req);
+  json_begin_array(&w);
+  for (JsonArray entry : doc.as<JsonArray>())
+  {
+    int r = -1;
+    if (!entry.isNull() && entry.size() == 3)
+    {
+      sensor_lock();
+      r = s->set_reg(s, entry[0].as<int>(), entry[1].as<int>(), entry[2].as<int>());
+      sensor_unlock();
+    }
+    json_int(&w, r);
+  }
+  json_end_array(&w);
+  settings_changed("regs");
+  esp_err_t res = json_writer_finish(&w);
+  if (res == ESP_OK)
+  {
+    res = httpd_resp_send_chunk(req, NULL, 0);
+  }
+  return res;
+}
+
 static int parse_get_var(char *buf, const char *key, int def)
 {
   char _int[16];
@@ -1064,12 +2140,15 @@ static esp_err_t pll_handler(httpd_req_t *req)
   int pclk = parse_get_var(buf, "pclk", 0);
   free(buf);
 
-  log_i("Set Pll: bypass: %d, mul: %d, sys: %d, root: %d, pre: %d, seld5: %d, pclken: %d, pclk: %d", bypass, mul, sys, root, pre, seld5, pclken, pclk);
+  LOGR_I(LOG_MOD_CMD, "Set Pll: bypass: %d, mul: %d, sys: %d, root: %d, pre: %d, seld5: %d, pclken: %d, pclk: %d", bypass, mul, sys, root, pre, seld5, pclken, pclk);
   sensor_t *s = esp_camera_sensor_get();
+  sensor_lock();
   int res = s->set_pll(s, bypass, mul, sys, root, pre, seld5, pclken, pclk);
+  sensor_unlock();
+  settings_changed("pll");
   if (res)
   {
-    return httpd_resp_send_500(req);
+    return http_send_500(req);
   }
 
   httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
@@ -1099,51 +2178,1319 @@ static esp_err_t win_handler(httpd_req_t *req)
   bool binning = parse_get_var(buf, "binning", 0) == 1;
   free(buf);
 
-  log_i(
-      "Set Window: Start: %d %d, End: %d %d, Offset: %d %d, Total: %d %d, Output: %d %d, Scale: %u, Binning: %u", startX, startY, endX, endY, offsetX, offsetY,
+  LOGR_I(
+      LOG_MOD_CMD, "Set Window: Start: %d %d, End: %d %d, Offset: %d %d, Total: %d %d, Output: %d %d, Scale: %u, Binning: %u", startX, startY, endX, endY, offsetX, offsetY,
       totalX, totalY, outputX, outputY, scale, binning // codespell:ignore totaly
   );
   sensor_t *s = esp_camera_sensor_get();
+  sensor_lock();
   int res = s->set_res_raw(s, startX, startY, endX, endY, offsetX, offsetY, totalX, totalY, outputX, outputY, scale, binning); // codespell:ignore totaly
+  sensor_unlock();
+  settings_changed("resolution");
   if (res)
   {
-    return httpd_resp_send_500(req);
+    return http_send_500(req);
   }
 
   httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
   return httpd_resp_send(req, NULL, 0);
 }
 
-static esp_err_t index_handler(httpd_req_t *req)
+// ===========================
+// Balayage des réglages capteur : /api/bench/camera
+// ===========================
+// GET /api/bench/camera?fs=5,8,10&q=10,20&xclk=10,20[&frames=30][&pll=4,6&restore=..][&roi=1]
+// Pour chaque point de la matrice (taille x qualité x XCLK [x multiplicateur PLL]) :
+// fps soutenu, taille JPEG moyenne, échecs de capture et images tronquées.
+// Les lignes sont envoyées au fil de l'eau ; les réglages d'origine sont rétablis à la fin.
+// La PLL n'a pas d'accesseur : pll= exige restore=bypass,mul,sys,root,pre,seld5,pclken,pclk
+// (arguments de /pll), réappliqué à la fin à la place du dernier point.
+// La mesure tourne dans sa propre tâche (comme /stream) et occupe une place de flux.
+#define BENCH_MAX_VALUES 8    // Valeurs max par dimension
+#define BENCH_MAX_POINTS 96   // Points max par balayage
+#define BENCH_WARMUP_FRAMES 3 // Images ignorées après un changement de réglage
+#define BENCH_MAX_FRAMES 200
+#define BENCH_PLL_ARGS 8 // restore= : arguments de set_pll
+
+// Liste d'entiers séparés par des virgules ; `def` si la clé est absente
+static int parse_get_list(char *buf, const char *key, int *out, int def)
 {
-  httpd_resp_set_type(req, "text/html");
-  httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
-  sensor_t *s = esp_camera_sensor_get();
-  if (s != NULL)
+  char list[64];
+  if (httpd_query_key_value(buf, key, list, sizeof(list)) != ESP_OK)
   {
-    if (s->id.PID == OV3660_PID)
-    {
-      return httpd_resp_send(req, (const char *)index_ov3660_html_gz, index_ov3660_html_gz_len);
-    }
-    else if (s->id.PID == OV5640_PID)
-    {
-      return httpd_resp_send(req, (const char *)index_ov5640_html_gz, index_ov5640_html_gz_len);
-    }
-    else
-    {
-      return httpd_resp_send(req, (const char *)index_ov2640_html_gz, index_ov2640_html_gz_len);
+    out[0] = def;
+    return 1;
+  }
+  int n = 0;
+  char *save = NULL;
+  for (char *tok = strtok_r(list, ",", &save); tok && n < BENCH_MAX_VALUES; tok = strtok_r(NULL, ",", &save))
+  {
+    out[n++] = atoi(tok);
+  }
+  return n;
+}
+
+// Un JPEG complet se termine par le marqueur EOI (FF D9), éventuellement suivi de bourrage
+static bool bench_jpeg_truncated(const camera_fb_t *fb)
+{
+  if (fb->format != PIXFORMAT_JPEG)
+  {
+    return false;
+  }
+  size_t end = fb->len;
+  size_t stop = end > 32 ? end - 32 : 0;
+  while (end > stop + 1)
+  {
+    if (fb->buf[end - 2] == 0xFF && fb->buf[end - 1] == 0xD9)
+    {
+      return false;
+    }
+    end--;
+  }
+  return true;
+}
+
+typedef struct
+{
+  uint32_t frames;
+  uint32_t failures;
+  uint32_t truncated;
+  uint64_t bytes;
+  int64_t elapsed_us;
+} bench_point_t;
+
+static void bench_measure(int frames, bench_point_t *p)
+{
+  memset(p, 0, sizeof(*p));
+  for (int i = 0; i < BENCH_WARMUP_FRAMES; i++)
+  {
+    camera_fb_t *fb = still_stream_fb_get();
+    if (fb)
+    {
+      esp_camera_fb_return(fb);
+    }
+  }
+  int64_t start = esp_timer_get_time();
+  for (int i = 0; i < frames; i++)
+  {
+    camera_fb_t *fb = still_stream_fb_get();
+    if (!fb)
+    {
+      p->failures++;
+      continue;
+    }
+    p->frames++;
+    p->bytes += fb->len;
+    if (bench_jpeg_truncated(fb))
+    {
+      p->truncated++;
+    }
+    esp_camera_fb_return(fb);
+  }
+  p->elapsed_us = esp_timer_get_time() - start;
+}
+
+typedef struct
+{
+  httpd_req_t *req; // Copie asynchrone (httpd_req_async_handler_begin)
+  int fs[BENCH_MAX_VALUES], q[BENCH_MAX_VALUES], xclk[BENCH_MAX_VALUES], pll[BENCH_MAX_VALUES];
+  int n_fs, n_q, n_xclk, n_pll;
+  int pll_sys, pll_root, pll_pre, pll_seld5, pll_pclk;
+  int pll_restore[BENCH_MAX_VALUES]; // bypass, mul, sys, root, pre, seld5, pclken, pclk
+  int frames;
+  bool roi;
+} bench_camera_job_t;
+
+static void bench_camera_run(bench_camera_job_t *job)
+{
+  httpd_req_t *req = job->req;
+  sensor_t *s = esp_camera_sensor_get();
+  // Réglages d'origine, rétablis après le balayage
+  int orig_fs = s->status.framesize;
+  int orig_q = s->status.quality;
+  int orig_xclk = s->xclk_freq_hz / 1000000;
+
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+
+  char out[256];
+  json_writer_t w;
+  json_writer_init_httpd(&w, out, sizeof(out), req);
+  json_begin_object(&w);
+  json_kv_uint(&w, "sensor", s->id.PID);
+  json_kv_int(&w, "frames", job->frames);
+  json_kv_bool(&w, "roi", job->roi);
+  json_key(&w, "points");
+  json_begin_array(&w);
+
+  // Verrou capteur le temps de chaque réglage seulement, jamais pendant la mesure
+  for (int ix = 0; ix < job->n_xclk && json_writer_ok(&w); ix++)
+  {
+    sensor_lock();
+    int xclk_err = s->set_xclk(s, LEDC_TIMER_0, job->xclk[ix]);
+    sensor_unlock();
+    for (int ip = 0; ip < job->n_pll && json_writer_ok(&w); ip++)
+    {
+      int pll_err = 0;
+      if (job->pll[ip] >= 0)
+      {
+        sensor_lock();
+        pll_err = s->set_pll(s, 0, job->pll[ip], job->pll_sys, job->pll_root, job->pll_pre, job->pll_seld5, 1, job->pll_pclk);
+        sensor_unlock();
+      }
+      for (int ifs = 0; ifs < job->n_fs && json_writer_ok(&w); ifs++)
+      {
+        sensor_lock();
+        int fs_err = s->set_framesize(s, (framesize_t)job->fs[ifs]);
+        if (job->roi && !fs_err)
+        {
+          fs_err = camera_window_restore() == ESP_OK ? 0 : -1;
+        }
+        sensor_unlock();
+        for (int iq = 0; iq < job->n_q && json_writer_ok(&w); iq++)
+        {
+          sensor_lock();
+          int q_err = s->set_quality(s, job->q[iq]);
+          sensor_unlock();
+          json_begin_object(&w);
+          json_kv_int(&w, "xclk", job->xclk[ix]);
+          if (job->pll[ip] >= 0)
+          {
+            json_kv_int(&w, "pll", job->pll[ip]);
+          }
+          json_kv_int(&w, "framesize", job->fs[ifs]);
+          json_kv_int(&w, "quality", job->q[iq]);
+          if (xclk_err || pll_err || fs_err || q_err)
+          {
+            json_kv_bool(&w, "error", true);
+          }
+          else
+          {
+            bench_point_t p;
+            TRACE_BEGIN("bench_point");
+            bench_measure(job->frames, &p);
+            TRACE_END("bench_point");
+            float secs = p.elapsed_us / 1e6f;
+            json_kv_float(&w, "fps", secs > 0 ? p.frames / secs : 0);
+            json_kv_uint(&w, "mean_bytes", p.frames ? (uint32_t)(p.bytes / p.frames) : 0);
+            json_kv_uint(&w, "failures", p.failures);
+            json_kv_uint(&w, "truncated", p.truncated);
+            LOGR_I(
+                LOG_MOD_CAMERA, "Bench xclk=%d pll=%d fs=%d q=%d: %.1ffps %luB fail=%lu trunc=%lu", job->xclk[ix], job->pll[ip], job->fs[ifs], job->q[iq],
+                secs > 0 ? p.frames / secs : 0, (unsigned long)(p.frames ? p.bytes / p.frames : 0), (unsigned long)p.failures, (unsigned long)p.truncated);
+          }
+          json_end_object(&w);
+        }
+      }
+    }
+  }
+  json_end_array(&w);
+
+  // Rétablit les réglages d'origine ; la PLL reprend le préréglage restore= du client
+  sensor_lock();
+  s->set_xclk(s, LEDC_TIMER_0, orig_xclk);
+  int restore_err = 0;
+  if (job->pll[0] >= 0)
+  {
+    const int *r = job->pll_restore;
+    restore_err = s->set_pll(s, r[0], r[1], r[2], r[3], r[4], r[5], r[6], r[7]);
+  }
+  s->set_framesize(s, (framesize_t)orig_fs);
+  camera_window_restore();
+  s->set_quality(s, orig_q);
+  settings_changed("bench");
+  sensor_unlock();
+  if (job->pll[0] >= 0)
+  {
+    json_kv_int(&w, "pll_restored", job->pll_restore[1]);
+    if (restore_err)
+    {
+      json_kv_bool(&w, "restore_error", true);
+      LOGR_E(LOG_MOD_CAMERA, "Bench: PLL d'origine non rétablie (%d)", restore_err);
+    }
+  }
+  json_end_object(&w);
+
+  if (json_writer_finish(&w) == ESP_OK)
+  {
+    httpd_resp_send_chunk(req, NULL, 0);
+  }
+}
+
+static void bench_camera_task(void *arg)
+{
+  bench_camera_job_t *job = (bench_camera_job_t *)arg;
+  int sockfd = httpd_req_to_sockfd(job->req);
+  bench_camera_run(job);
+  bench_camera_running = false;
+  admit_release(ADMIT_STREAM, sockfd);
+  httpd_req_async_handler_complete(job->req);
+  free(job);
+  vTaskDelete(NULL);
+}
+
+// Handler GET /api/bench/camera : validation et admission (comme un flux), puis
+// balayage dans une tâche dédiée ; refusé (503) tant qu'un autre flux est ouvert,
+// ses images fausseraient les mesures.
+static esp_err_t bench_camera_handler(httpd_req_t *req)
+{
+  char *buf = NULL;
+  if (parse_get(req, &buf) != ESP_OK)
+  {
+    return ESP_FAIL;
+  }
+  sensor_t *s = esp_camera_sensor_get();
+  if (!s)
+  {
+    free(buf);
+    return http_send_500(req);
+  }
+
+  bench_camera_job_t job = {};
+  job.n_fs = parse_get_list(buf, "fs", job.fs, s->status.framesize);
+  job.n_q = parse_get_list(buf, "q", job.q, s->status.quality);
+  job.n_xclk = parse_get_list(buf, "xclk", job.xclk, s->xclk_freq_hz / 1000000);
+  // PLL (OV3660/OV5640 seulement) : multiplicateurs essayés, autres paramètres fixes
+  bool has_pll = s->id.PID == OV3660_PID || s->id.PID == OV5640_PID;
+  job.n_pll = parse_get_list(buf, "pll", job.pll, -1);
+  job.pll_sys = parse_get_var(buf, "sys", 1);
+  job.pll_root = parse_get_var(buf, "root", 1);
+  job.pll_pre = parse_get_var(buf, "pre", 3);
+  job.pll_seld5 = parse_get_var(buf, "seld5", 1);
+  job.pll_pclk = parse_get_var(buf, "pclk", 4);
+  int n_restore = parse_get_list(buf, "restore", job.pll_restore, -1);
+  int frames = parse_get_var(buf, "frames", 30);
+  // roi=1 : chaque framesize est mesurée avec la ROI réappliquée (si roi.enabled)
+  job.roi = parse_get_var(buf, "roi", 0) == 1 && settings_get(SET_ROI_ENABLED);
+  free(buf);
+
+  if (!has_pll || job.pll[0] < 0)
+  {
+    job.n_pll = 1;
+    job.pll[0] = -1;
+  }
+  else if (n_restore != BENCH_PLL_ARGS)
+  {
+    // Sans préréglage d'origine, le dernier point resterait appliqué après le balayage
+    http_send_err(req, HTTPD_400_BAD_REQUEST, "pll= exige restore=bypass,mul,sys,root,pre,seld5,pclken,pclk");
+    return ESP_FAIL;
+  }
+  job.frames = frames < 1 ? 1 : (frames > BENCH_MAX_FRAMES ? BENCH_MAX_FRAMES : frames);
+  if (job.n_fs * job.n_q * job.n_xclk * job.n_pll > BENCH_MAX_POINTS)
+  {
+    http_send_err(req, HTTPD_400_BAD_REQUEST, "Trop de points dans la matrice");
+    return ESP_FAIL;
+  }
+
+  if (!admit_long_lived(req, ADMIT_STREAM))
+  {
+    return ESP_OK;
+  }
+  int sockfd = httpd_req_to_sockfd(req);
+  if (admit_active[ADMIT_STREAM].load() > 1)
+  {
+    admit_release(ADMIT_STREAM, sockfd);
+    http_set_status(req, "503 Service Unavailable");
+    httpd_resp_set_hdr(req, "Retry-After", ADMIT_RETRY_AFTER);
+    return httpd_resp_sendstr(req, "Flux en cours");
+  }
+
+  bench_camera_job_t *task_job = (bench_camera_job_t *)malloc(sizeof(bench_camera_job_t));
+  if (task_job)
+  {
+    *task_job = job;
+  }
+  if (!task_job || httpd_req_async_handler_begin(req, &task_job->req) != ESP_OK)
+  {
+    free(task_job);
+    admit_release(ADMIT_STREAM, sockfd);
+    return http_send_500(req);
+  }
+  task_job->req->user_ctx = NULL; // Contexte de statut sur la pile de metered_handler
+  bench_camera_running = true;
+  if (task_create(TASK_STREAM, bench_camera_task, task_job) != pdPASS)
+  {
+    LOGR_E(LOG_MOD_CAMERA, "Bench task creation failed");
+    bench_camera_running = false;
+    admit_release(ADMIT_STREAM, sockfd);
+    httpd_req_async_handler_complete(task_job->req);
+    free(task_job);
+    return ESP_FAIL;
+  }
+  return ESP_OK;
+}
+
+// ===========================
+// Débit du lien WiFi : /api/bench/net
+// ===========================
+// GET  /api/bench/net?bytes=N&chunk=M : envoie N octets synthétiques par morceaux de M
+//      octets via httpd_resp_send_chunk (même chemin que /stream), sans caméra.
+// POST /api/bench/net : reçoit un corps quelconque et chronomètre la réception.
+// GET  /api/bench/net (sans paramètre) : rapport JSON de la dernière mesure.
+// Le tampon est alloué une seule fois, en mémoire interne de préférence.
+// Le pilote n'expose pas le débit PHY de chaque trame : le rapport donne le mode PHY
+// négocié, relevé avec le RSSI pendant la mesure, et son débit nominal maximal.
+#define NET_BENCH_MAX_CHUNK (16 * 1024)
+#define NET_BENCH_DEFAULT_CHUNK 4096
+#define NET_BENCH_MAX_BYTES (64UL * 1024 * 1024)
+#define NET_BENCH_LINK_EVERY 64 // Appels entre deux relevés RSSI / mode PHY
+
+typedef struct
+{
+  bool valid;
+  bool upload;
+  uint64_t bytes;
+  uint32_t chunk;
+  uint32_t calls;
+  int64_t elapsed_us;
+  LogHistogram<> call_hist; // Durée par appel send/recv, en µs (quantiles)
+  MinMax<uint32_t> call_us; // Extrêmes exacts : l'histogramme ne donne qu'une borne de classe
+  MinMax<int> rssi;
+  int64_t rssi_sum;
+  MinMax<float> phy_mbps; // Débit nominal du mode PHY négocié
+  int phy_mode;           // Dernier wifi_phy_mode_t relevé, -1 : aucun
+} net_bench_t;
+
+static net_bench_t net_bench;
+static char *net_bench_buf = NULL;
+static std::atomic<bool> net_bench_running(false);
+
+static char *net_bench_buffer()
+{
+  if (!net_bench_buf)
+  {
+    net_bench_buf = (char *)heap_caps_malloc(NET_BENCH_MAX_CHUNK, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!net_bench_buf)
+    {
+      net_bench_buf = (char *)heap_caps_malloc(NET_BENCH_MAX_CHUNK, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    }
+    if (net_bench_buf)
+    {
+      for (size_t i = 0; i < NET_BENCH_MAX_CHUNK; i++)
+      {
+        net_bench_buf[i] = 'a' + i % 26;
+      }
+    }
+  }
+  return net_bench_buf;
+}
+
+static void net_bench_reset(bool upload, uint32_t chunk)
+{
+  net_bench.valid = false;
+  net_bench.upload = upload;
+  net_bench.bytes = 0;
+  net_bench.chunk = chunk;
+  net_bench.calls = 0;
+  net_bench.elapsed_us = 0;
+  net_bench.call_hist.reset();
+  net_bench.call_us.reset();
+  net_bench.rssi.reset();
+  net_bench.rssi_sum = 0;
+  net_bench.phy_mbps.reset();
+  net_bench.phy_mode = -1;
+}
+
+// Débit nominal maximal d'un mode PHY, 1 flux spatial (MCS7 et GI court en 11n)
+static float net_phy_max_mbps(wifi_phy_mode_t mode)
+{
+  switch (mode)
+  {
+  case WIFI_PHY_MODE_LR:
+    return 0.5f;
+  case WIFI_PHY_MODE_11B:
+    return 11.0f;
+  case WIFI_PHY_MODE_11G:
+    return 54.0f;
+  case WIFI_PHY_MODE_HT20:
+    return 72.2f;
+  case WIFI_PHY_MODE_HT40:
+    return 150.0f;
+  default:
+    return 0.0f;
+  }
+}
+
+static const char *net_phy_name(int mode)
+{
+  static const char *names[] = {"lr", "11b", "11g", "ht20", "ht40"};
+  return mode >= 0 && mode < (int)(sizeof(names) / sizeof(names[0])) ? names[mode] : "unknown";
+}
+
+static void net_bench_sample_link()
+{
+  int rssi = WiFi.RSSI();
+  net_bench.rssi.add(rssi);
+  net_bench.rssi_sum += rssi;
+  wifi_phy_mode_t mode;
+  if (esp_wifi_sta_get_negotiated_phymode(&mode) == ESP_OK)
+  {
+    net_bench.phy_mode = mode;
+    net_bench.phy_mbps.add(net_phy_max_mbps(mode));
+  }
+}
+
+static void net_bench_record_call(int64_t t0, size_t len)
+{
+  uint32_t us = esp_timer_get_time() - t0;
+  net_bench.call_hist.add(us);
+  net_bench.call_us.add(us);
+  net_bench.bytes += len;
+  if (++net_bench.calls % NET_BENCH_LINK_EVERY == 0)
+  {
+    net_bench_sample_link();
+  }
+}
+
+static esp_err_t net_bench_report(httpd_req_t *req)
+{
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  char out[256];
+  json_writer_t w;
+  json_writer_init_httpd(&w, out, sizeof(out), req);
+  json_begin_object(&w);
+  json_kv_bool(&w, "valid", net_bench.valid);
+  json_kv_str(&w, "direction", net_bench.upload ? "upload" : "download");
+  json_key(&w, "bytes");
+  json_uint64(&w, net_bench.bytes);
+  json_kv_uint(&w, "chunk", net_bench.chunk);
+  json_kv_uint(&w, "calls", net_bench.calls);
+  float secs = net_bench.elapsed_us / 1e6f;
+  json_kv_float(&w, "seconds", secs, 3);
+  json_kv_float(&w, "kbit_s", secs > 0 ? net_bench.bytes * 8 / 1000.0f / secs : 0, 1);
+  json_key(&w, "call_us");
+  json_begin_object(&w);
+  json_kv_uint(&w, "p50", net_bench.call_hist.quantile(0.5f));
+  json_kv_uint(&w, "p95", net_bench.call_hist.quantile(0.95f));
+  json_kv_uint(&w, "p99", net_bench.call_hist.quantile(0.99f));
+  json_kv_uint(&w, "max", net_bench.call_us.max());
+  json_end_object(&w);
+  json_key(&w, "rssi");
+  json_begin_object(&w);
+  json_kv_int(&w, "min", net_bench.rssi.min());
+  json_kv_int(&w, "max", net_bench.rssi.max());
+  json_kv_int(&w, "mean", net_bench.rssi.count() ? (int32_t)(net_bench.rssi_sum / net_bench.rssi.count()) : 0);
+  json_end_object(&w);
+  if (net_bench.phy_mbps.count())
+  {
+    json_kv_str(&w, "phy", net_phy_name(net_bench.phy_mode));
+    json_key(&w, "phy_mbps");
+    json_begin_object(&w);
+    json_kv_float(&w, "min", net_bench.phy_mbps.min(), 1);
+    json_kv_float(&w, "max", net_bench.phy_mbps.max(), 1);
+    json_end_object(&w);
+  }
+  wifi_ap_record_t ap;
+  if (esp_wifi_sta_get_ap_info(&ap) == ESP_OK)
+  {
+    json_kv_uint(&w, "channel", ap.primary);
+    json_kv_bool(&w, "ht40", ap.second != WIFI_SECOND_CHAN_NONE);
+  }
+  json_kv_bool(&w, "wifi_sleep", WiFi.getSleep());
+  json_end_object(&w);
+  esp_err_t res = json_writer_finish(&w);
+  if (res == ESP_OK)
+  {
+    res = httpd_resp_send_chunk(req, NULL, 0);
+  }
+  return res;
+}
+
+// Émission : N octets par morceaux de `chunk`, sur le profil socket du flux
+static esp_err_t net_bench_download(httpd_req_t *req, uint64_t total, uint32_t chunk)
+{
+  char *buf = net_bench_buffer();
+  httpd_resp_set_type(req, "application/octet-stream");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  // Même profil socket que /stream : la mesure reflète le débit réel du flux
+  net_profile_apply(httpd_req_to_sockfd(req), &net_profile.stream);
+  net_bench_reset(false, chunk);
+  net_bench_sample_link();
+  esp_err_t res = ESP_OK;
+  int64_t start = esp_timer_get_time();
+  while (net_bench.bytes < total && res == ESP_OK)
+  {
+    size_t len = total - net_bench.bytes < chunk ? total - net_bench.bytes : chunk;
+    int64_t t0 = esp_timer_get_time();
+    TRACE_BEGIN("send_chunk");
+    res = httpd_resp_send_chunk(req, buf, len);
+    TRACE_END("send_chunk");
+    net_bench_record_call(t0, len);
+  }
+  net_bench.elapsed_us = esp_timer_get_time() - start;
+  net_bench_sample_link();
+  net_bench.valid = res == ESP_OK;
+  metrics_bytes_sent(net_bench.bytes);
+  LOGR_I(
+      LOG_MOD_NET, "Net bench download: %llu B in %lldms (%.1f kbit/s), send p50/p99 %u/%uus", net_bench.bytes, net_bench.elapsed_us / 1000,
+      net_bench.elapsed_us ? net_bench.bytes * 8000.0 / net_bench.elapsed_us : 0.0, net_bench.call_hist.quantile(0.5f), net_bench.call_hist.quantile(0.99f));
+  if (res == ESP_OK)
+  {
+    res = httpd_resp_send_chunk(req, NULL, 0);
+  }
+  return res;
+}
+
+// Réception : le corps est lu puis ignoré
+static esp_err_t net_bench_upload(httpd_req_t *req, uint64_t total)
+{
+  char *buf = net_bench_buffer();
+  net_bench_reset(true, NET_BENCH_MAX_CHUNK);
+  net_bench_sample_link();
+  int64_t start = esp_timer_get_time();
+  while (net_bench.bytes < total)
+  {
+    size_t want = total - net_bench.bytes;
+    int64_t t0 = esp_timer_get_time();
+    int r = http_body_recv(req, buf, want < NET_BENCH_MAX_CHUNK ? want : NET_BENCH_MAX_CHUNK);
+    if (r <= 0)
+    {
+      return http_body_recv_failed(req, r);
+    }
+    net_bench_record_call(t0, r);
+  }
+  net_bench.elapsed_us = esp_timer_get_time() - start;
+  net_bench_sample_link();
+  net_bench.valid = true;
+  return net_bench_report(req);
+}
+
+typedef struct
+{
+  httpd_req_t *req; // Copie asynchrone (httpd_req_async_handler_begin)
+  bool upload;
+  uint64_t total;
+  uint32_t chunk;
+} net_bench_job_t;
+
+static void net_bench_task(void *arg)
+{
+  net_bench_job_t *job = (net_bench_job_t *)arg;
+  int sockfd = httpd_req_to_sockfd(job->req);
+  if (job->upload)
+  {
+    net_bench_upload(job->req, job->total);
+  }
+  else
+  {
+    net_bench_download(job->req, job->total, job->chunk);
+  }
+  net_bench_running = false;
+  admit_release(ADMIT_STREAM, sockfd);
+  httpd_req_async_handler_complete(job->req);
+  free(job);
+  vTaskDelete(NULL);
+}
+
+// Jusqu'à NET_BENCH_MAX_BYTES dans chaque sens : la mesure tourne dans sa propre tâche
+// et occupe une place de flux (comme /api/bench/camera), le serveur reste disponible.
+// Une seule mesure à la fois : elles partagent le tampon et le rapport.
+static esp_err_t net_bench_start(httpd_req_t *req, bool upload, uint64_t total, uint32_t chunk)
+{
+  if (!net_bench_buffer())
+  {
+    return http_send_500(req);
+  }
+  if (net_bench_running.exchange(true))
+  {
+    http_set_status(req, "503 Service Unavailable");
+    httpd_resp_set_hdr(req, "Retry-After", ADMIT_RETRY_AFTER);
+    return httpd_resp_sendstr(req, "Mesure en cours");
+  }
+  if (!admit_long_lived(req, ADMIT_STREAM))
+  {
+    net_bench_running = false;
+    return ESP_OK;
+  }
+  int sockfd = httpd_req_to_sockfd(req);
+  net_bench_job_t *job = (net_bench_job_t *)malloc(sizeof(net_bench_job_t));
+  if (job)
+  {
+    job->upload = upload;
+    job->total = total;
+    job->chunk = chunk;
+  }
+  if (!job || httpd_req_async_handler_begin(req, &job->req) != ESP_OK)
+  {
+    free(job);
+    net_bench_running = false;
+    admit_release(ADMIT_STREAM, sockfd);
+    return http_send_500(req);
+  }
+  job->req->user_ctx = NULL; // Contexte de statut sur la pile de metered_handler
+  if (task_create(TASK_STREAM, net_bench_task, job) != pdPASS)
+  {
+    LOGR_E(LOG_MOD_NET, "Net bench task creation failed");
+    net_bench_running = false;
+    admit_release(ADMIT_STREAM, sockfd);
+    httpd_req_async_handler_complete(job->req);
+    free(job);
+    return ESP_FAIL;
+  }
+  return ESP_OK;
+}
+
+// Handler GET /api/bench/net
+static esp_err_t bench_net_get_handler(httpd_req_t *req)
+{
+  char query[64];
+  char value[16];
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK || httpd_query_key_value(query, "bytes", value, sizeof(value)) != ESP_OK)
+  {
+    return net_bench_report(req);
+  }
+  uint64_t total = strtoull(value, NULL, 10);
+  uint32_t chunk = parse_get_var(query, "chunk", NET_BENCH_DEFAULT_CHUNK);
+  if (!total || total > NET_BENCH_MAX_BYTES || chunk < 1 || chunk > NET_BENCH_MAX_CHUNK)
+  {
+    http_send_err(req, HTTPD_400_BAD_REQUEST, "bytes/chunk hors limites");
+    return ESP_FAIL;
+  }
+  return net_bench_start(req, false, total, chunk);
+}
+
+// Handler POST /api/bench/net
+static esp_err_t bench_net_post_handler(httpd_req_t *req)
+{
+  if (req->content_len > NET_BENCH_MAX_BYTES)
+  {
+    http_send_err(req, HTTPD_400_BAD_REQUEST, "Corps trop gros");
+    return ESP_FAIL;
+  }
+  return net_bench_start(req, true, req->content_len, NET_BENCH_MAX_CHUNK);
+}
+
+// ===========================
+// Server-Sent Events : /events
+// ===========================
+// Le handler bascule la requête en mode asynchrone et la confie à sse_task, qui relit
+// l'anneau d'événements pour chaque abonné : le serveur HTTP n'est jamais bloqué.
+#define SSE_MAX_CLIENTS ADMIT_MAX_EVENTS
+#define SSE_POLL_MS 100
+#define SSE_PING_US (15 * 1000000LL)
+
+typedef struct
+{
+  httpd_req_t *req; // Copie asynchrone (httpd_req_async_handler_begin)
+  uint32_t cursor;
+  uint32_t dropped;
+  int64_t last_send;
+} sse_client_t;
+
+static QueueHandle_t sse_queue = NULL;
+
+static esp_err_t sse_send_event(sse_client_t *c, const event_t *ev)
+{
+  char buf[EVENT_DATA_SIZE + 64];
+  int n = snprintf(buf, sizeof(buf), "id: %lu\nevent: %s\ndata: %s\n\n", (unsigned long)ev->seq, event_type_name(ev->type), ev->data);
+  if (n >= (int)sizeof(buf))
+  {
+    n = sizeof(buf) - 1;
+  }
+  return httpd_resp_send_chunk(c->req, buf, n);
+}
+
+static void sse_task(void *arg)
+{
+  sse_client_t clients[SSE_MAX_CLIENTS] = {};
+  while (true)
+  {
+    sse_client_t incoming;
+    if (xQueueReceive(sse_queue, &incoming, pdMS_TO_TICKS(SSE_POLL_MS)) == pdTRUE)
+    {
+      for (int i = 0; i < SSE_MAX_CLIENTS; i++)
+      {
+        if (!clients[i].req)
+        {
+          clients[i] = incoming;
+          break;
+        }
+      }
+    }
+    event_check_heap();
+
+    int64_t now = esp_timer_get_time();
+    for (int i = 0; i < SSE_MAX_CLIENTS; i++)
+    {
+      sse_client_t *c = &clients[i];
+      if (!c->req)
+      {
+        continue;
+      }
+      esp_err_t res = ESP_OK;
+      event_t ev;
+      uint32_t dropped = c->dropped;
+      while (res == ESP_OK && event_read(&c->cursor, &ev, &c->dropped))
+      {
+        res = sse_send_event(c, &ev);
+        c->last_send = now;
+      }
+      if (res == ESP_OK && c->dropped != dropped)
+      {
+        LOGR_W(LOG_MOD_HTTP, "SSE client %d lagging, %lu events dropped", i, (unsigned long)c->dropped);
+      }
+      if (res == ESP_OK && now - c->last_send > SSE_PING_US)
+      {
+        res = httpd_resp_send_chunk(c->req, ": ping\n\n", 8);
+        c->last_send = now;
+      }
+      if (res != ESP_OK)
+      {
+        // Client déconnecté : libère le socket
+        admit_release(ADMIT_EVENTS, httpd_req_to_sockfd(c->req));
+        httpd_req_async_handler_complete(c->req);
+        c->req = NULL;
+      }
+    }
+  }
+}
+
+// Handler GET /events
+static esp_err_t events_handler(httpd_req_t *req)
+{
+  if (!admit_long_lived(req, ADMIT_EVENTS))
+  {
+    return ESP_OK;
+  }
+  int sockfd = httpd_req_to_sockfd(req);
+
+  httpd_resp_set_type(req, "text/event-stream");
+  httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  // Premier morceau : envoie les en-têtes et l'intervalle de reconnexion
+  if (httpd_resp_send_chunk(req, "retry: 2000\n\n", 13) != ESP_OK)
+  {
+    admit_release(ADMIT_EVENTS, sockfd);
+    return ESP_FAIL;
+  }
+
+  sse_client_t c = {};
+  c.cursor = event_head();
+  char last_id[16];
+  char *end = NULL;
+  if (httpd_req_get_hdr_value_str(req, "Last-Event-ID", last_id, sizeof(last_id)) == ESP_OK)
+  {
+    // Reprise après reconnexion : l'anneau renvoie ce qui est encore disponible
+    unsigned long id = strtoul(last_id, &end, 10);
+    if (end != last_id && !*end)
+    {
+      c.cursor = event_resume(id);
+    }
+  }
+  c.last_send = esp_timer_get_time();
+  if (httpd_req_async_handler_begin(req, &c.req) != ESP_OK)
+  {
+    admit_release(ADMIT_EVENTS, sockfd);
+    return ESP_FAIL;
+  }
+  c.req->user_ctx = NULL; // Contexte de statut sur la pile de metered_handler
+  if (xQueueSend(sse_queue, &c, 0) != pdTRUE)
+  {
+    admit_release(ADMIT_EVENTS, sockfd);
+    httpd_req_async_handler_complete(c.req);
+    return ESP_FAIL;
+  }
+  return ESP_OK;
+}
+
+// Handler GET /metrics (format texte Prometheus)
+static esp_err_t metrics_handler(httpd_req_t *req)
+{
+  httpd_resp_set_type(req, "text/plain; version=0.0.4; charset=utf-8");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  char out[256];
+  json_writer_t w;
+  json_writer_init_httpd(&w, out, sizeof(out), req);
+  metrics_write(&w);
+  esp_err_t res = json_writer_finish(&w);
+  if (res == ESP_OK)
+  {
+    res = httpd_resp_send_chunk(req, NULL, 0);
+  }
+  return res;
+}
+
+// ===========================
+// Réglages socket par classe de connexion : /api/net
+// ===========================
+// Handler GET /api/net
+static esp_err_t net_get_handler(httpd_req_t *req)
+{
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  char out[512];
+  json_writer_t w;
+  json_writer_init(&w, out, sizeof(out));
+  net_profile_write(&w);
+  if (json_writer_finish(&w) != ESP_OK)
+  {
+    return http_send_500(req);
+  }
+  return httpd_resp_send(req, out, w.len);
+}
+
+// Handler POST /api/net : seules les clés présentes sont modifiées.
+// Les profils s'appliquent aux prochaines connexions ; lru_purge/backlog au redémarrage.
+static esp_err_t net_post_handler(httpd_req_t *req)
+{
+  StaticJsonDocument<512> doc;
+  if (http_body_json(req, doc) != ESP_OK)
+  {
+    return ESP_FAIL;
+  }
+  if (!net_profile_update(doc.as<JsonObjectConst>()))
+  {
+    http_send_err(req, HTTPD_400_BAD_REQUEST, "Valeur hors limites");
+    return ESP_FAIL;
+  }
+  return net_get_handler(req);
+}
+
+// ===========================
+// Topologie des tâches : /api/tasks
+// ===========================
+#define TASKS_CHUNK_SIZE 512
+
+// Handler GET /api/tasks : configuration, puis cœur, pile et part CPU de chaque tâche.
+// La part CPU porte sur l'intervalle depuis l'appel précédent.
+static esp_err_t tasks_get_handler(httpd_req_t *req)
+{
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+  char out[TASKS_CHUNK_SIZE];
+  json_writer_t w;
+  json_writer_init_httpd(&w, out, sizeof(out), req);
+  task_topology_write(&w);
+  esp_err_t res = json_writer_finish(&w);
+  if (res == ESP_OK)
+  {
+    res = httpd_resp_send_chunk(req, NULL, 0);
+  }
+  return res;
+}
+
+// Handler POST /api/tasks : {"stream":{"core":0,"priority":3,"stack":8192}}.
+// Les flux suivants en tiennent compte ; httpd, sse et log au redémarrage.
+static esp_err_t tasks_post_handler(httpd_req_t *req)
+{
+  StaticJsonDocument<384> doc;
+  if (http_body_json(req, doc) != ESP_OK)
+  {
+    return ESP_FAIL;
+  }
+  if (!task_topology_update(doc.as<JsonObjectConst>()))
+  {
+    http_send_err(req, HTTPD_400_BAD_REQUEST, "Valeur hors limites");
+    return ESP_FAIL;
+  }
+  return tasks_get_handler(req);
+}
+
+// ===========================
+// Journal : /api/logs
+// ===========================
+#define LOGS_CHUNK_SIZE 512
+
+// Handler GET /api/logs[?since=N] : lignes encore présentes dans l'anneau, à partir du
+// numéro N (champ "next" de la réponse précédente pour un suivi incrémental).
+static esp_err_t logs_get_handler(httpd_req_t *req)
+{
+  char query[32];
+  char value[16];
+  uint32_t since = 0;
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK && httpd_query_key_value(query, "since", value, sizeof(value)) == ESP_OK)
+  {
+    since = strtoul(value, NULL, 10);
+  }
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+  char out[LOGS_CHUNK_SIZE];
+  json_writer_t w;
+  json_writer_init_httpd(&w, out, sizeof(out), req);
+  log_ring_write(&w, since);
+  esp_err_t res = json_writer_finish(&w);
+  if (res == ESP_OK)
+  {
+    res = httpd_resp_send_chunk(req, NULL, 0);
+  }
+  return res;
+}
+
+// Handler POST /api/logs : {"levels":{"stream":"debug","idf":"error"}}.
+// Les niveaux ne sont pas sauvegardés : valeurs de compilation au redémarrage.
+static esp_err_t logs_post_handler(httpd_req_t *req)
+{
+  StaticJsonDocument<384> doc;
+  if (http_body_json(req, doc) != ESP_OK)
+  {
+    return ESP_FAIL;
+  }
+  if (!doc["levels"].is<JsonObject>())
+  {
+    http_send_err(req, HTTPD_400_BAD_REQUEST, "JSON invalide");
+    return ESP_FAIL;
+  }
+  for (JsonPair kv : doc["levels"].as<JsonObject>())
+  {
+    if (!kv.value().is<const char *>() || !log_set_level(kv.key().c_str(), kv.value().as<const char *>()))
+    {
+      http_send_err(req, HTTPD_400_BAD_REQUEST, "Module ou niveau inconnu");
+      return ESP_FAIL;
+    }
+  }
+  return logs_get_handler(req);
+}
+
+// ===========================
+// Chronologie du démarrage : /api/boot
+// ===========================
+#define BOOT_CHUNK_SIZE 256
+
+// Handler GET /api/boot : cause du reset/réveil, phases (ms depuis le lancement), WiFi
+// et rafale du réveil
+static esp_err_t boot_get_handler(httpd_req_t *req)
+{
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+  char out[BOOT_CHUNK_SIZE];
+  json_writer_t w;
+  json_writer_init_httpd(&w, out, sizeof(out), req);
+  json_begin_object(&w);
+  json_key(&w, "boot");
+  boot_phase_write(&w);
+  json_key(&w, "wifi");
+  wifi_connect_write(&w);
+  json_key(&w, "visit");
+  visit_write(&w);
+  json_end_object(&w);
+  esp_err_t res = json_writer_finish(&w);
+  if (res == ESP_OK)
+  {
+    res = httpd_resp_send_chunk(req, NULL, 0);
+  }
+  return res;
+}
+
+// ===========================
+// Présence et position : /api/presence
+// ===========================
+#define PRESENCE_CHUNK_SIZE 256
+
+// Handler GET /api/presence : état filtré, position estimée par balayage des zones et
+// fenêtre caméra active ({"presence":{..},"window":{"x":..,"y":..,"w":..,"h":..}|null})
+static esp_err_t presence_get_handler(httpd_req_t *req)
+{
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+  char out[PRESENCE_CHUNK_SIZE];
+  json_writer_t w;
+  json_writer_init_httpd(&w, out, sizeof(out), req);
+  json_begin_object(&w);
+  json_key(&w, "presence");
+  presence_write(&w);
+  json_key(&w, "window");
+  camera_window_t win;
+  if (camera_window_get(&win))
+  {
+    json_begin_object(&w);
+    json_kv_uint(&w, "x", win.x);
+    json_kv_uint(&w, "y", win.y);
+    json_kv_uint(&w, "w", win.w);
+    json_kv_uint(&w, "h", win.h);
+    json_end_object(&w);
+  }
+  else
+  {
+    json_null(&w);
+  }
+  json_end_object(&w);
+  esp_err_t res = json_writer_finish(&w);
+  if (res == ESP_OK)
+  {
+    res = httpd_resp_send_chunk(req, NULL, 0);
+  }
+  return res;
+}
+
+// ===========================
+// Photos haute résolution : /still, /api/still
+// ===========================
+#define STILL_CHUNK_SIZE 256
+
+// Handler GET /still[?frames=N|?last=1] : bascule vers still.framesize le temps de N
+// images (la dernière est envoyée) puis retour à la taille du flux ; last=1 renvoie la
+// dernière photo sans bascule (celle de still.trigger par exemple). Coût de la bascule
+// en en-têtes : X-Switch-Us, X-Back-Us, X-Gap-Us, X-Frames-Lost
+static esp_err_t still_handler(httpd_req_t *req)
+{
+  char query[48];
+  bool last = false;
+  int frames = 1;
+  if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK)
+  {
+    last = parse_get_var(query, "last", 0) == 1;
+    frames = parse_get_var(query, "frames", 1);
+  }
+  if (frames < 1 || frames > STILL_MAX_FRAMES)
+  {
+    http_send_err(req, HTTPD_400_BAD_REQUEST, "frames hors limites");
+    return ESP_FAIL;
+  }
+  if (!last)
+  {
+    esp_err_t err = still_capture(frames, NULL);
+    if (err == ESP_ERR_TIMEOUT)
+    {
+      // Autre bascule en cours
+      http_set_status(req, "503 Service Unavailable");
+      httpd_resp_set_hdr(req, "Retry-After", ADMIT_RETRY_AFTER);
+      return httpd_resp_send(req, NULL, 0);
+    }
+    if (err != ESP_OK)
+    {
+      http_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, esp_err_to_name(err));
+      return ESP_FAIL;
+    }
+  }
+  // L'emplacement reste verrouillé pendant l'envoi : une photo déclenchée attend
+  still_info_t info;
+  const uint8_t *jpg = still_acquire(&info);
+  if (!jpg)
+  {
+    return http_send_404(req);
+  }
+  httpd_resp_set_type(req, "image/jpeg");
+  httpd_resp_set_hdr(req, "Content-Disposition", "inline; filename=still.jpg");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  char ts[32];
+  char switch_us[12];
+  char back_us[12];
+  char gap_us[12];
+  char lost[8];
+  snprintf(ts, sizeof(ts), "%lld.%06ld", (long long)(info.capture_us / 1000000), (long)(info.capture_us % 1000000));
+  snprintf(switch_us, sizeof(switch_us), "%lu", (unsigned long)info.switch_us);
+  snprintf(back_us, sizeof(back_us), "%lu", (unsigned long)info.back_us);
+  snprintf(gap_us, sizeof(gap_us), "%lu", (unsigned long)info.gap_us);
+  snprintf(lost, sizeof(lost), "%u", info.lost);
+  httpd_resp_set_hdr(req, "X-Timestamp", ts);
+  httpd_resp_set_hdr(req, "X-Switch-Us", switch_us);
+  httpd_resp_set_hdr(req, "X-Back-Us", back_us);
+  httpd_resp_set_hdr(req, "X-Gap-Us", gap_us);
+  httpd_resp_set_hdr(req, "X-Frames-Lost", lost);
+  TRACE_BEGIN("send");
+  esp_err_t res = httpd_resp_send(req, (const char *)jpg, info.len);
+  TRACE_END("send");
+  still_release();
+  return res;
+}
+
+// Handler GET /api/still : taille des tampons, photos prises et coût des bascules
+static esp_err_t still_get_handler(httpd_req_t *req)
+{
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+  char out[STILL_CHUNK_SIZE];
+  json_writer_t w;
+  json_writer_init_httpd(&w, out, sizeof(out), req);
+  still_write(&w);
+  esp_err_t res = json_writer_finish(&w);
+  if (res == ESP_OK)
+  {
+    res = httpd_resp_send_chunk(req, NULL, 0);
+  }
+  return res;
+}
+
+// ===========================
+// Enregistrements de flux : /api/record
+// ===========================
+// Handler GET /api/record : télécharge le dernier enregistrement (conteneur BCR1)
+static esp_err_t record_get_handler(httpd_req_t *req)
+{
+  if (!recorder_acquire())
+  {
+    // Enregistrement ou chargement en cours
+    http_set_status(req, "503 Service Unavailable");
+    httpd_resp_set_hdr(req, "Retry-After", ADMIT_RETRY_AFTER);
+    return httpd_resp_send(req, NULL, 0);
+  }
+  size_t len;
+  const uint8_t *data = recorder_data(&len);
+  if (!data)
+  {
+    recorder_release();
+    return http_send_404(req);
+  }
+  httpd_resp_set_type(req, "application/octet-stream");
+  httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=birdcam.bcr");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  char frames[12];
+  snprintf(frames, sizeof(frames), "%lu", (unsigned long)recorder_frames());
+  httpd_resp_set_hdr(req, "X-Frames", frames);
+  esp_err_t res = httpd_resp_send(req, (const char *)data, len);
+  recorder_release();
+  return res;
+}
+
+// Handler POST /api/record : charge un conteneur BCR1 pour /stream?replay=
+static esp_err_t record_post_handler(httpd_req_t *req)
+{
+  size_t total_len = req->content_len;
+  uint8_t *buf = NULL;
+  esp_err_t err = recorder_load_begin(total_len, &buf);
+  if (err == ESP_ERR_INVALID_STATE)
+  {
+    // Relecture ou enregistrement en cours
+    http_set_status(req, "503 Service Unavailable");
+    httpd_resp_set_hdr(req, "Retry-After", ADMIT_RETRY_AFTER);
+    return httpd_resp_send(req, NULL, 0);
+  }
+  if (err != ESP_OK)
+  {
+    http_send_err(req, HTTPD_400_BAD_REQUEST, "Taille du corps invalide");
+    return ESP_FAIL;
+  }
+  if (http_body_read(req, (char *)buf, total_len) != ESP_OK)
+  {
+    recorder_load_end();
+    return ESP_FAIL;
+  }
+  if (recorder_load_end() != ESP_OK)
+  {
+    http_send_err(req, HTTPD_400_BAD_REQUEST, "Conteneur BCR1 invalide");
+    return ESP_FAIL;
+  }
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  char out[48];
+  snprintf(out, sizeof(out), "{\"frames\":%lu}", (unsigned long)recorder_frames());
+  return httpd_resp_sendstr(req, out);
+}
+
+// Enveloppe de comptage : chaque handler enregistré via register_uri_metered
+// alimente birdcam_http_requests_total{uri,status}
+// Le serveur démarre dès que le réseau est prêt, parfois avant la caméra : les URI qui
+// l'utilisent attendent la fin de son initialisation (BOOT_CAMERA_WAIT_MS au plus),
+// puis répondent 503 si elle a échoué.
+#define BOOT_CAMERA_WAIT_MS 5000
+#define BOOT_RETRY_AFTER "2"
+
+static const char *const camera_free_uris[] = {
+    "/", "/settings.html", "/config.html", "/api/boot", "/api/presence", "/api/still", "/api/config",
+    "/api/reboot", "/api/logs", "/api/tasks", "/api/net", "/api/bench/net", "/api/record", "/api/admission", "/metrics", "/events",
+    "/debug/trace"};
+
+typedef struct
+{
+  esp_err_t (*handler)(httpd_req_t *req);
+  int uri_id;
+  bool camera; // Attend la caméra
+} metered_uri_t;
+
+static metered_uri_t metered_uris[HTTPD_MAX_URI_HANDLERS];
+static int metered_count = 0;
+
+static bool uri_needs_camera(const char *uri)
+{
+  for (size_t i = 0; i < sizeof(camera_free_uris) / sizeof(camera_free_uris[0]); i++)
+  {
+    if (strcmp(uri, camera_free_uris[i]) == 0)
+    {
+      return false;
     }
   }
+  return true;
+}
+
+static esp_err_t metered_handler(httpd_req_t *req)
+{
+  metered_uri_t *m = (metered_uri_t *)req->user_ctx;
+  http_req_ctx_t ctx = {200};
+  req->user_ctx = &ctx;
+  esp_err_t res = ESP_OK;
+  if (m->camera && !boot_is_set(BOOT_READY_CAMERA) && !(boot_wait(BOOT_DONE_CAMERA, BOOT_CAMERA_WAIT_MS) && boot_is_set(BOOT_READY_CAMERA)))
+  {
+    http_set_status(req, "503 Service Unavailable");
+    httpd_resp_set_hdr(req, "Retry-After", BOOT_RETRY_AFTER);
+    httpd_resp_send(req, NULL, 0);
+  }
   else
   {
-    log_e("Camera sensor not found");
-    return httpd_resp_send_500(req);
+    res = m->handler(req);
+    admit_touch(httpd_req_to_sockfd(req));
+  }
+  req->user_ctx = m;
+  // Echec sans réponse d'erreur explicite (client déconnecté...) : statut "other"
+  metrics_http_request(m->uri_id, (res != ESP_OK && ctx.status == 200) ? 0 : ctx.status);
+  return res;
+}
+
+static esp_err_t register_uri_metered(httpd_handle_t server, httpd_uri_t *uri)
+{
+  if (metered_count < HTTPD_MAX_URI_HANDLERS)
+  {
+    metered_uri_t *m = &metered_uris[metered_count++];
+    m->handler = uri->handler;
+    m->uri_id = metrics_http_uri(uri->uri);
+    m->camera = uri_needs_camera(uri->uri);
+    uri->handler = metered_handler;
+    uri->user_ctx = m;
+  }
+  return httpd_register_uri_handler(server, uri);
+}
+
+#if ENABLE_TRACE
+// Handler GET /debug/trace : instantané au format Chrome trace-event (Perfetto)
+static esp_err_t trace_handler(httpd_req_t *req)
+{
+  httpd_resp_set_type(req, "application/json");
+  httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=birdcam_trace.json");
+  httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
+  char out[512];
+  json_writer_t w;
+  json_writer_init_httpd(&w, out, sizeof(out), req);
+  trace_write_chrome(&w);
+  esp_err_t res = json_writer_finish(&w);
+  if (res == ESP_OK)
+  {
+    res = httpd_resp_send_chunk(req, NULL, 0);
+  }
+  return res;
+}
+#endif
+
+// Page selon le capteur ; sans capteur (caméra en cours d'initialisation ou absente),
+// page OV2640 : "/" ne dépend pas de la caméra (camera_free_uris), seuls ses appels
+// /status et /control attendent qu'elle soit prête.
+static esp_err_t index_handler(httpd_req_t *req)
+{
+  httpd_resp_set_type(req, "text/html");
+  httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+  sensor_t *s = esp_camera_sensor_get();
+  if (s == NULL)
+  {
+    LOGR_W(LOG_MOD_CMD, "Camera sensor not ready, serving the OV2640 page");
+  }
+  else if (s->id.PID == OV3660_PID)
+  {
+    return httpd_resp_send(req, (const char *)index_ov3660_html_gz, index_ov3660_html_gz_len);
+  }
+  else if (s->id.PID == OV5640_PID)
+  {
+    return httpd_resp_send(req, (const char *)index_ov5640_html_gz, index_ov5640_html_gz_len);
   }
+  return httpd_resp_send(req, (const char *)index_ov2640_html_gz, index_ov2640_html_gz_len);
 }
 
 void startCameraServer()
 {
-  Serial.println("startCameraServer() Starting web server on port: '80'");
+  LOGR_I(LOG_MOD_HTTP, "startCameraServer() Starting web server on port: '80'");
   httpd_uri_t settings_html_uri = {
       .uri = "/settings.html",
       .method = HTTP_GET,
@@ -1207,8 +3554,21 @@ void startCameraServer()
   };
 
   httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-  config.max_uri_handlers = 24;
-  config.max_open_sockets = 4; // Augmente à 4 connexions simultanées (adapte selon ta RAM)
+  config.max_uri_handlers = HTTPD_MAX_URI_HANDLERS;
+  config.max_open_sockets = HTTPD_MAX_SOCKETS; // Augmente à 4 connexions simultanées (adapte selon ta RAM)
+  net_profile_load();
+  config.core_id = task_cfg[TASK_HTTPD].core == TASK_CORE_ANY ? tskNO_AFFINITY : task_cfg[TASK_HTTPD].core;
+  config.task_priority = task_cfg[TASK_HTTPD].priority;
+  config.stack_size = task_cfg[TASK_HTTPD].stack;
+  config.lru_purge_enable = net_profile.lru_purge;
+  config.backlog_conn = net_profile.backlog;
+  // Profil "control" et admission à l'ouverture ; /stream passe au profil "stream"
+  config.open_fn = http_open_fn;
+  config.close_fn = http_close_fn;
+  for (int i = 0; i < HTTPD_MAX_SOCKETS; i++)
+  {
+    admit_socks[i].fd = -1;
+  }
 
   httpd_uri_t index_uri = {
       .uri = "/",
@@ -1327,6 +3687,281 @@ void startCameraServer()
 #endif
   };
 
+  httpd_uri_t regs_uri = {
+      .uri = "/api/regs",
+      .method = HTTP_GET,
+      .handler = regs_get_handler,
+      .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+      ,
+      .is_websocket = false,
+      .handle_ws_control_frames = false,
+      .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t regs_post_uri = {
+      .uri = "/api/regs",
+      .method = HTTP_POST,
+      .handler = regs_post_handler,
+      .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+      ,
+      .is_websocket = false,
+      .handle_ws_control_frames = false,
+      .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t events_uri = {
+      .uri = "/events",
+      .method = HTTP_GET,
+      .handler = events_handler,
+      .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+      ,
+      .is_websocket = false,
+      .handle_ws_control_frames = false,
+      .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t metrics_uri = {
+      .uri = "/metrics",
+      .method = HTTP_GET,
+      .handler = metrics_handler,
+      .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+      ,
+      .is_websocket = false,
+      .handle_ws_control_frames = false,
+      .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t bench_camera_uri = {
+      .uri = "/api/bench/camera",
+      .method = HTTP_GET,
+      .handler = bench_camera_handler,
+      .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+      ,
+      .is_websocket = false,
+      .handle_ws_control_frames = false,
+      .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t bench_net_get_uri = {
+      .uri = "/api/bench/net",
+      .method = HTTP_GET,
+      .handler = bench_net_get_handler,
+      .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+      ,
+      .is_websocket = false,
+      .handle_ws_control_frames = false,
+      .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t bench_net_post_uri = {
+      .uri = "/api/bench/net",
+      .method = HTTP_POST,
+      .handler = bench_net_post_handler,
+      .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+      ,
+      .is_websocket = false,
+      .handle_ws_control_frames = false,
+      .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t net_get_uri = {
+      .uri = "/api/net",
+      .method = HTTP_GET,
+      .handler = net_get_handler,
+      .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+      ,
+      .is_websocket = false,
+      .handle_ws_control_frames = false,
+      .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t net_post_uri = {
+      .uri = "/api/net",
+      .method = HTTP_POST,
+      .handler = net_post_handler,
+      .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+      ,
+      .is_websocket = false,
+      .handle_ws_control_frames = false,
+      .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t tasks_get_uri = {
+      .uri = "/api/tasks",
+      .method = HTTP_GET,
+      .handler = tasks_get_handler,
+      .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+      ,
+      .is_websocket = false,
+      .handle_ws_control_frames = false,
+      .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t tasks_post_uri = {
+      .uri = "/api/tasks",
+      .method = HTTP_POST,
+      .handler = tasks_post_handler,
+      .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+      ,
+      .is_websocket = false,
+      .handle_ws_control_frames = false,
+      .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t logs_get_uri = {
+      .uri = "/api/logs",
+      .method = HTTP_GET,
+      .handler = logs_get_handler,
+      .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+      ,
+      .is_websocket = false,
+      .handle_ws_control_frames = false,
+      .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t logs_post_uri = {
+      .uri = "/api/logs",
+      .method = HTTP_POST,
+      .handler = logs_post_handler,
+      .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+      ,
+      .is_websocket = false,
+      .handle_ws_control_frames = false,
+      .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t admission_uri = {
+      .uri = "/api/admission",
+      .method = HTTP_GET,
+      .handler = admission_handler,
+      .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+      ,
+      .is_websocket = false,
+      .handle_ws_control_frames = false,
+      .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t boot_uri = {
+      .uri = "/api/boot",
+      .method = HTTP_GET,
+      .handler = boot_get_handler,
+      .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+      ,
+      .is_websocket = false,
+      .handle_ws_control_frames = false,
+      .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t presence_uri = {
+      .uri = "/api/presence",
+      .method = HTTP_GET,
+      .handler = presence_get_handler,
+      .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+      ,
+      .is_websocket = false,
+      .handle_ws_control_frames = false,
+      .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t still_uri = {
+      .uri = "/still",
+      .method = HTTP_GET,
+      .handler = still_handler,
+      .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+      ,
+      .is_websocket = false,
+      .handle_ws_control_frames = false,
+      .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t still_get_uri = {
+      .uri = "/api/still",
+      .method = HTTP_GET,
+      .handler = still_get_handler,
+      .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+      ,
+      .is_websocket = false,
+      .handle_ws_control_frames = false,
+      .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t record_get_uri = {
+      .uri = "/api/record",
+      .method = HTTP_GET,
+      .handler = record_get_handler,
+      .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+      ,
+      .is_websocket = false,
+      .handle_ws_control_frames = false,
+      .supported_subprotocol = NULL
+#endif
+  };
+
+  httpd_uri_t record_post_uri = {
+      .uri = "/api/record",
+      .method = HTTP_POST,
+      .handler = record_post_handler,
+      .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+      ,
+      .is_websocket = false,
+      .handle_ws_control_frames = false,
+      .supported_subprotocol = NULL
+#endif
+  };
+
+#if ENABLE_TRACE
+  httpd_uri_t trace_uri = {
+      .uri = "/debug/trace",
+      .method = HTTP_GET,
+      .handler = trace_handler,
+      .user_ctx = NULL
+#ifdef CONFIG_HTTPD_WS_SUPPORT
+      ,
+      .is_websocket = false,
+      .handle_ws_control_frames = false,
+      .supported_subprotocol = NULL
+#endif
+  };
+#endif
+
   httpd_uri_t pll_uri = {
       .uri = "/pll",
       .method = HTTP_GET,
@@ -1353,89 +3988,83 @@ void startCameraServer()
 #endif
   };
 
-  ra_filter_init(&ra_filter, 20);
+#if ENABLE_TRACE
+  trace_init();
+#endif
+  sse_queue = xQueueCreate(SSE_MAX_CLIENTS, sizeof(sse_client_t));
+  task_create(TASK_SSE, sse_task, NULL);
 
-  log_i("Starting web server on port: '%d'", config.server_port);
-  Serial.println("[DIAG] Registering URI handlers...");
+  LOGR_I(LOG_MOD_HTTP, "Starting web server on port: '%d'", config.server_port);
+  LOGR_D(LOG_MOD_HTTP, "Registering URI handlers...");
   if (httpd_start(&camera_httpd, &config) == ESP_OK)
   {
-    Serial.println("[DIAG] Web server started OK");
-    Serial.println("[DIAG] Registering /control handler...");
-    esp_err_t reg_res = httpd_register_uri_handler(camera_httpd, &cmd_uri);
+    LOGR_I(LOG_MOD_HTTP, "Web server started OK");
+    LOGR_D(LOG_MOD_HTTP, "Registering /control handler...");
+    esp_err_t reg_res = register_uri_metered(camera_httpd, &cmd_uri);
     if (reg_res == ESP_OK)
     {
-      Serial.println("[DIAG] /control handler registered successfully");
+      LOGR_D(LOG_MOD_HTTP, "/control handler registered successfully");
     }
     else
     {
-      Serial.printf("[DIAG] /control handler registration FAILED: %d\n", reg_res);
+      LOGR_E(LOG_MOD_HTTP, "/control handler registration FAILED: %d", reg_res);
     }
     // Register other handlers as before
-    httpd_register_uri_handler(camera_httpd, &index_uri);
-    httpd_register_uri_handler(camera_httpd, &status_uri);
-    httpd_register_uri_handler(camera_httpd, &capture_uri);
-    httpd_register_uri_handler(camera_httpd, &bmp_uri);
-    httpd_register_uri_handler(camera_httpd, &xclk_uri);
-    httpd_register_uri_handler(camera_httpd, &reg_uri);
-    httpd_register_uri_handler(camera_httpd, &greg_uri);
-    httpd_register_uri_handler(camera_httpd, &pll_uri);
-    httpd_register_uri_handler(camera_httpd, &win_uri);
-    httpd_register_uri_handler(camera_httpd, &config_uri);
-    httpd_register_uri_handler(camera_httpd, &config_html_uri);
-    httpd_register_uri_handler(camera_httpd, &reboot_uri);
-    httpd_register_uri_handler(camera_httpd, &settings_html_uri);
-    httpd_register_uri_handler(camera_httpd, &settings_api_uri);
-    httpd_register_uri_handler(camera_httpd, &settings_api_post_uri);
-    // Charger et appliquer les réglages caméra au démarrage
-    StaticJsonDocument<512> doc_settings;
-
-    if (loadConfig(doc_settings, "/settings.json"))
-    {
-      Serial.println("[DIAG] LoadConfig OK");
-      sensor_t *s = esp_camera_sensor_get();
-      if (s)
-      {
-        if (doc_settings.containsKey("quality"))
-          s->set_quality(s, doc_settings["quality"]);
-        if (doc_settings.containsKey("contrast"))
-          s->set_contrast(s, doc_settings["contrast"]);
-        if (doc_settings.containsKey("brightness"))
-          s->set_brightness(s, doc_settings["brightness"]);
-        if (doc_settings.containsKey("saturation"))
-          s->set_saturation(s, doc_settings["saturation"]);
-        if (doc_settings.containsKey("awb"))
-          s->set_whitebal(s, doc_settings["awb"]);
-        if (doc_settings.containsKey("agc"))
-          s->set_gain_ctrl(s, doc_settings["agc"]);
-        if (doc_settings.containsKey("aec"))
-          s->set_exposure_ctrl(s, doc_settings["aec"]);
-      }
-      else
-      {
-        Serial.println("[DIAG] esp_camera_sensor_get Error");
-      }
-    }
-    else
-    {
-      Serial.println("[DIAG] LoadConfig Error");
-    }
+    register_uri_metered(camera_httpd, &index_uri);
+    register_uri_metered(camera_httpd, &status_uri);
+    register_uri_metered(camera_httpd, &capture_uri);
+    register_uri_metered(camera_httpd, &bmp_uri);
+    register_uri_metered(camera_httpd, &xclk_uri);
+    register_uri_metered(camera_httpd, &reg_uri);
+    register_uri_metered(camera_httpd, &greg_uri);
+    register_uri_metered(camera_httpd, &regs_uri);
+    register_uri_metered(camera_httpd, &regs_post_uri);
+    register_uri_metered(camera_httpd, &events_uri);
+    register_uri_metered(camera_httpd, &metrics_uri);
+    register_uri_metered(camera_httpd, &record_get_uri);
+    register_uri_metered(camera_httpd, &record_post_uri);
+    register_uri_metered(camera_httpd, &bench_camera_uri);
+    register_uri_metered(camera_httpd, &bench_net_get_uri);
+    register_uri_metered(camera_httpd, &bench_net_post_uri);
+    register_uri_metered(camera_httpd, &net_get_uri);
+    register_uri_metered(camera_httpd, &net_post_uri);
+    register_uri_metered(camera_httpd, &tasks_get_uri);
+    register_uri_metered(camera_httpd, &tasks_post_uri);
+    register_uri_metered(camera_httpd, &logs_get_uri);
+    register_uri_metered(camera_httpd, &logs_post_uri);
+#if ENABLE_TRACE
+    register_uri_metered(camera_httpd, &trace_uri);
+#endif
+    register_uri_metered(camera_httpd, &pll_uri);
+    register_uri_metered(camera_httpd, &win_uri);
+    register_uri_metered(camera_httpd, &config_uri);
+    register_uri_metered(camera_httpd, &config_get_uri);
+    register_uri_metered(camera_httpd, &config_patch_uri);
+    register_uri_metered(camera_httpd, &config_html_uri);
+    register_uri_metered(camera_httpd, &reboot_uri);
+    register_uri_metered(camera_httpd, &settings_html_uri);
+    register_uri_metered(camera_httpd, &settings_api_uri);
+    register_uri_metered(camera_httpd, &settings_api_post_uri);
+    register_uri_metered(camera_httpd, &boot_uri);
+    register_uri_metered(camera_httpd, &admission_uri);
+    register_uri_metered(camera_httpd, &presence_uri);
+    register_uri_metered(camera_httpd, &still_uri);
+    register_uri_metered(camera_httpd, &still_get_uri);
   }
   else
   {
-    Serial.println("[DIAG] Web server FAILED to start");
+    LOGR_E(LOG_MOD_HTTP, "Web server FAILED to start");
   }
 
   // Enregistrer le handler /stream sur le même serveur HTTP (port 80)
-  Serial.println("[DIAG] Tentative d'enregistrement du handler /stream...");
-  esp_err_t stream_reg_res = httpd_register_uri_handler(camera_httpd, &stream_uri);
-  Serial.printf("[DIAG] Résultat httpd_register_uri_handler /stream: %d\n", stream_reg_res);
+  esp_err_t stream_reg_res = register_uri_metered(camera_httpd, &stream_uri);
   if (stream_reg_res == ESP_OK)
   {
-    Serial.println("[DIAG] Handler /stream enregistré avec succès sur le serveur principal");
+    LOGR_D(LOG_MOD_HTTP, "Handler /stream enregistré avec succès sur le serveur principal");
   }
   else
   {
-    Serial.printf("[DIAG] Échec de l'enregistrement du handler /stream sur le serveur principal: %d\n", stream_reg_res);
+    LOGR_E(LOG_MOD_HTTP, "Échec de l'enregistrement du handler /stream sur le serveur principal: %d", stream_reg_res);
   }
 }
 
@@ -1444,6 +4073,6 @@ void setupLedFlash()
 #if defined(LED_GPIO_NUM)
   ledcAttach(LED_GPIO_NUM, 5000, 8);
 #else
-  log_i("LED flash is disabled -> LED_GPIO_NUM undefined");
+  LOGR_I(LOG_MOD_CORE, "LED flash is disabled -> LED_GPIO_NUM undefined");
 #endif
 }
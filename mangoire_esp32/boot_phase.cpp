@@ -0,0 +1,144 @@
+#include "boot_phase.h"
+#include <string.h>
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_sleep.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "log_ring.h"
+
+static boot_phase_t boot_phases[BOOT_PHASE_MAX];
+static int boot_phase_count = 0;
+static portMUX_TYPE boot_mux = portMUX_INITIALIZER_UNLOCKED;
+static StaticEventGroup_t boot_events_buf;
+static EventGroupHandle_t boot_events = NULL;
+
+volatile bool boot_first_frame_done = false;
+
+void boot_phase_init()
+{
+  if (!boot_events)
+  {
+    boot_events = xEventGroupCreateStatic(&boot_events_buf);
+  }
+}
+
+int boot_phase_begin(const char *name)
+{
+  int64_t now = esp_timer_get_time();
+  int id = -1;
+  portENTER_CRITICAL(&boot_mux);
+  if (boot_phase_count < BOOT_PHASE_MAX)
+  {
+    id = boot_phase_count++;
+    boot_phases[id].name = name;
+    boot_phases[id].start_us = now;
+    boot_phases[id].end_us = 0;
+  }
+  portEXIT_CRITICAL(&boot_mux);
+  return id;
+}
+
+void boot_phase_end(int id)
+{
+  if (id < 0)
+  {
+    return;
+  }
+  int64_t now = esp_timer_get_time();
+  portENTER_CRITICAL(&boot_mux);
+  boot_phases[id].end_us = now;
+  portEXIT_CRITICAL(&boot_mux);
+  LOGR_I(LOG_MOD_CORE, "Boot: %s %lu -> %lu ms (%lu ms)", boot_phases[id].name, (unsigned long)(boot_phases[id].start_us / 1000),
+         (unsigned long)(now / 1000), (unsigned long)((now - boot_phases[id].start_us) / 1000));
+}
+
+void boot_mark(const char *name)
+{
+  boot_phase_end(boot_phase_begin(name));
+}
+
+void boot_signal(uint32_t bits)
+{
+  xEventGroupSetBits(boot_events, bits);
+}
+
+bool boot_wait(uint32_t bits, uint32_t timeout_ms)
+{
+  EventBits_t set = xEventGroupWaitBits(boot_events, bits, pdFALSE, pdTRUE, pdMS_TO_TICKS(timeout_ms));
+  return (set & bits) == bits;
+}
+
+bool boot_is_set(uint32_t bits)
+{
+  return (xEventGroupGetBits(boot_events) & bits) == bits;
+}
+
+static const char *boot_reset_name(esp_reset_reason_t r)
+{
+  switch (r)
+  {
+  case ESP_RST_POWERON:
+    return "poweron";
+  case ESP_RST_SW:
+    return "software";
+  case ESP_RST_PANIC:
+    return "panic";
+  case ESP_RST_INT_WDT:
+  case ESP_RST_TASK_WDT:
+  case ESP_RST_WDT:
+    return "watchdog";
+  case ESP_RST_DEEPSLEEP:
+    return "deepsleep";
+  case ESP_RST_BROWNOUT:
+    return "brownout";
+  default:
+    return "other";
+  }
+}
+
+static const char *boot_wakeup_name(esp_sleep_wakeup_cause_t c)
+{
+  switch (c)
+  {
+  case ESP_SLEEP_WAKEUP_EXT0:
+  case ESP_SLEEP_WAKEUP_EXT1:
+    return "ext";
+  case ESP_SLEEP_WAKEUP_TIMER:
+    return "timer";
+  case ESP_SLEEP_WAKEUP_UNDEFINED:
+    return "none";
+  default:
+    return "other";
+  }
+}
+
+void boot_phase_write(json_writer_t *w)
+{
+  boot_phase_t phases[BOOT_PHASE_MAX];
+  portENTER_CRITICAL(&boot_mux);
+  int n = boot_phase_count;
+  memcpy(phases, boot_phases, n * sizeof(boot_phase_t));
+  portEXIT_CRITICAL(&boot_mux);
+
+  json_begin_object(w);
+  json_kv_str(w, "reset_reason", boot_reset_name(esp_reset_reason()));
+  json_kv_str(w, "wakeup", boot_wakeup_name(esp_sleep_get_wakeup_cause()));
+  json_kv_bool(w, "camera_ok", boot_is_set(BOOT_READY_CAMERA));
+  json_key(w, "phases");
+  json_begin_array(w);
+  for (int i = 0; i < n; i++)
+  {
+    json_begin_object(w);
+    json_kv_str(w, "name", phases[i].name);
+    json_kv_uint(w, "start_ms", phases[i].start_us / 1000);
+    if (phases[i].end_us)
+    {
+      json_kv_uint(w, "end_ms", phases[i].end_us / 1000);
+      json_kv_uint(w, "ms", (phases[i].end_us - phases[i].start_us) / 1000);
+    }
+    json_end_object(w);
+  }
+  json_end_array(w);
+  json_end_object(w);
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <stdint.h>
+#include "json_writer.h"
+
+// Démarrage par phases : LittleFS et caméra s'initialisent dans des tâches ponctuelles
+// pendant que setup() associe le WiFi, puis le serveur HTTP démarre dès que le réseau
+// est prêt. Chaque phase est horodatée (esp_timer_get_time, µs depuis le lancement de
+// l'application ; le chargeur de démarrage n'est pas compté) : chronologie sur /api/boot.
+// Indicateur principal : délai jusqu'à la première image ("first_frame") après un
+// reset ou un réveil, qui conditionne la capture d'une visite.
+
+#define BOOT_PHASE_MAX 16 // Phases conservées (les suivantes sont ignorées)
+
+// Dépendances entre phases (bits du groupe d'événements de démarrage)
+#define BOOT_READY_FS (1 << 0)     // LittleFS monté (ou échec signalé)
+#define BOOT_READY_CAMERA (1 << 1) // Caméra initialisée avec succès
+#define BOOT_DONE_CAMERA (1 << 2)  // Initialisation caméra terminée (succès ou échec)
+
+typedef struct
+{
+  const char *name; // Chaîne statique (seul le pointeur est conservé)
+  int64_t start_us;
+  int64_t end_us; // 0 = en cours
+} boot_phase_t;
+
+// À appeler en tout début de setup()
+void boot_phase_init();
+
+// Ouvre une phase ; retourne son numéro pour boot_phase_end (-1 si la table est pleine)
+int boot_phase_begin(const char *name);
+// Ferme une phase et la journalise
+void boot_phase_end(int id);
+// Jalon instantané (début = fin)
+void boot_mark(const char *name);
+
+void boot_signal(uint32_t bits);
+// Attend que tous les `bits` soient levés ; false au bout de timeout_ms
+bool boot_wait(uint32_t bits, uint32_t timeout_ms);
+bool boot_is_set(uint32_t bits);
+
+// {"reset_reason":..,"wakeup":..,"phases":[{"name":..,"start_ms":..,"end_ms":..,"ms":..}]}
+void boot_phase_write(json_writer_t *w);
+
+extern volatile bool boot_first_frame_done;
+
+// Première image servie après le démarrage ; ne coûte qu'un test ensuite
+static inline void boot_mark_first_frame()
+{
+  if (!boot_first_frame_done)
+  {
+    boot_first_frame_done = true;
+    boot_mark("first_frame");
+  }
+}
@@ -0,0 +1,294 @@
+#include "camera_window.h"
+#include <string.h>
+#include "esp_camera.h"
+#include "boot_phase.h"
+#include "event_ring.h"
+#include "log_ring.h"
+#include "sensor_lock.h"
+#include "settings_store.h"
+
+#define CAMERA_WINDOW_ALIGN 16 // Taille de fenêtre alignée (blocs JPEG, registres par 8)
+#define CAMERA_WINDOW_STEP 8   // Origine de la fenêtre
+
+// Modes de fenêtrage OV2640 (ov2640_sensor_mode_t, premier argument de set_res_raw)
+#define OV2640_WINDOW_UXGA 0
+#define OV2640_WINDOW_SVGA 1
+
+// Plein champ 4:3 des tables de rapports du pilote esp32-camera : matrice active,
+// fenêtre de lecture (start/end), décalage ISP et totaux de ligne/trame (HTS/VTS)
+typedef struct
+{
+  uint16_t pid;
+  uint16_t max_w, max_h;
+  uint16_t sx, sy, ex, ey;
+  uint16_t ox, oy;
+  uint16_t tx, ty;
+} camera_geometry_t;
+
+static const camera_geometry_t camera_geometries[] = {
+    {OV3660_PID, 2048, 1536, 0, 0, 2079, 1547, 16, 6, 2300, 1564},
+    {OV5640_PID, 2560, 1920, 0, 0, 2623, 1951, 32, 16, 2844, 1968},
+    {OV2640_PID, 1600, 1200, 0, 0, 0, 0, 0, 0, 0, 0}, // Fenêtre du mode UXGA
+};
+
+static bool camera_window_active = false;
+static bool camera_window_following = false; // Fenêtre posée par camera_window_follow
+static bool camera_window_roi_on = false;
+static camera_window_t camera_window_current;
+
+static const camera_geometry_t *camera_geometry(sensor_t *s)
+{
+  for (size_t i = 0; i < sizeof(camera_geometries) / sizeof(camera_geometries[0]); i++)
+  {
+    if (camera_geometries[i].pid == s->id.PID)
+    {
+      return &camera_geometries[i];
+    }
+  }
+  return NULL;
+}
+
+static int camera_clamp(int v, int lo, int hi)
+{
+  return v < lo ? lo : (v > hi ? hi : v);
+}
+
+// ‰ -> pixels du champ : rapport de la sortie, pas de suréchantillonnage, alignement
+static void camera_window_fit(const camera_window_t *win, int max_w, int max_h, int out_w, int out_h, int *x, int *y, int *w, int *h)
+{
+  int cx = (win->x + win->w / 2) * max_w / 1000;
+  int cy = (win->y + win->h / 2) * max_h / 1000;
+  int fw = win->w * max_w / 1000;
+  int fh = win->h * max_h / 1000;
+  // La fenêtre grandit sur l'axe trop court
+  if ((int64_t)fw * out_h < (int64_t)fh * out_w)
+  {
+    fw = fh * out_w / out_h;
+  }
+  else
+  {
+    fh = fw * out_h / out_w;
+  }
+  if (fw < out_w)
+  {
+    fw = out_w;
+    fh = out_h;
+  }
+  if (fw > max_w)
+  {
+    fh = fh * max_w / fw;
+    fw = max_w;
+  }
+  if (fh > max_h)
+  {
+    fw = fw * max_h / fh;
+    fh = max_h;
+  }
+  *w = camera_clamp(fw / CAMERA_WINDOW_ALIGN * CAMERA_WINDOW_ALIGN, CAMERA_WINDOW_ALIGN, max_w);
+  *h = camera_clamp(fh / CAMERA_WINDOW_ALIGN * CAMERA_WINDOW_ALIGN, CAMERA_WINDOW_ALIGN, max_h);
+  *x = camera_clamp(cx - *w / 2, 0, max_w - *w) / CAMERA_WINDOW_STEP * CAMERA_WINDOW_STEP;
+  *y = camera_clamp(cy - *h / 2, 0, max_h - *h) / CAMERA_WINDOW_STEP * CAMERA_WINDOW_STEP;
+}
+
+// Appelées sous sensor_lock (registres et état de fenêtre)
+static esp_err_t camera_window_apply_locked(const camera_window_t *win, uint16_t out_w, uint16_t out_h)
+{
+  sensor_t *s = esp_camera_sensor_get();
+  const camera_geometry_t *g = s ? camera_geometry(s) : NULL;
+  if (!g || s->pixformat != PIXFORMAT_JPEG)
+  {
+    return ESP_ERR_NOT_SUPPORTED;
+  }
+  if (!out_w || !out_h)
+  {
+    out_w = resolution[s->status.framesize].width;
+    out_h = resolution[s->status.framesize].height;
+  }
+  out_w = camera_clamp(out_w, CAMERA_WINDOW_ALIGN, g->max_w) / CAMERA_WINDOW_ALIGN * CAMERA_WINDOW_ALIGN;
+  out_h = camera_clamp(out_h, CAMERA_WINDOW_ALIGN, g->max_h) / CAMERA_WINDOW_ALIGN * CAMERA_WINDOW_ALIGN;
+  int x, y, w, h;
+  camera_window_fit(win, g->max_w, g->max_h, out_w, out_h, &x, &y, &w, &h);
+
+  // Sortie assez petite : lecture binnée
+  bool half = out_w * 2 <= w && out_h * 2 <= h;
+  int res;
+  if (g->pid == OV2640_PID)
+  {
+    // Mode SVGA : coordonnées divisées par 2
+    int d = half ? 2 : 1;
+    res = s->set_res_raw(s, half ? OV2640_WINDOW_SVGA : OV2640_WINDOW_UXGA, 0, 0, 0, x / d, y / d, w / d, h / d, out_w, out_h, false, false);
+  }
+  else
+  {
+    // Même marge de lecture et même blanking vertical que le plein champ : VTS suit
+    // le nombre de lignes lues (divisé par 2 en binning, comme set_framesize du pilote)
+    int margin_x = g->ex - g->sx + 1 - g->max_w;
+    int margin_y = g->ey - g->sy + 1 - g->max_h;
+    int blank_y = g->ty - (g->ey - g->sy + 1);
+    int sx = g->sx + x;
+    int sy = g->sy + y;
+    int ex = sx + w + margin_x - 1;
+    int ey = sy + h + margin_y - 1;
+    int ty = ey - sy + 1 + blank_y;
+    bool scale = out_w != (half ? w / 2 : w) || out_h != (half ? h / 2 : h);
+    res = s->set_res_raw(s, sx, sy, ex, ey, g->ox, g->oy, g->tx, half ? ty / 2 : ty, out_w, out_h, scale, half);
+  }
+  if (res)
+  {
+    LOGR_E(LOG_MOD_CAMERA, "Fenêtre %d,%d %dx%d -> %ux%u refusée (%d)", x, y, w, h, out_w, out_h, res);
+    return ESP_FAIL;
+  }
+  camera_window_current.x = x * 1000 / g->max_w;
+  camera_window_current.y = y * 1000 / g->max_h;
+  camera_window_current.w = w * 1000 / g->max_w;
+  camera_window_current.h = h * 1000 / g->max_h;
+  camera_window_active = true;
+  camera_window_following = false;
+  camera_window_roi_on = false;
+  LOGR_I(LOG_MOD_CAMERA, "Fenêtre %d,%d %dx%d -> %ux%u%s", x, y, w, h, out_w, out_h, half ? " (binning)" : "");
+  return ESP_OK;
+}
+
+static esp_err_t camera_window_reset_locked()
+{
+  sensor_t *s = esp_camera_sensor_get();
+  if (!s)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+  camera_window_active = false;
+  camera_window_following = false;
+  camera_window_roi_on = false;
+  return s->set_framesize(s, s->status.framesize) ? ESP_FAIL : ESP_OK;
+}
+
+static esp_err_t camera_window_restore_locked()
+{
+  sensor_t *s = esp_camera_sensor_get();
+  if (!s)
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (!settings_get(SET_ROI_ENABLED))
+  {
+    return camera_window_active ? camera_window_reset_locked() : ESP_OK;
+  }
+  const camera_geometry_t *g = camera_geometry(s);
+  if (!g || s->pixformat != PIXFORMAT_JPEG)
+  {
+    camera_window_roi_on = false;
+    return ESP_ERR_NOT_SUPPORTED;
+  }
+  camera_window_t win;
+  win.x = settings_get(SET_ROI_X);
+  win.y = settings_get(SET_ROI_Y);
+  win.w = settings_get(SET_ROI_W);
+  win.h = settings_get(SET_ROI_H);
+  // Sortie : pixels de la fenêtre (moitié en binning), sans dépasser la framesize
+  int d = settings_get(SET_ROI_BINNING) ? 2 : 1;
+  int out_w = win.w * g->max_w / 1000 / d;
+  int out_h = win.h * g->max_h / 1000 / d;
+  int fs_w = resolution[s->status.framesize].width;
+  int fs_h = resolution[s->status.framesize].height;
+  if (out_w > fs_w)
+  {
+    out_h = out_h * fs_w / out_w;
+    out_w = fs_w;
+  }
+  if (out_h > fs_h)
+  {
+    out_w = out_w * fs_h / out_h;
+    out_h = fs_h;
+  }
+  esp_err_t err = camera_window_apply_locked(&win, out_w, out_h);
+  camera_window_roi_on = err == ESP_OK;
+  return err;
+}
+
+esp_err_t camera_window_apply(const camera_window_t *win, uint16_t out_w, uint16_t out_h)
+{
+  sensor_lock();
+  esp_err_t err = camera_window_apply_locked(win, out_w, out_h);
+  sensor_unlock();
+  return err;
+}
+
+esp_err_t camera_window_reset()
+{
+  sensor_lock();
+  esp_err_t err = camera_window_reset_locked();
+  sensor_unlock();
+  return err;
+}
+
+esp_err_t camera_window_restore()
+{
+  sensor_lock();
+  esp_err_t err = camera_window_restore_locked();
+  sensor_unlock();
+  return err;
+}
+
+bool camera_window_get(camera_window_t *win)
+{
+  sensor_lock();
+  bool active = camera_window_active;
+  if (active && win)
+  {
+    *win = camera_window_current;
+  }
+  sensor_unlock();
+  return active;
+}
+
+bool camera_window_roi()
+{
+  return camera_window_roi_on;
+}
+
+void camera_window_follow(const presence_position_t *pos)
+{
+  if (!boot_is_set(BOOT_READY_CAMERA))
+  {
+    return;
+  }
+  // Tâche présence : capteur occupé par un handler ou une capture fixe, on suivra au
+  // prochain passage plutôt que de retarder la détection
+  if (!sensor_lock_try(0))
+  {
+    return;
+  }
+  bool was_active = camera_window_active;
+  bool was_roi = camera_window_roi_on;
+  camera_window_t was = camera_window_current;
+  if (!settings_get(SET_PRESENCE_FOLLOW) || !pos->valid)
+  {
+    // Ne touche pas à une fenêtre posée par ailleurs
+    if (camera_window_following)
+    {
+      camera_window_restore_locked();
+    }
+  }
+  else
+  {
+    uint16_t size = settings_get(SET_PRESENCE_FOLLOW_SIZE);
+    camera_window_t win;
+    win.w = size;
+    win.h = size;
+    win.x = camera_clamp((int)pos->x - size / 2, 0, 1000 - size);
+    win.y = camera_clamp((int)pos->y - size / 2, 0, 1000 - size);
+    if (camera_window_apply_locked(&win, 0, 0) == ESP_OK)
+    {
+      camera_window_following = true;
+    }
+  }
+  // Fenêtre déplacée, posée ou rendue : /status (roi) et les abonnés /events suivent,
+  // comme après un réglage ; rien tant que l'oiseau reste dans la même fenêtre
+  if (camera_window_active != was_active || camera_window_roi_on != was_roi ||
+      (camera_window_active && memcmp(&camera_window_current, &was, sizeof(was))))
+  {
+    status_invalidate();
+    event_publish(EVENT_SETTINGS, "{\"keys\":[\"window\"]}");
+  }
+  sensor_unlock();
+}
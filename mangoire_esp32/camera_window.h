@@ -0,0 +1,49 @@
+#pragma once
+#include <stdint.h>
+#include "esp_err.h"
+#include "presence.h"
+
+// Fenêtrage capteur : ne lire (et n'encoder) qu'une partie du champ, mise à l'échelle
+// par l'ISP du capteur vers la taille de sortie. Traduit pour chaque capteur vers
+// set_res_raw (même chemin que /win, réglage brut de débogage) :
+//  - OV3660 / OV5640 : fenêtre de lecture dans la matrice active ; moins de lignes lues,
+//    la période de trame (VTS) est réduite d'autant ;
+//  - OV2640 : fenêtre du mode UXGA, ou du mode SVGA.
+// Quand la sortie tient dans la moitié de la fenêtre, le capteur lit en binning 2x2
+// (OV2640 : mode SVGA) : deux fois moins de lignes, cadence doublée.
+// Les coordonnées sont en ‰ du champ complet (gauche/haut = 0), comme la position de
+// presence.h. La fenêtre est agrandie si besoin pour ne jamais suréchantillonner
+// (1 pixel capteur par pixel de sortie au plus) et pour garder le rapport de la sortie.
+//
+// Mode ROI (réglages roi.*) : fenêtre persistante sur la mangeoire, réappliquée au
+// démarrage et après chaque changement de framesize. Sortie = taille de la fenêtre
+// (moitié avec roi.binning), plafonnée à la framesize : /stream et /capture livrent la
+// mangeoire seule, plus vite et en moins d'octets qu'au plein champ.
+
+typedef struct
+{
+  uint16_t x; // ‰ de la largeur
+  uint16_t y; // ‰ de la hauteur
+  uint16_t w;
+  uint16_t h;
+} camera_window_t;
+
+// Toutes les fonctions prennent sensor_lock (sensor_lock.h).
+// Applique `win` avec une sortie out_w x out_h (0 = taille de framesize courante).
+// ESP_ERR_NOT_SUPPORTED sur les autres capteurs ou hors JPEG.
+esp_err_t camera_window_apply(const camera_window_t *win, uint16_t out_w = 0, uint16_t out_h = 0);
+// Retour au champ complet de la framesize courante
+esp_err_t camera_window_reset();
+// Fenêtre active (en ‰, après ajustement) ; false = champ complet
+bool camera_window_get(camera_window_t *win);
+
+// Fenêtre de repos : ROI si roi.enabled, sinon champ complet. À appeler après
+// set_framesize (qui remet le capteur au plein champ) et après modification de roi.*
+esp_err_t camera_window_restore();
+// Mode ROI appliqué
+bool camera_window_roi();
+
+// Rappel de position (presence_init) : recadre sur l'oiseau si presence.follow est
+// actif (largeur presence.follow_size), fenêtre de repos quand la position est perdue.
+// Capteur occupé (sensor_lock) : ce passage est sauté
+void camera_window_follow(const presence_position_t *pos);
@@ -2,10 +2,12 @@
 #include <FS.h>
 #include <LittleFS.h>
 #include <arduino.h>
+#include "trace.h"
+#include "log_ring.h"
 // Utilitaire pour charger la config depuis LittleFS
 bool loadConfig(JsonDocument &doc, const char *filename)
 {
-      Serial.printf("[DIAG] Chargement de la config depuis %s\n", filename);
+      LOGR_D(LOG_MOD_CONFIG, "Chargement de la config depuis %s", filename);
       if (!LittleFS.begin())
             return false;
       File file = LittleFS.open(filename, "r");
@@ -13,21 +15,26 @@ bool loadConfig(JsonDocument &doc, const char *filename)
             return false;
       DeserializationError error = deserializeJson(doc, file);
       file.close();
-      Serial.println("[DIAG] Chargement de la config terminé");
+      LOGR_D(LOG_MOD_CONFIG, "Chargement de la config terminé");
       return !error;
 }
 
 // Utilitaire pour sauvegarder la config dans LittleFS
 bool saveConfig(const JsonDocument &doc, const char *filename)
 {
-      Serial.printf("[DIAG] Sauvegarde de la config dans %s\n", filename);
+      LOGR_D(LOG_MOD_CONFIG, "Sauvegarde de la config dans %s", filename);
       if (!LittleFS.begin())
             return false;
+      TRACE_BEGIN("config_save");
       File file = LittleFS.open(filename, "w");
       if (!file)
+      {
+            TRACE_END("config_save");
             return false;
+      }
       serializeJson(doc, file);
       file.close();
-      Serial.println("[DIAG] Config sauvegardée avec succès");
+      TRACE_END("config_save");
+      LOGR_I(LOG_MOD_CONFIG, "Config sauvegardée dans %s", filename);
       return true;
 }
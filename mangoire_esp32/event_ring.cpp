@@ -0,0 +1,131 @@
+#include "event_ring.h"
+#include <Arduino.h>
+#include <atomic>
+#include <stdarg.h>
+#include <string.h>
+#include <esp_heap_caps.h>
+#include "esp_timer.h"
+
+#define EVENT_SEQ_WRITING 0xFFFFFFFFUL // Slot en cours d'écriture
+#define EVENT_HEAP_WARN_BYTES (24 * 1024)
+#define EVENT_HEAP_PERIOD_US (5 * 1000000LL)
+
+typedef struct
+{
+  std::atomic<uint32_t> seq;
+  uint32_t time_ms;
+  uint8_t type;
+  char data[EVENT_DATA_SIZE];
+} event_slot_t;
+
+static event_slot_t event_slots[EVENT_RING_SIZE];
+static std::atomic<uint32_t> event_next(1); // 0 = slot jamais écrit
+
+static const char *event_names[EVENT_TYPE_COUNT] = {"settings", "motion", "distance", "controller", "heap", "position", "still"};
+
+const char *event_type_name(uint8_t type)
+{
+  return type < EVENT_TYPE_COUNT ? event_names[type] : "unknown";
+}
+
+void event_publish(event_type_t type, const char *fmt, ...)
+{
+  char data[EVENT_DATA_SIZE];
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(data, sizeof(data), fmt, args);
+  va_end(args);
+
+  uint32_t seq = event_next.fetch_add(1, std::memory_order_relaxed);
+  event_slot_t *slot = &event_slots[seq % EVENT_RING_SIZE];
+  slot->seq.store(EVENT_SEQ_WRITING, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot->time_ms = (uint32_t)(esp_timer_get_time() / 1000);
+  slot->type = type;
+  memcpy(slot->data, data, sizeof(data));
+  slot->seq.store(seq, std::memory_order_release);
+}
+
+uint32_t event_head()
+{
+  return event_next.load(std::memory_order_acquire);
+}
+
+uint32_t event_resume(uint32_t last_id)
+{
+  uint32_t head = event_head();
+  if (last_id >= head)
+  {
+    // Jamais publié depuis le démarrage : la séquence est repartie de 1
+    return head > EVENT_RING_SIZE ? head - EVENT_RING_SIZE : 1;
+  }
+  return last_id + 1;
+}
+
+bool event_read(uint32_t *cursor, event_t *out, uint32_t *dropped)
+{
+  uint32_t head = event_next.load(std::memory_order_acquire);
+  if ((int32_t)(head - *cursor) > EVENT_RING_SIZE)
+  {
+    // Dépassé par les producteurs : on repart du plus ancien slot encore valide
+    if (dropped)
+    {
+      *dropped += head - EVENT_RING_SIZE - *cursor;
+    }
+    *cursor = head - EVENT_RING_SIZE;
+  }
+  while ((int32_t)(head - *cursor) > 0)
+  {
+    event_slot_t *slot = &event_slots[*cursor % EVENT_RING_SIZE];
+    uint32_t s1 = slot->seq.load(std::memory_order_acquire);
+    if (s1 == EVENT_SEQ_WRITING || (int32_t)(s1 - *cursor) < 0)
+    {
+      return false; // Pas encore publié
+    }
+    if (s1 == *cursor)
+    {
+      out->time_ms = slot->time_ms;
+      out->type = slot->type;
+      memcpy(out->data, slot->data, sizeof(out->data));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot->seq.load(std::memory_order_relaxed) == s1)
+      {
+        out->data[sizeof(out->data) - 1] = 0;
+        out->seq = s1;
+        (*cursor)++;
+        return true;
+      }
+    }
+    // Slot réécrit pendant la lecture : événement perdu
+    if (dropped)
+    {
+      (*dropped)++;
+    }
+    (*cursor)++;
+  }
+  return false;
+}
+
+void event_check_heap()
+{
+  static int64_t last_check = 0;
+  static bool warned = false;
+  int64_t now = esp_timer_get_time();
+  if (now - last_check < EVENT_HEAP_PERIOD_US)
+  {
+    return;
+  }
+  last_check = now;
+  size_t free_heap = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+  size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+  // Hystérésis : une alerte par passage sous le seuil
+  if (free_heap < EVENT_HEAP_WARN_BYTES && !warned)
+  {
+    event_publish(EVENT_HEAP, "{\"free\":%u,\"largest\":%u}", (unsigned)free_heap, (unsigned)largest);
+    warned = true;
+  }
+  else if (free_heap > EVENT_HEAP_WARN_BYTES + EVENT_HEAP_WARN_BYTES / 4)
+  {
+    warned = false;
+  }
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Anneau d'événements sans verrou (diffusion, plusieurs producteurs / plusieurs lecteurs).
+// Les producteurs (caméra, capteur, handlers) ne bloquent jamais : ils réservent un numéro
+// de séquence puis écrivent le slot. Un lecteur lent est simplement dépassé : il saute les
+// événements écrasés et les compte comme perdus.
+
+#define EVENT_RING_SIZE 32 // Puissance de 2
+#define EVENT_DATA_SIZE 96 // Charge utile JSON max (tronquée au-delà)
+
+typedef enum
+{
+  EVENT_SETTINGS = 0, // Réglages modifiés : {"keys":[...]}
+  EVENT_MOTION,       // Mouvement : {"state":"start"|"stop"}
+  EVENT_DISTANCE,     // Présence VL53L1X (entrée/sortie) : {"mm":...,"present":true|false}
+  EVENT_CONTROLLER,   // Décision du contrôleur fps/qualité
+  EVENT_HEAP,         // Alerte mémoire : {"free":...,"largest":...}
+  EVENT_POSITION,     // Position estimée par le balayage VL53L1X : {"x":...,"y":...,"mm":...}
+  EVENT_STILL,        // Photo haute résolution : {"w":...,"h":...,"bytes":...,"switch_us":...,"lost":...}
+  EVENT_TYPE_COUNT
+} event_type_t;
+
+typedef struct
+{
+  uint32_t seq;
+  uint32_t time_ms;
+  uint8_t type;
+  char data[EVENT_DATA_SIZE];
+} event_t;
+
+// Publie un événement ; `fmt` produit l'objet JSON de données.
+void event_publish(event_type_t type, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+// Numéro de séquence du prochain événement (curseur initial d'un nouvel abonné)
+uint32_t event_head();
+// Curseur de reprise après `last_id` (en-tête Last-Event-ID). Un identifiant en avance sur
+// la séquence (antérieur à un redémarrage) repart du plus ancien événement conservé.
+uint32_t event_resume(uint32_t last_id);
+
+// Lit l'événement à *cursor. Retourne false s'il n'y a rien de nouveau.
+// Si le lecteur a été dépassé, *cursor avance au plus ancien événement disponible
+// et *dropped est incrémenté du nombre d'événements perdus.
+bool event_read(uint32_t *cursor, event_t *out, uint32_t *dropped);
+
+const char *event_type_name(uint8_t type);
+
+// Publie EVENT_HEAP si la mémoire interne passe sous le seuil (limité en fréquence)
+void event_check_heap();
@@ -0,0 +1,110 @@
+#include "http_body.h"
+#include <string.h>
+#include "http_status.h"
+#include "log_ring.h"
+
+int http_body_recv(httpd_req_t *req, char *buf, size_t len)
+{
+  int r = HTTPD_SOCK_ERR_TIMEOUT;
+  for (int tries = 0; r == HTTPD_SOCK_ERR_TIMEOUT && tries < HTTP_BODY_MAX_TIMEOUTS; tries++)
+  {
+    r = httpd_req_recv(req, buf, len);
+  }
+  return r;
+}
+
+esp_err_t http_body_recv_failed(httpd_req_t *req, int err)
+{
+  if (err == HTTPD_SOCK_ERR_TIMEOUT)
+  {
+    LOGR_W(LOG_MOD_HTTP, "%s: corps non reçu (client muet)", req->uri);
+    http_send_err(req, HTTPD_408_REQ_TIMEOUT, "Corps non reçu");
+  }
+  else
+  {
+    http_send_err(req, HTTPD_400_BAD_REQUEST, "Lecture échouée");
+  }
+  return ESP_FAIL;
+}
+
+esp_err_t http_body_read(httpd_req_t *req, char *buf, size_t len)
+{
+  size_t received = 0;
+  while (received < len)
+  {
+    int r = http_body_recv(req, buf + received, len - received);
+    if (r <= 0)
+    {
+      return http_body_recv_failed(req, r);
+    }
+    received += r;
+  }
+  return ESP_OK;
+}
+
+HttpBodyReader::HttpBodyReader(httpd_req_t *req) : req(req), remaining(req->content_len), pos(0), len(0), error(0)
+{
+}
+
+bool HttpBodyReader::fill()
+{
+  if (remaining == 0)
+  {
+    return false;
+  }
+  int r = http_body_recv(req, buf, remaining < sizeof(buf) ? remaining : sizeof(buf));
+  if (r <= 0)
+  {
+    error = r ? r : HTTPD_SOCK_ERR_FAIL;
+    remaining = 0;
+    return false;
+  }
+  remaining -= r;
+  pos = 0;
+  len = r;
+  return true;
+}
+
+int HttpBodyReader::read()
+{
+  if (pos >= len && !fill())
+  {
+    return -1;
+  }
+  return (uint8_t)buf[pos++];
+}
+
+size_t HttpBodyReader::readBytes(char *buffer, size_t length)
+{
+  size_t n = 0;
+  while (n < length && (pos < len || fill()))
+  {
+    size_t chunk = len - pos < length - n ? len - pos : length - n;
+    memcpy(buffer + n, buf + pos, chunk);
+    pos += chunk;
+    n += chunk;
+  }
+  return n;
+}
+
+esp_err_t http_body_json(httpd_req_t *req, JsonDocument &doc, const JsonDocument *filter)
+{
+  if (req->content_len == 0 || req->content_len > HTTP_BODY_MAX)
+  {
+    http_send_err(req, HTTPD_400_BAD_REQUEST, "Taille du corps invalide");
+    return ESP_FAIL;
+  }
+  HttpBodyReader reader(req);
+  DeserializationError err = filter ? deserializeJson(doc, reader, DeserializationOption::Filter(*filter)) : deserializeJson(doc, reader);
+  if (reader.failed())
+  {
+    return http_body_recv_failed(req, reader.recv_error());
+  }
+  if (err || !doc.is<JsonObject>())
+  {
+    LOGR_W(LOG_MOD_HTTP, "%s: JSON refusé (%s)", req->uri, err ? err.c_str() : "pas un objet");
+    http_send_err(req, HTTPD_400_BAD_REQUEST, err == DeserializationError::NoMemory ? "JSON trop gros" : "JSON invalide");
+    return ESP_FAIL;
+  }
+  return ESP_OK;
+}
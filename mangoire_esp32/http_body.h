@@ -0,0 +1,55 @@
+#pragma once
+#include <stddef.h>
+#include <ArduinoJson.h>
+#include "esp_http_server.h"
+
+// Lecture du corps d'une requête par morceaux bornés, pour désérialiser le JSON en flux :
+// ArduinoJson lit via HttpBodyReader (lecteur personnalisé read/readBytes) et un filtre
+// ne garde que les clés connues. La mémoire ne dépend plus de la taille du corps, seulement
+// du document cible ; un corps trop riche en clés connues lève NoMemory (400).
+
+#define HTTP_BODY_CHUNK 128       // Tampon de réception
+#define HTTP_BODY_MAX (16 * 1024) // Au-delà, la requête est refusée sans être lue
+#define HTTP_BODY_MAX_TIMEOUTS 3  // Délais de réception (recv_wait_timeout) d'affilée avant abandon
+
+// Toute lecture de corps passe par ici : un client qui envoie ses en-têtes puis se tait
+// ne retient la tâche httpd que HTTP_BODY_MAX_TIMEOUTS délais de réception.
+
+// Reçoit au plus `len` octets. Retourne le nombre reçu (> 0), HTTPD_SOCK_ERR_TIMEOUT si le
+// client s'est tu, ou une autre erreur HTTPD_SOCK_ERR_* (connexion fermée : 0).
+int http_body_recv(httpd_req_t *req, char *buf, size_t len);
+// Répond à un échec de http_body_recv : 408 si le client s'est tu, 400 sinon. ESP_FAIL.
+esp_err_t http_body_recv_failed(httpd_req_t *req, int err);
+// Lit exactement `len` octets du corps dans `buf` ; en cas d'échec, a déjà répondu.
+esp_err_t http_body_read(httpd_req_t *req, char *buf, size_t len);
+
+class HttpBodyReader
+{
+public:
+  explicit HttpBodyReader(httpd_req_t *req);
+  int read();
+  size_t readBytes(char *buffer, size_t length);
+  bool failed() const
+  {
+    return error != 0;
+  }
+  // Erreur de http_body_recv (0 = aucune)
+  int recv_error() const
+  {
+    return error;
+  }
+
+private:
+  bool fill();
+
+  httpd_req_t *req;
+  size_t remaining;
+  size_t pos;
+  size_t len;
+  int error;
+  char buf[HTTP_BODY_CHUNK];
+};
+
+// Désérialise le corps de `req` dans `doc` (filtre optionnel). En cas d'erreur, répond
+// 400 (408 si le client s'est tu) et retourne ESP_FAIL.
+esp_err_t http_body_json(httpd_req_t *req, JsonDocument &doc, const JsonDocument *filter = NULL);
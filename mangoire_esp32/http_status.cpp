@@ -0,0 +1,54 @@
+#include "http_status.h"
+#include <stdlib.h>
+
+static int http_err_status(httpd_err_code_t code)
+{
+  switch (code)
+  {
+  case HTTPD_400_BAD_REQUEST:
+    return 400;
+  case HTTPD_404_NOT_FOUND:
+    return 404;
+  case HTTPD_405_METHOD_NOT_ALLOWED:
+    return 405;
+  case HTTPD_408_REQ_TIMEOUT:
+    return 408;
+  case HTTPD_500_INTERNAL_SERVER_ERROR:
+    return 500;
+  default:
+    return 0;
+  }
+}
+
+void http_record_status(httpd_req_t *req, int status)
+{
+  http_req_ctx_t *ctx = (http_req_ctx_t *)req->user_ctx;
+  if (ctx)
+  {
+    ctx->status = status;
+  }
+}
+
+esp_err_t http_send_err(httpd_req_t *req, httpd_err_code_t code, const char *msg)
+{
+  http_record_status(req, http_err_status(code));
+  return httpd_resp_send_err(req, code, msg);
+}
+
+esp_err_t http_send_404(httpd_req_t *req)
+{
+  http_record_status(req, 404);
+  return httpd_resp_send_404(req);
+}
+
+esp_err_t http_send_500(httpd_req_t *req)
+{
+  http_record_status(req, 500);
+  return httpd_resp_send_500(req);
+}
+
+esp_err_t http_set_status(httpd_req_t *req, const char *status)
+{
+  http_record_status(req, atoi(status));
+  return httpd_resp_set_status(req, status);
+}
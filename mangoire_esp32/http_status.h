@@ -0,0 +1,21 @@
+#pragma once
+#include "esp_http_server.h"
+
+// Statut HTTP des réponses (pour /metrics).
+// metered_handler (app_httpd.cpp) confie à chaque requête un contexte (req->user_ctx) où
+// ces fonctions relèvent le statut envoyé, comptabilisé à la fin du handler : les requêtes
+// traitées en même temps (tâches des flux, /events) ne se marchent pas dessus. Une copie
+// asynchrone (httpd_req_async_handler_begin) n'en a pas : son statut n'est plus compté.
+// Toute réponse d'erreur passe par ces fonctions plutôt que par httpd_resp_send_err.
+
+typedef struct
+{
+  int status;
+} http_req_ctx_t;
+
+void http_record_status(httpd_req_t *req, int status);
+esp_err_t http_send_err(httpd_req_t *req, httpd_err_code_t code, const char *msg);
+esp_err_t http_send_404(httpd_req_t *req);
+esp_err_t http_send_500(httpd_req_t *req);
+// `status` : ligne de statut complète ("503 Service Unavailable")
+esp_err_t http_set_status(httpd_req_t *req, const char *status);
@@ -0,0 +1,649 @@
+#include "jpeg_crop.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define JPEG_MAX_COMPS 4
+#define JPEG_MAX_TABLES 2 // Baseline : tables Huffman 0 et 1
+#define JPEG_LOOKAHEAD 8  // Codes courts décodés en une lecture de table
+
+typedef struct
+{
+  bool present;
+  uint16_t look[1 << JPEG_LOOKAHEAD]; // (longueur << 8) | symbole ; 0 = code plus long
+  int32_t maxcode[17];                // Plus grand code de chaque longueur, -1 si aucun
+  int32_t valoff[17];                 // Index dans huffval moins le premier code
+  uint8_t huffval[256];
+  uint16_t code[256]; // Encodage : code et longueur de chaque symbole (0 = absent)
+  uint8_t size[256];
+} jpeg_huff_t;
+
+typedef struct
+{
+  uint8_t id;
+  uint8_t h;
+  uint8_t v;
+  uint8_t dc;
+  uint8_t ac;
+  int pred;     // Prédicteur DC de l'image source
+  int out_pred; // Prédicteur DC de l'image découpée
+} jpeg_comp_t;
+
+typedef struct
+{
+  const uint8_t *p;
+  const uint8_t *end;
+  uint32_t acc;
+  int bits;
+  bool marker; // Marqueur (ou fin) atteint : des zéros ensuite
+} jpeg_reader_t;
+
+typedef struct
+{
+  uint8_t *p;
+  uint8_t *end;
+  uint32_t acc;
+  int bits;
+  bool overflow;
+} jpeg_writer_t;
+
+typedef struct
+{
+  jpeg_huff_t dc[JPEG_MAX_TABLES];
+  jpeg_huff_t ac[JPEG_MAX_TABLES];
+  jpeg_comp_t comps[JPEG_MAX_COMPS];
+  int ncomps;
+  uint16_t restart; // Intervalle DRI (MCU), 0 = aucun
+} jpeg_ctx_t;
+
+static bool jpeg_huff_build(jpeg_huff_t *h, const uint8_t *counts, const uint8_t *vals)
+{
+  memset(h, 0, sizeof(*h));
+  int32_t code = 0;
+  int k = 0;
+  for (int len = 1; len <= 16; len++)
+  {
+    h->valoff[len] = k - code;
+    for (int i = 0; i < counts[len - 1]; i++, k++, code++)
+    {
+      uint8_t sym = vals[k];
+      h->huffval[k] = sym;
+      h->code[sym] = code;
+      h->size[sym] = len;
+      if (len <= JPEG_LOOKAHEAD)
+      {
+        int shift = JPEG_LOOKAHEAD - len;
+        for (int j = 0; j < (1 << shift); j++)
+        {
+          h->look[(code << shift) | j] = (len << 8) | sym;
+        }
+      }
+    }
+    h->maxcode[len] = counts[len - 1] ? code - 1 : -1;
+    if (code > (1 << len))
+    {
+      return false; // Plus de codes que la longueur n'en permet
+    }
+    code <<= 1;
+  }
+  h->present = true;
+  return true;
+}
+
+// ===========================
+// Lecture des données entropiques (octets 0xFF 0x00 déjà retirés)
+// ===========================
+static void jpeg_fill(jpeg_reader_t *r)
+{
+  while (r->bits <= 24)
+  {
+    uint32_t b = 0;
+    if (!r->marker && r->p < r->end)
+    {
+      b = *r->p;
+      if (b != 0xFF)
+      {
+        r->p++;
+      }
+      else if (r->p + 1 < r->end && r->p[1] == 0x00)
+      {
+        r->p += 2;
+      }
+      else
+      {
+        // RST, EOI ou fin tronquée : r->p reste sur le 0xFF
+        r->marker = true;
+        b = 0;
+      }
+    }
+    else
+    {
+      r->marker = true;
+    }
+    r->acc = (r->acc << 8) | b;
+    r->bits += 8;
+  }
+}
+
+static uint32_t jpeg_bits(jpeg_reader_t *r, int n)
+{
+  if (r->bits < n)
+  {
+    jpeg_fill(r);
+  }
+  r->bits -= n;
+  return (r->acc >> r->bits) & ((1u << n) - 1);
+}
+
+static int jpeg_huff_decode(jpeg_reader_t *r, const jpeg_huff_t *h)
+{
+  if (r->bits < 16)
+  {
+    jpeg_fill(r);
+  }
+  uint16_t e = h->look[(r->acc >> (r->bits - JPEG_LOOKAHEAD)) & ((1 << JPEG_LOOKAHEAD) - 1)];
+  if (e)
+  {
+    r->bits -= e >> 8;
+    return e & 0xFF;
+  }
+  // Codes canoniques : un préfixe absent de la table courte est plus grand que tous
+  // les codes plus courts
+  for (int len = JPEG_LOOKAHEAD + 1; len <= 16; len++)
+  {
+    int32_t code = (r->acc >> (r->bits - len)) & ((1u << len) - 1);
+    if (code <= h->maxcode[len])
+    {
+      r->bits -= len;
+      return h->huffval[h->valoff[len] + code];
+    }
+  }
+  return -1;
+}
+
+// Intervalle de redémarrage terminé : bits de bourrage ignorés, marqueur RSTn sauté
+static bool jpeg_restart(jpeg_reader_t *r)
+{
+  const uint8_t *p = r->p;
+  while (p + 1 < r->end && !(p[0] == 0xFF && (p[1] & 0xF8) == 0xD0))
+  {
+    p++;
+  }
+  if (p + 1 >= r->end)
+  {
+    return false;
+  }
+  r->p = p + 2;
+  r->acc = 0;
+  r->bits = 0;
+  r->marker = false;
+  return true;
+}
+
+// ===========================
+// Écriture
+// ===========================
+static void jpeg_put_byte(jpeg_writer_t *w, uint8_t b)
+{
+  if (w->p < w->end)
+  {
+    *w->p++ = b;
+  }
+  else
+  {
+    w->overflow = true;
+  }
+}
+
+static void jpeg_put_raw(jpeg_writer_t *w, const uint8_t *data, size_t len)
+{
+  if ((size_t)(w->end - w->p) < len)
+  {
+    w->overflow = true;
+    return;
+  }
+  memcpy(w->p, data, len);
+  w->p += len;
+}
+
+static void jpeg_put_bits(jpeg_writer_t *w, uint32_t v, int n)
+{
+  w->acc = (w->acc << n) | (v & ((1u << n) - 1));
+  w->bits += n;
+  while (w->bits >= 8)
+  {
+    w->bits -= 8;
+    uint8_t b = w->acc >> w->bits;
+    jpeg_put_byte(w, b);
+    if (b == 0xFF)
+    {
+      jpeg_put_byte(w, 0x00);
+    }
+  }
+}
+
+// Complète le dernier octet avec des 1
+static void jpeg_put_flush(jpeg_writer_t *w)
+{
+  if (w->bits)
+  {
+    jpeg_put_bits(w, 0x7F, 8 - w->bits);
+  }
+}
+
+static void jpeg_put_segment(jpeg_writer_t *w, uint8_t marker, const uint8_t *data, size_t len)
+{
+  uint8_t hdr[4] = {0xFF, marker, (uint8_t)((len + 2) >> 8), (uint8_t)(len + 2)};
+  jpeg_put_raw(w, hdr, sizeof(hdr));
+  jpeg_put_raw(w, data, len);
+}
+
+// ===========================
+// Blocs
+// ===========================
+// Un bloc 8x8 : DC relu puis recodé contre le prédicteur de sortie, AC recopiés
+// (mêmes tables, mêmes codes) si `keep`
+static jpeg_crop_err_t jpeg_block(jpeg_reader_t *r, jpeg_writer_t *w, const jpeg_ctx_t *c, jpeg_comp_t *comp, bool keep)
+{
+  const jpeg_huff_t *dc = &c->dc[comp->dc];
+  const jpeg_huff_t *ac = &c->ac[comp->ac];
+  int s = jpeg_huff_decode(r, dc);
+  if (s < 0 || s > 11)
+  {
+    return JPEG_CROP_CORRUPT;
+  }
+  if (s)
+  {
+    int v = jpeg_bits(r, s);
+    comp->pred += v < (1 << (s - 1)) ? v - (1 << s) + 1 : v;
+  }
+  if (keep)
+  {
+    int d = comp->pred - comp->out_pred;
+    comp->out_pred = comp->pred;
+    int n = 0;
+    for (int a = d < 0 ? -d : d; a; a >>= 1)
+    {
+      n++;
+    }
+    if (n > 11 || !dc->size[n])
+    {
+      return JPEG_CROP_UNSUPPORTED; // Catégorie absente d'une table optimisée
+    }
+    jpeg_put_bits(w, dc->code[n], dc->size[n]);
+    if (n)
+    {
+      jpeg_put_bits(w, d < 0 ? d - 1 : d, n);
+    }
+  }
+  for (int k = 1; k < 64;)
+  {
+    int sym = jpeg_huff_decode(r, ac);
+    if (sym < 0)
+    {
+      return JPEG_CROP_CORRUPT;
+    }
+    int run = sym >> 4;
+    int size = sym & 15;
+    uint32_t bits = size ? jpeg_bits(r, size) : 0;
+    if (keep)
+    {
+      jpeg_put_bits(w, ac->code[sym], ac->size[sym]);
+      if (size)
+      {
+        jpeg_put_bits(w, bits, size);
+      }
+    }
+    if (size)
+    {
+      k += run + 1;
+    }
+    else if (run == 15)
+    {
+      k += 16; // ZRL
+    }
+    else
+    {
+      break; // EOB
+    }
+    if (k > 64)
+    {
+      return JPEG_CROP_CORRUPT;
+    }
+  }
+  return JPEG_CROP_OK;
+}
+
+// ===========================
+// Découpe
+// ===========================
+static jpeg_crop_err_t jpeg_crop_run(jpeg_ctx_t *c, const uint8_t *in, size_t in_len, const jpeg_rect_t *rect, jpeg_writer_t *w, jpeg_rect_t *actual)
+{
+  const uint8_t *p = in + 2;
+  const uint8_t *end = in + in_len;
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t mcu_w = 8;
+  uint32_t mcu_h = 8;
+  uint32_t mx0 = 0, mx1 = 0, my0 = 0, my1 = 0, mcus_x = 0;
+  jpeg_put_raw(w, in, 2); // SOI
+
+  // En-têtes recopiés jusqu'au SOS (SOF réécrit, DRI retiré)
+  for (;;)
+  {
+    if (p >= end || *p != 0xFF)
+    {
+      return JPEG_CROP_CORRUPT;
+    }
+    while (p < end && *p == 0xFF)
+    {
+      p++;
+    }
+    if (p >= end)
+    {
+      return JPEG_CROP_CORRUPT;
+    }
+    uint8_t m = *p++;
+    if (m == 0x01 || (m >= 0xD0 && m <= 0xD8))
+    {
+      continue; // Marqueurs sans longueur
+    }
+    if (m == 0xD9 || end - p < 2)
+    {
+      return JPEG_CROP_CORRUPT;
+    }
+    size_t len = (p[0] << 8) | p[1];
+    if (len < 2 || (size_t)(end - p) < len)
+    {
+      return JPEG_CROP_CORRUPT;
+    }
+    const uint8_t *seg = p + 2;
+    size_t seg_len = len - 2;
+    p += len;
+
+    if (m == 0xC4)
+    {
+      // DHT : une ou plusieurs tables
+      for (const uint8_t *q = seg; q < seg + seg_len;)
+      {
+        if (seg + seg_len - q < 17)
+        {
+          return JPEG_CROP_CORRUPT;
+        }
+        int tc = q[0] >> 4;
+        int th = q[0] & 15;
+        int n = 0;
+        for (int i = 1; i <= 16; i++)
+        {
+          n += q[i];
+        }
+        if (n > 256 || seg + seg_len - q < 17 + n)
+        {
+          return JPEG_CROP_CORRUPT;
+        }
+        if (tc > 1 || th >= JPEG_MAX_TABLES)
+        {
+          return JPEG_CROP_UNSUPPORTED;
+        }
+        if (!jpeg_huff_build(tc ? &c->ac[th] : &c->dc[th], q + 1, q + 17))
+        {
+          return JPEG_CROP_CORRUPT;
+        }
+        q += 17 + n;
+      }
+      jpeg_put_segment(w, m, seg, seg_len);
+    }
+    else if (m == 0xC0 || m == 0xC1)
+    {
+      if (seg_len < 6 || seg[0] != 8)
+      {
+        return JPEG_CROP_UNSUPPORTED;
+      }
+      height = (seg[1] << 8) | seg[2];
+      width = (seg[3] << 8) | seg[4];
+      c->ncomps = seg[5];
+      if (!height || !width || c->ncomps < 1 || c->ncomps > JPEG_MAX_COMPS || seg_len < 6 + 3 * (size_t)c->ncomps)
+      {
+        return height ? JPEG_CROP_CORRUPT : JPEG_CROP_UNSUPPORTED; // Hauteur 0 : DNL
+      }
+      uint32_t hmax = 1, vmax = 1, blocks = 0;
+      for (int i = 0; i < c->ncomps; i++)
+      {
+        jpeg_comp_t *comp = &c->comps[i];
+        comp->id = seg[6 + 3 * i];
+        // Balayage non entrelacé d'une seule composante : MCU = un bloc
+        comp->h = c->ncomps == 1 ? 1 : seg[7 + 3 * i] >> 4;
+        comp->v = c->ncomps == 1 ? 1 : seg[7 + 3 * i] & 15;
+        if (comp->h < 1 || comp->h > 4 || comp->v < 1 || comp->v > 4)
+        {
+          return JPEG_CROP_CORRUPT;
+        }
+        hmax = comp->h > hmax ? comp->h : hmax;
+        vmax = comp->v > vmax ? comp->v : vmax;
+        blocks += comp->h * comp->v;
+      }
+      if (blocks > 10)
+      {
+        return JPEG_CROP_CORRUPT;
+      }
+      mcu_w = 8 * hmax;
+      mcu_h = 8 * vmax;
+      mcus_x = (width + mcu_w - 1) / mcu_w;
+      if (!rect->w || !rect->h || rect->x >= width || rect->y >= height)
+      {
+        return JPEG_CROP_OUTSIDE;
+      }
+      uint32_t x_end = (uint32_t)rect->x + rect->w < width ? (uint32_t)rect->x + rect->w : width;
+      uint32_t y_end = (uint32_t)rect->y + rect->h < height ? (uint32_t)rect->y + rect->h : height;
+      mx0 = rect->x / mcu_w;
+      my0 = rect->y / mcu_h;
+      mx1 = (x_end + mcu_w - 1) / mcu_w;
+      my1 = (y_end + mcu_h - 1) / mcu_h;
+      actual->x = mx0 * mcu_w;
+      actual->y = my0 * mcu_h;
+      actual->w = (mx1 * mcu_w < width ? mx1 * mcu_w : width) - actual->x;
+      actual->h = (my1 * mcu_h < height ? my1 * mcu_h : height) - actual->y;
+
+      uint8_t sof[6 + 3 * JPEG_MAX_COMPS];
+      memcpy(sof, seg, 6 + 3 * c->ncomps);
+      sof[1] = actual->h >> 8;
+      sof[2] = actual->h;
+      sof[3] = actual->w >> 8;
+      sof[4] = actual->w;
+      jpeg_put_segment(w, m, sof, 6 + 3 * c->ncomps);
+    }
+    else if (m >= 0xC2 && m <= 0xCF && m != 0xC4 && m != 0xC8 && m != 0xCC)
+    {
+      return JPEG_CROP_UNSUPPORTED; // Progressif, sans perte, arithmétique
+    }
+    else if (m == 0xDD)
+    {
+      if (seg_len < 2)
+      {
+        return JPEG_CROP_CORRUPT;
+      }
+      c->restart = (seg[0] << 8) | seg[1];
+    }
+    else if (m == 0xDA)
+    {
+      if (!mcus_x || seg_len < 1)
+      {
+        return JPEG_CROP_CORRUPT;
+      }
+      int ns = seg[0];
+      if (ns != c->ncomps || seg_len < 4 + 2 * (size_t)ns)
+      {
+        return JPEG_CROP_UNSUPPORTED; // Balayages multiples
+      }
+      for (int i = 0; i < ns; i++)
+      {
+        jpeg_comp_t *comp = NULL;
+        for (int j = 0; j < c->ncomps; j++)
+        {
+          if (c->comps[j].id == seg[1 + 2 * i])
+          {
+            comp = &c->comps[j];
+          }
+        }
+        if (!comp)
+        {
+          return JPEG_CROP_CORRUPT;
+        }
+        comp->dc = seg[2 + 2 * i] >> 4;
+        comp->ac = seg[2 + 2 * i] & 15;
+        if (comp->dc >= JPEG_MAX_TABLES || comp->ac >= JPEG_MAX_TABLES || !c->dc[comp->dc].present || !c->ac[comp->ac].present)
+        {
+          return JPEG_CROP_UNSUPPORTED;
+        }
+      }
+      const uint8_t *ss = seg + 1 + 2 * ns;
+      if (ss[0] != 0 || ss[1] != 63 || ss[2] != 0)
+      {
+        return JPEG_CROP_UNSUPPORTED;
+      }
+      jpeg_put_segment(w, m, seg, seg_len);
+      break;
+    }
+    else
+    {
+      jpeg_put_segment(w, m, seg, seg_len); // DQT, APPn, COM...
+    }
+  }
+  if (w->overflow)
+  {
+    return JPEG_CROP_OVERFLOW;
+  }
+
+  // Données entropiques : toutes les MCU jusqu'à la dernière du rectangle
+  jpeg_reader_t r = {p, end, 0, 0, false};
+  uint32_t mcu = 0;
+  for (uint32_t my = 0; my < my1; my++)
+  {
+    for (uint32_t mx = 0; mx < mcus_x; mx++, mcu++)
+    {
+      if (c->restart && mcu && mcu % c->restart == 0)
+      {
+        if (!jpeg_restart(&r))
+        {
+          return JPEG_CROP_CORRUPT;
+        }
+        for (int i = 0; i < c->ncomps; i++)
+        {
+          c->comps[i].pred = 0;
+        }
+      }
+      bool keep = my >= my0 && mx >= mx0 && mx < mx1;
+      for (int i = 0; i < c->ncomps; i++)
+      {
+        jpeg_comp_t *comp = &c->comps[i];
+        for (int b = 0; b < comp->h * comp->v; b++)
+        {
+          jpeg_crop_err_t err = jpeg_block(&r, w, c, comp, keep);
+          if (err != JPEG_CROP_OK)
+          {
+            return err;
+          }
+        }
+      }
+      if (my == my1 - 1 && mx == mx1 - 1)
+      {
+        break; // Reste de l'image inutile
+      }
+    }
+    if (w->overflow)
+    {
+      return JPEG_CROP_OVERFLOW;
+    }
+  }
+  jpeg_put_flush(w);
+  static const uint8_t eoi[2] = {0xFF, 0xD9};
+  jpeg_put_raw(w, eoi, sizeof(eoi));
+  return w->overflow ? JPEG_CROP_OVERFLOW : JPEG_CROP_OK;
+}
+
+jpeg_crop_err_t jpeg_crop(const uint8_t *in, size_t in_len, const jpeg_rect_t *rect, uint8_t *out, size_t out_size, size_t *out_len, jpeg_rect_t *actual)
+{
+  *out_len = 0;
+  if (in_len < 4 || in[0] != 0xFF || in[1] != 0xD8)
+  {
+    return JPEG_CROP_CORRUPT;
+  }
+  // Tables Huffman (~7 Ko) : hors de la pile de l'appelant
+  jpeg_ctx_t *c = (jpeg_ctx_t *)calloc(1, sizeof(jpeg_ctx_t));
+  if (!c)
+  {
+    return JPEG_CROP_NO_MEMORY;
+  }
+  jpeg_rect_t done = {};
+  jpeg_writer_t w = {out, out + out_size, 0, 0, false};
+  jpeg_crop_err_t err = jpeg_crop_run(c, in, in_len, rect, &w, &done);
+  free(c);
+  if (err == JPEG_CROP_OK)
+  {
+    *out_len = w.p - out;
+    if (actual)
+    {
+      *actual = done;
+    }
+  }
+  return err;
+}
+
+const char *jpeg_crop_strerror(jpeg_crop_err_t err)
+{
+  switch (err)
+  {
+  case JPEG_CROP_OK:
+    return "ok";
+  case JPEG_CROP_UNSUPPORTED:
+    return "JPEG non supporté (baseline seulement)";
+  case JPEG_CROP_CORRUPT:
+    return "JPEG invalide";
+  case JPEG_CROP_OUTSIDE:
+    return "Rectangle hors de l'image";
+  case JPEG_CROP_OVERFLOW:
+    return "Tampon de sortie trop petit";
+  case JPEG_CROP_NO_MEMORY:
+    return "Mémoire insuffisante";
+  }
+  return "?";
+}
+
+bool jpeg_size(const uint8_t *in, size_t in_len, uint16_t *w, uint16_t *h)
+{
+  if (in_len < 4 || in[0] != 0xFF || in[1] != 0xD8)
+  {
+    return false;
+  }
+  const uint8_t *p = in + 2;
+  const uint8_t *end = in + in_len;
+  while (end - p >= 4 && p[0] == 0xFF)
+  {
+    uint8_t m = p[1];
+    if (m == 0xFF)
+    {
+      p++; // Remplissage
+      continue;
+    }
+    if (m == 0xDA || m == 0xD9)
+    {
+      return false; // Données entropiques sans SOF
+    }
+    size_t len = (p[2] << 8) | p[3];
+    if (len < 2 || (size_t)(end - p - 2) < len)
+    {
+      return false;
+    }
+    if (m >= 0xC0 && m <= 0xCF && m != 0xC4 && m != 0xC8 && m != 0xCC)
+    {
+      if (len < 7)
+      {
+        return false;
+      }
+      *h = (p[5] << 8) | p[6];
+      *w = (p[7] << 8) | p[8];
+      return true;
+    }
+    p += 2 + len;
+  }
+  return false;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Découpe JPEG sans perte dans le domaine compressé (comme jpegtran -crop) :
+//  - le rectangle est étendu à la grille des MCU (16x8 en 4:2:2, 16x16 en 4:2:0) ;
+//  - les données entropiques sont parcourues (Huffman seulement, ni IDCT ni
+//    quantification) ; les blocs hors rectangle sont sautés, ceux du rectangle sont
+//    recopiés code pour code, seuls leurs prédicteurs DC sont recodés ;
+//  - un nouveau SOF porte la taille découpée, DRI est retiré (pas de marqueurs RST).
+// Aucun décodage ni réencodage : qualité identique à l'image source, coût ~ lecture
+// du flux jusqu'à la dernière ligne de MCU du rectangle.
+// JPEG baseline séquentiel (SOF0/SOF1, tables 0 et 1) : le format du capteur.
+// Sans dépendance ESP-IDF : compilé aussi sur l'hôte (host/bench/jpeg_crop_bench.cpp).
+
+// Marge de sortie : en-têtes plus recodage des DC en début de ligne de MCU
+#define JPEG_CROP_SLACK(in_len) ((in_len) / 16 + 1024)
+
+typedef struct
+{
+  uint16_t x;
+  uint16_t y;
+  uint16_t w;
+  uint16_t h;
+} jpeg_rect_t;
+
+typedef enum
+{
+  JPEG_CROP_OK = 0,
+  JPEG_CROP_UNSUPPORTED, // Progressif, arithmétique, 12 bits, table Huffman incomplète
+  JPEG_CROP_CORRUPT,     // Marqueur ou code Huffman invalide
+  JPEG_CROP_OUTSIDE,     // Rectangle vide ou hors de l'image
+  JPEG_CROP_OVERFLOW,    // Tampon de sortie trop petit
+  JPEG_CROP_NO_MEMORY,
+} jpeg_crop_err_t;
+
+// Découpe `in` sur `rect` (pixels) vers `out` (out_size octets ; in_len +
+// JPEG_CROP_SLACK(in_len) suffit). *out_len = octets écrits, *actual = rectangle
+// réellement découpé (aligné sur les MCU), si non NULL.
+jpeg_crop_err_t jpeg_crop(const uint8_t *in, size_t in_len, const jpeg_rect_t *rect, uint8_t *out, size_t out_size, size_t *out_len, jpeg_rect_t *actual);
+
+const char *jpeg_crop_strerror(jpeg_crop_err_t err);
+
+// Taille portée par le SOF (lecture des en-têtes seulement) ; false si absent
+bool jpeg_size(const uint8_t *in, size_t in_len, uint16_t *w, uint16_t *h);
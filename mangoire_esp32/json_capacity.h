@@ -0,0 +1,73 @@
+#pragma once
+#include <stddef.h>
+#include <ArduinoJson.h>
+
+// Capacités ArduinoJson calculées d'après le contenu plutôt que devinées d'après la taille
+// en octets : une valeur courte ("1,") coûte un emplacement entier (16 octets sur ESP32).
+
+// Tableau de `n` tableaux de `width` valeurs ([[a,b,c],...])
+#define JSON_TABLE_SIZE(n, width) (JSON_ARRAY_SIZE(n) + (n) * JSON_ARRAY_SIZE(width))
+
+// Éléments du tableau de premier niveau de `json`, sans l'analyser (chaînes sautées) ;
+// 0 si ce n'est pas un tableau. Une virgule en trop compte un élément : borne haute.
+static inline size_t json_array_count(const char *json)
+{
+  while (*json == ' ' || *json == '\t' || *json == '\r' || *json == '\n')
+  {
+    json++;
+  }
+  if (*json != '[')
+  {
+    return 0;
+  }
+  size_t count = 0;
+  int depth = 0;
+  bool empty = true;
+  for (const char *p = json; *p; p++)
+  {
+    switch (*p)
+    {
+    case '"':
+      // Chaîne : jusqu'au guillemet fermant non échappé
+      for (p++; *p && *p != '"'; p++)
+      {
+        if (*p == '\\' && p[1])
+        {
+          p++;
+        }
+      }
+      empty = false;
+      if (!*p)
+      {
+        return count + 1;
+      }
+      break;
+    case '[':
+    case '{':
+      if (depth++ == 1)
+      {
+        empty = false;
+      }
+      break;
+    case ']':
+    case '}':
+      if (--depth == 0)
+      {
+        return empty ? 0 : count + 1;
+      }
+      break;
+    case ',':
+      count += depth == 1;
+      break;
+    case ' ':
+    case '\t':
+    case '\r':
+    case '\n':
+      break;
+    default:
+      empty = false;
+      break;
+    }
+  }
+  return count + 1;
+}
@@ -0,0 +1,253 @@
+#include "json_writer.h"
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+static esp_err_t json_httpd_flush(void *ctx, const char *data, size_t len)
+{
+  return httpd_resp_send_chunk((httpd_req_t *)ctx, data, len);
+}
+
+void json_writer_init(json_writer_t *w, char *buf, size_t size, json_flush_cb_t flush, void *ctx)
+{
+  memset(w, 0, sizeof(json_writer_t));
+  w->buf = buf;
+  w->size = size;
+  w->flush = flush;
+  w->ctx = ctx;
+  w->err = ESP_OK;
+}
+
+void json_writer_init_httpd(json_writer_t *w, char *buf, size_t size, httpd_req_t *req)
+{
+  json_writer_init(w, buf, size, json_httpd_flush, req);
+}
+
+static void json_flush(json_writer_t *w)
+{
+  if (w->len && w->err == ESP_OK)
+  {
+    w->err = w->flush(w->ctx, w->buf, w->len);
+  }
+  w->len = 0;
+}
+
+void json_raw(json_writer_t *w, const void *data, size_t len)
+{
+  const char *p = (const char *)data;
+  while (len && json_writer_ok(w))
+  {
+    if (w->len == w->size)
+    {
+      if (!w->flush)
+      {
+        w->overflow = true;
+        return;
+      }
+      json_flush(w);
+      continue;
+    }
+    size_t n = w->size - w->len;
+    if (n > len)
+    {
+      n = len;
+    }
+    memcpy(w->buf + w->len, p, n);
+    w->len += n;
+    p += n;
+    len -= n;
+  }
+}
+
+esp_err_t json_writer_finish(json_writer_t *w)
+{
+  if (w->flush)
+  {
+    json_flush(w);
+  }
+  if (w->overflow)
+  {
+    return ESP_ERR_NO_MEM;
+  }
+  return w->err;
+}
+
+// Séparateur avant une nouvelle valeur (sauf juste après une clé)
+static void json_separator(json_writer_t *w)
+{
+  if (w->after_key)
+  {
+    w->after_key = false;
+    return;
+  }
+  uint32_t bit = 1UL << w->depth;
+  if (w->has_items & bit)
+  {
+    json_raw(w, ",", 1);
+  }
+  w->has_items |= bit;
+}
+
+static void json_open(json_writer_t *w, char c)
+{
+  json_separator(w);
+  json_raw(w, &c, 1);
+  if (w->depth + 1 >= JSON_WRITER_MAX_DEPTH)
+  {
+    w->overflow = true;
+    return;
+  }
+  w->depth++;
+  w->has_items &= ~(1UL << w->depth);
+}
+
+static void json_close(json_writer_t *w, char c)
+{
+  if (w->depth)
+  {
+    w->depth--;
+  }
+  json_raw(w, &c, 1);
+}
+
+void json_begin_object(json_writer_t *w)
+{
+  json_open(w, '{');
+}
+
+void json_end_object(json_writer_t *w)
+{
+  json_close(w, '}');
+}
+
+void json_begin_array(json_writer_t *w)
+{
+  json_open(w, '[');
+}
+
+void json_end_array(json_writer_t *w)
+{
+  json_close(w, ']');
+}
+
+static void json_escaped(json_writer_t *w, const char *s)
+{
+  json_raw(w, "\"", 1);
+  const char *run = s;
+  for (; *s; s++)
+  {
+    unsigned char c = (unsigned char)*s;
+    if (c >= 0x20 && c != '"' && c != '\\')
+    {
+      continue;
+    }
+    json_raw(w, run, s - run);
+    char esc[8];
+    int n;
+    if (c == '"' || c == '\\')
+    {
+      n = snprintf(esc, sizeof(esc), "\\%c", c);
+    }
+    else if (c == '\n')
+    {
+      n = snprintf(esc, sizeof(esc), "\\n");
+    }
+    else
+    {
+      n = snprintf(esc, sizeof(esc), "\\u%04x", c);
+    }
+    json_raw(w, esc, n);
+    run = s + 1;
+  }
+  json_raw(w, run, s - run);
+  json_raw(w, "\"", 1);
+}
+
+void json_key(json_writer_t *w, const char *key)
+{
+  json_separator(w);
+  json_escaped(w, key);
+  json_raw(w, ":", 1);
+  w->after_key = true;
+}
+
+static void json_number(json_writer_t *w, const char *fmt, ...)
+  __attribute__((format(printf, 2, 3)));
+
+static void json_number(json_writer_t *w, const char *fmt, ...)
+{
+  char num[32];
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(num, sizeof(num), fmt, args);
+  va_end(args);
+  if (n < 0)
+  {
+    // Erreur de formatage : le document serait invalide
+    w->err = ESP_FAIL;
+    return;
+  }
+  // Nombre tronqué au tampon (flottant énorme) : jamais de lecture au-delà
+  if ((size_t)n >= sizeof(num))
+  {
+    n = sizeof(num) - 1;
+  }
+  json_separator(w);
+  json_raw(w, num, n);
+}
+
+void json_int(json_writer_t *w, int32_t v)
+{
+  json_number(w, "%ld", (long)v);
+}
+
+void json_uint(json_writer_t *w, uint32_t v)
+{
+  json_number(w, "%lu", (unsigned long)v);
+}
+
+void json_uint64(json_writer_t *w, uint64_t v)
+{
+  json_number(w, "%llu", (unsigned long long)v);
+}
+
+void json_float(json_writer_t *w, float v, int decimals)
+{
+  if (!isfinite(v))
+  {
+    json_null(w); // NaN et ±inf n'existent pas en JSON
+    return;
+  }
+  json_number(w, "%.*f", decimals, (double)v);
+}
+
+void json_bool(json_writer_t *w, bool v)
+{
+  json_separator(w);
+  if (v)
+  {
+    json_raw(w, "true", 4);
+  }
+  else
+  {
+    json_raw(w, "false", 5);
+  }
+}
+
+void json_null(json_writer_t *w)
+{
+  json_separator(w);
+  json_raw(w, "null", 4);
+}
+
+void json_str(json_writer_t *w, const char *v)
+{
+  if (!v)
+  {
+    json_null(w);
+    return;
+  }
+  json_separator(w);
+  json_escaped(w, v);
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+// Écrivain JSON en flux, sans allocation et borné.
+// Le document est construit dans un tampon fourni par l'appelant :
+//  - avec un callback de vidage, le tampon est envoyé par morceaux dès qu'il est plein
+//    (ex. httpd_resp_send_chunk) ;
+//  - sans callback, le document doit tenir dans le tampon, sinon `overflow` est levé
+//    et l'écriture s'arrête (jamais de dépassement).
+
+#define JSON_WRITER_MAX_DEPTH 32
+
+typedef esp_err_t (*json_flush_cb_t)(void *ctx, const char *data, size_t len);
+
+typedef struct
+{
+  char *buf;
+  size_t size;
+  size_t len;
+  json_flush_cb_t flush;
+  void *ctx;
+  uint32_t has_items; // bit par niveau d'imbrication : une virgule est nécessaire
+  uint8_t depth;
+  bool after_key;
+  bool overflow;
+  esp_err_t err;
+} json_writer_t;
+
+void json_writer_init(json_writer_t *w, char *buf, size_t size, json_flush_cb_t flush = NULL, void *ctx = NULL);
+// Vidage vers httpd_resp_send_chunk (réponse chunked)
+void json_writer_init_httpd(json_writer_t *w, char *buf, size_t size, httpd_req_t *req);
+// Vide le reste du tampon (mode flux). Retourne ESP_OK si tout a été écrit sans erreur.
+esp_err_t json_writer_finish(json_writer_t *w);
+
+static inline bool json_writer_ok(const json_writer_t *w)
+{
+  return !w->overflow && w->err == ESP_OK;
+}
+
+void json_begin_object(json_writer_t *w);
+void json_end_object(json_writer_t *w);
+void json_begin_array(json_writer_t *w);
+void json_end_array(json_writer_t *w);
+void json_key(json_writer_t *w, const char *key);
+
+void json_int(json_writer_t *w, int32_t v);
+void json_uint(json_writer_t *w, uint32_t v);
+void json_uint64(json_writer_t *w, uint64_t v);
+void json_float(json_writer_t *w, float v, int decimals = 2);
+void json_bool(json_writer_t *w, bool v);
+void json_null(json_writer_t *w);
+void json_str(json_writer_t *w, const char *v);
+// Données brutes (déjà formatées ou binaires), sans séparateur
+void json_raw(json_writer_t *w, const void *data, size_t len);
+
+static inline void json_kv_int(json_writer_t *w, const char *key, int32_t v)
+{
+  json_key(w, key);
+  json_int(w, v);
+}
+
+static inline void json_kv_uint(json_writer_t *w, const char *key, uint32_t v)
+{
+  json_key(w, key);
+  json_uint(w, v);
+}
+
+static inline void json_kv_bool(json_writer_t *w, const char *key, bool v)
+{
+  json_key(w, key);
+  json_bool(w, v);
+}
+
+static inline void json_kv_str(json_writer_t *w, const char *key, const char *v)
+{
+  json_key(w, key);
+  json_str(w, v);
+}
+
+static inline void json_kv_float(json_writer_t *w, const char *key, float v, int decimals = 2)
+{
+  json_key(w, key);
+  json_float(w, v, decimals);
+}
@@ -0,0 +1,212 @@
+#include "log_ring.h"
+#include <Arduino.h>
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "task_topology.h"
+
+#define LOG_SEQ_WRITING 0xFFFFFFFFUL // Slot en cours d'écriture
+#define LOG_DRAIN_IDLE_MS 20         // Attente de la tâche de vidage quand l'anneau est vide
+
+typedef struct
+{
+  std::atomic<uint32_t> seq;
+  uint32_t time_ms;
+  uint8_t module;
+  uint8_t level;
+  char text[LOG_LINE_SIZE];
+} log_slot_t;
+
+volatile uint8_t log_levels[LOG_MOD_COUNT] = {
+    LOG_DEFAULT_LEVEL, LOG_DEFAULT_LEVEL, LOG_DEFAULT_LEVEL, LOG_DEFAULT_LEVEL,
+    LOG_DEFAULT_LEVEL, LOG_DEFAULT_LEVEL, LOG_DEFAULT_LEVEL, LOGR_WARN};
+
+static log_slot_t log_slots[LOG_RING_SIZE];
+static std::atomic<uint32_t> log_next(1);    // Prochain numéro à réserver (0 = slot jamais écrit)
+static std::atomic<uint32_t> log_drained(1); // Prochain numéro à écrire sur l'UART
+static std::atomic<uint32_t> log_dropped(0);
+
+static const char *log_module_names[LOG_MOD_COUNT] = {"core", "http", "cmd", "stream", "camera", "config", "net", "idf"};
+static const char *log_level_names[LOGR_LEVEL_COUNT] = {"none", "error", "warn", "info", "debug", "verbose"};
+
+void log_vwrite(log_module_t mod, log_level_t level, const char *fmt, va_list args)
+{
+  // Réservation : un slot n'est réutilisé qu'une fois écrit sur l'UART ; sinon on perd
+  // le message plutôt que d'attendre la tâche de vidage.
+  uint32_t seq = log_next.load(std::memory_order_relaxed);
+  do
+  {
+    if (seq - log_drained.load(std::memory_order_acquire) >= LOG_RING_SIZE)
+    {
+      log_dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+  } while (!log_next.compare_exchange_weak(seq, seq + 1, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+  log_slot_t *slot = &log_slots[seq % LOG_RING_SIZE];
+  slot->seq.store(LOG_SEQ_WRITING, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot->time_ms = (uint32_t)(esp_timer_get_time() / 1000);
+  slot->module = mod;
+  slot->level = level;
+  int n = vsnprintf(slot->text, sizeof(slot->text), fmt, args);
+  n = n < 0 ? 0 : n >= (int)sizeof(slot->text) ? sizeof(slot->text) - 1 : n;
+  while (n > 0 && (slot->text[n - 1] == '\n' || slot->text[n - 1] == '\r'))
+  {
+    slot->text[--n] = 0;
+  }
+  slot->seq.store(seq, std::memory_order_release);
+}
+
+void log_write(log_module_t mod, log_level_t level, const char *fmt, ...)
+{
+  va_list args;
+  va_start(args, fmt);
+  log_vwrite(mod, level, fmt, args);
+  va_end(args);
+}
+
+// Redirection esp_log : "I (1234) wifi: ..." (éventuellement précédé d'un code couleur)
+static int log_idf_vprintf(const char *fmt, va_list args)
+{
+  char text[LOG_LINE_SIZE];
+  int n = vsnprintf(text, sizeof(text), fmt, args);
+  const char *p = text;
+  if (*p == '\033')
+  {
+    const char *m = strchr(p, 'm');
+    p = m ? m + 1 : p;
+  }
+  log_level_t level;
+  switch (*p)
+  {
+  case 'E':
+    level = LOGR_ERROR;
+    break;
+  case 'W':
+    level = LOGR_WARN;
+    break;
+  case 'D':
+    level = LOGR_DEBUG;
+    break;
+  case 'V':
+    level = LOGR_VERBOSE;
+    break;
+  default:
+    level = LOGR_INFO;
+  }
+  LOGR(LOG_MOD_IDF, level, "%s", p);
+  return n;
+}
+
+static void log_drain_task(void *arg)
+{
+  char line[LOG_LINE_SIZE + 32];
+  uint32_t reported = 0;
+  for (;;)
+  {
+    uint32_t seq = log_drained.load(std::memory_order_relaxed);
+    log_slot_t *slot = &log_slots[seq % LOG_RING_SIZE];
+    if (slot->seq.load(std::memory_order_acquire) != seq)
+    {
+      // Vide (ou slot réservé pas encore écrit) : signale les pertes puis attend
+      uint32_t dropped = log_dropped.load(std::memory_order_relaxed);
+      if (dropped != reported)
+      {
+        int n = snprintf(line, sizeof(line), "[log] %lu message(s) perdu(s)\n", (unsigned long)(dropped - reported));
+        Serial.write((const uint8_t *)line, n);
+        reported = dropped;
+      }
+      vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_IDLE_MS));
+      continue;
+    }
+    int n = snprintf(line, sizeof(line), "[%lu.%03lu][%c][%s] %s\n",
+                     (unsigned long)(slot->time_ms / 1000), (unsigned long)(slot->time_ms % 1000),
+                     "-EWIDV"[slot->level], log_module_names[slot->module], slot->text);
+    Serial.write((const uint8_t *)line, n < (int)sizeof(line) ? n : sizeof(line) - 1);
+    log_drained.store(seq + 1, std::memory_order_release);
+  }
+}
+
+void log_ring_init()
+{
+  if (task_create(TASK_LOG, log_drain_task, NULL) != pdPASS)
+  {
+    Serial.println("[log] Tâche de vidage non créée");
+    return;
+  }
+  esp_log_set_vprintf(log_idf_vprintf);
+}
+
+bool log_set_level(const char *module, const char *level)
+{
+  for (int m = 0; m < LOG_MOD_COUNT; m++)
+  {
+    if (strcmp(module, log_module_names[m]) == 0)
+    {
+      for (int l = 0; l < LOGR_LEVEL_COUNT; l++)
+      {
+        if (strcmp(level, log_level_names[l]) == 0)
+        {
+          log_levels[m] = l;
+          return true;
+        }
+      }
+      return false;
+    }
+  }
+  return false;
+}
+
+void log_ring_write(json_writer_t *w, uint32_t since)
+{
+  uint32_t head = log_next.load(std::memory_order_acquire);
+  uint32_t first = head > LOG_RING_SIZE + 1 ? head - LOG_RING_SIZE : 1;
+  if ((int32_t)(since - first) > 0)
+  {
+    first = since;
+  }
+  json_begin_object(w);
+  json_kv_uint(w, "next", head);
+  json_kv_uint(w, "dropped", log_dropped.load(std::memory_order_relaxed));
+  json_key(w, "levels");
+  json_begin_object(w);
+  for (int m = 0; m < LOG_MOD_COUNT; m++)
+  {
+    json_kv_str(w, log_module_names[m], log_level_names[log_levels[m]]);
+  }
+  json_end_object(w);
+  json_key(w, "lines");
+  json_begin_array(w);
+  char text[LOG_LINE_SIZE];
+  for (uint32_t seq = first; (int32_t)(head - seq) > 0 && json_writer_ok(w); seq++)
+  {
+    // Copie puis revérification : un slot réécrit pendant la copie est sauté
+    log_slot_t *slot = &log_slots[seq % LOG_RING_SIZE];
+    if (slot->seq.load(std::memory_order_acquire) != seq)
+    {
+      continue;
+    }
+    uint32_t time_ms = slot->time_ms;
+    uint8_t module = slot->module;
+    uint8_t level = slot->level;
+    memcpy(text, slot->text, sizeof(text));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot->seq.load(std::memory_order_relaxed) != seq)
+    {
+      continue;
+    }
+    text[sizeof(text) - 1] = 0;
+    json_begin_object(w);
+    json_kv_uint(w, "seq", seq);
+    json_kv_uint(w, "t_ms", time_ms);
+    json_kv_str(w, "mod", log_module_names[module]);
+    json_kv_str(w, "lvl", log_level_names[level]);
+    json_kv_str(w, "msg", text);
+    json_end_object(w);
+  }
+  json_end_array(w);
+  json_end_object(w);
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "json_writer.h"
+
+// Journal asynchrone : les messages sont formatés dans un anneau sans verrou puis
+// écrits sur l'UART par une tâche de faible priorité (topologie "log").
+// À 115200 bauds une ligne coûte ~1 ms par 10 caractères : le chemin critique (flux,
+// /control, réglages) ne doit jamais attendre le port série.
+//  - filtrage par module, modifiable à l'exécution (POST /api/logs) ;
+//  - anneau plein : le message est perdu et compté, jamais d'attente ;
+//  - les dernières lignes restent lisibles sur GET /api/logs.
+// Les journaux ESP-IDF (WiFi, httpd...) passent aussi par l'anneau (module "idf").
+
+#define LOG_RING_SIZE 64  // Lignes conservées (puissance de 2)
+#define LOG_LINE_SIZE 100 // Texte max par ligne (tronqué au-delà)
+
+#ifndef LOG_DEFAULT_LEVEL
+#define LOG_DEFAULT_LEVEL LOGR_INFO
+#endif
+
+typedef enum
+{
+  LOGR_NONE = 0,
+  LOGR_ERROR,
+  LOGR_WARN,
+  LOGR_INFO,
+  LOGR_DEBUG,
+  LOGR_VERBOSE,
+  LOGR_LEVEL_COUNT
+} log_level_t;
+
+typedef enum
+{
+  LOG_MOD_CORE = 0, // Démarrage, diagnostics
+  LOG_MOD_HTTP,     // Serveur, admission, SSE
+  LOG_MOD_CMD,      // /control et réglages caméra
+  LOG_MOD_STREAM,   // /stream, enregistrement
+  LOG_MOD_CAMERA,   // Captures, bancs de test
+  LOG_MOD_CONFIG,   // LittleFS
+  LOG_MOD_NET,      // Sockets, WiFi
+  LOG_MOD_IDF,      // Journaux ESP-IDF redirigés
+  LOG_MOD_COUNT
+} log_module_t;
+
+extern volatile uint8_t log_levels[LOG_MOD_COUNT];
+
+static inline bool log_enabled(log_module_t mod, log_level_t level)
+{
+  return level <= log_levels[mod];
+}
+
+// Formate et publie une ligne ; ne bloque jamais
+void log_write(log_module_t mod, log_level_t level, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+void log_vwrite(log_module_t mod, log_level_t level, const char *fmt, va_list args);
+
+// Le niveau est testé avant le formatage : un message filtré ne coûte qu'une comparaison
+#define LOGR(mod, level, fmt, ...)                  \
+  do                                                \
+  {                                                 \
+    if (log_enabled(mod, level))                    \
+    {                                               \
+      log_write(mod, level, fmt, ##__VA_ARGS__);    \
+    }                                               \
+  } while (0)
+#define LOGR_E(mod, fmt, ...) LOGR(mod, LOGR_ERROR, fmt, ##__VA_ARGS__)
+#define LOGR_W(mod, fmt, ...) LOGR(mod, LOGR_WARN, fmt, ##__VA_ARGS__)
+#define LOGR_I(mod, fmt, ...) LOGR(mod, LOGR_INFO, fmt, ##__VA_ARGS__)
+#define LOGR_D(mod, fmt, ...) LOGR(mod, LOGR_DEBUG, fmt, ##__VA_ARGS__)
+#define LOGR_V(mod, fmt, ...) LOGR(mod, LOGR_VERBOSE, fmt, ##__VA_ARGS__)
+
+// Démarre la tâche de vidage et redirige esp_log. Les messages publiés avant restent
+// dans l'anneau (ou sont comptés perdus au-delà de LOG_RING_SIZE).
+void log_ring_init();
+
+// Niveau d'un module par nom ("stream", "debug") ; false si inconnu
+bool log_set_level(const char *module, const char *level);
+
+// {"next":..,"dropped":..,"levels":{..},"lines":[..]} : lignes de numéro >= since
+// encore présentes dans l'anneau (since = 0 : tout l'anneau)
+void log_ring_write(json_writer_t *w, uint32_t since);
@@ -25,7 +25,14 @@
 // ===========================
 // WiFi credentials (chargés dynamiquement)
 // ===========================
-#include "config_utils.h"
+#include "log_ring.h"
+#include "task_topology.h"
+#include "settings_store.h"
+#include "boot_phase.h"
+#include "sensor_lock.h"
+#include "wifi_connect.h"
+#include "visit_capture.h"
+#include "still_capture.h"
 #include <LittleFS.h>
 #include <ArduinoJson.h>
 
@@ -34,12 +41,100 @@ char password[64] = "";
 
 void startCameraServer();
 void setupLedFlash();
+void camera_settings_restore();
+
+// ===========================
+// Démarrage parallèle : tâches ponctuelles pendant l'association WiFi
+// ===========================
+#define BOOT_TASK_STACK 4096
+#define BOOT_TASK_PRIORITY 2 // Au-dessus de setup() (loopTask, priorité 1)
+
+static camera_config_t boot_camera_config;
+static bool boot_visit = false; // Réveil par le VL53L1X : rafale avant le WiFi
+
+static void boot_fs_task(void *arg)
+{
+  int phase = boot_phase_begin("fs");
+  if (!LittleFS.begin(true))
+  {
+    LOGR_E(LOG_MOD_CONFIG, "Erreur LittleFS: impossible de monter le système de fichiers");
+  }
+  else
+  {
+    LOGR_I(LOG_MOD_CONFIG, "LittleFS monté avec succès");
+  }
+  boot_phase_end(phase);
+  boot_signal(BOOT_READY_FS);
+  vTaskDelete(NULL);
+}
+
+static void boot_camera_task(void *arg)
+{
+  int phase = boot_phase_begin("camera");
+  esp_err_t err = esp_camera_init(&boot_camera_config);
+  if (err != ESP_OK)
+  {
+    LOGR_E(LOG_MOD_CAMERA, "Camera init failed with error 0x%x", err);
+    boot_phase_end(phase);
+    boot_signal(BOOT_DONE_CAMERA);
+    vTaskDelete(NULL);
+    return;
+  }
+  LOGR_I(LOG_MOD_CAMERA, "Camera init OK");
+
+  sensor_t *s = esp_camera_sensor_get();
+  sensor_lock();
+  // initial sensors are flipped vertically and colors are a bit saturated
+  if (s->id.PID == OV3660_PID)
+  {
+    s->set_vflip(s, 1);       // flip it back
+    s->set_brightness(s, 1);  // up the brightness just a bit
+    s->set_saturation(s, -2); // lower the saturation
+  }
+  // drop down frame size for higher initial frame rate
+  // Les tampons gardent la taille d'init (UXGA) : les photos haute résolution
+  // (still_capture) y rebasculent sans réallocation
+  if (boot_camera_config.pixel_format == PIXFORMAT_JPEG)
+  {
+    still_init(boot_camera_config.frame_size);
+    s->set_framesize(s, FRAMESIZE_VGA);
+  }
+
+#if defined(CAMERA_MODEL_M5STACK_WIDE) || defined(CAMERA_MODEL_M5STACK_ESP32CAM)
+  s->set_vflip(s, 1);
+  s->set_hmirror(s, 1);
+#endif
+
+#if defined(CAMERA_MODEL_ESP32S3_EYE)
+  s->set_vflip(s, 1);
+#endif
+  sensor_unlock();
+
+// Setup LED FLash if LED pin is defined in camera_pins.h
+#if defined(LED_GPIO_NUM)
+  setupLedFlash();
+#endif
+
+  // Réglages enregistrés (cache RAM, chargé une fois par settings_init)
+  camera_settings_restore();
+  boot_phase_end(phase);
+  if (boot_visit)
+  {
+    // Avant de libérer la caméra pour le serveur : l'oiseau est peut-être déjà reparti
+    visit_capture_burst();
+  }
+  boot_signal(BOOT_READY_CAMERA | BOOT_DONE_CAMERA);
+  vTaskDelete(NULL);
+}
 
 void setup()
 {
   Serial.begin(115200);
   Serial.setDebugOutput(true);
   Serial.println();
+  boot_phase_init();
+  sensor_lock_init();
+  boot_mark("setup");
 
   // ===========================
   // Setup de la caméra et du serveur
@@ -106,100 +201,67 @@ void setup()
 
   Serial.println(psramFound() ? "PSRAM OK" : "PSRAM ABSENTE");
 
-  // Initialisation LittleFS
-  if (!LittleFS.begin(true))
-  {
-    Serial.println("Erreur LittleFS: impossible de monter le système de fichiers");
-    return;
-  }
-  else
-  {
-    Serial.println("LittleFS monté avec succès");
-  }
+  // Dépendances : settings -> (caméra || WiFi -> httpd) ; LittleFS n'est attendu que
+  // pour l'import unique des anciens fichiers JSON
+  xTaskCreatePinnedToCore(boot_fs_task, "boot_fs", BOOT_TASK_STACK, NULL, BOOT_TASK_PRIORITY, NULL, tskNO_AFFINITY);
 
-  // Lecture de la config WiFi depuis /config.json
-  StaticJsonDocument<512> doc;
-  if (loadConfig(doc))
-  {
-    const char *s = doc["ssid"] | "";
-    const char *p = doc["password"] | "";
-    strncpy(ssid, s, sizeof(ssid) - 1);
-    strncpy(password, p, sizeof(password) - 1);
-    ssid[sizeof(ssid) - 1] = 0;
-    password[sizeof(password) - 1] = 0;
-    Serial.printf("Config WiFi chargée: ssid='%s'\n", ssid);
-  }
-  else
+  // Réglages NVS (cache RAM) puis journal asynchrone : à partir d'ici les modules
+  // n'écrivent plus sur l'UART eux-mêmes (la topologie des tâches est lue avant la
+  // création de la tâche "log")
+  int phase = boot_phase_begin("settings");
+  settings_init();
+  if (settings_import_pending())
   {
-    Serial.println("Aucune config WiFi trouvée, ssid/password vides");
+    boot_wait(BOOT_READY_FS, portMAX_DELAY);
+    settings_import_legacy();
   }
+  task_topology_load();
+  log_ring_init();
+  boot_phase_end(phase);
 
-  // camera init
-  esp_err_t err = esp_camera_init(&config);
-  if (err != ESP_OK)
+  // Config WiFi
+  settings_get_str(SET_WIFI_SSID, ssid, sizeof(ssid));
+  settings_get_str(SET_WIFI_PASSWORD, password, sizeof(password));
+  if (ssid[0])
   {
-    Serial.printf("Camera init failed with error 0x%x", err);
-    return;
+    LOGR_I(LOG_MOD_NET, "Config WiFi chargée: ssid='%s'", ssid);
   }
   else
   {
-    Serial.println("Camera init OK");
+    LOGR_W(LOG_MOD_NET, "Aucune config WiFi trouvée, ssid/password vides");
   }
 
-  sensor_t *s = esp_camera_sensor_get();
-  // initial sensors are flipped vertically and colors are a bit saturated
-  if (s->id.PID == OV3660_PID)
-  {
-    s->set_vflip(s, 1);       // flip it back
-    s->set_brightness(s, 1);  // up the brightness just a bit
-    s->set_saturation(s, -2); // lower the saturation
-  }
-  // drop down frame size for higher initial frame rate
-  if (config.pixel_format == PIXFORMAT_JPEG)
-  {
-    s->set_framesize(s, FRAMESIZE_VGA);
-  }
-
-#if defined(CAMERA_MODEL_M5STACK_WIDE) || defined(CAMERA_MODEL_M5STACK_ESP32CAM)
-  s->set_vflip(s, 1);
-  s->set_hmirror(s, 1);
-#endif
-
-#if defined(CAMERA_MODEL_ESP32S3_EYE)
-  s->set_vflip(s, 1);
-#endif
-
-// Setup LED FLash if LED pin is defined in camera_pins.h
-#if defined(LED_GPIO_NUM)
-  setupLedFlash();
+  // Caméra en parallèle de l'association WiFi
+#if ENABLE_VL53L1X
+  boot_visit = visit_wakeup();
 #endif
-
-  Serial.printf("Tentative connexion WiFi: ssid='%s'\n", ssid);
-  WiFi.begin(ssid, password);
-  WiFi.mode(WIFI_STA);
-  WiFi.begin(ssid, password);
-  WiFi.setSleep(false);
-
-  Serial.print("WiFi connecting");
-  int wifi_attempts = 0;
-  while (WiFi.status() != WL_CONNECTED && wifi_attempts < 40) // 20s max
+  boot_camera_config = config;
+  if (xTaskCreatePinnedToCore(boot_camera_task, "boot_camera", BOOT_TASK_STACK, NULL, BOOT_TASK_PRIORITY, NULL, tskNO_AFFINITY) != pdPASS)
   {
-    delay(500);
-    Serial.print(".");
-    wifi_attempts++;
+    LOGR_E(LOG_MOD_CAMERA, "Tâche d'initialisation caméra non créée");
+    boot_signal(BOOT_DONE_CAMERA);
   }
-  if (WiFi.status() == WL_CONNECTED)
+
+  phase = boot_phase_begin("wifi");
+  bool wifi_ok = wifi_connect(ssid, password);
+  boot_phase_end(phase);
+  if (wifi_ok)
   {
-    Serial.println("");
-    Serial.println("WiFi connected");
+    phase = boot_phase_begin("httpd");
     startCameraServer();
+    boot_phase_end(phase);
+    if (boot_visit)
+    {
+      // La rafale est prise pendant l'association ; l'envoi attend sa fin
+      boot_wait(BOOT_DONE_CAMERA, portMAX_DELAY);
+      visit_upload_start();
+    }
     Serial.print("Camera Ready! Use 'http://");
     Serial.print(WiFi.localIP());
     Serial.println("' to connect");
   }
   else
   {
-    Serial.println("");
     Serial.println("WiFi non connecté (timeout), passage en mode Access Point");
     WiFi.disconnect(true);
     delay(1000);
@@ -228,9 +290,11 @@ void setup()
 // VL53L1X (optionnel)
 // ===========================
 #if ENABLE_VL53L1X
-  setupVL53L1XAndSleep();
+  // La rafale du réveil doit être prise (et son envoi lancé) avant toute mise en sommeil
+  boot_wait(BOOT_DONE_CAMERA, portMAX_DELAY);
+  setupVL53L1X();
 #endif
-  // Deep sleep déjà géré dans setupVL53L1XAndSleep()
+  // Deep sleep géré par la tâche de mesure VL53L1X (absence détectée)
 }
 
 void loop()
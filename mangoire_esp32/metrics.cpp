@@ -0,0 +1,323 @@
+#include "metrics.h"
+#include <Arduino.h>
+#include <WiFi.h>
+#include <atomic>
+#include <stdarg.h>
+#include <string.h>
+#include <esp_heap_caps.h>
+
+// Bornes des seaux d'histogramme, en microsecondes (+Inf implicite)
+static const uint32_t hist_bounds_us[] = {500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000};
+#define HIST_BUCKETS (sizeof(hist_bounds_us) / sizeof(hist_bounds_us[0]) + 1)
+
+typedef struct
+{
+  std::atomic<uint32_t> buckets[HIST_BUCKETS]; // Non cumulatifs, cumulés à l'export
+  std::atomic<uint32_t> count;
+  std::atomic<uint32_t> sum_lo; // Somme en µs sur 64 bits, sans verrou :
+  std::atomic<uint32_t> sum_hi; // retenue propagée au mot haut
+} metrics_hist_t;
+
+typedef struct
+{
+  std::atomic<bool> active;
+  int sockfd;
+  char peer[48];
+  std::atomic<uint32_t> captured;
+  std::atomic<uint32_t> sent;
+  std::atomic<uint32_t> dropped;
+  std::atomic<uint32_t> bytes;
+} metrics_client_t;
+
+// Codes HTTP suivis (0 = autre)
+static const int http_codes[] = {0, 200, 204, 304, 400, 404, 405, 408, 500, 503};
+#define HTTP_CODES (sizeof(http_codes) / sizeof(http_codes[0]))
+
+static metrics_hist_t hists[METRIC_STAGE_COUNT][METRIC_HANDLER_COUNT];
+static metrics_client_t clients[METRICS_MAX_CLIENTS];
+static std::atomic<uint32_t> frames_captured(0);
+static std::atomic<uint32_t> frames_sent(0);
+static std::atomic<uint32_t> frames_dropped(0);
+static std::atomic<uint32_t> capture_failures(0);
+static std::atomic<uint32_t> bytes_lo(0);
+static std::atomic<uint32_t> bytes_hi(0);
+
+static const char *http_uris[METRICS_MAX_URIS];
+static std::atomic<int> http_uri_count(0);
+static std::atomic<uint32_t> http_requests[METRICS_MAX_URIS][HTTP_CODES];
+
+static const char *stage_names[METRIC_STAGE_COUNT] = {"fb_get", "jpeg", "send"};
+static const char *handler_names[METRIC_HANDLER_COUNT] = {"stream", "capture", "bmp"};
+
+static void add64(std::atomic<uint32_t> &lo, std::atomic<uint32_t> &hi, uint32_t v)
+{
+  uint32_t old = lo.fetch_add(v, std::memory_order_relaxed);
+  if (old + v < old)
+  {
+    hi.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+static uint64_t read64(std::atomic<uint32_t> &lo, std::atomic<uint32_t> &hi)
+{
+  uint32_t h, l;
+  do
+  {
+    h = hi.load(std::memory_order_relaxed);
+    l = lo.load(std::memory_order_relaxed);
+  } while (h != hi.load(std::memory_order_relaxed));
+  return ((uint64_t)h << 32) | l;
+}
+
+void metrics_observe(metric_stage_t stage, metric_handler_t handler, uint32_t us)
+{
+  metrics_hist_t *h = &hists[stage][handler];
+  size_t b = 0;
+  while (b < HIST_BUCKETS - 1 && us > hist_bounds_us[b])
+  {
+    b++;
+  }
+  h->buckets[b].fetch_add(1, std::memory_order_relaxed);
+  h->count.fetch_add(1, std::memory_order_relaxed);
+  add64(h->sum_lo, h->sum_hi, us);
+}
+
+int metrics_client_begin(int sockfd, const char *peer)
+{
+  for (int i = 0; i < METRICS_MAX_CLIENTS; i++)
+  {
+    bool expected = false;
+    if (clients[i].active.compare_exchange_strong(expected, true))
+    {
+      metrics_client_t *c = &clients[i];
+      c->sockfd = sockfd;
+      strncpy(c->peer, peer ? peer : "", sizeof(c->peer) - 1);
+      c->peer[sizeof(c->peer) - 1] = 0;
+      c->captured = 0;
+      c->sent = 0;
+      c->dropped = 0;
+      c->bytes = 0;
+      return i;
+    }
+  }
+  return -1;
+}
+
+void metrics_client_end(int slot)
+{
+  if (slot >= 0 && slot < METRICS_MAX_CLIENTS)
+  {
+    clients[slot].active.store(false, std::memory_order_release);
+  }
+}
+
+void metrics_frame_captured(int slot)
+{
+  frames_captured.fetch_add(1, std::memory_order_relaxed);
+  if (slot >= 0)
+  {
+    clients[slot].captured.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void metrics_frame_sent(int slot, size_t bytes)
+{
+  frames_sent.fetch_add(1, std::memory_order_relaxed);
+  metrics_bytes_sent(bytes);
+  if (slot >= 0)
+  {
+    clients[slot].sent.fetch_add(1, std::memory_order_relaxed);
+    clients[slot].bytes.fetch_add(bytes, std::memory_order_relaxed);
+  }
+}
+
+void metrics_frame_dropped(int slot)
+{
+  frames_dropped.fetch_add(1, std::memory_order_relaxed);
+  if (slot >= 0)
+  {
+    clients[slot].dropped.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void metrics_capture_failed()
+{
+  capture_failures.fetch_add(1, std::memory_order_relaxed);
+}
+
+void metrics_bytes_sent(size_t bytes)
+{
+  add64(bytes_lo, bytes_hi, bytes);
+}
+
+int metrics_http_uri(const char *uri)
+{
+  // Appelé à l'enregistrement des handlers (une seule tâche) : même URI = même série
+  int count = http_uri_count.load();
+  for (int i = 0; i < count; i++)
+  {
+    if (!strcmp(http_uris[i], uri))
+    {
+      return i;
+    }
+  }
+  if (count >= METRICS_MAX_URIS)
+  {
+    return -1;
+  }
+  http_uris[count] = uri;
+  http_uri_count.store(count + 1, std::memory_order_release);
+  return count;
+}
+
+void metrics_http_request(int uri_id, int status)
+{
+  if (uri_id < 0 || uri_id >= METRICS_MAX_URIS)
+  {
+    return;
+  }
+  size_t c = 0;
+  for (size_t i = 1; i < HTTP_CODES; i++)
+  {
+    if (http_codes[i] == status)
+    {
+      c = i;
+      break;
+    }
+  }
+  http_requests[uri_id][c].fetch_add(1, std::memory_order_relaxed);
+}
+
+static void metrics_printf(json_writer_t *w, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void metrics_printf(json_writer_t *w, const char *fmt, ...)
+{
+  char line[160];
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(line, sizeof(line), fmt, args);
+  va_end(args);
+  if (n >= (int)sizeof(line))
+  {
+    n = sizeof(line) - 1;
+  }
+  json_raw(w, line, n);
+}
+
+static void metrics_header(json_writer_t *w, const char *name, const char *type, const char *help)
+{
+  metrics_printf(w, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static void metrics_write_hists(json_writer_t *w)
+{
+  metrics_header(w, "birdcam_stage_seconds", "histogram", "Durée des étapes capture/JPEG/envoi par handler");
+  for (int s = 0; s < METRIC_STAGE_COUNT; s++)
+  {
+    for (int h = 0; h < METRIC_HANDLER_COUNT; h++)
+    {
+      metrics_hist_t *hist = &hists[s][h];
+      uint32_t count = hist->count.load(std::memory_order_relaxed);
+      if (!count)
+      {
+        continue;
+      }
+      uint32_t cumulative = 0;
+      for (size_t b = 0; b < HIST_BUCKETS; b++)
+      {
+        cumulative += hist->buckets[b].load(std::memory_order_relaxed);
+        if (b < HIST_BUCKETS - 1)
+        {
+          metrics_printf(w, "birdcam_stage_seconds_bucket{stage=\"%s\",handler=\"%s\",le=\"%g\"} %lu\n", stage_names[s], handler_names[h], hist_bounds_us[b] / 1e6,
+                         (unsigned long)cumulative);
+        }
+        else
+        {
+          metrics_printf(w, "birdcam_stage_seconds_bucket{stage=\"%s\",handler=\"%s\",le=\"+Inf\"} %lu\n", stage_names[s], handler_names[h], (unsigned long)cumulative);
+        }
+      }
+      metrics_printf(w, "birdcam_stage_seconds_sum{stage=\"%s\",handler=\"%s\"} %.6f\n", stage_names[s], handler_names[h], read64(hist->sum_lo, hist->sum_hi) / 1e6);
+      metrics_printf(w, "birdcam_stage_seconds_count{stage=\"%s\",handler=\"%s\"} %lu\n", stage_names[s], handler_names[h], (unsigned long)cumulative);
+    }
+  }
+}
+
+static void metrics_write_clients(json_writer_t *w)
+{
+  static const struct
+  {
+    const char *name;
+    const char *help;
+    std::atomic<uint32_t> metrics_client_t::*field;
+  } fields[] = {
+      {"birdcam_client_frames_captured_total", "Images capturées par client de flux", &metrics_client_t::captured},
+      {"birdcam_client_frames_sent_total", "Images envoyées par client de flux", &metrics_client_t::sent},
+      {"birdcam_client_frames_dropped_total", "Images perdues par client de flux", &metrics_client_t::dropped},
+      {"birdcam_client_bytes_sent_total", "Octets envoyés par client de flux", &metrics_client_t::bytes},
+  };
+  for (size_t f = 0; f < sizeof(fields) / sizeof(fields[0]); f++)
+  {
+    metrics_header(w, fields[f].name, "counter", fields[f].help);
+    for (int i = 0; i < METRICS_MAX_CLIENTS; i++)
+    {
+      metrics_client_t *c = &clients[i];
+      if (!c->active.load(std::memory_order_acquire))
+      {
+        continue;
+      }
+      metrics_printf(w, "%s{client=\"%d\",peer=\"%s\"} %lu\n", fields[f].name, c->sockfd, c->peer, (unsigned long)(c->*fields[f].field).load(std::memory_order_relaxed));
+    }
+  }
+}
+
+void metrics_write(json_writer_t *w)
+{
+  metrics_write_hists(w);
+
+  metrics_header(w, "birdcam_frames_captured_total", "counter", "Images capturées");
+  metrics_printf(w, "birdcam_frames_captured_total %lu\n", (unsigned long)frames_captured.load());
+  metrics_header(w, "birdcam_frames_sent_total", "counter", "Images envoyées");
+  metrics_printf(w, "birdcam_frames_sent_total %lu\n", (unsigned long)frames_sent.load());
+  metrics_header(w, "birdcam_frames_dropped_total", "counter", "Images capturées mais non envoyées");
+  metrics_printf(w, "birdcam_frames_dropped_total %lu\n", (unsigned long)frames_dropped.load());
+  metrics_header(w, "birdcam_capture_failures_total", "counter", "Echecs de esp_camera_fb_get");
+  metrics_printf(w, "birdcam_capture_failures_total %lu\n", (unsigned long)capture_failures.load());
+  metrics_header(w, "birdcam_bytes_sent_total", "counter", "Octets d'image envoyés");
+  metrics_printf(w, "birdcam_bytes_sent_total %llu\n", (unsigned long long)read64(bytes_lo, bytes_hi));
+  metrics_write_clients(w);
+
+  metrics_header(w, "birdcam_http_requests_total", "counter", "Requêtes HTTP par URI et statut");
+  int uri_count = http_uri_count.load();
+  for (int u = 0; u < uri_count && u < METRICS_MAX_URIS; u++)
+  {
+    for (size_t c = 0; c < HTTP_CODES; c++)
+    {
+      uint32_t n = http_requests[u][c].load(std::memory_order_relaxed);
+      if (!n)
+      {
+        continue;
+      }
+      if (http_codes[c])
+      {
+        metrics_printf(w, "birdcam_http_requests_total{uri=\"%s\",status=\"%d\"} %lu\n", http_uris[u], http_codes[c], (unsigned long)n);
+      }
+      else
+      {
+        metrics_printf(w, "birdcam_http_requests_total{uri=\"%s\",status=\"other\"} %lu\n", http_uris[u], (unsigned long)n);
+      }
+    }
+  }
+
+  metrics_header(w, "birdcam_heap_free_bytes", "gauge", "Mémoire interne libre");
+  metrics_printf(w, "birdcam_heap_free_bytes %u\n", (unsigned)heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+  metrics_header(w, "birdcam_heap_largest_free_block_bytes", "gauge", "Plus grand bloc libre en mémoire interne");
+  metrics_printf(w, "birdcam_heap_largest_free_block_bytes %u\n", (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL));
+  metrics_header(w, "birdcam_psram_free_bytes", "gauge", "PSRAM libre");
+  metrics_printf(w, "birdcam_psram_free_bytes %u\n", (unsigned)heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
+  metrics_header(w, "birdcam_psram_largest_free_block_bytes", "gauge", "Plus grand bloc libre en PSRAM");
+  metrics_printf(w, "birdcam_psram_largest_free_block_bytes %u\n", (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_SPIRAM));
+  metrics_header(w, "birdcam_wifi_rssi_dbm", "gauge", "RSSI WiFi");
+  metrics_printf(w, "birdcam_wifi_rssi_dbm %d\n", (int)WiFi.RSSI());
+  metrics_header(w, "birdcam_uptime_seconds", "gauge", "Temps depuis le démarrage");
+  metrics_printf(w, "birdcam_uptime_seconds %lu\n", (unsigned long)(millis() / 1000));
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "json_writer.h"
+
+// Métriques au format texte Prometheus (/metrics).
+// Toutes les mises à jour sont des incréments atomiques relaxés : aucun verrou sur le
+// chemin critique (capture / envoi). Seule l'exportation parcourt les compteurs.
+
+typedef enum
+{
+  METRIC_STAGE_FB_GET = 0, // Attente de esp_camera_fb_get
+  METRIC_STAGE_JPEG,       // Conversion JPEG (frame2jpg / frame2bmp)
+  METRIC_STAGE_SEND,       // Envoi de l'image (httpd_resp_send[_chunk])
+  METRIC_STAGE_COUNT
+} metric_stage_t;
+
+typedef enum
+{
+  METRIC_HANDLER_STREAM = 0,
+  METRIC_HANDLER_CAPTURE,
+  METRIC_HANDLER_BMP,
+  METRIC_HANDLER_COUNT
+} metric_handler_t;
+
+#define METRICS_MAX_CLIENTS 4 // = max_open_sockets
+#define METRICS_MAX_URIS 40
+
+// Latence d'une étape, en microsecondes
+void metrics_observe(metric_stage_t stage, metric_handler_t handler, uint32_t us);
+
+// Clients de flux : slot par connexion /stream (-1 si aucun slot libre)
+int metrics_client_begin(int sockfd, const char *peer);
+void metrics_client_end(int slot);
+void metrics_frame_captured(int slot);
+void metrics_frame_sent(int slot, size_t bytes);
+void metrics_frame_dropped(int slot);
+void metrics_capture_failed();
+void metrics_bytes_sent(size_t bytes);
+
+// Requêtes HTTP par URI (chaîne statique) et code de statut
+int metrics_http_uri(const char *uri);
+void metrics_http_request(int uri_id, int status);
+
+// Exporte toutes les métriques (format texte Prometheus 0.0.4)
+void metrics_write(json_writer_t *w);
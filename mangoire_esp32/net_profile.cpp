@@ -0,0 +1,98 @@
+#include "net_profile.h"
+#include <Arduino.h>
+#include "settings_store.h"
+#include "lwip/sockets.h"
+#include "log_ring.h"
+
+// Valeurs par défaut et bornes : SETTINGS_SCHEMA (settings_store.h)
+net_profile_t net_profile;
+
+static void sock_profile_from_settings(sock_profile_t *p, setting_id_t first)
+{
+  // Les six réglages d'un profil se suivent dans le schéma
+  static_assert(SET_NET_STREAM_KA_COUNT == SET_NET_STREAM_NODELAY + 5 && SET_NET_CONTROL_KA_COUNT == SET_NET_CONTROL_NODELAY + 5, "Ordre du schéma");
+  p->nodelay = settings_get(first);
+  p->sndbuf = settings_get((setting_id_t)(first + 1));
+  p->send_timeout_ms = settings_get((setting_id_t)(first + 2));
+  p->keepalive_idle_s = settings_get((setting_id_t)(first + 3));
+  p->keepalive_intvl_s = settings_get((setting_id_t)(first + 4));
+  p->keepalive_count = settings_get((setting_id_t)(first + 5));
+}
+
+void net_profile_load()
+{
+  sock_profile_from_settings(&net_profile.stream, SET_NET_STREAM_NODELAY);
+  sock_profile_from_settings(&net_profile.control, SET_NET_CONTROL_NODELAY);
+  net_profile.lru_purge = settings_get(SET_NET_LRU_PURGE);
+  net_profile.backlog = settings_get(SET_NET_BACKLOG);
+}
+
+bool net_profile_update(JsonObjectConst obj)
+{
+  // Les trois groupes vérifiés avant d'en appliquer un : tout ou rien
+  int rejected = settings_check_json(obj["stream"], "net_stream");
+  rejected += settings_check_json(obj["control"], "net_control");
+  rejected += settings_check_json(obj, "net");
+  if (rejected)
+  {
+    return false;
+  }
+  settings_from_json(obj["stream"], "net_stream");
+  settings_from_json(obj["control"], "net_control");
+  settings_from_json(obj, "net");
+  net_profile_load();
+  return true;
+}
+
+static void sock_profile_write(json_writer_t *w, const char *key, const sock_profile_t *p)
+{
+  json_key(w, key);
+  json_begin_object(w);
+  json_kv_bool(w, "nodelay", p->nodelay);
+  json_kv_int(w, "sndbuf", p->sndbuf);
+  json_kv_int(w, "send_timeout_ms", p->send_timeout_ms);
+  json_kv_int(w, "keepalive_idle_s", p->keepalive_idle_s);
+  json_kv_int(w, "keepalive_intvl_s", p->keepalive_intvl_s);
+  json_kv_int(w, "keepalive_count", p->keepalive_count);
+  json_end_object(w);
+}
+
+void net_profile_write(json_writer_t *w)
+{
+  json_begin_object(w);
+  sock_profile_write(w, "stream", &net_profile.stream);
+  sock_profile_write(w, "control", &net_profile.control);
+  json_kv_bool(w, "lru_purge", net_profile.lru_purge);
+  json_kv_int(w, "backlog", net_profile.backlog);
+  json_end_object(w);
+}
+
+int net_profile_apply(int sockfd, const sock_profile_t *p)
+{
+  int failed = 0;
+  int nodelay = p->nodelay;
+  failed += setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay)) != 0;
+  if (p->sndbuf > 0)
+  {
+    // Refusé si lwIP est compilé sans LWIP_SO_SNDBUF (cas du SDK Arduino par défaut)
+    failed += setsockopt(sockfd, SOL_SOCKET, SO_SNDBUF, &p->sndbuf, sizeof(p->sndbuf)) != 0;
+  }
+  if (p->send_timeout_ms > 0)
+  {
+    struct timeval tv = {.tv_sec = p->send_timeout_ms / 1000, .tv_usec = (p->send_timeout_ms % 1000) * 1000};
+    failed += setsockopt(sockfd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv)) != 0;
+  }
+  int keepalive = p->keepalive_idle_s > 0;
+  failed += setsockopt(sockfd, SOL_SOCKET, SO_KEEPALIVE, &keepalive, sizeof(keepalive)) != 0;
+  if (keepalive)
+  {
+    failed += setsockopt(sockfd, IPPROTO_TCP, TCP_KEEPIDLE, &p->keepalive_idle_s, sizeof(int)) != 0;
+    failed += setsockopt(sockfd, IPPROTO_TCP, TCP_KEEPINTVL, &p->keepalive_intvl_s, sizeof(int)) != 0;
+    failed += setsockopt(sockfd, IPPROTO_TCP, TCP_KEEPCNT, &p->keepalive_count, sizeof(int)) != 0;
+  }
+  if (failed)
+  {
+    LOGR_W(LOG_MOD_NET, "Socket %d: %d option(s) refused by lwIP", sockfd, failed);
+  }
+  return failed;
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <ArduinoJson.h>
+#include "json_writer.h"
+
+// Réglages TCP/lwIP par classe de connexion, persistés dans le magasin de réglages
+// (GET/POST /api/net).
+//  - stream  : appliqué par /stream et /api/bench/net (grosses écritures soutenues) ;
+//  - control : appliqué à l'ouverture de chaque socket (petites réponses, latence).
+// lru_purge et backlog sont des paramètres du serveur : pris en compte au démarrage.
+// Les valeurs par défaut (SETTINGS_SCHEMA) ne sont pas encore mesurées : procédure et
+// conditions à relever dans settings_store.h.
+
+typedef struct
+{
+  bool nodelay;          // TCP_NODELAY : pas d'attente Nagle entre les morceaux
+  int sndbuf;            // SO_SNDBUF en octets (0 = défaut lwIP)
+  int send_timeout_ms;   // SO_SNDTIMEO : un client qui ne lit plus libère le socket
+  int keepalive_idle_s;  // TCP keepalive (0 = désactivé)
+  int keepalive_intvl_s; // Intervalle entre sondes
+  int keepalive_count;   // Sondes sans réponse avant fermeture
+} sock_profile_t;
+
+typedef struct
+{
+  sock_profile_t stream;
+  sock_profile_t control;
+  bool lru_purge; // Ferme le socket le plus ancien quand les 4 sont occupés
+  int backlog;    // Connexions en attente d'accept
+} net_profile_t;
+
+extern net_profile_t net_profile;
+
+// Recopie le profil depuis le magasin de réglages
+void net_profile_load();
+// Applique les clés présentes dans `obj` au profil courant (sauvegarde différée) ;
+// false si une valeur est hors bornes (aucune n'est alors appliquée)
+bool net_profile_update(JsonObjectConst obj);
+void net_profile_write(json_writer_t *w);
+
+// Applique un profil à un socket ; retourne le nombre d'options refusées par lwIP
+int net_profile_apply(int sockfd, const sock_profile_t *p);
@@ -0,0 +1,271 @@
+#include "presence.h"
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "event_ring.h"
+#include "log_ring.h"
+#include "task_topology.h"
+
+static_assert(PRESENCE_MEDIAN % 2 == 1, "Fenêtre de médiane impaire");
+static_assert(PRESENCE_LEAVE_MM >= PRESENCE_ENTER_MM, "Hystérésis inversée");
+
+static const char *presence_state_names[] = {"unknown", "absent", "present"};
+
+static QueueHandle_t presence_queue = NULL;
+static presence_cb_t presence_cb = NULL;
+static presence_position_cb_t presence_position_cb = NULL;
+static volatile presence_state_t presence_state = PRESENCE_UNKNOWN;
+static volatile uint16_t presence_mm = 0;
+static volatile uint32_t presence_lost = 0;
+
+// Dernier tour de balayage complet (lu par presence_write)
+static portMUX_TYPE presence_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint16_t presence_zone_mm[PRESENCE_ZONE_COUNT];
+static presence_position_t presence_pos = {};
+static presence_position_t presence_published = {};
+
+static uint16_t presence_median(const uint16_t *window)
+{
+  uint16_t v[PRESENCE_MEDIAN];
+  memcpy(v, window, sizeof(v));
+  // Tri par insertion : 5 valeurs
+  for (int i = 1; i < PRESENCE_MEDIAN; i++)
+  {
+    uint16_t x = v[i];
+    int j = i - 1;
+    while (j >= 0 && v[j] > x)
+    {
+      v[j + 1] = v[j];
+      j--;
+    }
+    v[j + 1] = x;
+  }
+  return v[PRESENCE_MEDIAN / 2];
+}
+
+static void presence_set_position(const presence_position_t *pos)
+{
+  portENTER_CRITICAL(&presence_mux);
+  presence_pos = *pos;
+  portEXIT_CRITICAL(&presence_mux);
+  bool moved = pos->valid != presence_published.valid ||
+               (pos->valid && (abs((int)pos->x - (int)presence_published.x) >= PRESENCE_POSITION_STEP ||
+                               abs((int)pos->y - (int)presence_published.y) >= PRESENCE_POSITION_STEP));
+  if (!moved)
+  {
+    return;
+  }
+  presence_published = *pos;
+  if (pos->valid)
+  {
+    event_publish(EVENT_POSITION, "{\"x\":%u,\"y\":%u,\"mm\":%u}", pos->x, pos->y, pos->mm);
+  }
+  else
+  {
+    event_publish(EVENT_POSITION, "{\"x\":null,\"y\":null,\"mm\":%u}", pos->mm);
+  }
+  if (presence_position_cb)
+  {
+    presence_position_cb(pos);
+  }
+}
+
+// Tour de balayage complet : position estimée, retourne la distance la plus courte
+static uint16_t presence_locate(const uint16_t *zones)
+{
+  uint32_t weight_sum = 0;
+  uint32_t x_sum = 0;
+  uint32_t y_sum = 0;
+  uint16_t nearest = PRESENCE_NO_TARGET_MM;
+  for (int i = 0; i < PRESENCE_ZONE_COUNT; i++)
+  {
+    uint16_t mm = zones[i];
+    if (mm < nearest)
+    {
+      nearest = mm;
+    }
+    if (mm >= PRESENCE_LEAVE_MM)
+    {
+      continue;
+    }
+    // Zone plus proche = plus de poids ; centre de la zone en ‰
+    uint32_t weight = PRESENCE_LEAVE_MM - mm;
+    x_sum += weight * ((2 * (i % PRESENCE_ZONE_COLS) + 1) * 1000 / (2 * PRESENCE_ZONE_COLS));
+    y_sum += weight * ((2 * (i / PRESENCE_ZONE_COLS) + 1) * 1000 / (2 * PRESENCE_ZONE_ROWS));
+    weight_sum += weight;
+  }
+  presence_position_t pos = {};
+  pos.valid = weight_sum > 0;
+  pos.x = pos.valid ? x_sum / weight_sum : 0;
+  pos.y = pos.valid ? y_sum / weight_sum : 0;
+  pos.mm = nearest;
+  portENTER_CRITICAL(&presence_mux);
+  memcpy(presence_zone_mm, zones, sizeof(presence_zone_mm));
+  portEXIT_CRITICAL(&presence_mux);
+  presence_set_position(&pos);
+  return nearest;
+}
+
+static void presence_task(void *arg)
+{
+  // Zone pas encore mesurée (tour interrompu, premier tour) : aucune cible
+  uint16_t zones[PRESENCE_ZONE_COUNT];
+  for (int i = 0; i < PRESENCE_ZONE_COUNT; i++)
+  {
+    zones[i] = PRESENCE_NO_TARGET_MM;
+  }
+  uint16_t window[PRESENCE_MEDIAN];
+  int filled = 0;
+  int next = 0;
+  presence_sample_t sample;
+  for (;;)
+  {
+    if (xQueueReceive(presence_queue, &sample, portMAX_DELAY) != pdTRUE)
+    {
+      continue;
+    }
+    uint16_t mm = sample.status ? PRESENCE_NO_TARGET_MM : sample.mm;
+    if (sample.zone != PRESENCE_ZONE_FULL)
+    {
+      // Le balayage commence toujours par la zone 0 : un tour se termine sur la dernière
+      if (sample.zone < 0 || sample.zone >= PRESENCE_ZONE_COUNT)
+      {
+        continue;
+      }
+      zones[sample.zone] = mm;
+      if (sample.zone != PRESENCE_ZONE_COUNT - 1)
+      {
+        continue;
+      }
+      mm = presence_locate(zones);
+    }
+    window[next] = mm;
+    next = (next + 1) % PRESENCE_MEDIAN;
+    if (filled < PRESENCE_MEDIAN && ++filled < PRESENCE_MEDIAN)
+    {
+      continue;
+    }
+    mm = presence_median(window);
+    presence_mm = mm;
+
+    presence_state_t state = presence_state;
+    if (mm < PRESENCE_ENTER_MM)
+    {
+      state = PRESENCE_PRESENT;
+    }
+    else if (mm > PRESENCE_LEAVE_MM || state == PRESENCE_UNKNOWN)
+    {
+      state = PRESENCE_ABSENT;
+    }
+    if (state == presence_state)
+    {
+      continue;
+    }
+    presence_state = state;
+    bool present = state == PRESENCE_PRESENT;
+    event_publish(EVENT_DISTANCE, "{\"mm\":%u,\"present\":%s}", mm, present ? "true" : "false");
+    LOGR_I(LOG_MOD_CORE, "Présence: %s (%u mm)", present ? "entrée" : "sortie", mm);
+    if (!present)
+    {
+      presence_position_t none = {};
+      none.mm = mm;
+      presence_set_position(&none);
+    }
+    if (presence_cb)
+    {
+      presence_cb(state, mm);
+    }
+  }
+}
+
+bool presence_init(presence_cb_t cb, presence_position_cb_t position_cb)
+{
+  if (presence_queue)
+  {
+    return true;
+  }
+  presence_cb = cb;
+  presence_position_cb = position_cb;
+  presence_queue = xQueueCreate(PRESENCE_QUEUE_LEN, sizeof(presence_sample_t));
+  if (!presence_queue || task_create(TASK_PRESENCE, presence_task, NULL) != pdPASS)
+  {
+    LOGR_E(LOG_MOD_CORE, "Présence: tâche de filtrage non créée");
+    return false;
+  }
+  return true;
+}
+
+bool presence_push(const presence_sample_t *sample)
+{
+  if (!presence_queue || xQueueSend(presence_queue, sample, 0) != pdTRUE)
+  {
+    presence_lost++;
+    return false;
+  }
+  return true;
+}
+
+presence_state_t presence_get()
+{
+  return presence_state;
+}
+
+uint16_t presence_distance()
+{
+  return presence_mm;
+}
+
+uint32_t presence_dropped()
+{
+  return presence_lost;
+}
+
+presence_position_t presence_position()
+{
+  portENTER_CRITICAL(&presence_mux);
+  presence_position_t pos = presence_pos;
+  portEXIT_CRITICAL(&presence_mux);
+  return pos;
+}
+
+void presence_write(json_writer_t *w)
+{
+  uint16_t zones[PRESENCE_ZONE_COUNT];
+  portENTER_CRITICAL(&presence_mux);
+  presence_position_t pos = presence_pos;
+  memcpy(zones, presence_zone_mm, sizeof(zones));
+  portEXIT_CRITICAL(&presence_mux);
+
+  json_begin_object(w);
+  json_kv_str(w, "state", presence_state_names[presence_state]);
+  json_kv_uint(w, "mm", presence_mm);
+  json_kv_uint(w, "dropped", presence_lost);
+  json_key(w, "position");
+  if (pos.valid)
+  {
+    json_begin_object(w);
+    json_kv_uint(w, "x", pos.x);
+    json_kv_uint(w, "y", pos.y);
+    json_kv_uint(w, "mm", pos.mm);
+    json_end_object(w);
+  }
+  else
+  {
+    json_null(w);
+  }
+  json_key(w, "grid");
+  json_begin_array(w);
+  json_uint(w, PRESENCE_ZONE_COLS);
+  json_uint(w, PRESENCE_ZONE_ROWS);
+  json_end_array(w);
+  // Distances du dernier tour, ligne par ligne (0 = pas encore balayé)
+  json_key(w, "zones");
+  json_begin_array(w);
+  for (int i = 0; i < PRESENCE_ZONE_COUNT; i++)
+  {
+    json_uint(w, zones[i]);
+  }
+  json_end_array(w);
+  json_end_object(w);
+}
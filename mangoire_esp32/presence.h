@@ -0,0 +1,72 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "json_writer.h"
+
+// Détection de présence à partir des mesures de distance (VL53L1X).
+// La tâche de mesure (topologie "ranging") ne fait que lire le capteur sur interruption
+// et pousser les échantillons dans une file ; la tâche "presence" les filtre :
+//  - médiane glissante sur PRESENCE_MEDIAN mesures (rejette les échos isolés) ;
+//  - hystérésis : entrée sous PRESENCE_ENTER_MM, sortie au-dessus de PRESENCE_LEAVE_MM ;
+//  - chaque transition publie EVENT_DISTANCE ({"mm":..,"present":true|false}) et appelle
+//    le rappel éventuel (contexte de la tâche "presence", jamais d'une interruption).
+// File pleine : l'échantillon est perdu et compté, la tâche de mesure ne bloque jamais.
+//
+// Localisation : pendant une visite, la tâche de mesure balaye une grille de zones
+// (ROI de SPAD) et étiquette chaque échantillon. À chaque tour complet, la plus courte
+// distance alimente la médiane et la position est le barycentre des zones occupées,
+// pondéré par leur proximité : coordonnées en ‰ de l'image caméra (gauche/haut = 0).
+// Publiée sur EVENT_POSITION ({"x":..,"y":..,"mm":..}) quand elle bouge d'au moins
+// PRESENCE_POSITION_STEP, et transmise au rappel de position.
+
+#define PRESENCE_QUEUE_LEN 8       // Échantillons en attente
+#define PRESENCE_MEDIAN 5          // Fenêtre de la médiane (impaire)
+#define PRESENCE_ENTER_MM 500      // Présence si la médiane passe sous ce seuil
+#define PRESENCE_LEAVE_MM 600      // Absence si elle repasse au-dessus
+#define PRESENCE_NO_TARGET_MM 4000 // Mesure invalide (statut non nul) : aucune cible
+
+#define PRESENCE_ZONE_COLS 3       // Grille de zones (colonnes x lignes, vue caméra)
+#define PRESENCE_ZONE_ROWS 2
+#define PRESENCE_ZONE_COUNT (PRESENCE_ZONE_COLS * PRESENCE_ZONE_ROWS)
+#define PRESENCE_ZONE_FULL -1      // Échantillon plein champ (hors balayage)
+#define PRESENCE_POSITION_STEP 100 // Déplacement minimal (‰) avant nouvel événement
+
+typedef struct
+{
+  uint16_t mm;
+  uint8_t status; // Statut de mesure du capteur (0 = valide)
+  int8_t zone;    // 0..PRESENCE_ZONE_COUNT-1 (ligne par ligne) ou PRESENCE_ZONE_FULL
+  uint32_t time_ms;
+} presence_sample_t;
+
+typedef enum
+{
+  PRESENCE_UNKNOWN = 0, // Fenêtre de la médiane pas encore remplie
+  PRESENCE_ABSENT,
+  PRESENCE_PRESENT,
+} presence_state_t;
+
+typedef struct
+{
+  bool valid;  // Au moins une zone occupée au dernier tour
+  uint16_t x;  // ‰ de la largeur de l'image
+  uint16_t y;  // ‰ de la hauteur
+  uint16_t mm; // Zone la plus proche
+} presence_position_t;
+
+typedef void (*presence_cb_t)(presence_state_t state, uint16_t mm);
+typedef void (*presence_position_cb_t)(const presence_position_t *pos);
+
+// Crée la file et la tâche de filtrage ; false en cas d'échec
+bool presence_init(presence_cb_t cb = NULL, presence_position_cb_t position_cb = NULL);
+// Depuis la tâche de mesure ; false si la file est pleine (échantillon perdu)
+bool presence_push(const presence_sample_t *sample);
+
+presence_state_t presence_get();
+// Dernière médiane calculée (mm)
+uint16_t presence_distance();
+uint32_t presence_dropped();
+presence_position_t presence_position();
+
+// {"state":..,"mm":..,"dropped":..,"position":{..}|null,"grid":[cols,rows],"zones":[mm,..]}
+void presence_write(json_writer_t *w);
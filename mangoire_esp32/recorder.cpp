@@ -0,0 +1,269 @@
+#include "recorder.h"
+#include <Arduino.h>
+#include <atomic>
+#include <string.h>
+#include <esp_heap_caps.h>
+#include "log_ring.h"
+
+#define REC_FILE_HEADER 8 // "BCR1" + nombre d'images
+#define REC_HEADER 8      // type + réservé + longueur
+
+static uint8_t *rec_buf = NULL;
+static size_t rec_size = 0;
+static size_t rec_len = 0;
+static uint32_t rec_frame_count = 0;
+static uint32_t rec_max_frames = 0;
+static bool rec_active = false;
+static std::atomic<int> rec_users(0); // -1 : écriture exclusive, N > 0 : N lecteurs
+
+// Prise exclusive du tampon (enregistrement ou chargement)
+static bool recorder_lock_write()
+{
+  int expected = 0;
+  return rec_users.compare_exchange_strong(expected, -1);
+}
+
+bool recorder_acquire()
+{
+  int n = rec_users.load();
+  while (n >= 0)
+  {
+    if (rec_users.compare_exchange_weak(n, n + 1))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+void recorder_release()
+{
+  int n = rec_users.load();
+  while (!rec_users.compare_exchange_weak(n, n < 0 ? 0 : n - 1))
+  {
+  }
+}
+
+static void recorder_free()
+{
+  if (rec_buf)
+  {
+    heap_caps_free(rec_buf);
+  }
+  rec_buf = NULL;
+  rec_size = 0;
+  rec_len = 0;
+  rec_frame_count = 0;
+  rec_active = false;
+}
+
+static bool recorder_alloc(size_t size)
+{
+  recorder_free();
+  // PSRAM de préférence : la mémoire interne est réservée à la caméra et au WiFi
+  rec_buf = (uint8_t *)heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  if (!rec_buf)
+  {
+    return false;
+  }
+  rec_size = size;
+  return true;
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+  p[0] = v;
+  p[1] = v >> 8;
+  p[2] = v >> 16;
+  p[3] = v >> 24;
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Réserve un record de `len` octets de données ; retourne le début des données
+static uint8_t *recorder_append(rec_type_t type, size_t len)
+{
+  if (!rec_active || rec_len + REC_HEADER + len > rec_size)
+  {
+    return NULL;
+  }
+  uint8_t *p = rec_buf + rec_len;
+  p[0] = type;
+  p[1] = p[2] = p[3] = 0;
+  put_u32(p + 4, len);
+  rec_len += REC_HEADER + len;
+  return p + REC_HEADER;
+}
+
+esp_err_t recorder_start(size_t max_bytes, uint32_t max_frames)
+{
+  if (!recorder_lock_write())
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (!recorder_alloc(max_bytes))
+  {
+    recorder_release();
+    LOGR_E(LOG_MOD_STREAM, "Recorder: %u bytes allocation failed", max_bytes);
+    return ESP_ERR_NO_MEM;
+  }
+  memcpy(rec_buf, RECORDER_MAGIC, 4);
+  put_u32(rec_buf + 4, 0);
+  rec_len = REC_FILE_HEADER;
+  rec_max_frames = max_frames;
+  rec_active = true;
+  LOGR_I(LOG_MOD_STREAM, "Recorder: started (%u KB, %lu frames max)", max_bytes / 1024, (unsigned long)max_frames);
+  return ESP_OK;
+}
+
+void recorder_stop()
+{
+  if (rec_active)
+  {
+    rec_active = false;
+    LOGR_I(LOG_MOD_STREAM, "Recorder: stopped, %lu frames, %u bytes", (unsigned long)rec_frame_count, rec_len);
+  }
+}
+
+bool recorder_recording()
+{
+  return rec_active;
+}
+
+bool recorder_add_settings(const char *json, size_t len)
+{
+  uint8_t *p = recorder_append(REC_SETTINGS, len);
+  if (!p)
+  {
+    return false;
+  }
+  memcpy(p, json, len);
+  return true;
+}
+
+rec_frame_t *recorder_add_frame(const uint8_t *jpg, size_t len, int64_t capture_us, uint32_t fb_get_us)
+{
+  if (rec_max_frames && rec_frame_count >= rec_max_frames)
+  {
+    recorder_stop();
+    return NULL;
+  }
+  uint8_t *p = recorder_append(REC_FRAME, sizeof(rec_frame_t) + len);
+  if (!p)
+  {
+    recorder_stop();
+    return NULL;
+  }
+  rec_frame_t *hdr = (rec_frame_t *)p;
+  hdr->capture_us = capture_us;
+  hdr->fb_get_us = fb_get_us;
+  hdr->send_us = 0;
+  hdr->len = len;
+  memcpy(p + sizeof(rec_frame_t), jpg, len);
+  put_u32(rec_buf + 4, ++rec_frame_count);
+  return hdr;
+}
+
+const uint8_t *recorder_data(size_t *len)
+{
+  *len = rec_len;
+  return rec_frame_count ? rec_buf : NULL;
+}
+
+uint32_t recorder_frames()
+{
+  return rec_frame_count;
+}
+
+esp_err_t recorder_load_begin(size_t len, uint8_t **buf)
+{
+  if (len < REC_FILE_HEADER)
+  {
+    return ESP_ERR_INVALID_SIZE;
+  }
+  if (!recorder_lock_write())
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (!recorder_alloc(len))
+  {
+    recorder_release();
+    return ESP_ERR_NO_MEM;
+  }
+  rec_len = len;
+  *buf = rec_buf;
+  return ESP_OK;
+}
+
+// Vérifie l'en-tête et le chaînage des records ; retourne le nombre d'images (0 si invalide)
+static uint32_t recorder_validate()
+{
+  if (!rec_buf || memcmp(rec_buf, RECORDER_MAGIC, 4))
+  {
+    return 0;
+  }
+  uint32_t frames = 0;
+  size_t pos = REC_FILE_HEADER;
+  while (pos + REC_HEADER <= rec_len)
+  {
+    uint32_t len = get_u32(rec_buf + pos + 4);
+    if (len > rec_len - pos - REC_HEADER)
+    {
+      break;
+    }
+    if (rec_buf[pos] == REC_FRAME)
+    {
+      const rec_frame_t *hdr = (const rec_frame_t *)(rec_buf + pos + REC_HEADER);
+      if (len < sizeof(rec_frame_t) || hdr->len != len - sizeof(rec_frame_t))
+      {
+        break;
+      }
+      frames++;
+    }
+    pos += REC_HEADER + len;
+  }
+  return pos == rec_len ? frames : 0;
+}
+
+esp_err_t recorder_load_end()
+{
+  uint32_t frames = recorder_validate();
+  if (!frames)
+  {
+    recorder_free();
+    recorder_release();
+    return ESP_ERR_INVALID_ARG;
+  }
+  rec_frame_count = frames;
+  recorder_release();
+  LOGR_I(LOG_MOD_STREAM, "Recorder: loaded %lu frames, %u bytes", (unsigned long)frames, rec_len);
+  return ESP_OK;
+}
+
+void recorder_rewind(rec_cursor_t *c)
+{
+  c->pos = REC_FILE_HEADER;
+  c->frame = 0;
+}
+
+bool recorder_next_frame(rec_cursor_t *c, const rec_frame_t **hdr, const uint8_t **jpg)
+{
+  // Pas de relecture pendant un enregistrement : le tampon est en cours d'écriture
+  while (rec_buf && !rec_active && c->pos + REC_HEADER <= rec_len)
+  {
+    const uint8_t *p = rec_buf + c->pos;
+    uint32_t len = get_u32(p + 4);
+    c->pos += REC_HEADER + len;
+    if (p[0] == REC_FRAME)
+    {
+      *hdr = (const rec_frame_t *)(p + REC_HEADER);
+      *jpg = p + REC_HEADER + sizeof(rec_frame_t);
+      c->frame++;
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Enregistreur de séquences d'images pour des tests de performance reproductibles.
+// Une session /stream?record=N est copiée en PSRAM dans un conteneur compact (BCR1),
+// téléchargeable (GET /api/record) puis rejouable à l'identique :
+//  - sur l'appareil : POST /api/record puis /stream?replay=orig|max ;
+//  - sur l'hôte : feeder_emulator.py --source session.bcr.
+//
+// Format BCR1 (little-endian) :
+//   en-tête : "BCR1" | u32 nombre d'images
+//   record  : u8 type | u8[3] réservé | u32 longueur des données | données
+//     REC_SETTINGS : document /status (JSON) au début et à chaque changement de réglages
+//     REC_FRAME    : rec_frame_t suivi du JPEG
+// Chaque client /stream s'exécute dans sa propre tâche : l'enregistrement et le
+// chargement détiennent le tampon en exclusivité, les relectures le partagent
+// (recorder_acquire / recorder_release).
+
+#define RECORDER_MAGIC "BCR1"
+#define RECORDER_DEFAULT_KB 1536 // Taille du tampon PSRAM par défaut
+
+typedef enum
+{
+  REC_SETTINGS = 1,
+  REC_FRAME = 2,
+} rec_type_t;
+
+typedef struct __attribute__((packed))
+{
+  int64_t capture_us; // Horodatage de capture (fb->timestamp)
+  uint32_t fb_get_us; // Attente de esp_camera_fb_get
+  uint32_t send_us;   // Envoi du JPEG (renseigné après l'envoi)
+  uint32_t len;       // Taille du JPEG qui suit
+} rec_frame_t;
+
+// Démarre un enregistrement (remplace le précédent) et détient le tampon jusqu'à
+// recorder_release(). ESP_ERR_INVALID_STATE si le tampon est utilisé,
+// ESP_ERR_NO_MEM s'il ne peut pas être alloué.
+esp_err_t recorder_start(size_t max_bytes, uint32_t max_frames);
+void recorder_stop();
+bool recorder_recording();
+
+// Ajoute un document de réglages (JSON)
+bool recorder_add_settings(const char *json, size_t len);
+// Ajoute une image ; retourne son en-tête (pour renseigner send_us) ou NULL si le
+// tampon ou le nombre d'images maximal est atteint (l'enregistrement s'arrête).
+rec_frame_t *recorder_add_frame(const uint8_t *jpg, size_t len, int64_t capture_us, uint32_t fb_get_us);
+
+// Conteneur courant (NULL si vide)
+const uint8_t *recorder_data(size_t *len);
+uint32_t recorder_frames();
+
+// Accès en lecture (téléchargement, relecture) ; false si une écriture est en cours
+bool recorder_acquire();
+// Libère l'accès obtenu par recorder_start ou recorder_acquire
+void recorder_release();
+
+// Chargement d'un conteneur reçu : tampon de `len` octets à remplir dans `*buf`, puis
+// validation ; recorder_load_end libère l'accès. ESP_ERR_INVALID_STATE si le tampon est
+// utilisé, ESP_ERR_INVALID_SIZE / ESP_ERR_NO_MEM si `len` est trop petit ou trop grand.
+esp_err_t recorder_load_begin(size_t len, uint8_t **buf);
+esp_err_t recorder_load_end();
+
+// Relecture : curseur sur le conteneur courant
+typedef struct
+{
+  size_t pos;
+  uint32_t frame;
+} rec_cursor_t;
+
+void recorder_rewind(rec_cursor_t *c);
+// Image suivante (les autres records sont sautés). Retourne false en fin de conteneur.
+bool recorder_next_frame(rec_cursor_t *c, const rec_frame_t **hdr, const uint8_t **jpg);
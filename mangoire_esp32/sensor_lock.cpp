@@ -0,0 +1,41 @@
+#include "sensor_lock.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <atomic>
+
+static StaticSemaphore_t sensor_mutex_buf;
+static SemaphoreHandle_t sensor_mutex = NULL;
+static std::atomic<uint32_t> sensor_status_version(0);
+
+void sensor_lock_init()
+{
+  if (!sensor_mutex)
+  {
+    sensor_mutex = xSemaphoreCreateRecursiveMutexStatic(&sensor_mutex_buf);
+  }
+}
+
+void sensor_lock()
+{
+  xSemaphoreTakeRecursive(sensor_mutex, portMAX_DELAY);
+}
+
+bool sensor_lock_try(uint32_t timeout_ms)
+{
+  return xSemaphoreTakeRecursive(sensor_mutex, pdMS_TO_TICKS(timeout_ms)) == pdTRUE;
+}
+
+void sensor_unlock()
+{
+  xSemaphoreGiveRecursive(sensor_mutex);
+}
+
+void status_invalidate()
+{
+  sensor_status_version.fetch_add(1, std::memory_order_release);
+}
+
+uint32_t status_version()
+{
+  return sensor_status_version.load(std::memory_order_acquire);
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <stdint.h>
+
+// Accès au capteur (sensor_t : set_*, get_reg, set_reg, set_res_raw...) sérialisés.
+// Chaque accès passe par le SCCB et, sur l'OV2640, sélectionne d'abord une banque de
+// registres (0xFF) : deux tâches entrelacées écrivent dans la mauvaise banque. Les
+// handlers httpd, le suivi de fenêtre (tâche présence), la capture fixe et la tâche
+// d'init caméra prennent ce verrou. Il est récursif : une séquence (set_framesize puis
+// camera_window_restore, bascule de capture fixe) le garde de bout en bout.
+// Ordre de prise : still_lock, puis sensor_lock.
+
+// À appeler en début de setup(), avant la tâche d'init caméra
+void sensor_lock_init();
+
+void sensor_lock();
+// false si le verrou n'est pas obtenu en timeout_ms (0 = sans attendre)
+bool sensor_lock_try(uint32_t timeout_ms);
+void sensor_unlock();
+
+// Version de l'état capteur publié par /status (cache et ETag). À incrémenter sous
+// sensor_lock après chaque modification, y compris hors des handlers de réglages
+// (bascule photo, suivi de fenêtre, banc caméra) : un lecteur qui prend le verrou lit
+// un état cohérent avec la version.
+void status_invalidate();
+uint32_t status_version();
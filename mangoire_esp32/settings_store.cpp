@@ -0,0 +1,603 @@
+#include "settings_store.h"
+#include <Arduino.h>
+#include <string.h>
+#include "nvs.h"
+#include "esp_timer.h"
+#include "config_utils.h"
+#include "log_ring.h"
+
+#define SETTINGS_SCHEMA_KEY "schema" // Présent une fois les fichiers JSON importés
+#define SETTINGS_SCHEMA_VERSION 1
+
+#define SETTINGS_DEF(id, group, name, nvs, type, def, min, max) {group, name, nvs, type, def, min, max},
+const setting_def_t settings_schema[SETTING_COUNT] = {SETTINGS_SCHEMA(SETTINGS_DEF)};
+#undef SETTINGS_DEF
+
+#define SETTINGS_KEY_CHECK(id, group, name, nvs, type, def, min, max) \
+  static_assert(sizeof(nvs) <= NVS_KEY_NAME_MAX_SIZE, "Clé NVS trop longue : " nvs);
+SETTINGS_SCHEMA(SETTINGS_KEY_CHECK)
+#undef SETTINGS_KEY_CHECK
+
+static nvs_handle_t settings_nvs = 0;
+static esp_timer_handle_t settings_timer = NULL;
+static portMUX_TYPE settings_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static int32_t settings_values[SETTING_COUNT];
+static char *settings_strs[SETTING_COUNT]; // Alloué pour les SETTING_STR seulement
+static settings_mask_t settings_present;   // Valeur enregistrée (sinon défaut)
+static settings_mask_t settings_dirty;     // À écrire en NVS
+
+// Anciens fichiers JSON : {fichier, sous-objet (NULL = racine), groupe}
+static const struct
+{
+  const char *file;
+  const char *key;
+  const char *group;
+} settings_legacy[] = {
+    {"/settings.json", NULL, "camera"},
+    {"/config.json", NULL, "wifi"},
+    {"/net.json", "stream", "net_stream"},
+    {"/net.json", "control", "net_control"},
+    {"/net.json", NULL, "net"},
+    {"/tasks.json", "httpd", "task_httpd"},
+    {"/tasks.json", "stream", "task_stream"},
+    {"/tasks.json", "sse", "task_sse"},
+    {"/tasks.json", "log", "task_log"},
+};
+
+static bool setting_is_str(setting_id_t id)
+{
+  return settings_schema[id].type == SETTING_STR || settings_schema[id].type == SETTING_SECRET;
+}
+
+static bool setting_in_range(setting_id_t id, int32_t value)
+{
+  return value >= settings_schema[id].min && value <= settings_schema[id].max;
+}
+
+static void settings_flush_cb(void *arg)
+{
+  settings_flush();
+}
+
+// Relance le délai de regroupement : l'écriture suit la dernière modification
+static void settings_schedule()
+{
+  if (!settings_timer)
+  {
+    return;
+  }
+  esp_timer_stop(settings_timer);
+  esp_timer_start_once(settings_timer, SETTINGS_FLUSH_DELAY_MS * 1000ULL);
+}
+
+void settings_import_legacy()
+{
+  const char *loaded = NULL;
+  DynamicJsonDocument doc(1024);
+  int imported = 0;
+  for (size_t i = 0; i < sizeof(settings_legacy) / sizeof(settings_legacy[0]); i++)
+  {
+    if (!loaded || strcmp(loaded, settings_legacy[i].file) != 0)
+    {
+      doc.clear();
+      loaded = settings_legacy[i].file;
+      if (!loadConfig(doc, loaded))
+      {
+        continue;
+      }
+      imported++;
+    }
+    JsonObjectConst obj = doc.as<JsonObjectConst>();
+    if (settings_legacy[i].key)
+    {
+      obj = obj[settings_legacy[i].key].as<JsonObjectConst>();
+    }
+    settings_from_json(obj, settings_legacy[i].group);
+  }
+  LOGR_I(LOG_MOD_CONFIG, "Settings: %d legacy JSON file(s) imported", imported);
+  nvs_set_i32(settings_nvs, SETTINGS_SCHEMA_KEY, SETTINGS_SCHEMA_VERSION);
+  settings_flush();
+}
+
+void settings_init()
+{
+  for (int i = 0; i < SETTING_COUNT; i++)
+  {
+    settings_values[i] = settings_schema[i].def;
+    if (setting_is_str((setting_id_t)i))
+    {
+      settings_strs[i] = (char *)calloc(1, settings_schema[i].max + 1);
+    }
+  }
+  esp_err_t err = nvs_open(SETTINGS_NAMESPACE, NVS_READWRITE, &settings_nvs);
+  if (err != ESP_OK)
+  {
+    // Réglages par défaut, non persistés
+    LOGR_E(LOG_MOD_CONFIG, "Settings: nvs_open failed (0x%x)", err);
+    settings_nvs = 0;
+    return;
+  }
+
+  for (int i = 0; i < SETTING_COUNT; i++)
+  {
+    const setting_def_t *d = &settings_schema[i];
+    if (setting_is_str((setting_id_t)i))
+    {
+      size_t len = d->max + 1;
+      if (settings_strs[i] && nvs_get_str(settings_nvs, d->nvs_key, settings_strs[i], &len) == ESP_OK)
+      {
+        settings_mask_set(&settings_present, i);
+      }
+      continue;
+    }
+    int32_t v;
+    if (nvs_get_i32(settings_nvs, d->nvs_key, &v) == ESP_OK && setting_in_range((setting_id_t)i, v))
+    {
+      settings_values[i] = v;
+      settings_mask_set(&settings_present, i);
+    }
+  }
+
+  const esp_timer_create_args_t args = {
+      .callback = settings_flush_cb,
+      .arg = NULL,
+      .dispatch_method = ESP_TIMER_TASK,
+      .name = "settings",
+      .skip_unhandled_events = true,
+  };
+  esp_timer_create(&args, &settings_timer);
+}
+
+bool settings_import_pending()
+{
+  int32_t version = 0;
+  return settings_nvs && nvs_get_i32(settings_nvs, SETTINGS_SCHEMA_KEY, &version) != ESP_OK;
+}
+
+int32_t settings_get(setting_id_t id)
+{
+  return settings_values[id];
+}
+
+void settings_get_str(setting_id_t id, char *buf, size_t len)
+{
+  if (!len)
+  {
+    return;
+  }
+  buf[0] = 0;
+  if (!settings_strs[id])
+  {
+    return;
+  }
+  portENTER_CRITICAL(&settings_mux);
+  strncpy(buf, settings_strs[id], len - 1);
+  portEXIT_CRITICAL(&settings_mux);
+  buf[len - 1] = 0;
+}
+
+bool settings_is_set(setting_id_t id)
+{
+  return settings_mask_has(&settings_present, id);
+}
+
+// Marque une valeur modifiée (sous verrou) ; `changed` reçoit son bit
+static void setting_mark(setting_id_t id, settings_mask_t *changed)
+{
+  settings_mask_set(&settings_dirty, id);
+  if (changed)
+  {
+    settings_mask_set(changed, id);
+  }
+}
+
+static bool setting_set_tracked(setting_id_t id, int32_t value, settings_mask_t *changed)
+{
+  if (setting_is_str(id) || !setting_in_range(id, value))
+  {
+    return false;
+  }
+  portENTER_CRITICAL(&settings_mux);
+  bool modified = settings_values[id] != value || !settings_mask_has(&settings_present, id);
+  settings_values[id] = value;
+  settings_mask_set(&settings_present, id);
+  if (modified)
+  {
+    setting_mark(id, changed);
+  }
+  portEXIT_CRITICAL(&settings_mux);
+  if (modified)
+  {
+    settings_schedule();
+  }
+  return true;
+}
+
+static bool setting_set_str_tracked(setting_id_t id, const char *value, settings_mask_t *changed)
+{
+  size_t len = strlen(value);
+  if (!setting_is_str(id) || !settings_strs[id] || !setting_in_range(id, len))
+  {
+    return false;
+  }
+  portENTER_CRITICAL(&settings_mux);
+  bool modified = strcmp(settings_strs[id], value) != 0 || !settings_mask_has(&settings_present, id);
+  memcpy(settings_strs[id], value, len + 1);
+  settings_mask_set(&settings_present, id);
+  if (modified)
+  {
+    setting_mark(id, changed);
+  }
+  portEXIT_CRITICAL(&settings_mux);
+  if (modified)
+  {
+    settings_schedule();
+  }
+  return true;
+}
+
+static void setting_reset_tracked(setting_id_t id, settings_mask_t *changed)
+{
+  portENTER_CRITICAL(&settings_mux);
+  bool modified = settings_mask_has(&settings_present, id);
+  settings_values[id] = settings_schema[id].def;
+  if (settings_strs[id])
+  {
+    settings_strs[id][0] = 0;
+  }
+  settings_mask_clear(&settings_present, id);
+  if (modified)
+  {
+    setting_mark(id, changed);
+  }
+  portEXIT_CRITICAL(&settings_mux);
+  if (modified)
+  {
+    settings_schedule();
+  }
+}
+
+bool settings_set(setting_id_t id, int32_t value)
+{
+  return setting_set_tracked(id, value, NULL);
+}
+
+bool settings_set_str(setting_id_t id, const char *value)
+{
+  return setting_set_str_tracked(id, value, NULL);
+}
+
+void settings_reset(setting_id_t id)
+{
+  setting_reset_tracked(id, NULL);
+}
+
+void settings_flush()
+{
+  if (!settings_nvs)
+  {
+    return;
+  }
+  int written = 0;
+  settings_mask_t failed = {};
+  settings_mask_t flushed = {};
+  char str[SETTINGS_STR_MAX + 1];
+  for (int i = 0; i < SETTING_COUNT; i++)
+  {
+    // Copie sous verrou, écriture flash hors verrou. Le bit est retiré avec la copie :
+    // une modification pendant l'écriture le remet et sera écrite au prochain passage
+    portENTER_CRITICAL(&settings_mux);
+    bool dirty = settings_mask_has(&settings_dirty, i);
+    settings_mask_clear(&settings_dirty, i);
+    bool present = settings_mask_has(&settings_present, i);
+    int32_t value = settings_values[i];
+    if (dirty && settings_strs[i])
+    {
+      strncpy(str, settings_strs[i], SETTINGS_STR_MAX);
+      str[SETTINGS_STR_MAX] = 0;
+    }
+    portEXIT_CRITICAL(&settings_mux);
+    if (!dirty)
+    {
+      continue;
+    }
+    esp_err_t err;
+    if (!present)
+    {
+      // Retour au défaut du schéma
+      err = nvs_erase_key(settings_nvs, settings_schema[i].nvs_key);
+      err = err == ESP_ERR_NVS_NOT_FOUND ? ESP_OK : err;
+    }
+    else
+    {
+      err = setting_is_str((setting_id_t)i) ? nvs_set_str(settings_nvs, settings_schema[i].nvs_key, str) : nvs_set_i32(settings_nvs, settings_schema[i].nvs_key, value);
+    }
+    if (err != ESP_OK)
+    {
+      LOGR_E(LOG_MOD_CONFIG, "Settings: %s write failed (0x%x)", settings_schema[i].nvs_key, err);
+      settings_mask_set(&failed, i);
+      continue;
+    }
+    settings_mask_set(&flushed, i);
+    written++;
+  }
+  esp_err_t err = nvs_commit(settings_nvs);
+  if (err != ESP_OK)
+  {
+    LOGR_E(LOG_MOD_CONFIG, "Settings: commit failed (0x%x)", err);
+    settings_mask_merge(&failed, &flushed);
+    written = 0;
+  }
+  if (settings_mask_any(&failed))
+  {
+    // Non persisté : reste à écrire, nouvel essai après le délai de regroupement
+    portENTER_CRITICAL(&settings_mux);
+    settings_mask_merge(&settings_dirty, &failed);
+    portEXIT_CRITICAL(&settings_mux);
+    settings_schedule();
+  }
+  if (written)
+  {
+    LOGR_I(LOG_MOD_CONFIG, "Settings: %d value(s) written to NVS", written);
+  }
+}
+
+bool settings_blob_get(const char *key, void *buf, size_t len)
+{
+  size_t stored = len;
+  return settings_nvs && nvs_get_blob(settings_nvs, key, buf, &stored) == ESP_OK && stored == len;
+}
+
+bool settings_blob_set(const char *key, const void *buf, size_t len)
+{
+  if (!settings_nvs)
+  {
+    return false;
+  }
+  esp_err_t err = nvs_set_blob(settings_nvs, key, buf, len);
+  if (err == ESP_OK)
+  {
+    err = nvs_commit(settings_nvs);
+  }
+  if (err != ESP_OK)
+  {
+    LOGR_E(LOG_MOD_CONFIG, "Settings: %s write failed (0x%x)", key, err);
+  }
+  return err == ESP_OK;
+}
+
+bool settings_blob_erase(const char *key)
+{
+  if (!settings_nvs)
+  {
+    return false;
+  }
+  esp_err_t err = nvs_erase_key(settings_nvs, key);
+  if (err == ESP_ERR_NVS_NOT_FOUND)
+  {
+    return true;
+  }
+  if (err == ESP_OK)
+  {
+    err = nvs_commit(settings_nvs);
+  }
+  if (err != ESP_OK)
+  {
+    LOGR_E(LOG_MOD_CONFIG, "Settings: %s erase failed (0x%x)", key, err);
+  }
+  return err == ESP_OK;
+}
+
+setting_id_t settings_find(const char *group, const char *name)
+{
+  for (int i = 0; i < SETTING_COUNT; i++)
+  {
+    if (strcmp(settings_schema[i].group, group) == 0 && strcmp(settings_schema[i].name, name) == 0)
+    {
+      return (setting_id_t)i;
+    }
+  }
+  return SETTING_COUNT;
+}
+
+// Secret renvoyé tel que GET l'affiche : le client n'y a pas touché
+static bool setting_secret_unchanged(JsonVariantConst v)
+{
+  return strcmp(v.as<const char *>(), SETTINGS_SECRET_MASK) == 0;
+}
+
+// Valeur JSON acceptable pour le réglage (type et bornes) ; null = retour au défaut
+static bool setting_json_valid(setting_id_t id, JsonVariantConst v)
+{
+  if (v.isNull())
+  {
+    return true;
+  }
+  switch (settings_schema[id].type)
+  {
+  case SETTING_STR:
+    return v.is<const char *>() && setting_in_range(id, strlen(v.as<const char *>()));
+  case SETTING_SECRET:
+    return v.is<const char *>() && (setting_secret_unchanged(v) || setting_in_range(id, strlen(v.as<const char *>())));
+  case SETTING_BOOL:
+    // Le formulaire /settings.html envoie 0/1
+    return v.is<bool>() || v.is<int>();
+  default:
+    return v.is<int>() && setting_in_range(id, v.as<int>());
+  }
+}
+
+int settings_check_json(JsonObjectConst obj, const char *group)
+{
+  int rejected = 0;
+  for (JsonPairConst kv : obj)
+  {
+    setting_id_t id = settings_find(group, kv.key().c_str());
+    // Clé d'un autre groupe ou sous-objet (ex. "stream" dans "net") : ignorée
+    rejected += id != SETTING_COUNT && !setting_json_valid(id, kv.value());
+  }
+  return rejected;
+}
+
+int settings_from_json(JsonObjectConst obj, const char *group, settings_mask_t *changed)
+{
+  // Tout ou rien : une valeur refusée n'en laisse aucune appliquée
+  int rejected = settings_check_json(obj, group);
+  if (rejected)
+  {
+    return rejected;
+  }
+  for (JsonPairConst kv : obj)
+  {
+    setting_id_t id = settings_find(group, kv.key().c_str());
+    if (id == SETTING_COUNT)
+    {
+      continue;
+    }
+    JsonVariantConst v = kv.value();
+    if (v.isNull())
+    {
+      setting_reset_tracked(id, changed);
+      continue;
+    }
+    switch (settings_schema[id].type)
+    {
+    case SETTING_SECRET:
+      if (!setting_secret_unchanged(v))
+      {
+        setting_set_str_tracked(id, v.as<const char *>(), changed);
+      }
+      break;
+    case SETTING_STR:
+      setting_set_str_tracked(id, v.as<const char *>(), changed);
+      break;
+    case SETTING_BOOL:
+      setting_set_tracked(id, v.is<bool>() ? v.as<bool>() : v.as<int>() != 0, changed);
+      break;
+    default:
+      setting_set_tracked(id, v.as<int>(), changed);
+    }
+  }
+  return 0;
+}
+
+int settings_patch(JsonObjectConst patch, settings_mask_t *changed)
+{
+  // Tout le document vérifié avant d'appliquer un groupe : tout ou rien
+  int rejected = 0;
+  for (JsonPairConst kv : patch)
+  {
+    JsonVariantConst v = kv.value();
+    if (!v.isNull())
+    {
+      rejected += v.is<JsonObjectConst>() ? settings_check_json(v.as<JsonObjectConst>(), kv.key().c_str()) : 1;
+    }
+  }
+  if (rejected)
+  {
+    return rejected;
+  }
+  for (JsonPairConst kv : patch)
+  {
+    const char *group = kv.key().c_str();
+    if (kv.value().isNull())
+    {
+      // {"camera":null} : tout le groupe revient au défaut
+      for (int i = 0; i < SETTING_COUNT; i++)
+      {
+        if (strcmp(settings_schema[i].group, group) == 0)
+        {
+          setting_reset_tracked((setting_id_t)i, changed);
+        }
+      }
+      continue;
+    }
+    settings_from_json(kv.value().as<JsonObjectConst>(), group, changed);
+  }
+  return 0;
+}
+
+void settings_filter(JsonDocument &filter, const char *group)
+{
+  for (int i = 0; i < SETTING_COUNT; i++)
+  {
+    if (!group)
+    {
+      // Groupe gardé entier : une valeur qui n'est pas un objet doit être vue pour être
+      // refusée (un filtre par clé la réduirait à null, soit « groupe au défaut »)
+      filter[settings_schema[i].group] = true;
+    }
+    else if (strcmp(settings_schema[i].group, group) == 0)
+    {
+      filter[settings_schema[i].name] = true;
+    }
+  }
+}
+
+static void setting_write(json_writer_t *w, setting_id_t id)
+{
+  const setting_def_t *d = &settings_schema[id];
+  char str[SETTINGS_STR_MAX + 1];
+  switch (d->type)
+  {
+  case SETTING_SECRET:
+    json_kv_str(w, d->name, settings_is_set(id) ? SETTINGS_SECRET_MASK : "");
+    break;
+  case SETTING_STR:
+    settings_get_str(id, str, sizeof(str));
+    json_kv_str(w, d->name, str);
+    break;
+  case SETTING_BOOL:
+    json_kv_bool(w, d->name, settings_values[id]);
+    break;
+  default:
+    json_kv_int(w, d->name, settings_values[id]);
+  }
+}
+
+void settings_write_group(json_writer_t *w, const char *group, bool only_set)
+{
+  json_begin_object(w);
+  for (int i = 0; i < SETTING_COUNT; i++)
+  {
+    const setting_def_t *d = &settings_schema[i];
+    if (strcmp(d->group, group) != 0 || d->type == SETTING_SECRET || (only_set && !settings_is_set((setting_id_t)i)))
+    {
+      continue;
+    }
+    setting_write(w, (setting_id_t)i);
+  }
+  json_end_object(w);
+}
+
+void settings_write_mask(json_writer_t *w, const settings_mask_t *mask, const char *group)
+{
+  // Les réglages d'un groupe sont contigus dans le schéma
+  const char *open = NULL;
+  json_begin_object(w);
+  for (int i = 0; i < SETTING_COUNT; i++)
+  {
+    const setting_def_t *d = &settings_schema[i];
+    if (!settings_mask_has(mask, i) || (group && strcmp(d->group, group) != 0))
+    {
+      continue;
+    }
+    if (!group && (!open || strcmp(open, d->group) != 0))
+    {
+      if (open)
+      {
+        json_end_object(w);
+      }
+      json_key(w, d->group);
+      json_begin_object(w);
+      open = d->group;
+    }
+    setting_write(w, (setting_id_t)i);
+  }
+  if (open)
+  {
+    json_end_object(w);
+  }
+  json_end_object(w);
+}
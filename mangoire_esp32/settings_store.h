@@ -0,0 +1,294 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <ArduinoJson.h>
+#include "esp_camera.h"
+#include "json_writer.h"
+#include "task_topology.h"
+
+// Réglages persistants typés, stockés en NVS (espace "birdwatch").
+//  - schéma fixé à la compilation (SETTINGS_SCHEMA) : clé, type, défaut et bornes ;
+//  - cache RAM chargé une fois au démarrage : une lecture ne touche ni la flash ni JSON ;
+//  - écritures regroupées : une modification marque la valeur, l'écriture NVS a lieu
+//    SETTINGS_FLUSH_DELAY_MS après la dernière modification (curseurs, rafales de POST),
+//    et seulement pour les valeurs réellement changées.
+// Au premier démarrage, les anciens fichiers JSON de LittleFS (/settings.json,
+// /config.json, /net.json, /tasks.json) sont importés une fois ; ils ne sont plus lus ensuite.
+
+#define SETTINGS_NAMESPACE "birdwatch"
+#define SETTINGS_FLUSH_DELAY_MS 2000
+#define SETTINGS_STR_MAX 64 // Longueur max d'une chaîne (hors zéro final)
+#define SETTINGS_SECRET_MASK "********"
+
+typedef enum
+{
+  SETTING_INT,
+  SETTING_BOOL,
+  SETTING_STR,    // Bornes : longueur min/max
+  SETTING_SECRET, // Chaîne jamais renvoyée par les API
+} setting_type_t;
+
+// X(id, groupe, nom JSON, clé NVS (15 caractères max), type, défaut, min, max)
+// Profils socket (net_profile) :
+//  - flux : trois morceaux par image (séparateur, en-tête, JPEG) ; sans TCP_NODELAY,
+//    Nagle retient le petit en-tête jusqu'à l'ACK retardé du client (jusqu'à 200 ms).
+//    Un client mort est détecté en ~2 s (envoi bloqué) ou ~11 s (keepalive) au lieu
+//    de garder un des 4 sockets ;
+//  - contrôle : délai d'envoi identique au défaut httpd (5 s), pas de keepalive.
+//  Mesure des défauts en attente (pas encore de mangeoire sur un lien réel) : ils
+//  viennent du raisonnement ci-dessus. Procédure, pour chaque profil flux candidat
+//  posé par POST /api/net (nodelay 0/1, sndbuf 0/5744/11488) :
+//   1. curl -o /dev/null "http://<ip>/api/bench/net?bytes=8000000&chunk=4096", puis
+//      GET /api/bench/net : kbit_s, call_us.p99, rssi.mean, phy, channel ;
+//   2. python bench_client.py --target stream --duration 30 : images/s, p99 ;
+//   3. client /stream suspendu (kill -STOP) : délai avant "streams":0 sur
+//      /api/admission, à comparer à send_timeout_ms.
+//  Retenir le profil dont /stream (octets/s) approche le mieux kbit_s de l'étape 1,
+//  et noter ici ses valeurs avec les conditions (RSSI, canal, mode PHY, distance).
+// WiFi (wifi_connect) : ip/gateway/netmask/dns vides = DHCP ; reuse_lease reprend la
+// dernière adresse DHCP en statique (pas d'échange DHCP, à réserver sur le routeur).
+// Présence (VL53L1X) : scan balaye les zones du capteur pendant une visite, follow
+// recadre la caméra sur la position estimée (follow_size : largeur en ‰ du champ).
+// ROI (camera_window) : zone de la mangeoire en ‰ du champ complet du capteur (mêmes
+// coordonnées quel que soit le capteur) ; binning lit le capteur à mi-résolution.
+// Photo (still_capture) : framesize (framesize_t) des photos haute résolution, UXGA par
+// défaut, bornée par la taille d'initialisation des tampons ; trigger en prend une à
+// chaque arrivée d'oiseau.
+#define SETTINGS_SCHEMA(X)                                                                                             \
+  X(CAM_QUALITY, "camera", "quality", "cam_quality", SETTING_INT, 10, 0, 63)                                           \
+  X(CAM_CONTRAST, "camera", "contrast", "cam_contrast", SETTING_INT, 0, -2, 2)                                         \
+  X(CAM_BRIGHTNESS, "camera", "brightness", "cam_bright", SETTING_INT, 0, -2, 2)                                       \
+  X(CAM_SATURATION, "camera", "saturation", "cam_satur", SETTING_INT, 0, -2, 2)                                        \
+  X(CAM_AWB, "camera", "awb", "cam_awb", SETTING_BOOL, 1, 0, 1)                                                        \
+  X(CAM_AGC, "camera", "agc", "cam_agc", SETTING_BOOL, 1, 0, 1)                                                        \
+  X(CAM_AEC, "camera", "aec", "cam_aec", SETTING_BOOL, 1, 0, 1)                                                        \
+  X(WIFI_SSID, "wifi", "ssid", "wifi_ssid", SETTING_STR, 0, 0, 32)                                                     \
+  X(WIFI_PASSWORD, "wifi", "password", "wifi_pass", SETTING_SECRET, 0, 0, 63)                                          \
+  X(WIFI_FAST_CONNECT, "wifi", "fast_connect", "wifi_fast", SETTING_BOOL, 1, 0, 1)                                     \
+  X(WIFI_REUSE_LEASE, "wifi", "reuse_lease", "wifi_lease", SETTING_BOOL, 0, 0, 1)                                      \
+  X(WIFI_IP, "wifi", "ip", "wifi_ip", SETTING_STR, 0, 0, 15)                                                           \
+  X(WIFI_GATEWAY, "wifi", "gateway", "wifi_gw", SETTING_STR, 0, 0, 15)                                                 \
+  X(WIFI_NETMASK, "wifi", "netmask", "wifi_mask", SETTING_STR, 0, 0, 15)                                               \
+  X(WIFI_DNS, "wifi", "dns", "wifi_dns", SETTING_STR, 0, 0, 15)                                                        \
+  X(NET_STREAM_NODELAY, "net_stream", "nodelay", "ns_nodelay", SETTING_BOOL, 1, 0, 1)                                  \
+  X(NET_STREAM_SNDBUF, "net_stream", "sndbuf", "ns_sndbuf", SETTING_INT, 0, 0, 65535)                                  \
+  X(NET_STREAM_SEND_TIMEOUT, "net_stream", "send_timeout_ms", "ns_sndto", SETTING_INT, 2000, 0, 60000)                 \
+  X(NET_STREAM_KA_IDLE, "net_stream", "keepalive_idle_s", "ns_ka_idle", SETTING_INT, 5, 0, 7200)                       \
+  X(NET_STREAM_KA_INTVL, "net_stream", "keepalive_intvl_s", "ns_ka_intvl", SETTING_INT, 2, 0, 600)                     \
+  X(NET_STREAM_KA_COUNT, "net_stream", "keepalive_count", "ns_ka_cnt", SETTING_INT, 3, 0, 20)                          \
+  X(NET_CONTROL_NODELAY, "net_control", "nodelay", "nc_nodelay", SETTING_BOOL, 1, 0, 1)                                \
+  X(NET_CONTROL_SNDBUF, "net_control", "sndbuf", "nc_sndbuf", SETTING_INT, 0, 0, 65535)                                \
+  X(NET_CONTROL_SEND_TIMEOUT, "net_control", "send_timeout_ms", "nc_sndto", SETTING_INT, 5000, 0, 60000)               \
+  X(NET_CONTROL_KA_IDLE, "net_control", "keepalive_idle_s", "nc_ka_idle", SETTING_INT, 0, 0, 7200)                     \
+  X(NET_CONTROL_KA_INTVL, "net_control", "keepalive_intvl_s", "nc_ka_intvl", SETTING_INT, 0, 0, 600)                   \
+  X(NET_CONTROL_KA_COUNT, "net_control", "keepalive_count", "nc_ka_cnt", SETTING_INT, 0, 0, 20)                        \
+  X(NET_LRU_PURGE, "net", "lru_purge", "net_lru", SETTING_BOOL, 1, 0, 1)                                               \
+  X(NET_BACKLOG, "net", "backlog", "net_backlog", SETTING_INT, 5, 1, 16)                                               \
+  X(TASK_HTTPD_CORE_ID, "task_httpd", "core", "t_httpd_core", SETTING_INT, TASK_HTTPD_CORE, -1, 1)                     \
+  X(TASK_HTTPD_PRIO, "task_httpd", "priority", "t_httpd_prio", SETTING_INT, TASK_HTTPD_PRIORITY, 1, 24)                \
+  X(TASK_HTTPD_STACK_SIZE, "task_httpd", "stack", "t_httpd_stack", SETTING_INT, TASK_HTTPD_STACK, 2048, 32768)         \
+  X(TASK_STREAM_CORE_ID, "task_stream", "core", "t_stream_core", SETTING_INT, TASK_STREAM_CORE, -1, 1)                 \
+  X(TASK_STREAM_PRIO, "task_stream", "priority", "t_stream_prio", SETTING_INT, TASK_STREAM_PRIORITY, 1, 24)            \
+  X(TASK_STREAM_STACK_SIZE, "task_stream", "stack", "t_stream_stack", SETTING_INT, TASK_STREAM_STACK, 2048, 32768)     \
+  X(TASK_SSE_CORE_ID, "task_sse", "core", "t_sse_core", SETTING_INT, TASK_SSE_CORE, -1, 1)                             \
+  X(TASK_SSE_PRIO, "task_sse", "priority", "t_sse_prio", SETTING_INT, TASK_SSE_PRIORITY, 1, 24)                        \
+  X(TASK_SSE_STACK_SIZE, "task_sse", "stack", "t_sse_stack", SETTING_INT, TASK_SSE_STACK, 2048, 32768)                 \
+  X(TASK_LOG_CORE_ID, "task_log", "core", "t_log_core", SETTING_INT, TASK_LOG_CORE, -1, 1)                             \
+  X(TASK_LOG_PRIO, "task_log", "priority", "t_log_prio", SETTING_INT, TASK_LOG_PRIORITY, 1, 24)                        \
+  X(TASK_LOG_STACK_SIZE, "task_log", "stack", "t_log_stack", SETTING_INT, TASK_LOG_STACK, 2048, 32768)                 \
+  X(TASK_RANGING_CORE_ID, "task_ranging", "core", "t_rng_core", SETTING_INT, TASK_RANGING_CORE, -1, 1)                 \
+  X(TASK_RANGING_PRIO, "task_ranging", "priority", "t_rng_prio", SETTING_INT, TASK_RANGING_PRIORITY, 1, 24)            \
+  X(TASK_RANGING_STACK_SIZE, "task_ranging", "stack", "t_rng_stack", SETTING_INT, TASK_RANGING_STACK, 2048, 32768)     \
+  X(TASK_PRESENCE_CORE_ID, "task_presence", "core", "t_pres_core", SETTING_INT, TASK_PRESENCE_CORE, -1, 1)             \
+  X(TASK_PRESENCE_PRIO, "task_presence", "priority", "t_pres_prio", SETTING_INT, TASK_PRESENCE_PRIORITY, 1, 24)        \
+  X(TASK_PRESENCE_STACK_SIZE, "task_presence", "stack", "t_pres_stack", SETTING_INT, TASK_PRESENCE_STACK, 2048, 32768) \
+  X(TASK_STILL_CORE_ID, "task_still", "core", "t_still_core", SETTING_INT, TASK_STILL_CORE, -1, 1)                     \
+  X(TASK_STILL_PRIO, "task_still", "priority", "t_still_prio", SETTING_INT, TASK_STILL_PRIORITY, 1, 24)                \
+  X(TASK_STILL_STACK_SIZE, "task_still", "stack", "t_still_stack", SETTING_INT, TASK_STILL_STACK, 2048, 32768)         \
+  X(TASK_VISIT_CORE_ID, "task_visit", "core", "t_visit_core", SETTING_INT, TASK_VISIT_CORE, -1, 1)                     \
+  X(TASK_VISIT_PRIO, "task_visit", "priority", "t_visit_prio", SETTING_INT, TASK_VISIT_PRIORITY, 1, 24)                \
+  X(TASK_VISIT_STACK_SIZE, "task_visit", "stack", "t_visit_stack", SETTING_INT, TASK_VISIT_STACK, 2048, 32768)         \
+  X(VISIT_BURST, "visit", "burst", "visit_burst", SETTING_INT, 5, 1, 30)                                               \
+  X(VISIT_INTERVAL_MS, "visit", "interval_ms", "visit_intvl", SETTING_INT, 0, 0, 1000)                                 \
+  X(VISIT_BUFFER_KB, "visit", "buffer_kb", "visit_buf_kb", SETTING_INT, 1536, 64, 4096)                                \
+  X(VISIT_UPLOAD_URL, "visit", "upload_url", "visit_url", SETTING_STR, 0, 0, 64)                                       \
+  X(VISIT_UPLOAD_TIMEOUT, "visit", "upload_timeout_ms", "visit_up_to", SETTING_INT, 10000, 1000, 60000)                \
+  X(PRESENCE_SCAN, "presence", "scan", "pres_scan", SETTING_BOOL, 1, 0, 1)                                             \
+  X(PRESENCE_FOLLOW, "presence", "follow", "pres_follow", SETTING_BOOL, 0, 0, 1)                                       \
+  X(PRESENCE_FOLLOW_SIZE, "presence", "follow_size", "pres_follow_sz", SETTING_INT, 500, 250, 1000)                    \
+  X(ROI_ENABLED, "roi", "enabled", "roi_on", SETTING_BOOL, 0, 0, 1)                                                    \
+  X(ROI_X, "roi", "x", "roi_x", SETTING_INT, 250, 0, 950)                                                              \
+  X(ROI_Y, "roi", "y", "roi_y", SETTING_INT, 500, 0, 950)                                                              \
+  X(ROI_W, "roi", "w", "roi_w", SETTING_INT, 500, 50, 1000)                                                            \
+  X(ROI_H, "roi", "h", "roi_h", SETTING_INT, 500, 50, 1000)                                                            \
+  X(ROI_BINNING, "roi", "binning", "roi_bin", SETTING_BOOL, 1, 0, 1)                                                   \
+  X(STILL_FRAMESIZE, "still", "framesize", "still_fs", SETTING_INT, FRAMESIZE_UXGA, 0, FRAMESIZE_INVALID - 1)          \
+  X(STILL_TRIGGER, "still", "trigger", "still_trigger", SETTING_BOOL, 0, 0, 1)
+
+#define SETTINGS_ENUM(id, group, name, nvs, type, def, min, max) SET_##id,
+typedef enum
+{
+  SETTINGS_SCHEMA(SETTINGS_ENUM)
+      SETTING_COUNT
+} setting_id_t;
+#undef SETTINGS_ENUM
+
+typedef struct
+{
+  const char *group;
+  const char *name;
+  const char *nvs_key;
+  setting_type_t type;
+  int32_t def;
+  int32_t min;
+  int32_t max;
+} setting_def_t;
+
+extern const setting_def_t settings_schema[SETTING_COUNT];
+
+// Ensemble de réglages, un bit par setting_id_t ; sa taille suit le schéma
+#define SETTINGS_MASK_WORDS ((SETTING_COUNT + 31) / 32)
+
+typedef struct
+{
+  uint32_t bits[SETTINGS_MASK_WORDS];
+} settings_mask_t;
+
+static inline void settings_mask_set(settings_mask_t *m, int id)
+{
+  m->bits[id / 32] |= (uint32_t)1 << (id % 32);
+}
+
+static inline void settings_mask_clear(settings_mask_t *m, int id)
+{
+  m->bits[id / 32] &= ~((uint32_t)1 << (id % 32));
+}
+
+static inline bool settings_mask_has(const settings_mask_t *m, int id)
+{
+  return m->bits[id / 32] & ((uint32_t)1 << (id % 32));
+}
+
+static inline void settings_mask_merge(settings_mask_t *m, const settings_mask_t *other)
+{
+  for (int i = 0; i < SETTINGS_MASK_WORDS; i++)
+  {
+    m->bits[i] |= other->bits[i];
+  }
+}
+
+static inline bool settings_mask_any(const settings_mask_t *m)
+{
+  for (int i = 0; i < SETTINGS_MASK_WORDS; i++)
+  {
+    if (m->bits[i])
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Tous les réglages du schéma
+static inline settings_mask_t settings_mask_all()
+{
+  settings_mask_t m = {};
+  for (int i = 0; i < SETTING_COUNT; i++)
+  {
+    settings_mask_set(&m, i);
+  }
+  return m;
+}
+
+// Capacités ArduinoJson du document complet de /api/config (GET renvoyé tel quel en
+// PATCH), déduites du schéma : un membre par groupe et par réglage, noms copiés, chaînes
+// à leur longueur maximale. Une clé ajoutée agrandit les documents d'elle-même.
+#define SETTINGS_NAME_CHARS(id, group, name, nvs, type, def, min, max) +sizeof(name)
+#define SETTINGS_STR_CHARS(id, group, name, nvs, type, def, min, max) +((type) == SETTING_STR || (type) == SETTING_SECRET ? (max) + 1 : 0)
+#define SETTINGS_GROUP_NAME(id, group, name, nvs, type, def, min, max) group,
+static constexpr const char *settings_group_names[SETTING_COUNT] = {SETTINGS_SCHEMA(SETTINGS_GROUP_NAME)};
+#undef SETTINGS_GROUP_NAME
+
+constexpr bool settings_same_str(const char *a, const char *b)
+{
+  return *a == *b && (*a == '\0' || settings_same_str(a + 1, b + 1));
+}
+
+constexpr size_t settings_str_size(const char *s)
+{
+  return *s ? 1 + settings_str_size(s + 1) : 1;
+}
+
+// Groupes du schéma (chars : octets de leurs noms). Un groupe en plusieurs morceaux est
+// compté plusieurs fois : borne haute
+constexpr size_t settings_group_total(bool chars)
+{
+  size_t n = 0;
+  for (int i = 0; i < SETTING_COUNT; i++)
+  {
+    if (i == 0 || !settings_same_str(settings_group_names[i], settings_group_names[i - 1]))
+    {
+      n += chars ? settings_str_size(settings_group_names[i]) : 1;
+    }
+  }
+  return n;
+}
+
+// Filtre : groupes et noms ; document : en plus les valeurs texte et la chaîne en cours
+// de lecture (copiée avant d'être gardée ou écartée par le filtre)
+#define SETTINGS_JSON_FILTER_SIZE \
+  (JSON_OBJECT_SIZE(settings_group_total(false) + SETTING_COUNT) + settings_group_total(true) + (0 SETTINGS_SCHEMA(SETTINGS_NAME_CHARS)))
+#define SETTINGS_JSON_DOC_SIZE (SETTINGS_JSON_FILTER_SIZE + (0 SETTINGS_SCHEMA(SETTINGS_STR_CHARS)) + SETTINGS_STR_MAX + 1)
+
+// Ouvre la NVS et remplit le cache
+void settings_init();
+// Vrai tant que les anciens fichiers JSON n'ont pas été importés (premier démarrage)
+bool settings_import_pending();
+// Importe les anciens fichiers JSON (LittleFS doit être monté) puis écrit la NVS
+void settings_import_legacy();
+
+int32_t settings_get(setting_id_t id);
+// Copie une chaîne (la valeur peut changer pendant la lecture)
+void settings_get_str(setting_id_t id, char *buf, size_t len);
+// Vrai si la valeur a été enregistrée (sinon c'est le défaut du schéma)
+bool settings_is_set(setting_id_t id);
+
+// Modifie le cache et programme l'écriture ; false si la valeur est hors bornes
+bool settings_set(setting_id_t id, int32_t value);
+bool settings_set_str(setting_id_t id, const char *value);
+// Revient au défaut du schéma (la clé NVS est effacée)
+void settings_reset(setting_id_t id);
+// Écrit immédiatement les valeurs en attente (avant un redémarrage) ; une valeur dont
+// l'écriture échoue reste en attente
+void settings_flush();
+
+// Données hors schéma (caches internes) : lecture/écriture immédiate d'un blob NVS.
+// false si absent, de taille différente ou si la NVS est indisponible.
+bool settings_blob_get(const char *key, void *buf, size_t len);
+bool settings_blob_set(const char *key, const void *buf, size_t len);
+// Efface le blob ; true s'il n'existe plus
+bool settings_blob_erase(const char *key);
+
+// Réglage `name` du groupe `group` ; SETTING_COUNT si inconnu
+setting_id_t settings_find(const char *group, const char *name);
+
+// Les mises à jour JSON suivent JSON Merge Patch (RFC 7396) : clé absente = inchangée,
+// null = retour au défaut. Un secret égal à SETTINGS_SECRET_MASK (valeur renvoyée par
+// GET) est inchangé. `changed` (optionnel) reçoit les réglages modifiés.
+// Nombre de valeurs de `obj` connues dans `group` qui seraient refusées (type, bornes)
+int settings_check_json(JsonObjectConst obj, const char *group);
+// Applique les clés de `obj` connues dans `group`, toutes ou aucune : retourne le nombre
+// de valeurs refusées, rien n'est modifié s'il n'est pas nul
+int settings_from_json(JsonObjectConst obj, const char *group, settings_mask_t *changed = NULL);
+// Document complet {"groupe":{"nom":valeur,...},...}, tout ou rien ; un groupe qui n'est
+// ni un objet ni null est refusé
+int settings_patch(JsonObjectConst patch, settings_mask_t *changed = NULL);
+// Filtre ArduinoJson ne gardant que les clés du schéma d'un groupe, ou si NULL les
+// groupes du schéma (valeurs entières)
+void settings_filter(JsonDocument &filter, const char *group);
+
+// Objet {"nom":valeur,...} d'un groupe, sans les secrets (only_set : seulement les valeurs enregistrées)
+void settings_write_group(json_writer_t *w, const char *group, bool only_set);
+// Réglages de `mask` : {"groupe":{"nom":valeur}} ou, si `group` est donné, {"nom":valeur}.
+// Un secret est masqué (SETTINGS_SECRET_MASK, "" s'il est effacé).
+void settings_write_mask(json_writer_t *w, const settings_mask_t *mask, const char *group);
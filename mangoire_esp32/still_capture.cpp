@@ -0,0 +1,370 @@
+#include "still_capture.h"
+#include <string.h>
+#include <atomic>
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+#include "boot_phase.h"
+#include "camera_window.h"
+#include "event_ring.h"
+#include "jpeg_crop.h"
+#include "sensor_lock.h"
+#include "log_ring.h"
+#include "settings_store.h"
+#include "task_topology.h"
+
+#define STILL_IDLE_BIT (1 << 0) // Aucune bascule en cours
+
+typedef struct
+{
+  uint32_t last;
+  uint32_t max;
+  uint64_t sum;
+} still_stat_t;
+
+static framesize_t still_max_size = FRAMESIZE_INVALID;
+static uint8_t *still_slot = NULL; // Dernière photo (PSRAM), taille d'un tampon JPEG du pilote
+static size_t still_slot_size = 0;
+static bool still_valid = false;
+static still_info_t still_last;
+static SemaphoreHandle_t still_lock = NULL; // Bascule et emplacement
+static EventGroupHandle_t still_events = NULL;
+static TaskHandle_t still_task = NULL; // Photos sur arrivée d'un oiseau (still_trigger)
+static std::atomic<uint32_t> still_stream_returned{0};
+
+static uint32_t still_count = 0;
+static uint32_t still_switches = 0; // Photos avec bascule (flux à une autre taille)
+static uint32_t still_triggered = 0;
+static uint32_t still_failed = 0;
+static uint32_t still_lost_total = 0;
+static still_stat_t still_switch_stat;
+static still_stat_t still_back_stat;
+static still_stat_t still_gap_stat;
+
+static esp_err_t still_capture_run(uint8_t frames, bool triggered, still_info_t *info);
+
+// Les arrivées rapprochées se regroupent : une notification en attente = une photo
+static void still_trigger_task(void *arg)
+{
+  for (;;)
+  {
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    if (settings_get(SET_STILL_TRIGGER) && boot_is_set(BOOT_READY_CAMERA))
+    {
+      still_capture_run(1, true, NULL);
+    }
+  }
+}
+
+void still_init(framesize_t max_size)
+{
+  still_max_size = max_size;
+  still_lock = xSemaphoreCreateMutex();
+  still_events = xEventGroupCreate();
+  if (!still_lock || !still_events)
+  {
+    LOGR_E(LOG_MOD_CAMERA, "Photo: verrou non créé");
+    return;
+  }
+  xEventGroupSetBits(still_events, STILL_IDLE_BIT);
+  // Même taille que les tampons JPEG du pilote (largeur x hauteur / 5)
+  still_slot_size = (size_t)resolution[max_size].width * resolution[max_size].height / 5;
+  still_slot = (uint8_t *)heap_caps_malloc(still_slot_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+  if (!still_slot)
+  {
+    LOGR_W(LOG_MOD_CAMERA, "Photo: emplacement de %u Ko indisponible (PSRAM)", (unsigned)(still_slot_size / 1024));
+    return;
+  }
+  if (task_create(TASK_STILL, still_trigger_task, NULL, &still_task) != pdPASS)
+  {
+    still_task = NULL;
+    LOGR_W(LOG_MOD_CAMERA, "Photo: tâche non créée, still.trigger inactif");
+  }
+  LOGR_I(LOG_MOD_CAMERA, "Photo: tampons %ux%u, emplacement %u Ko", resolution[max_size].width, resolution[max_size].height,
+         (unsigned)(still_slot_size / 1024));
+}
+
+// still.framesize, sans dépasser les tampons (comparaison en pixels : l'ordre de
+// framesize_t ne suit pas la surface)
+static framesize_t still_framesize()
+{
+  int fs = settings_get(SET_STILL_FRAMESIZE);
+  if (still_max_size >= FRAMESIZE_INVALID)
+  {
+    return (framesize_t)fs;
+  }
+  if (fs >= FRAMESIZE_INVALID ||
+      (uint32_t)resolution[fs].width * resolution[fs].height > (uint32_t)resolution[still_max_size].width * resolution[still_max_size].height)
+  {
+    return still_max_size;
+  }
+  return (framesize_t)fs;
+}
+
+static bool still_frame_is(const camera_fb_t *fb, uint16_t w, uint16_t h)
+{
+  uint16_t fw, fh;
+  return jpeg_size(fb->buf, fb->len, &fw, &fh) && fw == w && fh == h;
+}
+
+static void still_stat_add(still_stat_t *st, uint32_t v)
+{
+  st->last = v;
+  st->sum += v;
+  st->max = v > st->max ? v : st->max;
+}
+
+static esp_err_t still_capture_run(uint8_t frames, bool triggered, still_info_t *info)
+{
+  sensor_t *s = esp_camera_sensor_get();
+  if (!s || !still_lock || !boot_is_set(BOOT_READY_CAMERA))
+  {
+    return ESP_ERR_INVALID_STATE;
+  }
+  if (s->pixformat != PIXFORMAT_JPEG)
+  {
+    return ESP_ERR_NOT_SUPPORTED;
+  }
+  if (!still_slot)
+  {
+    return ESP_ERR_NO_MEM;
+  }
+  if (xSemaphoreTake(still_lock, pdMS_TO_TICKS(STILL_LOCK_WAIT_MS)) != pdTRUE)
+  {
+    return ESP_ERR_TIMEOUT;
+  }
+  // Capteur réservé de la lecture de la taille de flux jusqu'au retour : un handler ne
+  // change pas la framesize au milieu de la bascule
+  sensor_lock();
+  frames = frames < 1 ? 1 : (frames > STILL_MAX_FRAMES ? STILL_MAX_FRAMES : frames);
+  framesize_t low = s->status.framesize;
+  framesize_t high = still_framesize();
+  uint16_t hw = resolution[high].width;
+  uint16_t hh = resolution[high].height;
+  // Flux déjà à la taille photo, plein champ : pas de bascule
+  bool switched = low != high || camera_window_get(NULL);
+  still_info_t got = {};
+  got.triggered = triggered;
+  uint32_t discarded = 0;
+  esp_err_t err = ESP_OK;
+
+  xEventGroupClearBits(still_events, STILL_IDLE_BIT);
+  still_stream_returned = 0;
+  int64_t t0 = esp_timer_get_time();
+  if (switched && s->set_framesize(s, high))
+  {
+    err = ESP_FAIL;
+  }
+  // Images encore à l'ancienne taille (file du pilote, trame en cours) : jetées
+  for (uint8_t kept = 0; err == ESP_OK && kept < frames;)
+  {
+    camera_fb_t *fb = esp_camera_fb_get();
+    if (!fb)
+    {
+      err = ESP_FAIL;
+      break;
+    }
+    if (!still_frame_is(fb, hw, hh))
+    {
+      esp_camera_fb_return(fb);
+      if (++discarded > STILL_SWITCH_MAX_FRAMES)
+      {
+        err = ESP_ERR_INVALID_SIZE;
+      }
+      continue;
+    }
+    if (!kept++)
+    {
+      got.switch_us = esp_timer_get_time() - t0;
+    }
+    if (kept == frames)
+    {
+      if (fb->len > still_slot_size)
+      {
+        err = ESP_ERR_NO_MEM;
+      }
+      else
+      {
+        // Invalidée seulement ici : un échec avant la copie garde la photo précédente
+        still_valid = false;
+        memcpy(still_slot, fb->buf, fb->len);
+        got.len = fb->len;
+        got.capture_us = (int64_t)fb->timestamp.tv_sec * 1000000 + fb->timestamp.tv_usec;
+      }
+    }
+    esp_camera_fb_return(fb);
+  }
+
+  if (switched)
+  {
+    int64_t t_back = esp_timer_get_time();
+    s->set_framesize(s, low);
+    camera_window_restore();
+    // Première image qui n'est plus à la taille photo : fin de la bascule. Chaque image
+    // prise ici manque au flux
+    for (uint32_t n = 0; n <= STILL_SWITCH_MAX_FRAMES; n++)
+    {
+      camera_fb_t *fb = esp_camera_fb_get();
+      if (!fb)
+      {
+        break;
+      }
+      bool back = !still_frame_is(fb, hw, hh);
+      esp_camera_fb_return(fb);
+      discarded++;
+      if (back)
+      {
+        got.back_us = esp_timer_get_time() - t_back;
+        break;
+      }
+    }
+    // Framesize et fenêtre sont passées par la taille photo : /status relu, même si le
+    // retour a échoué
+    status_invalidate();
+  }
+  sensor_unlock();
+  got.gap_us = esp_timer_get_time() - t0;
+  uint32_t lost = discarded + still_stream_returned.load();
+  got.lost = lost > UINT8_MAX ? UINT8_MAX : lost;
+  xEventGroupSetBits(still_events, STILL_IDLE_BIT);
+
+  if (err == ESP_OK)
+  {
+    got.width = hw;
+    got.height = hh;
+    still_last = got;
+    still_valid = true;
+    still_count++;
+    still_triggered += triggered;
+    still_lost_total += lost;
+    if (switched)
+    {
+      still_switches++;
+      still_stat_add(&still_switch_stat, got.switch_us);
+      still_stat_add(&still_back_stat, got.back_us);
+      still_stat_add(&still_gap_stat, got.gap_us);
+    }
+  }
+  else
+  {
+    still_failed++;
+  }
+  xSemaphoreGive(still_lock);
+
+  if (err == ESP_OK)
+  {
+    LOGR_I(LOG_MOD_CAMERA, "Photo %ux%u: %u o, bascule %lu us, retour %lu us, %lu image(s) perdue(s)", hw, hh, (unsigned)got.len,
+           (unsigned long)got.switch_us, (unsigned long)got.back_us, (unsigned long)lost);
+    event_publish(EVENT_STILL, "{\"w\":%u,\"h\":%u,\"bytes\":%u,\"switch_us\":%lu,\"lost\":%u}", hw, hh, (unsigned)got.len,
+                  (unsigned long)got.switch_us, got.lost);
+  }
+  else
+  {
+    LOGR_E(LOG_MOD_CAMERA, "Photo %ux%u échouée (0x%x), %lu image(s) perdue(s)", hw, hh, err, (unsigned long)lost);
+  }
+  if (info)
+  {
+    *info = got;
+  }
+  return err;
+}
+
+esp_err_t still_capture(uint8_t frames, still_info_t *info)
+{
+  return still_capture_run(frames, false, info);
+}
+
+void still_trigger()
+{
+  if (still_task && settings_get(SET_STILL_TRIGGER))
+  {
+    xTaskNotifyGive(still_task);
+  }
+}
+
+const uint8_t *still_acquire(still_info_t *info)
+{
+  if (!still_lock || xSemaphoreTake(still_lock, pdMS_TO_TICKS(STILL_LOCK_WAIT_MS)) != pdTRUE)
+  {
+    return NULL;
+  }
+  if (!still_valid)
+  {
+    xSemaphoreGive(still_lock);
+    return NULL;
+  }
+  *info = still_last;
+  return still_slot;
+}
+
+void still_release()
+{
+  xSemaphoreGive(still_lock);
+}
+
+camera_fb_t *still_stream_fb_get()
+{
+  for (;;)
+  {
+    if (still_events)
+    {
+      xEventGroupWaitBits(still_events, STILL_IDLE_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(STILL_STREAM_WAIT_MS));
+    }
+    camera_fb_t *fb = esp_camera_fb_get();
+    if (!fb || !still_events || (xEventGroupGetBits(still_events) & STILL_IDLE_BIT))
+    {
+      return fb;
+    }
+    // Bascule commencée pendant l'attente : l'image revient à la photo
+    esp_camera_fb_return(fb);
+    still_stream_returned++;
+  }
+}
+
+static void still_write_stat(json_writer_t *w, const char *key, const still_stat_t *st, uint32_t n)
+{
+  json_key(w, key);
+  json_begin_object(w);
+  json_kv_uint(w, "last", st->last);
+  json_kv_uint(w, "avg", n ? st->sum / n : 0);
+  json_kv_uint(w, "max", st->max);
+  json_end_object(w);
+}
+
+void still_write(json_writer_t *w)
+{
+  json_begin_object(w);
+  json_kv_int(w, "max_framesize", still_max_size);
+  json_kv_int(w, "framesize", still_framesize());
+  json_kv_uint(w, "slot", still_slot ? still_slot_size : 0);
+  json_kv_uint(w, "count", still_count);
+  json_kv_uint(w, "triggered", still_triggered);
+  json_kv_uint(w, "failed", still_failed);
+  json_kv_uint(w, "switches", still_switches);
+  still_write_stat(w, "switch_us", &still_switch_stat, still_switches);
+  still_write_stat(w, "back_us", &still_back_stat, still_switches);
+  still_write_stat(w, "gap_us", &still_gap_stat, still_switches);
+  json_key(w, "lost");
+  json_begin_object(w);
+  json_kv_uint(w, "last", still_valid ? still_last.lost : 0);
+  json_kv_uint(w, "total", still_lost_total);
+  json_end_object(w);
+  json_key(w, "last");
+  if (still_valid)
+  {
+    json_begin_object(w);
+    json_kv_uint(w, "w", still_last.width);
+    json_kv_uint(w, "h", still_last.height);
+    json_kv_uint(w, "bytes", still_last.len);
+    json_kv_uint(w, "age_ms", (esp_timer_get_time() - still_last.capture_us) / 1000);
+    json_kv_bool(w, "triggered", still_last.triggered);
+    json_end_object(w);
+  }
+  else
+  {
+    json_null(w);
+  }
+  json_end_object(w);
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_camera.h"
+#include "esp_err.h"
+#include "json_writer.h"
+
+// Double résolution : flux à la framesize courante (VGA au démarrage), photos à
+// still.framesize (UXGA par défaut) à la demande (/still) ou à l'arrivée d'un oiseau
+// (still.trigger). Les tampons caméra sont dimensionnés à l'init pour la plus grande
+// taille (config.frame_size) : la bascule n'est qu'un set_framesize, sans réallocation.
+// Une bascule :
+//  1. les lecteurs du flux sont retenus (still_stream_fb_get) ;
+//  2. set_framesize(photo) ; les images encore à l'ancienne taille sont jetées ;
+//  3. `frames` images à la taille photo, la dernière copiée dans l'emplacement photo
+//     (PSRAM, alloué à l'init) : les premières laissent l'exposition se stabiliser ;
+//  4. retour à la framesize du flux (et à la ROI), images de la photo en vol jetées.
+// La taille réelle d'une image est lue dans son SOF : fb->width/height suivent la
+// framesize demandée, pas celle de l'image reçue.
+// Mesures par bascule : latence jusqu'à la première image photo, latence de retour,
+// interruption du flux et images perdues (jetées à la mauvaise taille ou rendues par
+// les clients /stream).
+
+#define STILL_MAX_FRAMES 4        // Images par photo (la dernière est gardée)
+#define STILL_SWITCH_MAX_FRAMES 8 // Images à la mauvaise taille tolérées par bascule
+#define STILL_LOCK_WAIT_MS 2000   // Attente d'une bascule ou de l'emplacement en cours
+#define STILL_STREAM_WAIT_MS 3000 // Client /stream retenu au plus pendant une bascule
+
+typedef struct
+{
+  uint16_t width;
+  uint16_t height;
+  size_t len;
+  int64_t capture_us; // Horodatage de l'image (fb->timestamp)
+  uint32_t switch_us; // set_framesize(photo) -> première image à la taille photo
+  uint32_t back_us;   // set_framesize(flux) -> première image à la taille du flux
+  uint32_t gap_us;    // Flux interrompu
+  uint8_t lost;       // Images perdues par cette bascule
+  bool triggered;     // Prise sur arrivée d'un oiseau
+} still_info_t;
+
+// Appelé par la tâche d'initialisation caméra, avant la première réduction de framesize :
+// `max_size` = config.frame_size (taille des tampons). Sans PSRAM, pas d'emplacement photo
+// (ni de tâche "still").
+void still_init(framesize_t max_size);
+
+// Photo haute résolution (1 à STILL_MAX_FRAMES images) gardée dans l'emplacement.
+// ESP_ERR_NOT_SUPPORTED hors JPEG, ESP_ERR_NO_MEM sans emplacement, ESP_ERR_TIMEOUT si
+// une autre bascule est en cours.
+esp_err_t still_capture(uint8_t frames, still_info_t *info);
+// Rappel de présence : demande une photo (still.trigger) à la tâche "still" et rend la
+// main aussitôt ; la photo publie EVENT_STILL une fois prise
+void still_trigger();
+
+// Emplacement photo en lecture, verrouillé jusqu'à still_release ; NULL si vide
+const uint8_t *still_acquire(still_info_t *info);
+void still_release();
+
+// esp_camera_fb_get pour tous les lecteurs du flux (/stream, /capture, /bmp, rafale de
+// visite) : attend la fin d'une bascule, rend (et compte comme perdue) une image obtenue
+// pendant une bascule ; jamais d'image à la taille photo ni volée à la bascule
+camera_fb_t *still_stream_fb_get();
+
+// {"max_framesize":..,"framesize":..,"slot":..,"count":..,"triggered":..,"failed":..,
+//  "switches":..,"switch_us":{"last","avg","max"},"back_us":{..},"gap_us":{..},"lost":{"last","total"},
+//  "last":{"w","h","bytes","age_ms","triggered"}|null}
+void still_write(json_writer_t *w);
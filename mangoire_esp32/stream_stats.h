@@ -0,0 +1,211 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Statistiques en flux, sans allocation, instanciables par client et par étape.
+//  - WindowMean<T, N> : moyenne glissante sur N valeurs (remplace ra_filter_t)
+//  - Ewma             : moyenne mobile exponentielle
+//  - MinMax<T>        : extrêmes observés
+//  - LogHistogram<>   : histogramme logarithmique compact pour p50/p95/p99
+// Non thread-safe : une instance par tâche (ex. par client /stream).
+
+template <typename T, size_t N, typename Sum = int64_t>
+class WindowMean
+{
+public:
+  WindowMean() { reset(); }
+
+  void reset()
+  {
+    index_ = 0;
+    count_ = 0;
+    sum_ = 0;
+  }
+
+  // Ajoute une valeur et retourne la moyenne courante
+  T add(T value)
+  {
+    if (count_ == N)
+    {
+      sum_ -= values_[index_];
+    }
+    else
+    {
+      count_++;
+    }
+    values_[index_] = value;
+    sum_ += value;
+    index_ = (index_ + 1) % N;
+    return mean();
+  }
+
+  T mean() const { return count_ ? (T)(sum_ / (Sum)count_) : 0; }
+  size_t count() const { return count_; }
+
+private:
+  T values_[N];
+  size_t index_;
+  size_t count_;
+  Sum sum_;
+};
+
+class Ewma
+{
+public:
+  // alpha : poids de la nouvelle valeur (0 < alpha <= 1)
+  explicit Ewma(float alpha) : alpha_(alpha), value_(0), primed_(false) {}
+
+  void reset() { primed_ = false; }
+
+  float add(float value)
+  {
+    value_ = primed_ ? value_ + alpha_ * (value - value_) : value;
+    primed_ = true;
+    return value_;
+  }
+
+  float value() const { return value_; }
+
+private:
+  float alpha_;
+  float value_;
+  bool primed_;
+};
+
+template <typename T>
+class MinMax
+{
+public:
+  MinMax() { reset(); }
+
+  void reset()
+  {
+    count_ = 0;
+    min_ = 0;
+    max_ = 0;
+  }
+
+  void add(T value)
+  {
+    if (!count_ || value < min_)
+    {
+      min_ = value;
+    }
+    if (!count_ || value > max_)
+    {
+      max_ = value;
+    }
+    count_++;
+  }
+
+  T min() const { return min_; }
+  T max() const { return max_; }
+  uint32_t count() const { return count_; }
+
+private:
+  uint32_t count_;
+  T min_;
+  T max_;
+};
+
+// Histogramme logarithmique : 2^SubBits seaux par octave, valeurs entières jusqu'à 2^MaxBits.
+// Erreur relative sur les quantiles < 1/2^SubBits (25 % avec SubBits = 2).
+// Compteurs 16 bits : divisés par 2 à saturation (les proportions sont conservées).
+template <unsigned SubBits = 2, unsigned MaxBits = 24>
+class LogHistogram
+{
+public:
+  static const unsigned kSub = 1u << SubBits;
+  static const unsigned kBuckets = (MaxBits - SubBits + 1) * kSub;
+
+  LogHistogram() { reset(); }
+
+  void reset()
+  {
+    for (unsigned i = 0; i < kBuckets; i++)
+    {
+      counts_[i] = 0;
+    }
+    total_ = 0;
+  }
+
+  void add(uint32_t value)
+  {
+    unsigned b = bucket(value);
+    if (counts_[b] == 0xFFFF)
+    {
+      halve();
+    }
+    counts_[b]++;
+    total_++;
+  }
+
+  // Quantile q dans [0, 1] ; retourne la borne haute du seau correspondant
+  uint32_t quantile(float q) const
+  {
+    if (!total_)
+    {
+      return 0;
+    }
+    uint32_t rank = (uint32_t)(q * (total_ - 1)) + 1;
+    uint32_t seen = 0;
+    for (unsigned b = 0; b < kBuckets; b++)
+    {
+      seen += counts_[b];
+      if (seen >= rank)
+      {
+        return upper(b);
+      }
+    }
+    return upper(kBuckets - 1);
+  }
+
+  uint32_t count() const { return total_; }
+
+  // Valeurs < kSub : un seau par valeur ; au-delà : kSub seaux par puissance de 2
+  static unsigned bucket(uint32_t v)
+  {
+    if (v < kSub)
+    {
+      return v;
+    }
+    unsigned e = msb(v);
+    if (e >= MaxBits)
+    {
+      return kBuckets - 1;
+    }
+    unsigned sub = (v >> (e - SubBits)) & (kSub - 1);
+    return (e - SubBits + 1) * kSub + sub;
+  }
+
+  // Plus grande valeur du seau b
+  static uint32_t upper(unsigned b)
+  {
+    if (b < kSub)
+    {
+      return b;
+    }
+    unsigned e = b / kSub + SubBits - 1;
+    unsigned sub = b % kSub;
+    return ((uint32_t)(kSub + sub + 1) << (e - SubBits)) - 1;
+  }
+
+private:
+  static unsigned msb(uint32_t v)
+  {
+    return 31 - __builtin_clz(v);
+  }
+
+  void halve()
+  {
+    total_ = 0;
+    for (unsigned i = 0; i < kBuckets; i++)
+    {
+      counts_[i] = (counts_[i] + 1) / 2;
+      total_ += counts_[i];
+    }
+  }
+
+  uint16_t counts_[kBuckets];
+  uint32_t total_;
+};
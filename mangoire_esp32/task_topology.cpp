@@ -0,0 +1,193 @@
+#include "task_topology.h"
+#include "settings_store.h"
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#define TASK_SNAPSHOT_MAX 32 // Tâches suivies entre deux appels (part CPU)
+
+task_cfg_t task_cfg[TASK_ID_COUNT] = {
+    {.name = "httpd", .core = TASK_HTTPD_CORE, .priority = TASK_HTTPD_PRIORITY, .stack = TASK_HTTPD_STACK},
+    {.name = "stream", .core = TASK_STREAM_CORE, .priority = TASK_STREAM_PRIORITY, .stack = TASK_STREAM_STACK},
+    {.name = "sse", .core = TASK_SSE_CORE, .priority = TASK_SSE_PRIORITY, .stack = TASK_SSE_STACK},
+    {.name = "log", .core = TASK_LOG_CORE, .priority = TASK_LOG_PRIORITY, .stack = TASK_LOG_STACK},
+    {.name = "ranging", .core = TASK_RANGING_CORE, .priority = TASK_RANGING_PRIORITY, .stack = TASK_RANGING_STACK},
+    {.name = "presence", .core = TASK_PRESENCE_CORE, .priority = TASK_PRESENCE_PRIORITY, .stack = TASK_PRESENCE_STACK},
+    {.name = "still", .core = TASK_STILL_CORE, .priority = TASK_STILL_PRIORITY, .stack = TASK_STILL_STACK},
+    {.name = "visit", .core = TASK_VISIT_CORE, .priority = TASK_VISIT_PRIORITY, .stack = TASK_VISIT_STACK},
+};
+
+// Réglages core/priority/stack de chaque tâche, dans l'ordre de task_id_t
+static const setting_id_t task_settings[TASK_ID_COUNT] = {SET_TASK_HTTPD_CORE_ID, SET_TASK_STREAM_CORE_ID, SET_TASK_SSE_CORE_ID,
+                                                          SET_TASK_LOG_CORE_ID, SET_TASK_RANGING_CORE_ID, SET_TASK_PRESENCE_CORE_ID,
+                                                          SET_TASK_STILL_CORE_ID, SET_TASK_VISIT_CORE_ID};
+static_assert(SET_TASK_HTTPD_STACK_SIZE == SET_TASK_HTTPD_CORE_ID + 2 && SET_TASK_STREAM_STACK_SIZE == SET_TASK_STREAM_CORE_ID + 2 &&
+                  SET_TASK_SSE_STACK_SIZE == SET_TASK_SSE_CORE_ID + 2 && SET_TASK_LOG_STACK_SIZE == SET_TASK_LOG_CORE_ID + 2 &&
+                  SET_TASK_RANGING_STACK_SIZE == SET_TASK_RANGING_CORE_ID + 2 && SET_TASK_PRESENCE_STACK_SIZE == SET_TASK_PRESENCE_CORE_ID + 2 &&
+                  SET_TASK_STILL_STACK_SIZE == SET_TASK_STILL_CORE_ID + 2 && SET_TASK_VISIT_STACK_SIZE == SET_TASK_VISIT_CORE_ID + 2,
+              "Ordre du schéma");
+
+void task_topology_load()
+{
+  for (int i = 0; i < TASK_ID_COUNT; i++)
+  {
+    setting_id_t first = task_settings[i];
+    task_cfg[i].core = settings_get(first);
+    task_cfg[i].priority = settings_get((setting_id_t)(first + 1));
+    task_cfg[i].stack = settings_get((setting_id_t)(first + 2));
+  }
+}
+
+bool task_topology_update(JsonObjectConst obj)
+{
+  int rejected = 0;
+  char group[16];
+  // Toutes les tâches vérifiées avant d'en appliquer une : tout ou rien
+  for (int i = 0; i < TASK_ID_COUNT; i++)
+  {
+    snprintf(group, sizeof(group), "task_%s", task_cfg[i].name);
+    rejected += settings_check_json(obj[task_cfg[i].name], group);
+  }
+  if (rejected)
+  {
+    return false;
+  }
+  for (int i = 0; i < TASK_ID_COUNT; i++)
+  {
+    snprintf(group, sizeof(group), "task_%s", task_cfg[i].name);
+    settings_from_json(obj[task_cfg[i].name], group);
+  }
+  task_topology_load();
+  return true;
+}
+
+BaseType_t task_create(task_id_t id, TaskFunction_t fn, void *arg, TaskHandle_t *handle)
+{
+  const task_cfg_t *c = &task_cfg[id];
+  BaseType_t core = c->core == TASK_CORE_ANY || c->core >= portNUM_PROCESSORS ? tskNO_AFFINITY : c->core;
+  return xTaskCreatePinnedToCore(fn, c->name, c->stack, arg, c->priority, handle, core);
+}
+
+#if configUSE_TRACE_FACILITY && configGENERATE_RUN_TIME_STATS
+// Compteurs du précédent appel : la part CPU porte sur l'intervalle entre deux lectures
+typedef struct
+{
+  TaskHandle_t handle;
+  configRUN_TIME_COUNTER_TYPE runtime;
+} task_snapshot_t;
+
+static task_snapshot_t task_prev[TASK_SNAPSHOT_MAX];
+static int task_prev_count = 0;
+static configRUN_TIME_COUNTER_TYPE task_prev_total = 0;
+
+static configRUN_TIME_COUNTER_TYPE task_prev_runtime(TaskHandle_t h)
+{
+  for (int i = 0; i < task_prev_count; i++)
+  {
+    if (task_prev[i].handle == h)
+    {
+      return task_prev[i].runtime;
+    }
+  }
+  return 0;
+}
+#endif
+
+#if configUSE_TRACE_FACILITY
+static const char *task_state_names[] = {"running", "ready", "blocked", "suspended", "deleted"};
+#endif
+
+static void task_write_config(json_writer_t *w)
+{
+  json_key(w, "config");
+  json_begin_object(w);
+  for (int i = 0; i < TASK_ID_COUNT; i++)
+  {
+    json_key(w, task_cfg[i].name);
+    json_begin_object(w);
+    json_kv_int(w, "core", task_cfg[i].core);
+    json_kv_uint(w, "priority", task_cfg[i].priority);
+    json_kv_uint(w, "stack", task_cfg[i].stack);
+    json_end_object(w);
+  }
+  json_end_object(w);
+
+  // Placement des tâches du SDK, fixé à la compilation (sdkconfig)
+  json_key(w, "sdk");
+  json_begin_object(w);
+#ifdef CONFIG_ARDUINO_RUNNING_CORE
+  json_kv_int(w, "loop_core", CONFIG_ARDUINO_RUNNING_CORE);
+#endif
+#ifdef CONFIG_ESP_WIFI_TASK_CORE_ID
+  json_kv_int(w, "wifi_core", CONFIG_ESP_WIFI_TASK_CORE_ID);
+#elif defined(CONFIG_ESP32_WIFI_TASK_PINNED_TO_CORE_1)
+  json_kv_int(w, "wifi_core", 1);
+#endif
+#if defined(CONFIG_CAMERA_CORE0)
+  json_kv_int(w, "camera_core", 0);
+#elif defined(CONFIG_CAMERA_CORE1)
+  json_kv_int(w, "camera_core", 1);
+#elif defined(CONFIG_CAMERA_NO_AFFINITY)
+  json_kv_int(w, "camera_core", TASK_CORE_ANY);
+#endif
+  json_end_object(w);
+}
+
+void task_topology_write(json_writer_t *w)
+{
+  json_begin_object(w);
+  task_write_config(w);
+#if configUSE_TRACE_FACILITY
+  UBaseType_t n = uxTaskGetNumberOfTasks();
+  TaskStatus_t *tasks = (TaskStatus_t *)malloc(n * sizeof(TaskStatus_t));
+  if (!tasks)
+  {
+    json_kv_str(w, "error", "no_mem");
+    json_end_object(w);
+    return;
+  }
+  configRUN_TIME_COUNTER_TYPE total = 0;
+  n = uxTaskGetSystemState(tasks, n, &total);
+#if configGENERATE_RUN_TIME_STATS
+  // Compteur en µs (esp_timer) ; la soustraction non signée absorbe un débordement
+  configRUN_TIME_COUNTER_TYPE elapsed = total - task_prev_total;
+  json_kv_uint(w, "interval_ms", elapsed / 1000);
+#endif
+  json_key(w, "tasks");
+  json_begin_array(w);
+  for (UBaseType_t i = 0; i < n; i++)
+  {
+    const TaskStatus_t *t = &tasks[i];
+    json_begin_object(w);
+    json_kv_str(w, "name", t->pcTaskName);
+#if configTASKLIST_INCLUDE_COREID
+    json_kv_int(w, "core", t->xCoreID == tskNO_AFFINITY ? TASK_CORE_ANY : (int)t->xCoreID);
+#endif
+    json_kv_uint(w, "priority", t->uxCurrentPriority);
+    json_kv_str(w, "state", t->eCurrentState < 5 ? task_state_names[t->eCurrentState] : "invalid");
+    // Réserve minimale de pile depuis la création, en octets (StackType_t = 1 octet sur ESP-IDF)
+    json_kv_uint(w, "stack_free_min", t->usStackHighWaterMark * sizeof(StackType_t));
+#if configGENERATE_RUN_TIME_STATS
+    // Part d'un cœur sur l'intervalle ; une tâche créée entre-temps compte depuis sa création
+    configRUN_TIME_COUNTER_TYPE delta = t->ulRunTimeCounter - task_prev_runtime(t->xHandle);
+    json_kv_float(w, "cpu_pct", elapsed ? 100.0f * (float)delta / (float)elapsed : 0.0f, 1);
+    json_kv_uint(w, "runtime_ms", t->ulRunTimeCounter / 1000);
+#endif
+    json_end_object(w);
+  }
+  json_end_array(w);
+#if configGENERATE_RUN_TIME_STATS
+  task_prev_count = 0;
+  for (UBaseType_t i = 0; i < n && task_prev_count < TASK_SNAPSHOT_MAX; i++)
+  {
+    task_prev[task_prev_count].handle = tasks[i].xHandle;
+    task_prev[task_prev_count].runtime = tasks[i].ulRunTimeCounter;
+    task_prev_count++;
+  }
+  task_prev_total = total;
+#endif
+  free(tasks);
+#else
+  json_kv_str(w, "error", "configUSE_TRACE_FACILITY disabled");
+#endif
+  json_end_object(w);
+}
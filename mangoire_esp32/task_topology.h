@@ -0,0 +1,136 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "json_writer.h"
+
+// Topologie des tâches du firmware : cœur, priorité et pile de chaque tâche créée par
+// le firmware, définis ici à la compilation puis surchargeables dans le magasin de
+// réglages (POST /api/tasks, bornes dans SETTINGS_SCHEMA). Les surcharges s'appliquent à la prochaine création de la tâche :
+// immédiatement pour les flux, au redémarrage pour httpd, sse, log, ranging, presence,
+// still et visit.
+// Les tâches du SDK (WiFi, caméra, loop) ont un placement fixé par sdkconfig : elles
+// sont seulement listées par /api/tasks.
+
+#define TASK_CORE_ANY -1 // tskNO_AFFINITY
+
+// Par défaut, le WiFi et le pilote caméra tournent sur le cœur 0 : le service HTTP et
+// l'envoi des flux vont sur le cœur 1, où loop() ne fait rien.
+#ifndef TASK_HTTPD_CORE
+#define TASK_HTTPD_CORE 1
+#endif
+#ifndef TASK_HTTPD_PRIORITY
+#define TASK_HTTPD_PRIORITY 5
+#endif
+#ifndef TASK_HTTPD_STACK
+#define TASK_HTTPD_STACK 4096
+#endif
+
+#ifndef TASK_STREAM_CORE
+#define TASK_STREAM_CORE 1
+#endif
+#ifndef TASK_STREAM_PRIORITY
+#define TASK_STREAM_PRIORITY 4 // Sous httpd : le contrôle passe avant le flux
+#endif
+#ifndef TASK_STREAM_STACK
+#define TASK_STREAM_STACK 6144
+#endif
+
+#ifndef TASK_SSE_CORE
+#define TASK_SSE_CORE TASK_CORE_ANY
+#endif
+#ifndef TASK_SSE_PRIORITY
+#define TASK_SSE_PRIORITY 4
+#endif
+#ifndef TASK_SSE_STACK
+#define TASK_SSE_STACK 4096
+#endif
+
+#ifndef TASK_LOG_CORE
+#define TASK_LOG_CORE 0
+#endif
+#ifndef TASK_LOG_PRIORITY
+#define TASK_LOG_PRIORITY 1 // Juste au-dessus d'idle : l'UART passe après tout le reste
+#endif
+#ifndef TASK_LOG_STACK
+#define TASK_LOG_STACK 3072
+#endif
+
+// Capteur de distance : la tâche I2C ne se réveille que sur interruption, le filtre de
+// présence consomme sa file
+#ifndef TASK_RANGING_CORE
+#define TASK_RANGING_CORE TASK_CORE_ANY
+#endif
+#ifndef TASK_RANGING_PRIORITY
+#define TASK_RANGING_PRIORITY 3
+#endif
+#ifndef TASK_RANGING_STACK
+#define TASK_RANGING_STACK 3072
+#endif
+
+#ifndef TASK_PRESENCE_CORE
+#define TASK_PRESENCE_CORE TASK_CORE_ANY
+#endif
+#ifndef TASK_PRESENCE_PRIORITY
+#define TASK_PRESENCE_PRIORITY 2
+#endif
+#ifndef TASK_PRESENCE_STACK
+#define TASK_PRESENCE_STACK 3072
+#endif
+
+// Photo sur arrivée (still.trigger) et envoi des visites : ni l'une ni l'autre n'est
+// pressée, elles passent après le flux et le capteur
+#ifndef TASK_STILL_CORE
+#define TASK_STILL_CORE TASK_CORE_ANY
+#endif
+#ifndef TASK_STILL_PRIORITY
+#define TASK_STILL_PRIORITY 2
+#endif
+#ifndef TASK_STILL_STACK
+#define TASK_STILL_STACK 4096
+#endif
+
+#ifndef TASK_VISIT_CORE
+#define TASK_VISIT_CORE TASK_CORE_ANY
+#endif
+#ifndef TASK_VISIT_PRIORITY
+#define TASK_VISIT_PRIORITY 2
+#endif
+#ifndef TASK_VISIT_STACK
+#define TASK_VISIT_STACK 6144 // esp_http_client (HTTPS : prévoir plus)
+#endif
+
+typedef enum
+{
+  TASK_HTTPD = 0,
+  TASK_STREAM,
+  TASK_SSE,
+  TASK_LOG,
+  TASK_RANGING,
+  TASK_PRESENCE,
+  TASK_STILL,
+  TASK_VISIT,
+  TASK_ID_COUNT
+} task_id_t;
+
+typedef struct
+{
+  const char *name;
+  int core; // 0, 1 ou TASK_CORE_ANY
+  UBaseType_t priority;
+  uint32_t stack; // Octets
+} task_cfg_t;
+
+extern task_cfg_t task_cfg[TASK_ID_COUNT];
+
+// Recopie la topologie depuis le magasin de réglages
+void task_topology_load();
+// Applique les clés présentes ({"stream":{"core":0,"priority":3,"stack":8192},...}) ;
+// false si une valeur est hors bornes (aucune n'est alors appliquée)
+bool task_topology_update(JsonObjectConst obj);
+
+// xTaskCreatePinnedToCore avec la configuration de `id`
+BaseType_t task_create(task_id_t id, TaskFunction_t fn, void *arg, TaskHandle_t *handle = NULL);
+
+// Configuration, puis toutes les tâches : cœur, priorité, réserve de pile et part CPU
+// depuis l'appel précédent (si les statistiques FreeRTOS sont compilées)
+void task_topology_write(json_writer_t *w);
@@ -0,0 +1,119 @@
+#include "trace.h"
+
+#if ENABLE_TRACE
+#include <Arduino.h>
+#include <atomic>
+#include <stdio.h>
+#include <esp_heap_caps.h>
+#include "esp_timer.h"
+#include "log_ring.h"
+
+#define TRACE_CORES portNUM_PROCESSORS
+
+typedef struct
+{
+  int64_t ts;
+  const char *name;
+  TaskHandle_t task;
+  char phase;
+} trace_rec_t;
+
+typedef struct
+{
+  trace_rec_t *recs;
+  std::atomic<uint32_t> next; // Index d'écriture (jamais remis à zéro sauf à l'export)
+} trace_ring_t;
+
+static trace_ring_t trace_rings[TRACE_CORES];
+static std::atomic<bool> trace_active(false);
+
+void trace_init()
+{
+  for (int c = 0; c < TRACE_CORES; c++)
+  {
+    if (trace_rings[c].recs)
+    {
+      continue;
+    }
+    size_t size = TRACE_RING_SIZE * sizeof(trace_rec_t);
+    // PSRAM de préférence : la mémoire interne est réservée à la caméra et au WiFi
+    trace_rings[c].recs = (trace_rec_t *)heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!trace_rings[c].recs)
+    {
+      trace_rings[c].recs = (trace_rec_t *)heap_caps_malloc(size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (!trace_rings[c].recs)
+    {
+      LOGR_E(LOG_MOD_CORE, "Trace ring allocation failed");
+      return;
+    }
+  }
+  trace_active.store(true, std::memory_order_release);
+}
+
+void trace_record(const char *name, char phase)
+{
+  if (!trace_active.load(std::memory_order_relaxed))
+  {
+    return;
+  }
+  // Anneau du cœur courant : pas de contention entre cœurs, l'index atomique
+  // protège des préemptions entre tâches d'un même cœur.
+  trace_ring_t *ring = &trace_rings[xPortGetCoreID()];
+  uint32_t i = ring->next.fetch_add(1, std::memory_order_relaxed) & (TRACE_RING_SIZE - 1);
+  trace_rec_t *r = &ring->recs[i];
+  r->ts = esp_timer_get_time();
+  r->name = name;
+  r->task = xTaskGetCurrentTaskHandle();
+  r->phase = phase;
+}
+
+void trace_write_chrome(json_writer_t *w)
+{
+  bool was_active = trace_active.exchange(false);
+  vTaskDelay(1); // Laisse se terminer un enregistrement en cours
+
+  json_begin_object(w);
+  json_kv_str(w, "displayTimeUnit", "ms");
+  json_key(w, "traceEvents");
+  json_begin_array(w);
+  for (int c = 0; c < TRACE_CORES && json_writer_ok(w); c++)
+  {
+    trace_ring_t *ring = &trace_rings[c];
+    if (!ring->recs)
+    {
+      continue;
+    }
+    uint32_t next = ring->next.load();
+    uint32_t count = next < TRACE_RING_SIZE ? next : TRACE_RING_SIZE;
+    for (uint32_t k = next - count; k != next && json_writer_ok(w); k++)
+    {
+      trace_rec_t *r = &ring->recs[k & (TRACE_RING_SIZE - 1)];
+      char ph[2] = {r->phase, 0};
+      json_begin_object(w);
+      json_kv_str(w, "name", r->name);
+      json_kv_str(w, "ph", ph);
+      json_key(w, "ts");
+      json_uint64(w, (uint64_t)r->ts);
+      // Paires B/E par tâche (un seul processus) : une tâche non épinglée peut changer de
+      // cœur entre le début et la fin d'une étape. Le cœur reste visible en argument.
+      json_kv_int(w, "pid", 0);
+      json_kv_uint(w, "tid", (uint32_t)(uintptr_t)r->task);
+      if (r->phase == 'i')
+      {
+        json_kv_str(w, "s", "t");
+      }
+      json_key(w, "args");
+      json_begin_object(w);
+      json_kv_int(w, "core", c);
+      json_end_object(w);
+      json_end_object(w);
+    }
+    ring->next.store(0);
+  }
+  json_end_array(w);
+  json_end_object(w);
+
+  trace_active.store(was_active);
+}
+#endif
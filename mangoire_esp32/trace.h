@@ -0,0 +1,39 @@
+#pragma once
+#include <stdint.h>
+
+// Traceur du chemin critique (capture, encodage, envoi, réglages, sommeil).
+// Chaque cœur possède un anneau fixe d'enregistrements horodatés (esp_timer_get_time),
+// chacun avec la tâche qui l'a produit.
+// Export au format Chrome trace-event JSON sur /debug/trace (visualisable dans Perfetto) :
+// une piste par tâche, les B/E s'apparient même si la tâche a changé de cœur.
+// Désactivé, tout est retiré à la compilation : les macros ne génèrent aucun code.
+#define ENABLE_TRACE 0 // Mettre à 1 pour activer le traçage
+
+#define TRACE_RING_SIZE 512 // Enregistrements par cœur (puissance de 2)
+
+#if ENABLE_TRACE
+#include "json_writer.h"
+
+// `name` doit être une chaîne statique (seul le pointeur est conservé)
+void trace_record(const char *name, char phase);
+void trace_init();
+// Exporte puis vide les anneaux ; l'enregistrement est suspendu pendant l'export
+void trace_write_chrome(json_writer_t *w);
+
+#define TRACE_BEGIN(name) trace_record(name, 'B')
+#define TRACE_END(name) trace_record(name, 'E')
+#define TRACE_INSTANT(name) trace_record(name, 'i')
+#else
+#define TRACE_BEGIN(name) \
+  do                      \
+  {                       \
+  } while (0)
+#define TRACE_END(name) \
+  do                    \
+  {                     \
+  } while (0)
+#define TRACE_INSTANT(name) \
+  do                        \
+  {                         \
+  } while (0)
+#endif
@@ -0,0 +1,190 @@
+#include "visit_capture.h"
+#include <Arduino.h>
+#include "esp_camera.h"
+#include "esp_http_client.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "boot_phase.h"
+#include "log_ring.h"
+#include "recorder.h"
+#include "settings_store.h"
+#include "still_capture.h"
+#include "task_topology.h"
+
+typedef enum
+{
+  VISIT_UPLOAD_IDLE = 0, // Pas de rafale
+  VISIT_UPLOAD_PENDING,  // Rafale prête, réseau attendu
+  VISIT_UPLOAD_RUNNING,
+  VISIT_UPLOAD_DONE,
+  VISIT_UPLOAD_FAILED,
+  VISIT_UPLOAD_SKIPPED, // Pas d'URL : conteneur gardé pour GET /api/record
+} visit_upload_state_t;
+
+static const char *visit_state_names[] = {"idle", "pending", "running", "done", "failed", "skipped"};
+
+static volatile visit_upload_state_t visit_state = VISIT_UPLOAD_IDLE;
+static uint32_t visit_frames = 0;
+static int64_t visit_first_frame_us = 0;
+static uint32_t visit_upload_ms = 0;
+static int visit_http_status = 0;
+static SemaphoreHandle_t visit_done = NULL;
+
+bool visit_wakeup()
+{
+  return esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_EXT0;
+}
+
+int visit_capture_burst()
+{
+  int phase = boot_phase_begin("visit_burst");
+  uint32_t burst = settings_get(SET_VISIT_BURST);
+  uint32_t interval_ms = settings_get(SET_VISIT_INTERVAL_MS);
+  esp_err_t err = recorder_start((size_t)settings_get(SET_VISIT_BUFFER_KB) * 1024, burst);
+  if (err != ESP_OK)
+  {
+    LOGR_E(LOG_MOD_CAMERA, "Visite: tampon indisponible (0x%x)", err);
+    boot_phase_end(phase);
+    return 0;
+  }
+  for (uint32_t i = 0; i < burst; i++)
+  {
+    int64_t t_get = esp_timer_get_time();
+    camera_fb_t *fb = still_stream_fb_get();
+    int64_t t_got = esp_timer_get_time();
+    if (!fb)
+    {
+      LOGR_E(LOG_MOD_CAMERA, "Visite: capture %lu échouée", (unsigned long)i);
+      continue;
+    }
+    if (!visit_first_frame_us)
+    {
+      visit_first_frame_us = t_got;
+      boot_mark_first_frame();
+    }
+    bool kept = fb->format == PIXFORMAT_JPEG &&
+                recorder_add_frame(fb->buf, fb->len, (int64_t)fb->timestamp.tv_sec * 1000000 + fb->timestamp.tv_usec, t_got - t_get);
+    esp_camera_fb_return(fb);
+    if (!kept)
+    {
+      // Tampon plein ou format non JPEG : les images suivantes ne rentreraient pas non plus
+      break;
+    }
+    visit_frames++;
+    if (interval_ms && i + 1 < burst)
+    {
+      vTaskDelay(pdMS_TO_TICKS(interval_ms));
+    }
+  }
+  recorder_stop();
+  recorder_release();
+  if (visit_frames)
+  {
+    visit_state = VISIT_UPLOAD_PENDING;
+  }
+  boot_phase_end(phase);
+  LOGR_I(LOG_MOD_CAMERA, "Visite: %lu image(s), première à %lu ms", (unsigned long)visit_frames, (unsigned long)(visit_first_frame_us / 1000));
+  return visit_frames;
+}
+
+static void visit_upload_task(void *arg)
+{
+  char url[SETTINGS_STR_MAX + 1];
+  settings_get_str(SET_VISIT_UPLOAD_URL, url, sizeof(url));
+  int phase = boot_phase_begin("visit_upload");
+  int64_t start = esp_timer_get_time();
+  size_t len = 0;
+  const uint8_t *data = NULL;
+  if (!url[0])
+  {
+    visit_state = VISIT_UPLOAD_SKIPPED;
+  }
+  else if (!recorder_acquire())
+  {
+    visit_state = VISIT_UPLOAD_FAILED;
+  }
+  else if (!(data = recorder_data(&len)))
+  {
+    recorder_release();
+    visit_state = VISIT_UPLOAD_FAILED;
+  }
+  else
+  {
+    visit_state = VISIT_UPLOAD_RUNNING;
+    esp_http_client_config_t cfg = {};
+    cfg.url = url;
+    cfg.method = HTTP_METHOD_POST;
+    cfg.timeout_ms = settings_get(SET_VISIT_UPLOAD_TIMEOUT);
+    esp_http_client_handle_t client = esp_http_client_init(&cfg);
+    esp_err_t err = ESP_FAIL;
+    if (client)
+    {
+      char frames[12];
+      snprintf(frames, sizeof(frames), "%lu", (unsigned long)recorder_frames());
+      esp_http_client_set_header(client, "Content-Type", "application/octet-stream");
+      esp_http_client_set_header(client, "X-Frames", frames);
+      esp_http_client_set_post_field(client, (const char *)data, len);
+      err = esp_http_client_perform(client);
+      visit_http_status = esp_http_client_get_status_code(client);
+      esp_http_client_cleanup(client);
+    }
+    recorder_release();
+    visit_state = err == ESP_OK && visit_http_status >= 200 && visit_http_status < 300 ? VISIT_UPLOAD_DONE : VISIT_UPLOAD_FAILED;
+  }
+  visit_upload_ms = (esp_timer_get_time() - start) / 1000;
+  boot_phase_end(phase);
+  LOGR_I(LOG_MOD_NET, "Visite: envoi %s (%u octets, HTTP %d, %lu ms)", visit_state_names[visit_state], len, visit_http_status,
+         (unsigned long)visit_upload_ms);
+  xSemaphoreGive(visit_done);
+  vTaskDelete(NULL);
+}
+
+void visit_upload_start()
+{
+  if (visit_state != VISIT_UPLOAD_PENDING || visit_done)
+  {
+    return;
+  }
+  visit_done = xSemaphoreCreateBinary();
+  if (!visit_done || task_create(TASK_VISIT, visit_upload_task, NULL) != pdPASS)
+  {
+    LOGR_E(LOG_MOD_NET, "Visite: tâche d'envoi non créée");
+    visit_state = VISIT_UPLOAD_FAILED;
+    if (visit_done)
+    {
+      xSemaphoreGive(visit_done);
+    }
+  }
+}
+
+bool visit_upload_wait(uint32_t timeout_ms)
+{
+  if (!visit_done)
+  {
+    return true;
+  }
+  if (xSemaphoreTake(visit_done, pdMS_TO_TICKS(timeout_ms)) != pdTRUE)
+  {
+    return false;
+  }
+  // Rend le jeton : d'autres attentes éventuelles passent aussi
+  xSemaphoreGive(visit_done);
+  return true;
+}
+
+void visit_write(json_writer_t *w)
+{
+  json_begin_object(w);
+  json_kv_bool(w, "wakeup", visit_wakeup());
+  json_kv_uint(w, "frames", visit_frames);
+  json_kv_uint(w, "first_frame_ms", visit_first_frame_us / 1000);
+  json_key(w, "upload");
+  json_begin_object(w);
+  json_kv_str(w, "state", visit_state_names[visit_state]);
+  json_kv_int(w, "http_status", visit_http_status);
+  json_kv_uint(w, "ms", visit_upload_ms);
+  json_end_object(w);
+  json_end_object(w);
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <stdint.h>
+#include "json_writer.h"
+
+// Chemin rapide réveil -> rafale -> envoi, pour les cycles de sommeil profond déclenchés
+// par le VL53L1X (réveil ext0).
+//  1. la tâche d'initialisation caméra prend une rafale dès esp_camera_init, avant
+//     que le WiFi soit associé : l'oiseau est encore là ;
+//  2. les images sont gardées en PSRAM dans le conteneur de l'enregistreur (BCR1),
+//     téléchargeable sur GET /api/record ;
+//  3. une fois le réseau prêt, une tâche de fond envoie le conteneur (POST
+//     application/octet-stream sur visit.upload_url, si configurée) ;
+//  4. le sommeil profond attend la fin de l'envoi (visit.upload_timeout_ms au plus).
+
+// Vrai si le démarrage courant est un réveil par le capteur de distance
+bool visit_wakeup();
+// Rafale visit.burst images ; retourne le nombre d'images gardées
+int visit_capture_burst();
+// Envoi en tâche de fond (sans effet sans rafale ou sans URL)
+void visit_upload_start();
+// Attend la fin de l'envoi ; false au bout de timeout_ms
+bool visit_upload_wait(uint32_t timeout_ms);
+
+// {"wakeup":..,"frames":..,"first_frame_ms":..,"upload":{..}}
+void visit_write(json_writer_t *w);
@@ -5,29 +5,117 @@
 #include "VL53L1X_ULD.h"
 #include "esp_sleep.h"
 #include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "camera_window.h"
+#include "log_ring.h"
+#include "presence.h"
+#include "task_topology.h"
+#include "trace.h"
+#include "visit_capture.h"
+#include "settings_store.h"
+#include "still_capture.h"
 
 #define I2C_SDA 14
 #define I2C_SCL 15
 #define VL53L1X_I2C_ADDR 0x52
 #define VL53L1X_INT_PIN GPIO_NUM_13
 
-static uint8_t booted = 0;
+#define VL53L1X_TIMING_BUDGET_MS 50
+#define VL53L1X_INTERMEASUREMENT_MS 100
+#define VL53L1X_IRQ_TIMEOUT_MS 1000 // Sans interruption : contrôle de la broche (front manqué)
+#define VL53L1X_SLEEP_ARM_MS 200    // Attente max du retour à HIGH avant le sommeil
 
-inline void setupVL53L1XAndSleep()
+// Balayage des zones (presence.h) : matrice 16x16 SPAD découpée en PRESENCE_ZONE_COLS x
+// PRESENCE_ZONE_ROWS ROI. L'optique du récepteur inverse l'image : la colonne SPAD 0
+// voit la droite de la caméra (à ajuster selon le montage)
+#define VL53L1X_SPAD_GRID 16
+#define VL53L1X_SPAD_FULL_CENTER 199 // SPAD central du plein champ
+#define VL53L1X_ROI_MIRROR_X 1
+#define VL53L1X_ROI_MIRROR_Y 1
+
+static_assert(VL53L1X_SPAD_GRID / PRESENCE_ZONE_COLS >= 4 && VL53L1X_SPAD_GRID / PRESENCE_ZONE_ROWS >= 4, "ROI VL53L1X : 4x4 SPAD minimum");
+
+// Le capteur mesure en continu et lève GPIO1 (actif bas) à chaque nouvelle mesure :
+// l'interruption réveille la tâche "ranging", qui lit la distance et la pousse vers le
+// filtre de présence (presence.h). Aucune interrogation I2C tant qu'aucune mesure n'est
+// prête ; setup() n'est plus bloqué, caméra et serveur HTTP restent disponibles.
+// Quand la présence retombe (ou qu'aucun objet n'est là au démarrage), la même tâche
+// repasse le capteur en mode seuil et met la carte en sommeil profond (réveil ext0).
+// Pendant une visite (presence.scan), chaque mesure change de zone pour localiser
+// l'oiseau ; la position peut recadrer la caméra (camera_window_follow).
+
+static TaskHandle_t vl53_task = NULL;
+static volatile bool vl53_sleep_requested = false;
+static volatile bool vl53_scan_requested = false;
+
+static void IRAM_ATTR vl53_isr()
 {
-      Wire.begin(I2C_SDA, I2C_SCL);
-      Serial.println("VL53L1X Test avec ESP32");
-      while (booted == 0)
+      BaseType_t woken = pdFALSE;
+      vTaskNotifyGiveFromISR(vl53_task, &woken);
+      portYIELD_FROM_ISR(woken);
+}
+
+// Contexte de la tâche "presence" : le bus I2C reste à la tâche de mesure
+static void vl53_presence_changed(presence_state_t state, uint16_t mm)
+{
+      if (state == PRESENCE_PRESENT)
       {
-            VL53L1X_BootState(VL53L1X_I2C_ADDR, &booted);
-            delay(2);
+            vl53_scan_requested = settings_get(SET_PRESENCE_SCAN);
+            // Photo haute résolution de l'arrivée (still.trigger), prise par la tâche "still"
+            // pour ne pas retenir le filtrage
+            still_trigger();
+      }
+      else if (state == PRESENCE_ABSENT)
+      {
+            vl53_scan_requested = false;
+            vl53_sleep_requested = true;
+            xTaskNotifyGive(vl53_task);
+      }
+}
+
+// Numéro du SPAD central d'une ROI (table de l'UM2555), colonne/ligne dans la matrice
+static uint8_t vl53_spad_center(int col, int row)
+{
+      return row > 7 ? 128 + (col << 3) + (15 - row) : ((15 - col) << 3) + row;
+}
+
+// ROI de la zone (vue caméra, ligne par ligne) ou plein champ
+static void vl53_set_zone(int zone)
+{
+      if (zone == PRESENCE_ZONE_FULL)
+      {
+            VL53L1X_SetROI(VL53L1X_I2C_ADDR, VL53L1X_SPAD_GRID, VL53L1X_SPAD_GRID);
+            VL53L1X_SetROICenter(VL53L1X_I2C_ADDR, VL53L1X_SPAD_FULL_CENTER);
+            return;
+      }
+      int zw = VL53L1X_SPAD_GRID / PRESENCE_ZONE_COLS;
+      int zh = VL53L1X_SPAD_GRID / PRESENCE_ZONE_ROWS;
+      int col = zone % PRESENCE_ZONE_COLS;
+      int row = zone / PRESENCE_ZONE_COLS;
+      if (VL53L1X_ROI_MIRROR_X)
+      {
+            col = PRESENCE_ZONE_COLS - 1 - col;
+      }
+      if (VL53L1X_ROI_MIRROR_Y)
+      {
+            row = PRESENCE_ZONE_ROWS - 1 - row;
+      }
+      // Grille centrée (16 SPAD non divisibles : bords inutilisés)
+      int x0 = col * zw + (VL53L1X_SPAD_GRID - PRESENCE_ZONE_COLS * zw) / 2;
+      int y0 = row * zh + (VL53L1X_SPAD_GRID - PRESENCE_ZONE_ROWS * zh) / 2;
+      VL53L1X_SetROI(VL53L1X_I2C_ADDR, zw, zh);
+      VL53L1X_SetROICenter(VL53L1X_I2C_ADDR, vl53_spad_center(x0 + zw / 2, y0 + zh / 2));
+}
+
+static void vl53_deep_sleep()
+{
+      detachInterrupt(digitalPinToInterrupt(VL53L1X_INT_PIN));
+      // Envoi de la rafale du réveil en cours : attendre sa fin (ou son délai)
+      if (!visit_upload_wait(settings_get(SET_VISIT_UPLOAD_TIMEOUT)))
+      {
+            LOGR_W(LOG_MOD_CORE, "Envoi de la visite non terminé, mise en sommeil quand même");
       }
-      Serial.println("Capteur booté");
-      VL53L1X_SensorInit(VL53L1X_I2C_ADDR);
-      VL53L1X_SetDistanceMode(VL53L1X_I2C_ADDR, 1);
-      VL53L1X_SetTimingBudgetInMs(VL53L1X_I2C_ADDR, 50);
-      VL53L1X_SetInterMeasurementInMs(VL53L1X_I2C_ADDR, 100);
-      VL53L1X_SetInterruptPolarity(VL53L1X_I2C_ADDR, 0);
       /*
             VL53L1X_SetDistanceThreshold arguments :
                   1. Adresse I2C du capteur (ici 0x52)
@@ -40,54 +128,84 @@ inline void setupVL53L1XAndSleep()
                          3 = ABOVE   (interruption si la mesure est > seuil haut)
                   5. (optionnel) dépend du firmware/librairie (souvent 0)
 
-            Exemple pour réveil si objet détecté à moins de 50 cm :
-            VL53L1X_SetDistanceThreshold(VL53L1X_I2C_ADDR, 0, 500, 2, 0);
+            Réveil si objet détecté à moins de PRESENCE_ENTER_MM (50 cm) :
       */
-      VL53L1X_SetDistanceThreshold(VL53L1X_I2C_ADDR, 0, 500, 2, 0);
+      VL53L1X_StopRanging(VL53L1X_I2C_ADDR);
+      vl53_set_zone(PRESENCE_ZONE_FULL);
+      VL53L1X_SetDistanceThreshold(VL53L1X_I2C_ADDR, 0, PRESENCE_ENTER_MM, 2, 0);
+      VL53L1X_ClearInterrupt(VL53L1X_I2C_ADDR);
       VL53L1X_StartRanging(VL53L1X_I2C_ADDR);
 
-      // Mesure immédiate avant deep sleep
-      uint16_t distance = 0;
-      uint8_t dataReady = 0;
-      // Attendre que la mesure soit prête
-      while (dataReady == 0)
+      esp_sleep_enable_ext0_wakeup((gpio_num_t)VL53L1X_INT_PIN, 0); // wake on LOW
+      // Broche encore basse au-delà du délai : objet revenu, le réveil sera immédiat
+      for (int waited = 0; digitalRead(VL53L1X_INT_PIN) == LOW && waited < VL53L1X_SLEEP_ARM_MS; waited += 10)
+      {
+            vTaskDelay(pdMS_TO_TICKS(10));
+      }
+      LOGR_I(LOG_MOD_CORE, "Mise en deep sleep, attente d'un objet (%lu mesures perdues)", (unsigned long)presence_dropped());
+      TRACE_INSTANT("deep_sleep");
+      esp_deep_sleep_start();
+}
+
+static void vl53_ranging_task(void *arg)
+{
+      uint8_t booted = 0;
+      while (booted == 0)
       {
-            VL53L1X_CheckForDataReady(VL53L1X_I2C_ADDR, &dataReady);
-            delay(2);
+            VL53L1X_BootState(VL53L1X_I2C_ADDR, &booted);
+            vTaskDelay(pdMS_TO_TICKS(2));
       }
-      VL53L1X_GetDistance(VL53L1X_I2C_ADDR, &distance);
+      // Configuration par défaut : interruption à chaque nouvelle mesure (pas de seuil)
+      VL53L1X_SensorInit(VL53L1X_I2C_ADDR);
+      VL53L1X_SetDistanceMode(VL53L1X_I2C_ADDR, 1);
+      VL53L1X_SetTimingBudgetInMs(VL53L1X_I2C_ADDR, VL53L1X_TIMING_BUDGET_MS);
+      VL53L1X_SetInterMeasurementInMs(VL53L1X_I2C_ADDR, VL53L1X_INTERMEASUREMENT_MS);
+      VL53L1X_SetInterruptPolarity(VL53L1X_I2C_ADDR, 0);
+      pinMode(VL53L1X_INT_PIN, INPUT);
+      attachInterrupt(digitalPinToInterrupt(VL53L1X_INT_PIN), vl53_isr, FALLING);
       VL53L1X_ClearInterrupt(VL53L1X_I2C_ADDR);
-      Serial.print("Distance initiale: ");
-      Serial.print(distance);
-      Serial.println(" mm");
-      // Tant qu'un objet est présent (< 500mm), on ne dort pas
-      while (distance < 500)
+      VL53L1X_StartRanging(VL53L1X_I2C_ADDR);
+      LOGR_I(LOG_MOD_CORE, "VL53L1X: mesure sur interruption (GPIO%d)", VL53L1X_INT_PIN);
+
+      int zone = PRESENCE_ZONE_FULL;
+      for (;;)
       {
-            delay(100);
-            dataReady = 0;
-            while (dataReady == 0)
+            uint32_t notified = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(VL53L1X_IRQ_TIMEOUT_MS));
+            if (vl53_sleep_requested)
+            {
+                  vl53_deep_sleep();
+            }
+            // Délai écoulé : lecture seulement si la broche signale une mesure en attente
+            if (!notified && digitalRead(VL53L1X_INT_PIN) != LOW)
             {
-                  VL53L1X_CheckForDataReady(VL53L1X_I2C_ADDR, &dataReady);
-                  delay(2);
+                  continue;
             }
-            VL53L1X_GetDistance(VL53L1X_I2C_ADDR, &distance);
+            presence_sample_t sample = {};
+            VL53L1X_GetDistance(VL53L1X_I2C_ADDR, &sample.mm);
+            VL53L1X_GetRangeStatus(VL53L1X_I2C_ADDR, &sample.status);
             VL53L1X_ClearInterrupt(VL53L1X_I2C_ADDR);
-            Serial.print("Distance: ");
-            Serial.print(distance);
-            Serial.println(" mm (attente objet parti)");
+            sample.zone = zone;
+            sample.time_ms = millis();
+            // Zone suivante : la prochaine mesure ne démarre qu'à la fin de la période
+            // inter-mesures, la nouvelle ROI s'y applique
+            int next = vl53_scan_requested ? (zone + 1) % PRESENCE_ZONE_COUNT : PRESENCE_ZONE_FULL;
+            if (next != zone)
+            {
+                  vl53_set_zone(next);
+                  zone = next;
+            }
+            presence_push(&sample);
       }
+}
 
-      // Quand plus d'objet, on peut dormir
-      esp_sleep_enable_ext0_wakeup((gpio_num_t)VL53L1X_INT_PIN, 0); // wake on LOW
-      Serial.println("Mise en deep sleep, attente d'un objet...");
-      delay(100);
-      pinMode(13, INPUT);
-      while (digitalRead(13) == LOW)
+// Démarre le filtre de présence puis la tâche de mesure ; retourne immédiatement
+inline void setupVL53L1X()
+{
+      Wire.begin(I2C_SDA, I2C_SCL);
+      if (!presence_init(vl53_presence_changed, camera_window_follow) || task_create(TASK_RANGING, vl53_ranging_task, NULL, &vl53_task) != pdPASS)
       {
-            Serial.println("Attente que l'interruption repasse à HIGH...");
-            delay(10);
+            LOGR_E(LOG_MOD_CORE, "VL53L1X: tâche de mesure non créée");
       }
-      esp_deep_sleep_start();
 }
 
 #endif // VL53L1X_SLEEP_H
@@ -0,0 +1,219 @@
+#include "wifi_connect.h"
+#include <Arduino.h>
+#include <WiFi.h>
+#include <stddef.h>
+#include <string.h>
+#include "esp_attr.h"
+#include "log_ring.h"
+#include "settings_store.h"
+
+#define WIFI_CACHE_MAGIC 0x42574331UL // "BWC1"
+
+typedef struct
+{
+  uint32_t magic;
+  uint32_t ssid_hash; // Le cache ne vaut que pour ce SSID
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint8_t reserved;
+  uint32_t ip; // Dernier bail DHCP (0 = inconnu)
+  uint32_t gateway;
+  uint32_t netmask;
+  uint32_t dns;
+  uint32_t check; // Somme de contrôle : la RTC est aléatoire après une coupure
+} wifi_cache_t;
+
+wifi_connect_info_t wifi_connect_info;
+
+RTC_DATA_ATTR static wifi_cache_t wifi_rtc_cache;
+
+// FNV-1a
+static uint32_t wifi_hash(const void *data, size_t len)
+{
+  const uint8_t *p = (const uint8_t *)data;
+  uint32_t h = 2166136261UL;
+  for (size_t i = 0; i < len; i++)
+  {
+    h = (h ^ p[i]) * 16777619UL;
+  }
+  return h;
+}
+
+static uint32_t wifi_cache_check(const wifi_cache_t *c)
+{
+  return wifi_hash(c, offsetof(wifi_cache_t, check));
+}
+
+static bool wifi_cache_valid(const wifi_cache_t *c, uint32_t ssid_hash)
+{
+  return c->magic == WIFI_CACHE_MAGIC && c->check == wifi_cache_check(c) && c->ssid_hash == ssid_hash && c->channel > 0;
+}
+
+static bool wifi_wait(uint32_t timeout_ms)
+{
+  uint32_t start = millis();
+  while (WiFi.status() != WL_CONNECTED)
+  {
+    if (millis() - start >= timeout_ms)
+    {
+      return false;
+    }
+    delay(WIFI_POLL_MS);
+  }
+  return true;
+}
+
+// IP statique des réglages ; false si non configurée ou invalide (DHCP)
+static bool wifi_static_config()
+{
+  char ip[16], gateway[16], netmask[16], dns[16];
+  settings_get_str(SET_WIFI_IP, ip, sizeof(ip));
+  if (!ip[0])
+  {
+    return false;
+  }
+  settings_get_str(SET_WIFI_GATEWAY, gateway, sizeof(gateway));
+  settings_get_str(SET_WIFI_NETMASK, netmask, sizeof(netmask));
+  settings_get_str(SET_WIFI_DNS, dns, sizeof(dns));
+  IPAddress a, g, m, d;
+  if (!a.fromString(ip) || !g.fromString(gateway) || !m.fromString(netmask[0] ? netmask : "255.255.255.0"))
+  {
+    LOGR_W(LOG_MOD_NET, "WiFi: IP statique invalide (%s/%s/%s), DHCP", ip, gateway, netmask);
+    return false;
+  }
+  if (!d.fromString(dns))
+  {
+    d = g;
+  }
+  return WiFi.config(a, g, m, d);
+}
+
+bool wifi_connect(const char *ssid, const char *password)
+{
+  memset(&wifi_connect_info, 0, sizeof(wifi_connect_info));
+  // Pas d'écriture des identifiants en flash par le pilote à chaque connexion
+  WiFi.persistent(false);
+  WiFi.mode(WIFI_STA);
+  WiFi.setSleep(false);
+
+  // Cache : RTC après un réveil, sinon NVS
+  uint32_t ssid_hash = wifi_hash(ssid, strlen(ssid));
+  wifi_cache_t nvs_cache;
+  bool nvs_loaded = false;
+  if (!wifi_cache_valid(&wifi_rtc_cache, ssid_hash))
+  {
+    nvs_loaded = settings_blob_get(WIFI_CACHE_KEY, &nvs_cache, sizeof(nvs_cache));
+    if (nvs_loaded && wifi_cache_valid(&nvs_cache, ssid_hash))
+    {
+      wifi_rtc_cache = nvs_cache;
+    }
+    else
+    {
+      memset(&wifi_rtc_cache, 0, sizeof(wifi_rtc_cache));
+    }
+  }
+  wifi_cache_t *c = &wifi_rtc_cache;
+  bool cached = wifi_cache_valid(c, ssid_hash);
+
+  bool static_ip = wifi_static_config();
+  bool reused = false;
+  if (!static_ip && cached && c->ip && settings_get(SET_WIFI_REUSE_LEASE))
+  {
+    reused = WiFi.config(IPAddress(c->ip), IPAddress(c->gateway), IPAddress(c->netmask), IPAddress(c->dns));
+  }
+
+  uint32_t start = millis();
+  bool connected = false;
+  if (cached && settings_get(SET_WIFI_FAST_CONNECT))
+  {
+    LOGR_I(LOG_MOD_NET, "WiFi: connexion rapide '%s' canal %u %02X:%02X:%02X:%02X:%02X:%02X%s", ssid, c->channel,
+           c->bssid[0], c->bssid[1], c->bssid[2], c->bssid[3], c->bssid[4], c->bssid[5], static_ip || reused ? " (IP statique)" : "");
+    WiFi.begin(ssid, password, c->channel, c->bssid, true);
+    connected = wifi_wait(WIFI_FAST_TIMEOUT_MS);
+    if (connected)
+    {
+      wifi_connect_info.path = WIFI_PATH_FAST;
+    }
+    else
+    {
+      LOGR_W(LOG_MOD_NET, "WiFi: échec du chemin rapide après %lu ms, balayage complet", (unsigned long)(millis() - start));
+      WiFi.disconnect();
+      // Cache périmé (point d'accès déplacé ou remplacé) : la copie NVS aussi, sinon
+      // chaque démarrage à froid repaierait le délai du chemin rapide
+      memset(c, 0, sizeof(*c));
+      settings_blob_erase(WIFI_CACHE_KEY);
+      nvs_loaded = false;
+      if (reused)
+      {
+        // Le bail réutilisé n'est peut-être plus valide sur le nouveau point d'accès
+        WiFi.config(IPAddress(), IPAddress(), IPAddress());
+        reused = false;
+      }
+    }
+  }
+  if (!connected)
+  {
+    LOGR_I(LOG_MOD_NET, "WiFi: connexion '%s' (balayage)", ssid);
+    WiFi.begin(ssid, password);
+    connected = wifi_wait(WIFI_SCAN_TIMEOUT_MS);
+    wifi_connect_info.path = connected ? WIFI_PATH_SCAN : WIFI_PATH_NONE;
+  }
+  wifi_connect_info.connect_ms = millis() - start;
+  if (!connected)
+  {
+    LOGR_W(LOG_MOD_NET, "WiFi: non connecté après %lu ms", (unsigned long)wifi_connect_info.connect_ms);
+    return false;
+  }
+  wifi_connect_info.static_ip = static_ip || reused;
+  wifi_connect_info.channel = WiFi.channel();
+  LOGR_I(LOG_MOD_NET, "WiFi: connecté en %lu ms (%s), IP %s, canal %u, RSSI %d", (unsigned long)wifi_connect_info.connect_ms,
+         wifi_connect_info.path == WIFI_PATH_FAST ? "rapide" : "balayage", WiFi.localIP().toString().c_str(), wifi_connect_info.channel, WiFi.RSSI());
+
+  // Mise à jour du cache ; la NVS n'est réécrite que si le point d'accès ou le bail change
+  wifi_cache_t fresh;
+  memset(&fresh, 0, sizeof(fresh));
+  fresh.magic = WIFI_CACHE_MAGIC;
+  fresh.ssid_hash = ssid_hash;
+  const uint8_t *bssid = WiFi.BSSID();
+  if (bssid)
+  {
+    memcpy(fresh.bssid, bssid, sizeof(fresh.bssid));
+  }
+  fresh.channel = wifi_connect_info.channel;
+  if (!wifi_connect_info.static_ip)
+  {
+    fresh.ip = WiFi.localIP();
+    fresh.gateway = WiFi.gatewayIP();
+    fresh.netmask = WiFi.subnetMask();
+    fresh.dns = WiFi.dnsIP();
+  }
+  else if (reused)
+  {
+    fresh.ip = c->ip;
+    fresh.gateway = c->gateway;
+    fresh.netmask = c->netmask;
+    fresh.dns = c->dns;
+  }
+  fresh.check = wifi_cache_check(&fresh);
+  *c = fresh;
+  if (!nvs_loaded)
+  {
+    nvs_loaded = settings_blob_get(WIFI_CACHE_KEY, &nvs_cache, sizeof(nvs_cache));
+  }
+  if (!nvs_loaded || memcmp(&nvs_cache, &fresh, sizeof(fresh)) != 0)
+  {
+    settings_blob_set(WIFI_CACHE_KEY, &fresh, sizeof(fresh));
+  }
+  return true;
+}
+
+void wifi_connect_write(json_writer_t *w)
+{
+  static const char *path_names[] = {"none", "fast", "scan"};
+  json_begin_object(w);
+  json_kv_str(w, "path", path_names[wifi_connect_info.path]);
+  json_kv_bool(w, "static_ip", wifi_connect_info.static_ip);
+  json_kv_uint(w, "channel", wifi_connect_info.channel);
+  json_kv_uint(w, "connect_ms", wifi_connect_info.connect_ms);
+  json_end_object(w);
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <stdint.h>
+#include "json_writer.h"
+
+// Connexion WiFi station rapide au démarrage et au réveil.
+//  - le dernier point d'accès (BSSID, canal) et le dernier bail DHCP sont gardés en
+//    mémoire RTC (conservée en sommeil profond) et en NVS (reset, coupure) ;
+//  - chemin rapide : connexion directe au BSSID sur son canal, sans balayage complet ;
+//    avec une IP statique (réglages wifi.ip...) ou reuse_lease, pas d'échange DHCP ;
+//  - échec du chemin rapide : cache invalidé (RTC et NVS), balayage complet puis DHCP.
+// Le cache est lié au SSID : changer de réseau repasse par un balayage.
+
+#define WIFI_FAST_TIMEOUT_MS 3000   // Chemin rapide : au-delà, balayage complet
+#define WIFI_SCAN_TIMEOUT_MS 20000  // Balayage complet + DHCP
+#define WIFI_POLL_MS 10             // Scrutation de l'état de connexion
+#define WIFI_CACHE_KEY "wifi_cache" // Blob NVS (hors schéma des réglages)
+
+typedef enum
+{
+  WIFI_PATH_NONE = 0, // Non connecté
+  WIFI_PATH_FAST,     // BSSID/canal en cache
+  WIFI_PATH_SCAN,     // Balayage complet
+} wifi_path_t;
+
+typedef struct
+{
+  wifi_path_t path;
+  bool static_ip;      // IP statique (réglage ou bail réutilisé) : pas de DHCP
+  uint8_t channel;
+  uint32_t connect_ms; // Du premier WiFi.begin à l'obtention de l'adresse IP
+} wifi_connect_info_t;
+
+extern wifi_connect_info_t wifi_connect_info;
+
+// Connexion station (bloquant, WIFI_FAST_TIMEOUT_MS + WIFI_SCAN_TIMEOUT_MS au pire) ;
+// false si non connecté (l'appelant passe en point d'accès)
+bool wifi_connect(const char *ssid, const char *password);
+
+// {"path":"fast|scan|none","static_ip":..,"channel":..,"connect_ms":..}
+void wifi_connect_write(json_writer_t *w);